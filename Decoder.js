@@ -197,6 +197,155 @@ function lppDecode(bytes) {
 
 }
 
+// compactDecode decodes the compact tracker payload into the same objects as lppDecode,
+// using the LPP channels and types of the tracker, so the decoded fields do not change.
+// Byte 0 is 0xA0 | record type << 2 | version, byte 1 the map of the included fields,
+// the fields follow bit-packed MSB first:
+//  Field         Bits  Encoding                  LPP channel
+//  Latitude      28    0.000001 ° Signed         10
+//  Longitude     29    0.000001 ° Signed         10
+//  Battery       8     0.01 V, offset 2.50 V     1
+//  Temperature   11    0.1 °C, offset -40.0 °C   7
+//  Humidity      8     0.5 %RH                   6
+//  Pressure      13    0.1 hPa, offset 300.0 hPa 8
+//  Motion        2     motion state              12
+//  Range         8     number of samples         14
+//                      then min, max and mean of the temperature (18..20), humidity (15..17)
+//                      and pressure (21..23) that are in the record, in their encoding
+// The tower flag (channel 11) has no bits, it is bit 1 of the field map.
+// A track record (0xA5) has the fields of the newest fix, then byte aligned the time of the newest
+// fix (4 bytes MSB first), the number of older fixes and per older fix the zig-zag varint
+// difference of time, latitude and longitude to the next newer fix.
+// A diagnostic record (0xA9) has no field map, byte 1 is the number of values, the values are
+// unsigned varints: boots, uptime and the seconds in each energy state, all over all boots.
+// Cellular and LoRa P2P uplinks end with the Device ID as in LPP.
+function compactDecode(bytes) {
+
+	var bit = 16;
+
+	function readBits(bits, is_signed) {
+		var value = 0;
+		for (var n = 0; n < bits; n++) {
+			value = value * 2 + ((bytes[bit >> 3] >> (7 - (bit & 7))) & 1);
+			bit++;
+		}
+		if (is_signed && (value >= Math.pow(2, bits - 1))) {
+			value -= Math.pow(2, bits);
+		}
+		return value;
+	}
+
+	function push(channel, type, name, value) {
+		sensors.push({ 'channel': channel, 'type': type, 'name': name, 'value': value });
+	}
+
+	function readUnsigned() {
+		var value = 0;
+		var factor = 1;
+		while (i < bytes.length) {
+			var byte = bytes[i++];
+			value += (byte & 0x7F) * factor;
+			factor *= 128;
+			if (!(byte & 0x80)) {
+				return value;
+			}
+		}
+		throw 'Record too short!';
+	}
+
+	function readVarint() {
+		var value = readUnsigned();
+		// Zig-zag, even values are positive
+		return (value % 2) ? -(value + 1) / 2 : value / 2;
+	}
+
+	if ((bytes.length < 2) || ((bytes[0] != 0xA1) && (bytes[0] != 0xA5) && (bytes[0] != 0xA9))) {
+		throw 'Unknown compact record: ' + bytes[0];
+	}
+
+	var sensors = [];
+
+	// Energy counters of a diagnostic record
+	if (bytes[0] == 0xA9) {
+		var names = ['boots', 'uptime', 'gnss', 'sync', 'lora_tx', 'lora_rx', 'i2c', 'bme680', 'led_blue', 'led_green'];
+		var count = bytes[1];
+		var i = 2;
+		for (var n = 0; n < count; n++) {
+			push(13, 0xA9, (n < names.length) ? names[n] : 'diag' + n, readUnsigned());
+		}
+		if ((bytes.length - i == 6) && (bytes[i + 1] == 255)) {
+			push(bytes[i], 255, 'dev_id', (bytes[i + 2] << 24) | (bytes[i + 3] << 16) | (bytes[i + 4] << 8) | bytes[i + 5]);
+		}
+		return sensors;
+	}
+	var fields = bytes[1];
+	if (fields & 0x01) {
+		var gps = {
+			'latitude': readBits(28, true) / 1000000,
+			'longitude': readBits(29, true) / 1000000,
+			'altitude': 0
+		};
+		push(10, 137, 'location', "(" + gps.latitude + "," + gps.longitude + ")");
+		push(10, 137, 'altitude', 0);
+		push(10, 137, 'gps', gps);
+		push(11, 102, 'presence', (fields & 0x02) ? 1 : 0);
+	}
+	if (fields & 0x04) {
+		push(1, 116, 'voltage', (readBits(8, false) + 250) / 100);
+	}
+	if (fields & 0x08) {
+		push(7, 103, 'temperature', (readBits(11, false) - 400) / 10);
+	}
+	if (fields & 0x10) {
+		push(6, 104, 'humidity', readBits(8, false) / 2);
+	}
+	if (fields & 0x20) {
+		push(8, 115, 'barometer', (readBits(13, false) + 3000) / 10);
+	}
+	if (fields & 0x40) {
+		push(12, 0, 'digital_in', readBits(2, false));
+	}
+	// Min, max and mean of the RAK1906 samples since the last uplink
+	if (fields & 0x80) {
+		push(14, 0, 'digital_in', readBits(8, false));
+		for (var n = 0; (n < 3) && (fields & 0x08); n++) {
+			push(18 + n, 103, 'temperature', (readBits(11, false) - 400) / 10);
+		}
+		for (var n = 0; (n < 3) && (fields & 0x10); n++) {
+			push(15 + n, 104, 'humidity', readBits(8, false) / 2);
+		}
+		for (var n = 0; (n < 3) && (fields & 0x20); n++) {
+			push(21 + n, 115, 'barometer', (readBits(13, false) + 3000) / 10);
+		}
+	}
+	var i = (bit + 7) >> 3;
+
+	// Older fixes of a track record, newest first
+	if (bytes[0] == 0xA5) {
+		var time = ((bytes[i] << 24) | (bytes[i + 1] << 16) | (bytes[i + 2] << 8) | bytes[i + 3]) >>> 0;
+		var count = bytes[i + 4];
+		i += 5;
+		var fix = { 'time': time, 'latitude': gps.latitude * 1000000, 'longitude': gps.longitude * 1000000 };
+		var track = [{ 'time': fix.time, 'latitude': gps.latitude, 'longitude': gps.longitude }];
+		for (var n = 0; n < count; n++) {
+			fix.time -= readVarint();
+			fix.latitude -= readVarint();
+			fix.longitude -= readVarint();
+			track.push({ 'time': fix.time, 'latitude': Math.round(fix.latitude) / 1000000, 'longitude': Math.round(fix.longitude) / 1000000 });
+		}
+		push(10, 133, 'time', time);
+		push(10, 0xA5, 'track', track);
+	}
+
+	// Device ID of cellular and LoRa P2P uplinks
+	if ((bytes.length - i == 6) && (bytes[i + 1] == 255)) {
+		push(bytes[i], 255, 'dev_id', (bytes[i + 2] << 24) | (bytes[i + 3] << 16) | (bytes[i + 4] << 8) | bytes[i + 5]);
+	}
+
+	return sensors;
+
+}
+
 function Decoder(request, fPort) {
 
 	var decoded = {};
@@ -211,9 +360,18 @@ function Decoder(request, fPort) {
 		decoded.source = 'LoRaWAN';
 	}
 
-	// Decode from LoRaWAN payload
-	lppDecode(request, 1).forEach(function (field) {
-		if ((field['type'] == 101) || (field['type'] == 103) || (field['type'] == 104) || (field['type'] == 115)) {
+	// Decode from LoRaWAN payload, compact payloads start with 0xA0 | record type << 2 | version
+	var sensors = ((request[0] & 0xF0) == 0xA0) ? compactDecode(request) : lppDecode(request, 1);
+	// Channels of the RAK1906 samples since the last uplink
+	var range_names = {
+		14: 'samples', 15: 'humidity_min', 16: 'humidity_max', 17: 'humidity_mean', 18: 'temperature_min', 19: 'temperature_max',
+		20: 'temperature_mean', 21: 'barometer_min', 22: 'barometer_max', 23: 'barometer_mean'
+	};
+	sensors.forEach(function (field) {
+		if (field['channel'] in range_names) {
+			decoded[range_names[field['channel']]] = field['value'];
+		}
+		else if ((field['type'] == 101) || (field['type'] == 103) || (field['type'] == 104) || (field['type'] == 115)) {
 			decoded[field['name']] = field['value'];
 			decoded[field['name'] + '_' + field['channel']] = field['value'];
 		}
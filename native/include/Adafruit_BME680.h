@@ -0,0 +1,52 @@
+/**
+ * @file Adafruit_BME680.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in for the Adafruit BME680 driver, conversions take virtual time
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_ADAFRUIT_BME680_H_
+#define _HOST_ADAFRUIT_BME680_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define BME680_OS_NONE 0
+#define BME680_OS_1X 1
+#define BME680_OS_2X 2
+#define BME680_OS_4X 3
+#define BME680_OS_8X 4
+#define BME680_OS_16X 5
+
+#define BME680_FILTER_SIZE_0 0
+#define BME680_FILTER_SIZE_1 1
+#define BME680_FILTER_SIZE_3 2
+
+class Adafruit_BME680
+{
+public:
+	Adafruit_BME680(TwoWire *theWire = &Wire) { (void)theWire; }
+	bool begin(uint8_t addr = 0x77, bool initSettings = true);
+	bool setTemperatureOversampling(uint8_t os) { (void)os; return true; }
+	bool setHumidityOversampling(uint8_t os) { (void)os; return true; }
+	bool setPressureOversampling(uint8_t os) { (void)os; return true; }
+	bool setIIRFilterSize(uint8_t fs) { (void)fs; return true; }
+	bool setGasHeater(uint16_t heaterTemp, uint16_t heaterTime) { (void)heaterTemp; (void)heaterTime; return true; }
+	uint32_t beginReading(void);
+	bool endReading(void);
+	int remainingReadingMillis(void);
+	bool performReading(void);
+
+	float temperature = 0;
+	uint32_t pressure = 0;
+	float humidity = 0;
+	uint32_t gas_resistance = 0;
+
+private:
+	uint32_t _meas_end = 0;
+};
+
+#endif // _HOST_ADAFRUIT_BME680_H_
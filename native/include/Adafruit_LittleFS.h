@@ -0,0 +1,86 @@
+/**
+ * @file Adafruit_LittleFS.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in for the Adafruit LittleFS wrapper, files live in RAM
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_ADAFRUIT_LITTLEFS_H_
+#define _HOST_ADAFRUIT_LITTLEFS_H_
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Adafruit_LittleFS_Namespace
+{
+	enum
+	{
+		FILE_O_READ = 0,
+		FILE_O_WRITE = 1,
+	};
+
+	class File;
+}
+
+class Adafruit_LittleFS
+{
+public:
+	bool begin(void) { return true; }
+	bool exists(char const *filepath);
+	bool remove(char const *filepath);
+	bool rename(char const *oldfilepath, char const *newfilepath);
+	bool format(void);
+
+	// Simulation bookkeeping
+	std::map<std::string, std::vector<uint8_t>> _files;
+	uint32_t _bytes_written = 0;
+	uint32_t _commits = 0;
+	bool _full = false; // No free block, writes fail as on a full flash
+};
+
+namespace Adafruit_LittleFS_Namespace
+{
+	/**
+	 * @brief File stand-in. As on LittleFS, FILE_O_WRITE appends and
+	 *        changes become visible only on close()
+	 *
+	 */
+	class File
+	{
+	public:
+		File(Adafruit_LittleFS &fs) : _fs(&fs) {}
+		File(char const *filename, uint8_t mode, Adafruit_LittleFS &fs) : _fs(&fs) { open(filename, mode); }
+
+		bool open(char const *filename, uint8_t mode);
+		int read(void);
+		int read(void *buf, uint16_t nbyte);
+		size_t write(uint8_t ch);
+		size_t write(uint8_t const *buf, size_t size);
+		size_t write(const char *buf, size_t size) { return write((uint8_t const *)buf, size); }
+		bool seek(uint32_t pos);
+		uint32_t position(void) { return _pos; }
+		uint32_t size(void) { return (uint32_t)_data.size(); }
+		bool truncate(uint32_t pos);
+		int available(void) { return _open ? (int)(_data.size() - _pos) : 0; }
+		void flush(void);
+		void close(void);
+		bool isOpen(void) { return _open; }
+		operator bool(void) { return _open; }
+
+	private:
+		Adafruit_LittleFS *_fs;
+		std::string _name;
+		std::vector<uint8_t> _data;
+		uint32_t _pos = 0;
+		bool _open = false;
+		bool _dirty = false;
+		bool _writable = false;
+	};
+}
+
+#endif // _HOST_ADAFRUIT_LITTLEFS_H_
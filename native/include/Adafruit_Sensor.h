@@ -0,0 +1,16 @@
+/**
+ * @file Adafruit_Sensor.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in for the Adafruit unified sensor header
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_ADAFRUIT_SENSOR_H_
+#define _HOST_ADAFRUIT_SENSOR_H_
+
+#include <Arduino.h>
+
+#endif // _HOST_ADAFRUIT_SENSOR_H_
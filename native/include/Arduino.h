@@ -0,0 +1,110 @@
+/**
+ * @file Arduino.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in for the Arduino core, driven by the virtual clock of the simulation
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+// WisBlock RAK4631 pin numbers
+#define LED_GREEN 35
+#define LED_BLUE 36
+#define WB_IO1 17
+#define WB_IO2 34
+#define WB_IO5 9
+#define WB_IO6 10
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode);
+void detachInterrupt(uint32_t pin);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+/**
+ * @brief Minimal Arduino String, only what the application uses
+ *
+ */
+class String
+{
+public:
+	String(void) {}
+	String(const char *str) : _str(str ? str : "") {}
+	const char *c_str(void) const { return _str.c_str(); }
+	unsigned int length(void) const { return (unsigned int)_str.length(); }
+	int indexOf(const String &str) const
+	{
+		size_t pos = _str.find(str._str);
+		return pos == std::string::npos ? -1 : (int)pos;
+	}
+	int indexOf(const char *str) const { return indexOf(String(str)); }
+
+private:
+	std::string _str;
+};
+
+/** nRF52 POWER peripheral, only the USB supply detection */
+struct host_nrf_power
+{
+	uint32_t USBREGSTATUS;
+};
+extern host_nrf_power *NRF_POWER;
+#define POWER_USBREGSTATUS_VBUSDETECT_Msk (0x1UL)
+
+/**
+ * @brief Serial port stand-in, output goes to stdout only if the simulation is verbose
+ *
+ */
+class HostSerial
+{
+public:
+	void begin(uint32_t baud) { (void)baud; }
+	operator bool(void) { return true; }
+	int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+	size_t print(const char *str);
+	size_t println(const char *str = "");
+	size_t write(uint8_t data);
+	int available(void) { return 0; }
+	int read(void) { return -1; }
+	void flush(void) {}
+};
+
+extern HostSerial Serial;
+
+#endif // _HOST_ARDUINO_H_
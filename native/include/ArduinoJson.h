@@ -0,0 +1,14 @@
+/**
+ * @file ArduinoJson.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in, the application does not use ArduinoJson directly
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_ARDUINOJSON_H_
+#define _HOST_ARDUINOJSON_H_
+
+#endif // _HOST_ARDUINOJSON_H_
@@ -0,0 +1,22 @@
+/**
+ * @file InternalFileSystem.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in for the nRF52 internal flash file system
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_INTERNAL_FILESYSTEM_H_
+#define _HOST_INTERNAL_FILESYSTEM_H_
+
+#include <Adafruit_LittleFS.h>
+
+class InternalFileSystem : public Adafruit_LittleFS
+{
+};
+
+extern InternalFileSystem InternalFS;
+
+#endif // _HOST_INTERNAL_FILESYSTEM_H_
@@ -0,0 +1,42 @@
+/**
+ * @file Wire.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in for the Arduino I2C driver
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_WIRE_H_
+#define _HOST_WIRE_H_
+
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+	void begin(void) {}
+	void setClock(uint32_t clock) { _clock = clock; }
+	uint32_t getClock(void) { return _clock; }
+	void beginTransmission(uint8_t address);
+	size_t write(uint8_t data);
+	size_t write(const uint8_t *data, size_t len);
+	uint8_t endTransmission(bool stop = true);
+	uint8_t requestFrom(uint8_t address, size_t len, bool stop = true);
+	int available(void);
+	int read(void);
+
+private:
+	uint32_t _clock = 100000;
+	uint8_t _address = 0;
+	uint8_t _tx_buf[64];
+	size_t _tx_len = 0;
+	uint8_t _rx_buf[64];
+	size_t _rx_len = 0;
+	size_t _rx_pos = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // _HOST_WIRE_H_
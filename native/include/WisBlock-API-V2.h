@@ -0,0 +1,251 @@
+/**
+ * @file WisBlock-API-V2.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in for the parts of WisBlock-API-V2 used by the application
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_WISBLOCK_API_H_
+#define _HOST_WISBLOCK_API_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Debug output of the API is never enabled on the host
+#define API_LOG(...)
+#define PRINTF(...) Serial.printf(__VA_ARGS__)
+
+/*********************************************************************/
+/* FreeRTOS / nRF52 core timer                                       */
+/*********************************************************************/
+typedef void *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+#define tskIDLE_PRIORITY 0
+typedef void *SemaphoreHandle_t;
+#define pdPASS 1
+#define pdTRUE 1
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdMS_TO_TICKS(ms) (ms)
+
+// Tasks are not run on the host, the simulation calls their work from the loop
+long xTaskCreate(TaskFunction_t task, const char *name, uint16_t stack, void *arg, uint32_t priority, TaskHandle_t *handle);
+void vTaskDelay(uint32_t ticks);
+
+// Only one task runs on the host, semaphores and mutexes never block
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+long xSemaphoreGive(SemaphoreHandle_t semaphore);
+long xSemaphoreTake(SemaphoreHandle_t semaphore, uint32_t ticks);
+long xSemaphoreGiveRecursive(SemaphoreHandle_t mutex);
+long xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, uint32_t ticks);
+
+/**
+ * @brief SoftwareTimer stand-in, expires on the virtual clock
+ *
+ */
+class SoftwareTimer
+{
+public:
+	SoftwareTimer(void);
+	~SoftwareTimer(void);
+	void begin(uint32_t ms, TimerCallbackFunction_t callback, void *timerID = NULL, bool repeating = true);
+	void start(void);
+	void stop(void);
+	void reset(void);
+	void setPeriod(uint32_t ms);
+
+	// Simulation bookkeeping
+	uint32_t _period = 0;
+	uint32_t _expires = 0;
+	bool _active = false;
+	bool _repeating = true;
+	TimerCallbackFunction_t _callback = NULL;
+	void *_id = NULL;
+};
+
+/*********************************************************************/
+/* Wake up events                                                    */
+/*********************************************************************/
+#define NO_EVENT 0
+#define STATUS 0b0000000000000001
+#define N_STATUS 0b1111111111111110
+#define BLE_CONFIG 0b0000000000000010
+#define N_BLE_CONFIG 0b1111111111111101
+#define BLE_DATA 0b0000000000000100
+#define N_BLE_DATA 0b1111111111111011
+#define LORA_DATA 0b0000000000001000
+#define N_LORA_DATA 0b1111111111110111
+#define LORA_TX_FIN 0b0000000000010000
+#define N_LORA_TX_FIN 0b1111111111101111
+#define AT_CMD 0b0000000000100000
+#define N_AT_CMD 0b1111111111011111
+#define LORA_JOIN_FIN 0b0000000001000000
+#define N_LORA_JOIN_FIN 0b1111111110111111
+
+extern volatile uint16_t g_task_event_type;
+void api_wake_loop(uint16_t reason);
+void api_set_version(uint16_t sw_1 = 1, uint16_t sw_2 = 0, uint16_t sw_3 = 0);
+void api_timer_start(void);
+void api_timer_stop(void);
+void api_timer_restart(uint32_t new_time);
+
+/*********************************************************************/
+/* LoRaWAN                                                           */
+/*********************************************************************/
+struct s_lorawan_settings
+{
+	uint8_t valid_mark_1 = 0xAA;
+	uint8_t valid_mark_2 = 0x55;
+	uint8_t node_device_eui[8] = {0xAC, 0x1F, 0x09, 0xFF, 0xFE, 0x03, 0xEF, 0xDC};
+	uint8_t node_app_eui[8] = {0};
+	uint8_t node_app_key[16] = {0};
+	uint32_t node_dev_addr = 0;
+	uint8_t node_nws_key[16] = {0};
+	uint8_t node_apps_key[16] = {0};
+	bool otaa_enabled = true;
+	bool adr_enabled = false;
+	bool public_network = true;
+	bool duty_cycle_enabled = false;
+	uint32_t send_repeat_time = 600000;
+	uint8_t join_trials = 5;
+	uint8_t tx_power = 0;
+	uint8_t data_rate = 3;
+	uint8_t lora_class = 0;
+	uint8_t subband_channels = 1;
+	bool auto_join = true;
+	uint8_t app_port = 2;
+	bool confirmed_msg_enabled = true;
+	uint8_t lora_region = 4;
+	bool lorawan_enable = true;
+};
+
+typedef enum
+{
+	LMH_SUCCESS = 0,
+	LMH_BUSY = -1,
+	LMH_ERROR = -2,
+} lmh_error_status;
+
+extern s_lorawan_settings g_lorawan_settings;
+extern bool g_lpwan_has_joined;
+extern bool g_join_result;
+extern bool g_rx_fin_result;
+extern uint8_t g_rx_lora_data[256];
+extern uint16_t g_rx_data_len;
+extern int16_t g_last_rssi;
+extern int8_t g_last_snr;
+
+int8_t init_lorawan(bool region_change = false);
+int8_t re_init_lorawan(void);
+lmh_error_status send_lora_packet(uint8_t *data, uint8_t size, uint8_t fport = 0);
+bool send_p2p_packet(uint8_t *data, uint8_t size);
+void lmh_join(void);
+
+/*********************************************************************/
+/* BLE                                                               */
+/*********************************************************************/
+class BLEUart
+{
+public:
+	int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+	int available(void) { return 0; }
+	int read(void) { return -1; }
+};
+
+extern bool g_enable_ble;
+extern bool g_ble_uart_is_connected;
+extern BLEUart g_ble_uart;
+extern char g_ble_dev_name[];
+void restart_advertising(uint16_t timeout);
+
+/*********************************************************************/
+/* Misc                                                              */
+/*********************************************************************/
+float read_batt(void);
+
+/*********************************************************************/
+/* AT commands                                                       */
+/*********************************************************************/
+#define ATQUERY_SIZE 128
+
+#define AT_SUCCESS (0)
+#define AT_ERRNO_NOSUPP (1)
+#define AT_ERRNO_NOALLOW (2)
+#define AT_ERRNO_PARA_VAL (5)
+#define AT_ERRNO_PARA_NUM (6)
+#define AT_ERRNO_EXEC_FAIL (7)
+#define AT_ERRNO_SYS (8)
+#define AT_CB_PRINT (0xFF)
+
+#define AT_PRINTF(...)                \
+	do                                \
+	{                                 \
+		Serial.printf(__VA_ARGS__);   \
+		Serial.printf("\r\n");        \
+	} while (0)
+
+typedef struct atcmd_s
+{
+	const char *cmd_name;
+	const char *cmd_desc;
+	int (*query_cmd)(void);
+	int (*exec_cmd)(char *str);
+	int (*exec_cmd_no_para)(void);
+	const char *permission;
+} atcmd_t;
+
+extern char g_at_query_buf[ATQUERY_SIZE];
+extern atcmd_t *g_user_at_cmd_list;
+extern uint8_t g_user_at_cmd_num;
+void at_serial_input(uint8_t cmd);
+
+/*********************************************************************/
+/* Cayenne LPP                                                       */
+/*********************************************************************/
+#define LPP_DIGITAL_INPUT 0
+#define LPP_DIGITAL_OUTPUT 1
+#define LPP_ANALOG_INPUT 2
+#define LPP_PRESENCE 102
+#define LPP_TEMPERATURE 103
+#define LPP_RELATIVE_HUMIDITY 104
+#define LPP_BAROMETRIC_PRESSURE 115
+#define LPP_VOLTAGE 116
+#define LPP_GPS6 137
+#define LPP_DEVID 255
+
+#define LPP_CHANNEL_DEVID 255
+
+/**
+ * @brief Cayenne LPP encoder with the RAKwireless extensions
+ *
+ */
+class WisCayenne
+{
+public:
+	WisCayenne(uint8_t size);
+	~WisCayenne(void);
+	void reset(void);
+	uint8_t getSize(void);
+	uint8_t *getBuffer(void);
+	uint8_t addDigitalInput(uint8_t channel, uint32_t value);
+	uint8_t addAnalogInput(uint8_t channel, float value);
+	uint8_t addPresence(uint8_t channel, uint32_t value);
+	uint8_t addTemperature(uint8_t channel, float celsius);
+	uint8_t addRelativeHumidity(uint8_t channel, float rh);
+	uint8_t addBarometricPressure(uint8_t channel, float hpa);
+	uint8_t addVoltage(uint8_t channel, float voltage);
+	uint8_t addGNSS_6(uint8_t channel, int32_t latitude, int32_t longitude, int32_t altitude);
+	uint8_t addDevID(uint8_t channel, uint8_t *dev_id);
+
+private:
+	uint8_t *_buffer;
+	uint8_t _maxsize;
+	uint8_t _cursor;
+};
+
+#endif // _HOST_WISBLOCK_API_H_
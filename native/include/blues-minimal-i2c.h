@@ -0,0 +1,74 @@
+/**
+ * @file blues-minimal-i2c.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host stand-in for the Blues-Minimal-I2C library, talks to the simulated NoteCard
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_BLUES_MINIMAL_I2C_H_
+#define _HOST_BLUES_MINIMAL_I2C_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <string>
+#include <vector>
+
+#define NOTE_I2C_ADDR_DEFAULT 0x17
+
+/**
+ * @brief Same API as the Blues-Minimal-I2C class. The request is collected as JSON text
+ *        and handed to the simulated NoteCard, the response is kept as JSON text and
+ *        searched by the get_* functions.
+ *
+ */
+class RAK_BLUES
+{
+public:
+	RAK_BLUES(byte addr = NOTE_I2C_ADDR_DEFAULT) { (void)addr; }
+
+	bool start_req(char *request);
+	bool send_req(char *response = NULL, uint16_t resp_len = 0);
+
+	void add_string_entry(char *type, char *value);
+	void add_bool_entry(char *type, bool value);
+	void add_int32_entry(char *type, int32_t value);
+	void add_uint32_entry(char *type, uint32_t value);
+	void add_float_entry(char *type, float value);
+	void add_nested_string_entry(char *type, char *nested, char *value);
+	void add_nested_int32_entry(char *type, char *nested, int32_t value);
+	void add_nested_uint32_entry(char *type, char *nested, uint32_t value);
+	void add_nested_bool_entry(char *type, char *nested, bool value);
+
+	bool has_entry(char *type);
+	bool has_nested_entry(char *type, char *nested);
+	bool get_string_entry(char *type, char *value, uint16_t value_size);
+	bool get_string_entry_from_array(char *type, char *value, uint16_t value_size);
+	bool get_bool_entry(char *type, bool &value);
+	bool get_int32_entry(char *type, int32_t &value);
+	bool get_uint32_entry(char *type, uint32_t &value);
+	bool get_float_entry(char *type, float &value);
+	bool get_nested_string_entry(char *type, char *nested, char *value, uint16_t value_size);
+	bool get_nested_int32_entry(char *type, char *nested, int32_t &value);
+	bool get_nested_uint32_entry(char *type, char *nested, uint32_t &value);
+	bool get_nested_bool_entry(char *type, char *nested, bool &value);
+
+	size_t myJB64Encode(char *encoded, const char *string, size_t len);
+
+	// Host only, load a response without a transaction for the benchmarks
+	void sim_set_response(const char *response) { _response = response; }
+
+private:
+	void add_raw_entry(const char *type, const std::string &value);
+	void add_raw_nested_entry(const char *type, const char *nested, const std::string &value);
+	bool find_value(const char *type, const char *nested, std::string &raw);
+
+	std::string _req_name;
+	std::string _req_body;
+	std::vector<std::pair<std::string, std::string>> _nested;
+	std::string _response;
+};
+
+#endif // _HOST_BLUES_MINIMAL_I2C_H_
@@ -0,0 +1,46 @@
+/**
+ * @file host_bench.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Benchmarks and tools of the native host build
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_BENCH_H_
+#define _HOST_BENCH_H_
+
+#include <stdint.h>
+
+/** Signature of a benchmark or tool, gets the key=value arguments after its name */
+typedef int (*bench_fn_t)(int argc, char **argv);
+
+/** Entry of the benchmark list */
+struct s_bench
+{
+	const char *name;
+	const char *desc;
+	bench_fn_t run;
+};
+
+// Argument helpers, arguments are given as key=value
+uint32_t bench_arg_u32(int argc, char **argv, const char *key, uint32_t def_value);
+const char *bench_arg_str(int argc, char **argv, const char *key, const char *def_value);
+void bench_apply_sim_args(int argc, char **argv);
+void bench_run_cycles(uint32_t cycles);
+
+// Benchmarks
+int bench_cycle(int argc, char **argv);
+int bench_capture(int argc, char **argv);
+int bench_replay(int argc, char **argv);
+int bench_serializer(int argc, char **argv);
+int bench_parser(int argc, char **argv);
+int bench_deadband(int argc, char **argv);
+int bench_codec(int argc, char **argv);
+int bench_log(int argc, char **argv);
+int bench_events(int argc, char **argv);
+int bench_config(int argc, char **argv);
+int bench_settings(int argc, char **argv);
+
+#endif // _HOST_BENCH_H_
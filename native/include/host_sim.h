@@ -0,0 +1,133 @@
+/**
+ * @file host_sim.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Virtual clock, simulated NoteCard and LoRaWAN link for the native host build
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _HOST_SIM_H_
+#define _HOST_SIM_H_
+
+#include <Arduino.h>
+#include <string>
+
+/** Knobs for a simulation run */
+struct s_sim_config
+{
+	uint32_t seed = 1;						 // Seed for the simulation PRNG
+	bool verbose = false;					 // Print Serial output to stdout
+	uint32_t gnss_ttff_ms = 35000;			 // Time to first fix after GNSS is switched on
+	uint8_t gnss_fix_percent = 100;			 // Chance that a GNSS window gets a fix at all
+	uint32_t motion_period_ms = 0;			 // Average time between motion events, 0 = never moves
+	uint32_t trip_ms = 0;					 // Length of a trip, motion events only during trips, 0 = always
+	uint32_t park_ms = 0;					 // Time parked between two trips
+	uint8_t card_fail_percent = 0;			 // Chance that a NoteCard transaction fails on I2C
+	uint8_t card_mute_percent = 0;			 // Chance that a streamed request is never answered
+	uint32_t card_boot_ms = 0;				 // NoteCard NAKs all requests until this time after the power-up
+	uint8_t lora_ack_percent = 100;			 // Chance that a confirmed LoRaWAN uplink is ACK'ed
+	uint8_t lora_downlink_percent = 0;		 // Chance that an unconfirmed LoRaWAN uplink gets a downlink
+	bool lora_joinable = true;				 // LoRaWAN join succeeds
+	double lat = 35.6812362;				 // Position reported by GNSS
+	double lon = 139.7671248;				 // Position reported by GNSS
+	char country[3] = "JP";					 // Country reported by card.time
+	char card_device[24] = "dev:860322068073292"; // Device ID of the NoteCard
+	char border_country[3] = "";			 // Country of a second tower near a border
+	uint8_t border_percent = 0;				 // Chance that card.time reports the tower of border_country
+	uint32_t i2c_us_per_byte = 90;			 // I2C transfer time per byte at 100kHz
+	uint32_t card_latency_ms = 25;			 // NoteCard processing time per request
+	uint32_t card_sync_latency_ms = 60;		 // NoteCard processing time for hub.sync and note.add with sync
+	uint32_t card_sync_session_ms = 20000;	 // Length of the background NoteHub sync session
+	uint32_t bme_conversion_ms = 190;		 // BME680 conversion time
+	uint32_t lora_tx_cycle_ms = 2500;		 // LoRaWAN TX + RX windows
+	uint32_t outage_start_ms = 0;			 // Start of a link outage, no LoRaWAN ACK and note.add fails
+	uint32_t outage_end_ms = 0;				 // End of the link outage
+};
+
+/** Counters collected during a simulation run */
+struct s_sim_stats
+{
+	uint32_t transactions = 0;	 // NoteCard requests sent
+	uint32_t failed = 0;		 // NoteCard requests failed on I2C
+	uint32_t bytes_tx = 0;		 // Bytes sent to the NoteCard
+	uint32_t bytes_rx = 0;		 // Bytes received from the NoteCard
+	uint64_t card_busy_us = 0;	 // Time spent in NoteCard transactions
+	uint64_t handler_us = 0;	 // Time spent inside the application event handlers
+	uint64_t worker_us = 0;		 // Time spent in the NoteCard worker jobs
+	uint32_t status_events = 0;	 // STATUS (timer) events handled
+	uint32_t gnss_fixes = 0;	 // GNSS fixes produced by the card
+	uint64_t gnss_on_us = 0;	 // Time the GNSS was in continuous mode
+	uint32_t attn_irqs = 0;		 // ATTN interrupts raised by the card
+	uint32_t notes_added = 0;	 // note.add requests
+	uint32_t notes_failed = 0;	 // note.add requests rejected during an outage
+	uint32_t hub_syncs = 0;		 // hub.sync and note.add with sync:true
+	uint32_t hub_sets = 0;		 // hub.set requests
+	uint32_t wireless_sets = 0;	 // card.wireless with a SIM selection, restarts the modem
+	uint32_t lora_tx = 0;		 // LoRaWAN uplinks enqueued
+	uint32_t lora_ack = 0;		 // LoRaWAN uplinks ACK'ed
+	uint32_t lora_size_err = 0;	 // LoRaWAN uplinks rejected for size
+	uint32_t lora_bytes = 0;	 // LoRaWAN payload bytes sent
+	uint32_t region_changes = 0; // init_lorawan(true) calls
+	uint32_t app_events = 0;	 // Wake ups of the application
+};
+
+extern s_sim_config g_sim_config;
+extern s_sim_stats g_sim_stats;
+
+// Virtual clock
+uint64_t sim_now_us(void);
+void sim_advance_us(uint64_t us);
+bool sim_advance_to_next_event(uint64_t limit_us);
+
+// Simulated hardware
+/** I2C address of the simulated NoteCard */
+#define SIM_CARD_I2C_ADDR 0x17
+bool sim_link_outage(void);
+void sim_reset(void);
+void sim_reset_hardware(void);
+void sim_reset_card(void);
+void sim_reset_lorawan(void);
+void sim_raise_interrupt(uint32_t pin);
+std::string sim_card_transaction(const std::string &request);
+uint8_t sim_card_i2c_write(const uint8_t *data, size_t len);
+size_t sim_card_i2c_read(uint8_t *data, size_t len);
+uint64_t sim_card_next_event_us(void);
+void sim_card_process_events(void);
+uint64_t sim_timer_next_expiry_us(void);
+void sim_timer_process_expired(void);
+
+// Application loop as the WisBlock API runs it
+void sim_boot(void);
+void sim_reboot(void);
+void sim_dispatch_events(void);
+int sim_at_command(const char *cmd);
+
+// Replay of a recorded NoteCard transcript
+struct s_replay_record
+{
+	uint32_t start_ms;
+	uint32_t duration_ms;
+	bool success;
+	std::string req;
+	std::string request;
+	std::string response;
+};
+
+bool sim_replay_load(const char *path);
+bool sim_replay_active(void);
+void sim_replay_stop(void);
+size_t sim_replay_cursor(void);
+size_t sim_replay_count(void);
+uint32_t sim_replay_mismatches(void);
+uint32_t sim_replay_body_matches(void);
+const s_replay_record *sim_replay_record(size_t idx);
+void sim_replay_skip(void);
+bool sim_replay_answer(const std::string &request, std::string &response, uint32_t &duration_ms);
+
+// JSON helpers shared by the simulated NoteCard and the RAK_BLUES stand-in
+bool sim_json_find(const std::string &json, const char *key, std::string &raw);
+std::string sim_json_unquote(const std::string &raw);
+
+#endif // _HOST_SIM_H_
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Decode the binary debug log of the tracker.
+
+With AT+BLOG=1 the firmware sends every log record as a line "LOG:" followed by
+the 32 bit words of the record in hex. Tag and format are only stored as
+addresses, this script reads the strings from the firmware ELF file and prints
+the same text as the text mode.
+
+Usage: python3 log_decode.py firmware.elf log.txt
+       Lines that do not start with "LOG:" are printed unchanged.
+
+Record: [0xA5 | count | words] [types] [time ms] [tag] [format] [arguments]
+Types has 2 bits per argument: 0 = integer (1 word), 1 = double (2 words),
+2 = string (with terminating 0, padded to full words).
+"""
+
+import re
+import struct
+import sys
+
+ARG_INT = 0
+ARG_DOUBLE = 1
+ARG_STR = 2
+LOG_COMMIT = 0xA5
+
+
+class Elf32:
+    """Loaded sections of a 32 bit little endian ELF file."""
+
+    def __init__(self, path):
+        with open(path, "rb") as elf_file:
+            self.data = elf_file.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError(path + " is not a 32 bit little endian ELF file")
+        sh_off, = struct.unpack_from("<I", self.data, 0x20)
+        sh_entsize, sh_num = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for idx in range(sh_num):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                "<IIIIII", self.data, sh_off + idx * sh_entsize)
+            # Allocated sections with content, .rodata, .text and .data
+            if sh_type == 1 and (flags & 2) and size != 0:
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        """String at an address of the firmware."""
+        for (addr, offset, size) in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.index(b"\0", start, offset + size)
+                return self.data[start:end].decode("latin-1")
+        return "<0x%08X>" % address
+
+
+# Conversion of printf, the length modifier is removed
+SPEC = re.compile(r"%([-+ #0]*[0-9]*(?:\.[0-9]*)?)(?:hh|h|ll|l|z|j|t|L)?([diouxXcsfFeEgGaAp%])")
+
+
+def format_record(elf, words):
+    """Text of one record, the same as printf on the device."""
+    count = (words[0] >> 16) & 0xFF
+    types = words[1]
+    args = []
+    pos = 5
+    for arg in range(count):
+        arg_type = (types >> (2 * arg)) & 3
+        if arg_type == ARG_DOUBLE:
+            args.append(struct.unpack("<d", struct.pack("<II", words[pos], words[pos + 1]))[0])
+            pos += 2
+        elif arg_type == ARG_STR:
+            raw = b""
+            while pos < len(words):
+                raw += struct.pack("<I", words[pos])
+                pos += 1
+                if b"\0" in raw:
+                    break
+            args.append(raw.split(b"\0")[0].decode("latin-1"))
+        else:
+            args.append(words[pos])
+            pos += 1
+
+    def convert(match):
+        flags, conversion = match.group(1), match.group(2)
+        if conversion == "%":
+            return "%"
+        if not args:
+            return "?"
+        value = args.pop(0)
+        if isinstance(value, str):
+            return ("%" + flags + "s") % value
+        if conversion in "di":
+            value = value - (1 << 32) if value >= 1 << 31 else value
+            return ("%" + flags + "d") % value
+        if conversion in "fFeEgGaA":
+            return ("%" + flags + conversion.replace("a", "e").replace("A", "E")) % float(value)
+        if conversion == "c":
+            return chr(value & 0xFF)
+        if conversion == "s":
+            return "?"
+        if conversion == "p":
+            return "0x%x" % value
+        return ("%" + flags + conversion) % int(value)
+
+    tag = elf.string(words[3])
+    text = SPEC.sub(convert, elf.string(words[4]))
+    return "[%s] %s" % (tag, text)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("Usage: python3 log_decode.py firmware.elf log.txt")
+        return 1
+    elf = Elf32(sys.argv[1])
+    with open(sys.argv[2], "r", errors="replace") as log_file:
+        for line in log_file:
+            line = line.rstrip("\r\n")
+            if not line.startswith("LOG:"):
+                print(line)
+                continue
+            hex_words = line[4:].strip()
+            words = [int(hex_words[idx:idx + 8], 16) for idx in range(0, len(hex_words) - 7, 8)]
+            if len(words) < 5 or (words[0] >> 24) != LOG_COMMIT or (words[0] & 0xFFFF) != len(words):
+                print("Invalid record: " + line)
+                continue
+            print("%10.3f %s" % (words[2] / 1000.0, format_record(elf, words)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
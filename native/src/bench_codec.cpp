@@ -0,0 +1,426 @@
+/**
+ * @file bench_codec.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Round trip of the compact payload codec and size of the tracker uplinks
+ *        in Cayenne LPP and in the compact format
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+
+/** Uplink types of the tracker */
+struct s_codec_packet
+{
+	const char *name;
+	uint16_t fields;
+};
+
+static const s_codec_packet codec_packets[] = {
+	{"battery only", PAYLOAD_HAS_BATTERY},
+	{"location", PAYLOAD_HAS_POSITION | PAYLOAD_HAS_BATTERY},
+	{"location, tower", PAYLOAD_HAS_POSITION | PAYLOAD_HAS_TOWER | PAYLOAD_HAS_BATTERY},
+	{"location, motion", PAYLOAD_HAS_POSITION | PAYLOAD_HAS_BATTERY | PAYLOAD_HAS_MOTION},
+	{"location, RAK1906", PAYLOAD_HAS_POSITION | PAYLOAD_HAS_BATTERY | PAYLOAD_HAS_TEMPERATURE | PAYLOAD_HAS_HUMIDITY | PAYLOAD_HAS_PRESSURE},
+	{"RAK1906 samples", PAYLOAD_HAS_POSITION | PAYLOAD_HAS_BATTERY | PAYLOAD_HAS_TEMPERATURE | PAYLOAD_HAS_HUMIDITY | PAYLOAD_HAS_PRESSURE | PAYLOAD_HAS_RANGE},
+	{"all, cellular DevID", 0xFF | PAYLOAD_HAS_DEVID},
+};
+
+/** Smallest maximum payloads of the regions, DR0 */
+#define CODEC_US915_DR0 11
+#define CODEC_EU868_DR0 51
+
+/**
+ * @brief Random values in the range of the fields
+ *
+ */
+static void codec_random_values(s_payload_fields *values, uint16_t fields)
+{
+	values->fields = fields;
+	values->lat = (int32_t)random(-90000000L, 90000001L);
+	values->lon = (int32_t)random(-180000000L, 180000001L);
+	values->battery = (uint16_t)random(250, 506);
+	values->temperature = (int16_t)random(-400, 1648);
+	values->humidity = (uint8_t)random(0, 201);
+	values->pressure = (uint16_t)random(3000, 11001);
+	values->motion = (uint8_t)random(0, 3);
+	for (uint8_t idx = 0; idx < 4; idx++)
+	{
+		values->dev_id[idx] = (uint8_t)random(0, 256);
+	}
+	values->range_count = (uint8_t)random(2, 256);
+	for (uint8_t idx = 0; idx < 3; idx++)
+	{
+		values->temperature_range[idx] = (int16_t)random(-400, 1648);
+		values->humidity_range[idx] = (uint8_t)random(0, 201);
+		values->pressure_range[idx] = (uint16_t)random(3000, 11001);
+	}
+}
+
+/**
+ * @brief Compare the fields included in the field map
+ *
+ */
+static bool codec_equal(const s_payload_fields *a, const s_payload_fields *b)
+{
+	uint16_t fields = a->fields;
+	if (fields != b->fields)
+	{
+		return false;
+	}
+	if ((fields & PAYLOAD_HAS_POSITION) && ((a->lat != b->lat) || (a->lon != b->lon)))
+	{
+		return false;
+	}
+	if ((fields & PAYLOAD_HAS_BATTERY) && (a->battery != b->battery))
+	{
+		return false;
+	}
+	if ((fields & PAYLOAD_HAS_TEMPERATURE) && (a->temperature != b->temperature))
+	{
+		return false;
+	}
+	if ((fields & PAYLOAD_HAS_HUMIDITY) && (a->humidity != b->humidity))
+	{
+		return false;
+	}
+	if ((fields & PAYLOAD_HAS_PRESSURE) && (a->pressure != b->pressure))
+	{
+		return false;
+	}
+	if ((fields & PAYLOAD_HAS_MOTION) && (a->motion != b->motion))
+	{
+		return false;
+	}
+	if ((fields & PAYLOAD_HAS_DEVID) && (memcmp(a->dev_id, b->dev_id, 4) != 0))
+	{
+		return false;
+	}
+	if ((fields & PAYLOAD_HAS_RANGE) && (a->range_count != b->range_count))
+	{
+		return false;
+	}
+	for (uint8_t idx = 0; (idx < 3) && (fields & PAYLOAD_HAS_RANGE); idx++)
+	{
+		if (((fields & PAYLOAD_HAS_TEMPERATURE) && (a->temperature_range[idx] != b->temperature_range[idx])) ||
+			((fields & PAYLOAD_HAS_HUMIDITY) && (a->humidity_range[idx] != b->humidity_range[idx])) ||
+			((fields & PAYLOAD_HAS_PRESSURE) && (a->pressure_range[idx] != b->pressure_range[idx])))
+		{
+			return false;
+		}
+	}
+	if ((fields & PAYLOAD_HAS_TRACK) && (a->time != b->time))
+	{
+		return false;
+	}
+	// A track that was limited by the size keeps the newest fixes
+	for (uint8_t idx = 0; idx < b->track_count; idx++)
+	{
+		if ((a->track[idx].lat != b->track[idx].lat) || (a->track[idx].lon != b->track[idx].lon) ||
+			(a->track[idx].time != b->track[idx].time))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Random track of a moving asset, fixes every 30 seconds to 10 minutes, up to 50 m/s
+ *
+ */
+static void codec_random_track(s_payload_fields *values, uint8_t count)
+{
+	values->fields |= PAYLOAD_HAS_TRACK | PAYLOAD_HAS_POSITION;
+	values->time = (uint32_t)random(1700000000L, 1900000000L);
+	s_track_fix newer = {values->lat, values->lon, values->time};
+	for (uint8_t idx = 0; idx < count; idx++)
+	{
+		int32_t interval = (int32_t)random(30, 601);
+		// 1e-6 degrees latitude are ~0.11 m
+		int32_t range = interval * 450;
+		newer.time -= interval;
+		newer.lat -= (int32_t)random(-range, range + 1);
+		newer.lon -= (int32_t)random(-range, range + 1);
+		values->track[idx] = newer;
+	}
+	values->track_count = count;
+}
+
+/**
+ * @brief Add the values the same way as the application does
+ *
+ */
+static void codec_fill(TrackerPayload *payload, const s_payload_fields *values)
+{
+	payload->reset();
+	uint16_t fields = values->fields;
+	if (fields & PAYLOAD_HAS_MOTION)
+	{
+		payload->addDigitalInput(LPP_CHANNEL_MOTION, values->motion);
+	}
+	if (fields & PAYLOAD_HAS_POSITION)
+	{
+		payload->addGNSS_6(LPP_CHANNEL_GPS, values->lat * 10, values->lon * 10, 0);
+		payload->addPresence(LPP_CHANNEL_GPS_TOWER, (fields & PAYLOAD_HAS_TOWER) ? 1 : 0);
+	}
+	if (fields & PAYLOAD_HAS_HUMIDITY)
+	{
+		payload->addRelativeHumidity(LPP_CHANNEL_HUMID_2, values->humidity / 2.0);
+	}
+	if (fields & PAYLOAD_HAS_TEMPERATURE)
+	{
+		payload->addTemperature(LPP_CHANNEL_TEMP_2, values->temperature / 10.0);
+	}
+	if (fields & PAYLOAD_HAS_PRESSURE)
+	{
+		payload->addBarometricPressure(LPP_CHANNEL_PRESS_2, values->pressure / 10.0);
+	}
+	if (fields & PAYLOAD_HAS_BATTERY)
+	{
+		payload->addVoltage(LPP_CHANNEL_BATT, values->battery / 100.0);
+	}
+	if (fields & PAYLOAD_HAS_RANGE)
+	{
+		payload->addSampleCount(LPP_CHANNEL_ENV_COUNT, values->range_count);
+		payload->addRange(LPP_CHANNEL_TEMP_2, values->temperature_range[0] / 10.0, values->temperature_range[1] / 10.0,
+						  values->temperature_range[2] / 10.0);
+		payload->addRange(LPP_CHANNEL_HUMID_2, values->humidity_range[0] / 2.0, values->humidity_range[1] / 2.0, values->humidity_range[2] / 2.0);
+		payload->addRange(LPP_CHANNEL_PRESS_2, values->pressure_range[0] / 10.0, values->pressure_range[1] / 10.0, values->pressure_range[2] / 10.0);
+	}
+	if (fields & PAYLOAD_HAS_DEVID)
+	{
+		payload->addDevID(0, (uint8_t *)values->dev_id);
+	}
+}
+
+/**
+ * @brief Payload codec benchmark
+ *        Arguments: samples=N seed=N
+ *        Returns 1 if a record does not decode to the encoded values, can be used as a test.
+ *
+ */
+int bench_codec(int argc, char **argv)
+{
+	uint32_t samples = bench_arg_u32(argc, argv, "samples", 100000);
+	bench_apply_sim_args(argc, argv);
+	sim_reset();
+
+	// Round trip of random records, direct and through the WisCayenne style interface
+	TrackerPayload compact(255);
+	compact.setFormat(PAYLOAD_COMPACT);
+	uint32_t failed = 0;
+	for (uint32_t sample = 0; sample < samples; sample++)
+	{
+		static s_payload_fields values;
+		static s_payload_fields decoded;
+		uint8_t buffer[PAYLOAD_MAX_SIZE + 6];
+		codec_random_values(&values, (uint16_t)random(0, 0x100) | (random(0, 2) ? PAYLOAD_HAS_DEVID : 0));
+
+		uint8_t len = payload_encode(&values, buffer, sizeof(buffer));
+		bool direct_ok = (len != 0) && payload_decode(buffer, len, &decoded) && codec_equal(&values, &decoded);
+
+		// The tower flag is only set with a position
+		if (!(values.fields & PAYLOAD_HAS_POSITION))
+		{
+			values.fields &= ~PAYLOAD_HAS_TOWER;
+		}
+		codec_fill(&compact, &values);
+		bool class_ok = payload_decode(compact.getBuffer(), compact.getSize(), &decoded) && codec_equal(&values, &decoded);
+		if (!direct_ok || !class_ok)
+		{
+			if (failed < 10)
+			{
+				printf("  FAIL fields %03X: %s\n", values.fields, direct_ok ? "TrackerPayload" : "payload_encode");
+			}
+			failed++;
+		}
+		// Truncated records are rejected
+		if ((len > 2) && payload_decode(buffer, len - 1, &decoded))
+		{
+			if (failed < 10)
+			{
+				printf("  FAIL fields %03X: truncated record accepted\n", values.fields);
+			}
+			failed++;
+		}
+	}
+
+	// Round trip of random tracks, limited to the payload sizes of the datarates
+	static const uint8_t track_limits[] = {0, 51, 115, 222, 242};
+	uint32_t track_failed = 0;
+	uint32_t track_fixes = 0;
+	uint32_t track_bytes = 0;
+	for (uint32_t sample = 0; sample < samples / 10; sample++)
+	{
+		static s_payload_fields values;
+		static s_payload_fields decoded;
+		uint8_t buffer[PAYLOAD_MAX_SIZE + 6];
+		codec_random_values(&values, (uint16_t)random(0, 0x100) | (random(0, 2) ? PAYLOAD_HAS_DEVID : 0));
+		codec_random_track(&values, (uint8_t)random(0, PAYLOAD_TRACK_MAX + 1));
+		values.max_size = track_limits[random(0, sizeof(track_limits))];
+
+		uint8_t len = payload_encode(&values, buffer, sizeof(buffer));
+		uint8_t record_len = (values.fields & PAYLOAD_HAS_DEVID) ? len - 6 : len;
+		bool ok = (len != 0) && payload_decode(buffer, len, &decoded) && codec_equal(&values, &decoded) &&
+				  ((values.max_size == 0) || (record_len <= values.max_size));
+		// Older fixes are only dropped if the next one does not fit
+		if (ok && (decoded.track_count < values.track_count))
+		{
+			uint8_t limit = (values.max_size != 0) && (values.max_size < PAYLOAD_MAX_SIZE) ? values.max_size : PAYLOAD_MAX_SIZE;
+			s_track_fix newest = {values.lat, values.lon, values.time};
+			const s_track_fix *newer = decoded.track_count == 0 ? &newest : &values.track[decoded.track_count - 1];
+			ok = record_len + payload_track_delta_size(newer, &values.track[decoded.track_count]) > limit;
+		}
+		uint8_t sent_fixes = decoded.track_count;
+		if (ok && (len > 2) && payload_decode(buffer, len - 1, &decoded))
+		{
+			ok = false;
+		}
+		if (!ok)
+		{
+			if (track_failed < 10)
+			{
+				printf("  FAIL track fields %03X, %d fixes, limit %d\n", values.fields, values.track_count, values.max_size);
+			}
+			track_failed++;
+		}
+		if (values.max_size == 0)
+		{
+			// Size of the older fixes, difference to the same record without older fixes
+			values.track_count = 0;
+			track_fixes += sent_fixes;
+			track_bytes += len - payload_encode(&values, buffer, sizeof(buffer));
+		}
+	}
+	failed += track_failed;
+
+	// Round trip of random diagnostic records, with and without DevID
+	uint32_t diag_failed = 0;
+	for (uint32_t sample = 0; sample < samples / 10; sample++)
+	{
+		uint32_t values[ENERGY_NUM + 2];
+		uint32_t decoded[ENERGY_NUM + 2];
+		uint8_t buffer[64];
+		for (uint8_t idx = 0; idx < ENERGY_NUM + 2; idx++)
+		{
+			values[idx] = (uint32_t)random(0, 0x10000) << random(0, 17);
+		}
+		uint8_t len = payload_encode_diag(values, ENERGY_NUM + 2, buffer, sizeof(buffer) - 6);
+		if (random(0, 2))
+		{
+			buffer[len++] = 0;
+			buffer[len++] = LPP_DEVID;
+			for (uint8_t idx = 0; idx < 4; idx++)
+			{
+				buffer[len++] = (uint8_t)random(0, 256);
+			}
+		}
+		bool ok = (len != 0) && (payload_decode_diag(buffer, len, decoded, ENERGY_NUM + 2) == ENERGY_NUM + 2) &&
+				  (memcmp(values, decoded, sizeof(values)) == 0) && (payload_decode_diag(buffer, len - 1, decoded, ENERGY_NUM + 2) == 0);
+		if (!ok)
+		{
+			diag_failed++;
+		}
+	}
+	failed += diag_failed;
+	printf("Round trip, %u random records: %u failed, %u random tracks: %u failed, %u random diagnostic records: %u failed\n", samples,
+		   failed - track_failed - diag_failed, samples / 10, track_failed, samples / 10, diag_failed);
+	printf("Track, %.1f bytes per older fix, 15 bytes per status record\n", track_fixes ? (double)track_bytes / track_fixes : 0.0);
+
+	// Size of the uplinks of the tracker
+	TrackerPayload lpp(255);
+	lpp.setFormat(PAYLOAD_LPP);
+	printf("Uplink                  LPP  compact  US915 DR0 %d B  EU868 DR0 %d B\n", CODEC_US915_DR0, CODEC_EU868_DR0);
+	for (const s_codec_packet &packet : codec_packets)
+	{
+		s_payload_fields values;
+		codec_random_values(&values, packet.fields);
+		codec_fill(&lpp, &values);
+		codec_fill(&compact, &values);
+		uint8_t lpp_size = lpp.getSize();
+		uint8_t compact_size = compact.getSize();
+		printf("  %-20s %4d %8d  %-14s %s\n", packet.name, lpp_size, compact_size,
+			   compact_size <= CODEC_US915_DR0 ? "fits" : (lpp_size <= CODEC_US915_DR0 ? "fits LPP only" : "-"),
+			   compact_size <= CODEC_EU868_DR0 ? "fits" : "-");
+	}
+
+	// Fixes per uplink while moving, fixes every 2.5 minutes at 15 m/s
+	printf("Fixes per uplink        51 B  115 B  222 B  (location, RAK1906, motion)\n");
+	{
+		static s_payload_fields values;
+		uint8_t buffer[PAYLOAD_MAX_SIZE + 6];
+		codec_random_values(&values, 0x7F);
+		values.fields |= PAYLOAD_HAS_TRACK;
+		values.time = 1800000000UL;
+		for (uint8_t idx = 0; idx < PAYLOAD_TRACK_MAX; idx++)
+		{
+			values.track[idx] = {values.lat - (idx + 1) * 18000, values.lon - (idx + 1) * 9000, values.time - (idx + 1) * 150};
+		}
+		values.track_count = PAYLOAD_TRACK_MAX;
+		printf("  track                ");
+		for (uint8_t limit : {51, 115, 222})
+		{
+			static s_payload_fields decoded;
+			values.max_size = limit;
+			payload_decode(buffer, payload_encode(&values, buffer, sizeof(buffer)), &decoded);
+			printf(" %5d ", decoded.track_count + 1);
+		}
+		printf("\n  status record            1      1      1\n");
+	}
+
+	// Example for a check of the decoder in Decoder.js
+	static s_payload_fields example = {0x3F, 52520008, 13404954, 412, 215, 93, 10132, 0, {0}};
+	uint8_t buffer[32];
+	uint8_t len = payload_encode(&example, buffer, sizeof(buffer));
+	printf("Example  ");
+	for (uint8_t idx = 0; idx < len; idx++)
+	{
+		printf("%02X", buffer[idx]);
+	}
+	printf("  (52.520008,13.404954 tower, 4.12V, 21.5C, 46.5%%, 1013.2hPa)\n");
+	example.fields = PAYLOAD_HAS_POSITION | PAYLOAD_HAS_BATTERY | PAYLOAD_HAS_MOTION | PAYLOAD_HAS_TRACK;
+	example.motion = MOTION_MOVING;
+	example.time = 1800000000UL;
+	example.track[0] = {52518208, 13404054, 1800000000UL - 150};
+	example.track[1] = {52516408, 13405954, 1800000000UL - 300};
+	example.track_count = 2;
+	len = payload_encode(&example, buffer, sizeof(buffer));
+	printf("Example  ");
+	for (uint8_t idx = 0; idx < len; idx++)
+	{
+		printf("%02X", buffer[idx]);
+	}
+	printf("  (moving, 3 fixes 150 s apart, newest at 1800000000)\n");
+	example.fields = PAYLOAD_HAS_TEMPERATURE | PAYLOAD_HAS_HUMIDITY | PAYLOAD_HAS_PRESSURE | PAYLOAD_HAS_RANGE;
+	example.range_count = 10;
+	example.temperature_range[0] = 42;
+	example.temperature_range[1] = 215;
+	example.temperature_range[2] = 98;
+	example.humidity_range[0] = 80;
+	example.humidity_range[1] = 120;
+	example.humidity_range[2] = 93;
+	example.pressure_range[0] = 10125;
+	example.pressure_range[1] = 10135;
+	example.pressure_range[2] = 10130;
+	len = payload_encode(&example, buffer, sizeof(buffer));
+	printf("Example  ");
+	for (uint8_t idx = 0; idx < len; idx++)
+	{
+		printf("%02X", buffer[idx]);
+	}
+	printf("  (21.5C, 46.5%%, 1013.2hPa, 10 samples 4.2 .. 21.5C mean 9.8C)\n");
+	uint32_t diag[ENERGY_NUM + 2] = {3, 86400, 2100, 340, 12, 9, 55, 18, 1300, 8640};
+	len = payload_encode_diag(diag, ENERGY_NUM + 2, buffer, sizeof(buffer));
+	printf("Example  ");
+	for (uint8_t idx = 0; idx < len; idx++)
+	{
+		printf("%02X", buffer[idx]);
+	}
+	printf("  (diagnostic, 3 boots, 1 day, GNSS 2100 s, sync 340 s, ..., green LED 8640 s)\n");
+	return failed == 0 ? 0 : 1;
+}
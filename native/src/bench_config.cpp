@@ -0,0 +1,111 @@
+/**
+ * @file bench_config.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Boots the application with a cold, a warm and a restored NoteCard and changes the SIM settings by AT command,
+ *        reports the configuration requests of each step and checks that only the needed ones are sent
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+
+/**
+ * @brief Print the cost of one step and check the expected hub.set and card.wireless requests
+ *
+ * @param step name of the step
+ * @param start counters before the step
+ * @param hub_sets expected hub.set requests
+ * @param wireless_sets expected card.wireless requests with SIM settings
+ * @return uint32_t 1 if the check failed
+ */
+static uint32_t config_step(const char *step, const s_sim_stats &start, uint32_t hub_sets, uint32_t wireless_sets)
+{
+	uint32_t transactions = g_sim_stats.transactions - start.transactions;
+	uint32_t hub = g_sim_stats.hub_sets - start.hub_sets;
+	uint32_t wireless = g_sim_stats.wireless_sets - start.wireless_sets;
+	bool ok = (hub == hub_sets) && (wireless == wireless_sets);
+	printf("  %-24s %8u %8u %8u %9.1f  %s\n", step, transactions, hub, wireless, (double)(g_sim_stats.card_busy_us - start.card_busy_us) / 1000.0,
+		   ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+/**
+ * @brief NoteCard configuration benchmark
+ *        Arguments: the simulation knobs
+ *
+ */
+int bench_config(int argc, char **argv)
+{
+	bench_apply_sim_args(argc, argv);
+	uint32_t failed = 0;
+	snprintf(g_blues_settings.product_uid, sizeof(g_blues_settings.product_uid), "com.test.config:tracker");
+	save_blues_settings();
+	settings_flush();
+
+	printf("NoteCard configuration          requests  hub.set wireless   card ms\n");
+
+	// New NoteCard, its SIM settings match, only hub.set and the setup are sent
+	sim_boot();
+	blues_worker_run();
+	blues_worker_complete();
+	failed += config_step("cold boot", s_sim_stats(), 1, 0);
+
+	// Same NoteCard, same settings
+	sim_reboot();
+	blues_worker_run();
+	blues_worker_complete();
+	failed += config_step("warm boot", s_sim_stats(), 0, 0);
+
+	// SIM change by AT command, applied in the worker without reboot
+	s_sim_stats start = g_sim_stats;
+	failed += sim_at_command("AT+BSIM=1:iot.apn") != AT_SUCCESS ? 1 : 0;
+	blues_worker_run();
+	blues_worker_complete();
+	settings_flush();
+	failed += config_step("AT+BSIM change", start, 0, 1);
+
+	// Same NoteCard with the changed settings
+	sim_reboot();
+	blues_worker_run();
+	blues_worker_complete();
+	failed += config_step("warm boot after change", s_sim_stats(), 0, 0);
+
+	// Factory reset of the NoteCard behind the back of the device, all parts are sent again
+	sim_card_transaction("{\"req\":\"card.restore\",\"delete\":true}");
+	sim_reboot();
+	blues_worker_run();
+	blues_worker_complete();
+	failed += config_step("boot after card.restore", s_sim_stats(), 1, 1);
+
+	// Connection mode changed from NoteHub, hub.set is sent again
+	sim_card_transaction("{\"req\":\"hub.set\",\"mode\":\"continuous\"}");
+	sim_reboot();
+	blues_worker_run();
+	blues_worker_complete();
+	failed += config_step("boot after NoteHub change", s_sim_stats(), 1, 0);
+
+	// Forgotten state, the NoteCard is read again
+	sim_at_command("AT+BCFG=0");
+	sim_reboot();
+	blues_worker_run();
+	blues_worker_complete();
+	failed += config_step("boot after AT+BCFG=0", s_sim_stats(), 1, 0);
+
+	// Replaced NoteCard with other SIM settings
+	snprintf(g_sim_config.card_device, sizeof(g_sim_config.card_device), "dev:860322068099999");
+	sim_reset_card();
+	sim_reboot();
+	blues_worker_run();
+	blues_worker_complete();
+	failed += config_step("boot with new NoteCard", s_sim_stats(), 1, 1);
+
+	const s_blues_config_stats *stats = blues_config_stats();
+	printf("  warm %u, lost %u, reconciled %u, live %u, skipped %u requests\n", stats->warm, stats->lost, stats->reconciled, stats->live,
+		   stats->skipped);
+	failed += (stats->warm != 2) || (stats->lost != 2) || (stats->live != 1) ? 1 : 0;
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file bench_cycle.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Runs the application for many send intervals on the virtual clock and reports
+ *        the NoteCard and radio cost of one STATUS -> GNSS_FINISH -> USE_CELLULAR cycle
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+
+/** Flag of the application if the NoteCard was found */
+extern bool has_blues;
+
+/**
+ * @brief Cycle cost benchmark
+ *        Arguments: cycles=N interval=sec confirmed=0|1 saved=0|1 sync_count=N sync_age=min sync_prio=N dead=meters fmt=0|1 track=N plus the simulation knobs
+ *        saved=1 boots with saved Blues settings, which configures the NoteCard in init_blues()
+ *
+ */
+int bench_cycle(int argc, char **argv)
+{
+	uint32_t cycles = bench_arg_u32(argc, argv, "cycles", 2000);
+	bench_apply_sim_args(argc, argv);
+	g_lorawan_settings.send_repeat_time = bench_arg_u32(argc, argv, "interval", 600) * 1000;
+	g_lorawan_settings.data_rate = (uint8_t)bench_arg_u32(argc, argv, "dr", g_lorawan_settings.data_rate);
+	g_lorawan_settings.confirmed_msg_enabled = bench_arg_u32(argc, argv, "confirmed", g_lorawan_settings.confirmed_msg_enabled) != 0;
+	g_blues_settings.sync_count = bench_arg_u32(argc, argv, "sync_count", g_blues_settings.sync_count);
+	g_blues_settings.sync_age = bench_arg_u32(argc, argv, "sync_age", g_blues_settings.sync_age);
+	g_blues_settings.sync_priority = bench_arg_u32(argc, argv, "sync_prio", g_blues_settings.sync_priority);
+	g_blues_settings.diag_interval = bench_arg_u32(argc, argv, "diag", g_blues_settings.diag_interval);
+	g_blues_settings.deadband = bench_arg_u32(argc, argv, "dead", g_blues_settings.deadband);
+	g_blues_settings.payload_format = bench_arg_u32(argc, argv, "fmt", g_blues_settings.payload_format);
+	g_blues_settings.track_fixes = bench_arg_u32(argc, argv, "track", g_blues_settings.track_fixes);
+	g_blues_settings.env_interval = bench_arg_u32(argc, argv, "env", g_blues_settings.env_interval);
+
+	if (bench_arg_u32(argc, argv, "saved", 1) != 0)
+	{
+		save_blues_settings();
+		settings_flush();
+	}
+
+	sim_boot();
+	// The NoteCard configuration of the boot runs in the worker after init_app()
+	blues_worker_run();
+	// Completion of the boot job as the loop calls it with BLUES_DONE
+	blues_worker_complete();
+	bool boot_blues = has_blues;
+	s_sim_stats boot = g_sim_stats;
+	uint32_t boot_skipped = blues_shadow_skipped();
+	uint64_t boot_us = sim_now_us();
+
+	bench_run_cycles(cycles);
+
+	s_sim_stats &run = g_sim_stats;
+	double n = cycles ? (double)cycles : 1.0;
+	double hours = (double)(sim_now_us() - boot_us) / 3600e6;
+
+	printf("Boot (init_app)\n");
+	printf("  NoteCard transactions   %u (%u skipped)\n", boot.transactions, boot_skipped);
+	printf("  NoteCard bytes tx/rx    %u / %u\n", boot.bytes_tx, boot.bytes_rx);
+	printf("  Boot time               %.1f ms\n", (double)boot_us / 1000.0);
+	printf("  NoteCard found          %s after the boot, %s after the run\n", boot_blues ? "yes" : "no", has_blues ? "yes" : "no");
+	const char *name;
+	const s_boot_phase *phase;
+	for (uint8_t idx = 0; (phase = boot_phase(idx, &name)) != NULL; idx++)
+	{
+		if (phase->finished)
+		{
+			printf("  %-22s %9.1f ms .. %9.1f ms\n", name, phase->start_ms / 1.0, phase->end_ms / 1.0);
+		}
+	}
+	printf("Cycles                    %u (%.1f h simulated)\n", run.status_events, hours);
+	printf("Per cycle\n");
+	printf("  NoteCard transactions   %.2f\n", (run.transactions - boot.transactions) / n);
+	printf("  NoteCard failed         %.2f\n", (run.failed - boot.failed) / n);
+	printf("  NoteCard skipped        %.2f\n", (blues_shadow_skipped() - boot_skipped) / n);
+	printf("  NoteCard bytes tx       %.1f\n", (run.bytes_tx - boot.bytes_tx) / n);
+	printf("  NoteCard bytes rx       %.1f\n", (run.bytes_rx - boot.bytes_rx) / n);
+	printf("  NoteCard busy           %.1f ms\n", (double)(run.card_busy_us - boot.card_busy_us) / 1000.0 / n);
+	printf("  Handler busy            %.1f ms\n", (double)(run.handler_us - boot.handler_us) / 1000.0 / n);
+	printf("  NoteCard worker busy    %.1f ms\n", (double)(run.worker_us - boot.worker_us) / 1000.0 / n);
+	printf("  App wake ups            %.2f\n", (run.app_events - boot.app_events) / n);
+	printf("  GNSS on                 %.1f s\n", (double)(run.gnss_on_us - boot.gnss_on_us) / 1e6 / n);
+	printf("Totals\n");
+	printf("  GNSS fixes              %u\n", run.gnss_fixes);
+	s_gnss_window_stats *gnss = gnss_window_stats();
+	printf("  GNSS windows            %u started, %u with fix, %u skipped by backoff\n", gnss->attempts, gnss->fixes, gnss->skipped);
+	printf("  ATTN interrupts         %u\n", run.attn_irqs);
+	printf("  LoRaWAN uplinks/ACK     %u / %u (%u bytes, %u size errors)\n", run.lora_tx, run.lora_ack, run.lora_bytes, run.lora_size_err);
+	printf("  Notes added / syncs     %u / %u (%u note.add failed)\n", run.notes_added, run.hub_syncs, run.notes_failed);
+	s_uplink_queue_stats *queue = uplink_queue_stats();
+	printf("  Uplink queue            %u queued, %u sent, %u dropped, %u left\n", queue->queued, queue->sent, queue->dropped, uplink_queue_count());
+	printf("  Region changes          %u\n", run.region_changes);
+	s_deadband_stats *dead = deadband_stats();
+	printf("  Deadband                %u reported, %u suppressed (%u bytes), %u keep-alive\n", dead->reported, dead->suppressed, dead->bytes_saved, dead->keepalive);
+	s_link_stats *link = link_stats();
+	printf("  Link model              %u LoRaWAN first, %u cellular only, %u probes, ACK %u%%, SNR %.1f dB\n", link->lora_chosen,
+		   link->cell_chosen, link->probes, link->lora_ack, link->snr_x10 / 10.0);
+	s_track_stats *track = track_stats();
+	printf("  Track                   %u fixes held back, %u tracks sent, %u fixes dropped\n", track->held, track->tracks, track->dropped);
+	s_rak1906_stats *bme = rak1906_stats();
+	uint32_t bme_readings = bme->readings != 0 ? bme->readings : 1;
+	printf("  BME680                  %u readings, %u finished early, saved avg %.1f ms, wait avg %.1f ms, %u timeouts, oldest %u ms\n", bme->readings,
+		   bme->early, (double)bme->saved_ms / bme_readings, (double)bme->wait_ms / bme_readings, bme->timeouts, bme->age_ms);
+	printf("  BME680 samples          %u between the uplinks, %u uplinks with min/max/mean of %u readings, %u without (payload size)\n",
+		   bme->samples, bme->ranges, bme->reported, bme->dropped);
+	s_energy_stats *energy = energy_stats();
+	printf("Time in energy states     (boot %u)\n", energy->boots);
+	for (uint8_t state = 0; state < ENERGY_NUM; state++)
+	{
+		printf("  %-22s %9.1f s %6.2f%%\n", energy_state_name(state), energy->boot_ms[state] / 1000.0,
+			   energy->boot_ms[state] / 10.0 / (energy->uptime_s ? energy->uptime_s : 1));
+	}
+	printf("NoteCard retry policies   requests  tries  failed  wait ms  busy ms\n");
+	const s_blues_req_stats *stats;
+	for (uint8_t idx = 0; (stats = blues_request_stats(idx, &name)) != NULL; idx++)
+	{
+		if (stats->requests != 0)
+		{
+			printf("  %-22s %9u %6u %7u %8u %8u\n", name, stats->requests, stats->attempts, stats->failures, stats->backoff_ms, stats->busy_ms);
+		}
+	}
+	printf("NoteCard requests         tries  retry  err  avg ms  max ms  tx bytes  rx bytes\n");
+	const s_blues_perf *perf;
+	for (uint8_t idx = 0; (perf = blues_perf_stats(idx)) != NULL; idx++)
+	{
+		uint32_t sent_num = 0;
+		uint32_t received_num = 0;
+		for (uint8_t bucket = 0; bucket < BLUES_PERF_SIZE_BUCKETS; bucket++)
+		{
+			sent_num += perf->sent_hist[bucket];
+			received_num += perf->received_hist[bucket];
+		}
+		printf("  %-22s %6u %6u %4u %7.1f %7u %9.1f %9.1f\n", perf->name, perf->tries, perf->retries, perf->errors,
+			   perf->tries ? (double)perf->total_ms / perf->tries : 0.0, perf->max_ms, sent_num ? (double)perf->sent / sent_num : 0.0,
+			   received_num ? (double)perf->received / received_num : 0.0);
+	}
+	printf("Wake-up events            posted  merged  handled  avg ms  max ms\n");
+	const s_app_event_stats *event;
+	for (uint8_t idx = 0; (event = app_event_stats(idx, &name)) != NULL; idx++)
+	{
+		if (event->handled != 0)
+		{
+			printf("  %-22s %7u %7u %8u %7.1f %7.1f\n", name, event->posted, event->coalesced, event->handled,
+				   event->latency_num ? event->total_us / 1000.0 / event->latency_num : 0.0, event->max_us / 1000.0);
+		}
+	}
+	const s_blues_worker_stats *worker = blues_worker_stats();
+	printf("NoteCard worker           %u jobs, %u in the loop, max depth %u, wait avg %.1f ms, run avg %.1f ms, max %u ms\n",
+		   worker->submitted, worker->inline_jobs, worker->max_depth, worker->completed ? (double)worker->wait_ms / worker->completed : 0.0,
+		   worker->completed ? (double)worker->run_ms / worker->completed : 0.0, worker->max_ms);
+	return 0;
+}
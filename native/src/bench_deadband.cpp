@@ -0,0 +1,137 @@
+/**
+ * @file bench_deadband.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Checks the fixed-point distance of the position deadband against the haversine
+ *        distance in double and compares the time per distance
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+#include <chrono>
+#include <math.h>
+#include <vector>
+
+/** Pair of positions in 1e-7 degrees */
+struct s_deadband_pair
+{
+	int32_t lat1;
+	int32_t lon1;
+	int32_t lat2;
+	int32_t lon2;
+};
+
+/**
+ * @brief Distance in meters with the haversine formula
+ *
+ */
+static double haversine_m(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+	const double to_rad = M_PI / 180.0 / 10000000.0;
+	double d_lat = (lat2 - lat1) * to_rad;
+	double d_lon = ((double)lon2 - lon1) * to_rad;
+	double a = sin(d_lat / 2) * sin(d_lat / 2) + cos(lat1 * to_rad) * cos(lat2 * to_rad) * sin(d_lon / 2) * sin(d_lon / 2);
+	return 2.0 * 6378137.0 * asin(sqrt(a));
+}
+
+/**
+ * @brief Position deadband benchmark
+ *        Arguments: samples=N range=meters deadband=meters seed=N
+ *        Returns 1 if the fixed-point distance decides differently than haversine for a
+ *        distance more than 1% away from the deadband, can be used as a test.
+ *
+ */
+int bench_deadband(int argc, char **argv)
+{
+	uint32_t samples = bench_arg_u32(argc, argv, "samples", 200000);
+	uint32_t range = bench_arg_u32(argc, argv, "range", 200);
+	uint32_t deadband = bench_arg_u32(argc, argv, "deadband", 20);
+	bench_apply_sim_args(argc, argv);
+	sim_reset();
+
+	std::vector<s_deadband_pair> pairs(samples);
+	for (s_deadband_pair &pair : pairs)
+	{
+		// Up to 80 degrees latitude, offset up to range meters in each direction
+		pair.lat1 = (int32_t)random(-800000000L, 800000000L);
+		pair.lon1 = (int32_t)random(-1800000000L, 1800000000L);
+		double cos_lat = cos(pair.lat1 / 10000000.0 * M_PI / 180.0);
+		int32_t max_lat = (int32_t)(range / 1.1131949);
+		int32_t max_lon = (int32_t)(range / 1.1131949 / cos_lat);
+		pair.lat2 = pair.lat1 + (int32_t)random(-max_lat, max_lat + 1) * 100;
+		pair.lon2 = pair.lon1 + (int32_t)random(-max_lon, max_lon + 1) * 100;
+		if (pair.lon2 > 1800000000L)
+		{
+			pair.lon2 -= 3600000000LL;
+		}
+		else if (pair.lon2 < -1800000000L)
+		{
+			pair.lon2 += 3600000000LL;
+		}
+	}
+
+	double max_error = 0;
+	double max_rel_error = 0;
+	uint32_t wrong = 0;
+	uint32_t near_limit = 0;
+	uint64_t limit_sq = (uint64_t)deadband * 100 * deadband * 100;
+	for (const s_deadband_pair &pair : pairs)
+	{
+		double exact = haversine_m(pair.lat1, pair.lon1, pair.lat2, pair.lon2);
+		uint64_t dist_sq = deadband_distance_sq(pair.lat1, pair.lon1, pair.lat2, pair.lon2);
+		double fixed = sqrt((double)dist_sq) / 100.0;
+		double error = fabs(fixed - exact);
+		if (error > max_error)
+		{
+			max_error = error;
+		}
+		if ((exact > 1.0) && (error / exact > max_rel_error))
+		{
+			max_rel_error = error / exact;
+		}
+		if ((dist_sq > limit_sq) != (exact > deadband))
+		{
+			if (fabs(exact - deadband) > deadband / 100.0)
+			{
+				if (wrong < 10)
+				{
+					printf("  FAIL %ld,%ld -> %ld,%ld: %.2fm, fixed-point %.2fm\n", (long)pair.lat1, (long)pair.lon1,
+						   (long)pair.lat2, (long)pair.lon2, exact, fixed);
+				}
+				wrong++;
+			}
+			else
+			{
+				near_limit++;
+			}
+		}
+	}
+
+	// Time per distance, the sum keeps the compiler from removing the loops
+	uint64_t fixed_sum = 0;
+	double exact_sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (const s_deadband_pair &pair : pairs)
+	{
+		fixed_sum += deadband_distance_sq(pair.lat1, pair.lon1, pair.lat2, pair.lon2) > limit_sq;
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (const s_deadband_pair &pair : pairs)
+	{
+		exact_sum += haversine_m(pair.lat1, pair.lon1, pair.lat2, pair.lon2) > deadband;
+	}
+	auto end = std::chrono::steady_clock::now();
+	double fixed_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count() / samples;
+	double exact_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count() / samples;
+
+	printf("Distance, %u position pairs up to %u m apart, deadband %u m\n", samples, range, deadband);
+	printf("  max error               %.3f m (%.3f%%)\n", max_error, max_rel_error * 100.0);
+	printf("  decisions different     %u within 1%% of the deadband, %u outside\n", near_limit, wrong);
+	printf("  fixed-point             %.1f ns (%lu outside)\n", fixed_ns, (unsigned long)fixed_sum);
+	printf("  haversine double        %.1f ns (%.0f outside)\n", exact_ns, exact_sum);
+	return wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+/**
+ * @file bench_events.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Posts wake-up events from a second thread while the main thread takes them, as the
+ *        ATTN interrupt and the timer callbacks do during a motion storm, and checks that no
+ *        event is lost. The same storm against the read-modify-write of g_task_event_type
+ *        shows how many events the old handlers lost. A second run posts an event exactly
+ *        while the handler takes another one and checks that each of these posts is handled.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+#include <atomic>
+#include <thread>
+
+/** Event word of the old handlers */
+static volatile uint16_t legacy_events = 0;
+
+/** Posts of the old handlers that found the bit clear */
+static uint32_t legacy_fresh[2];
+
+/** Events the old handlers handled */
+static uint32_t legacy_handled[2];
+
+/** Events of the storm */
+static const uint16_t storm_events[2] = {BLUES_ATTN, GNSS_FINISH};
+
+/** Rounds of the posts during a take */
+static std::atomic<uint32_t> late_posted_a(0);
+static std::atomic<uint32_t> late_take_started(0);
+static std::atomic<uint32_t> late_posted_b(0);
+static std::atomic<uint32_t> late_done(0);
+
+/**
+ * @brief Busy wait, keeps the threads running in parallel
+ *
+ */
+static void storm_spin(uint32_t loops)
+{
+	for (volatile uint32_t idx = 0; idx < loops; idx++)
+	{
+	}
+}
+
+/**
+ * @brief Poster thread, posts alternating events as the ATTN interrupt and the timers
+ *
+ */
+static void storm_post(uint32_t posts, std::atomic<bool> *done)
+{
+	for (uint32_t idx = 0; idx < posts; idx++)
+	{
+		app_event_post(storm_events[idx & 1]);
+		storm_spin(idx % 7);
+		// Interrupts arrive while the handler runs, also on a single core, a few at a time
+		if ((idx & 3) == 3)
+		{
+			std::this_thread::yield();
+		}
+	}
+	*done = true;
+}
+
+/**
+ * @brief Post of the old handlers, read-modify-write of api_wake_loop()
+ *
+ * @return true if the bit was clear
+ */
+static bool legacy_post_event(uint16_t event)
+{
+	uint16_t before = legacy_events;
+	legacy_events = before | event;
+	return !(before & event);
+}
+
+/**
+ * @brief Take of the old handlers, the &= of app_event_handler() as separate load and store
+ * 		The yield lets the poster run between them, as the ATTN interrupt can
+ *
+ * @return true if the event was set
+ */
+static bool legacy_take(uint16_t event)
+{
+	uint16_t now = legacy_events;
+	if (!(now & event))
+	{
+		return false;
+	}
+	std::this_thread::yield();
+	legacy_events = now & ~event;
+	return true;
+}
+
+/**
+ * @brief Poster thread with the read-modify-write of api_wake_loop()
+ *
+ */
+static void legacy_post(uint32_t posts, std::atomic<bool> *done)
+{
+	for (uint32_t idx = 0; idx < posts; idx++)
+	{
+		if (legacy_post_event(storm_events[idx & 1]))
+		{
+			legacy_fresh[idx & 1]++;
+		}
+		storm_spin(idx % 7);
+		if ((idx & 3) == 3)
+		{
+			std::this_thread::yield();
+		}
+	}
+	*done = true;
+}
+
+/**
+ * @brief Wait for a round of the other thread
+ *
+ */
+static void late_wait(std::atomic<uint32_t> *step, uint32_t round)
+{
+	while (*step != round)
+	{
+		std::this_thread::yield();
+	}
+}
+
+/**
+ * @brief Poster thread of the posts during a take, posts BLUES_ATTN, waits until the handler
+ *        starts to take it and posts GNSS_FINISH right then. The next round starts after the
+ *        handler finished this one.
+ *
+ */
+static void late_post(uint32_t rounds, bool legacy)
+{
+	for (uint32_t round = 1; round <= rounds; round++)
+	{
+		late_wait(&late_done, round - 1);
+		legacy ? (void)legacy_post_event(BLUES_ATTN) : app_event_post(BLUES_ATTN);
+		late_posted_a = round;
+		late_wait(&late_take_started, round);
+		legacy ? (void)legacy_post_event(GNSS_FINISH) : app_event_post(GNSS_FINISH);
+		late_posted_b = round;
+	}
+}
+
+/**
+ * @brief Handler side of the posts during a take
+ *
+ * @return uint32_t posts of GNSS_FINISH made after the take of BLUES_ATTN started and not handled
+ */
+static uint32_t late_take(uint32_t rounds, bool legacy)
+{
+	late_posted_a = 0;
+	late_take_started = 0;
+	late_posted_b = 0;
+	late_done = 0;
+	std::thread poster(late_post, rounds, legacy);
+	uint32_t lost = 0;
+	for (uint32_t round = 1; round <= rounds; round++)
+	{
+		late_wait(&late_posted_a, round);
+		late_take_started = round;
+		legacy ? legacy_take(BLUES_ATTN) : app_event_take(BLUES_ATTN);
+		late_wait(&late_posted_b, round);
+		// GNSS_FINISH was clear when the round started, the post must be handled now
+		lost += (legacy ? legacy_take(GNSS_FINISH) : app_event_take(GNSS_FINISH)) ? 0 : 1;
+		// A BLUES_ATTN brought back by a stale write of the poster
+		legacy ? legacy_take(BLUES_ATTN) : app_event_take(BLUES_ATTN);
+		late_done = round;
+	}
+	poster.join();
+	return lost;
+}
+
+/**
+ * @brief Counters of an event
+ *
+ */
+static const s_app_event_stats *storm_stats(uint16_t event)
+{
+	const char *name;
+	const s_app_event_stats *stats;
+	for (uint8_t idx = 0; (stats = app_event_stats(idx, &name)) != NULL; idx++)
+	{
+		if ((event == BLUES_ATTN) && (strcmp(name, "blues_attn") == 0))
+		{
+			return stats;
+		}
+		if ((event == GNSS_FINISH) && (strcmp(name, "gnss_finish") == 0))
+		{
+			return stats;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Event storm benchmark
+ *        Arguments: posts=N rounds=N
+ *        Returns 1 if an event posted with app_event_post() was neither handled nor merged
+ *        with a pending post or if a post during a take was not handled, can be used as a test.
+ *
+ */
+int bench_events(int argc, char **argv)
+{
+	uint32_t posts = bench_arg_u32(argc, argv, "posts", 2000000);
+	uint32_t rounds = bench_arg_u32(argc, argv, "rounds", 20000);
+	bench_apply_sim_args(argc, argv);
+	sim_reset();
+	app_event_stats_reset();
+	g_task_event_type = NO_EVENT;
+
+	// Atomic post and take
+	std::atomic<bool> done(false);
+	uint32_t handled[2] = {0, 0};
+	std::thread poster(storm_post, posts, &done);
+	while (!done)
+	{
+		bool idle = true;
+		for (uint8_t event = 0; event < 2; event++)
+		{
+			if (app_event_take(storm_events[event]))
+			{
+				handled[event]++;
+				storm_spin(50);
+				idle = false;
+			}
+		}
+		if (idle)
+		{
+			// The loop sleeps until the next wake-up
+			std::this_thread::yield();
+		}
+	}
+	poster.join();
+	for (uint8_t event = 0; event < 2; event++)
+	{
+		handled[event] += app_event_take(storm_events[event]) ? 1 : 0;
+	}
+
+	// Read-modify-write as in the old handlers
+	std::atomic<bool> legacy_done(false);
+	std::thread legacy_poster(legacy_post, posts, &legacy_done);
+	while (!legacy_done || (legacy_events != 0))
+	{
+		bool idle = true;
+		for (uint8_t event = 0; event < 2; event++)
+		{
+			if (legacy_take(storm_events[event]))
+			{
+				legacy_handled[event]++;
+				storm_spin(50);
+				idle = false;
+			}
+		}
+		if (idle)
+		{
+			std::this_thread::yield();
+		}
+	}
+	legacy_poster.join();
+
+	uint32_t lost = 0;
+	printf("Event storm, %u posts of blues_attn and gnss_finish from a second thread\n", posts);
+	printf("                          posted   merged  handled     lost  old lost\n");
+	for (uint8_t event = 0; event < 2; event++)
+	{
+		const s_app_event_stats *stats = storm_stats(storm_events[event]);
+		uint32_t missing = stats->posted - stats->coalesced - stats->handled;
+		lost += missing + (handled[event] != stats->handled ? 1 : 0);
+		// Posts the old handlers lost, less the events they handled twice
+		printf("  %-22s %8u %8u %8u %8u %9d\n", event == 0 ? "blues_attn" : "gnss_finish", stats->posted, stats->coalesced,
+			   stats->handled, missing, (int)(legacy_fresh[event] - legacy_handled[event]));
+	}
+
+	// Posts during a take
+	app_event_stats_reset();
+	legacy_events = 0;
+	uint32_t late_lost = late_take(rounds, false);
+	uint32_t late_legacy_lost = late_take(rounds, true);
+	printf("Posts of gnss_finish while blues_attn is taken, %u rounds\n", rounds);
+	printf("  not handled %u, old not handled %u\n", late_lost, late_legacy_lost);
+	lost += late_lost;
+	return lost == 0 ? 0 : 1;
+}
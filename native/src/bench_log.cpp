@@ -0,0 +1,149 @@
+/**
+ * @file bench_log.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Checks the text of the deferred log ring against snprintf and compares the time
+ *        of a log call with the time the blocking MYLOG waits for the UART
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+#include <chrono>
+
+/** Time of one character on the UART at 115200 baud, 10 bits */
+#define LOG_UART_US_PER_CHAR (10.0 * 1000000.0 / 115200.0)
+
+/** Number of wrong texts */
+static uint32_t log_wrong = 0;
+
+/**
+ * @brief Store a line in the ring, read it back and compare the text with snprintf
+ *
+ */
+template <typename... Args>
+static void log_check(const char *format, Args... args)
+{
+	char expected[256];
+	char text[256];
+	uint32_t record[LOG_RECORD_MAX];
+	const char *tag = NULL;
+	snprintf(expected, sizeof(expected), format, args...);
+	log_ring_printf("TEST", format, args...);
+	uint16_t words = log_ring_read(record, LOG_RECORD_MAX);
+	if (words == 0)
+	{
+		printf("  FAIL \"%s\": no record\n", format);
+		log_wrong++;
+		return;
+	}
+	log_format(record, text, sizeof(text), &tag);
+	if ((strcmp(text, expected) != 0) || (strcmp(tag, "TEST") != 0))
+	{
+		printf("  FAIL \"%s\": \"%s\", expected \"%s\"\n", format, text, expected);
+		log_wrong++;
+	}
+}
+
+/**
+ * @brief Deferred log benchmark
+ *        Arguments: calls=N
+ *        Returns 1 if a text from the ring differs from snprintf, can be used as a test.
+ *
+ */
+int bench_log(int argc, char **argv)
+{
+	uint32_t calls = bench_arg_u32(argc, argv, "calls", 100000);
+	bench_apply_sim_args(argc, argv);
+	sim_reset();
+
+	// Drain what the reset logged
+	uint32_t record[LOG_RECORD_MAX];
+	while (log_ring_read(record, LOG_RECORD_MAX) != 0)
+	{
+	}
+
+	log_wrong = 0;
+	log_check("No arguments");
+	log_check("Value %d", -42);
+	log_check("Value %d %d %d", 1, 22, 333);
+	log_check("Unsigned %u hex %08X %x", 4000000000U, 0xBEEFU, 255U);
+	log_check("Long %ld unsigned long %lu", -123456789L, 4000000000UL);
+	log_check("Width %5d|%-5d|%05d", 42, 42, 42);
+	log_check("Float %.2f %.6f %e", 3.14159, -0.000123, 12345.678);
+	log_check("Float argument %.1f", (float)21.5f);
+	log_check("String %s and %s", "first", "second");
+	log_check("Padded |%10s|%-10s|", "right", "left");
+	log_check("Char %c percent 100%%", 'x');
+	log_check("Bool %d size %d", true, (int)sizeof(uint32_t));
+	log_check("Mixed %s %d %.3f %s %lX", "lat", 473812345, 8.5412, "", 0xDEADBEEFUL);
+	log_check("Empty string '%s'", "");
+	log_check("Position %.7f,%.7f alt %.1f m", 47.3812345, 8.5412345, 412.3);
+
+	// A string longer than LOG_STR_MAX is cut
+	char long_text[LOG_STR_MAX + 20];
+	memset(long_text, 'a', sizeof(long_text) - 1);
+	long_text[sizeof(long_text) - 1] = 0;
+	log_ring_printf("TEST", "%s", long_text);
+	char text[256];
+	const char *tag;
+	log_ring_read(record, LOG_RECORD_MAX);
+	if (log_format(record, text, sizeof(text), &tag) != LOG_STR_MAX)
+	{
+		printf("  FAIL long string: %d characters, expected %d\n", (int)strlen(text), LOG_STR_MAX);
+		log_wrong++;
+	}
+
+	// Time of a log call, the ring is read in blocks so it does not run full
+	uint32_t chars = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t idx = 0; idx < calls; idx++)
+	{
+		log_ring_printf("GNSS", "Position %ld %ld alt %d sats %d", (long)473812345 + idx, (long)85412345, 412, 9);
+		if ((idx & 7) == 7)
+		{
+			while (log_ring_read(record, LOG_RECORD_MAX) != 0)
+			{
+			}
+		}
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (uint32_t idx = 0; idx < calls; idx++)
+	{
+		chars += snprintf(text, sizeof(text), "[%s] Position %ld %ld alt %d sats %d\n", "GNSS", (long)473812345 + idx, (long)85412345, 412, 9);
+	}
+	auto end = std::chrono::steady_clock::now();
+	while (log_ring_read(record, LOG_RECORD_MAX) != 0)
+	{
+	}
+	double ring_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count() / calls;
+	double text_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count() / calls;
+	double line_chars = (double)chars / calls;
+
+	// Lines written in one burst without a drain, the rest is dropped
+	s_log_stats *stats = log_ring_stats();
+	uint32_t dropped = stats->dropped;
+	uint32_t burst = 0;
+	while (stats->dropped == dropped)
+	{
+		log_ring_printf("GNSS", "Position %ld %ld alt %d sats %d", (long)473812345, (long)85412345, 412, 9);
+		burst++;
+	}
+	burst--;
+	while (log_ring_read(record, LOG_RECORD_MAX) != 0)
+	{
+	}
+
+	printf("Deferred log, %u calls, ring of %u words\n", calls, LOG_RING_WORDS);
+	printf("  texts different         %u\n", log_wrong);
+	printf("  log ring call           %.1f ns\n", ring_ns);
+	printf("  snprintf of the line    %.1f ns\n", text_ns);
+	printf("  UART wait of MYLOG      %.0f us (%.1f characters at 115200 baud)\n", line_chars * LOG_UART_US_PER_CHAR, line_chars);
+	printf("  burst without drain     %u lines, then dropped\n", burst);
+	printf("  records %lu, dropped %lu, most words used %lu\n", (unsigned long)stats->records, (unsigned long)stats->dropped,
+		   (unsigned long)stats->max_used);
+	return log_wrong == 0 ? 0 : 1;
+}
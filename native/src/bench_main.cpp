@@ -0,0 +1,133 @@
+/**
+ * @file bench_main.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Entry point of the native host build
+ *        Usage: program <benchmark> [key=value ...]
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+
+/** List of available benchmarks and tools */
+static const s_bench bench_list[] = {
+	{"cycle", "NoteCard and radio cost of the application cycle", bench_cycle},
+	{"capture", "Record a NoteCard transcript of a simulated session", bench_capture},
+	{"replay", "Replay a NoteCard transcript through the Blues functions", bench_replay},
+	{"serializer", "Requests built with RAK_BLUES against requests streamed from flash", bench_serializer},
+	{"parser", "Single pass response extractor against RAK_BLUES accessors, coordinate precision", bench_parser},
+	{"deadband", "Fixed-point deadband distance against haversine, accuracy and time", bench_deadband},
+	{"codec", "Round trip of the compact payload, size against Cayenne LPP", bench_codec},
+	{"log", "Deferred log ring against blocking MYLOG, text check and time", bench_log},
+	{"events", "Event storm from a second thread, lost events against the old handlers", bench_events},
+	{"config", "NoteCard configuration requests of cold and warm boots and AT changes", bench_config},
+	{"settings", "Settings records: conversion, AT burst, cut and damaged records", bench_settings},
+};
+
+uint32_t bench_arg_u32(int argc, char **argv, const char *key, uint32_t def_value)
+{
+	size_t key_len = strlen(key);
+	for (int idx = 0; idx < argc; idx++)
+	{
+		if ((strncmp(argv[idx], key, key_len) == 0) && (argv[idx][key_len] == '='))
+		{
+			return (uint32_t)strtoul(&argv[idx][key_len + 1], NULL, 0);
+		}
+	}
+	return def_value;
+}
+
+const char *bench_arg_str(int argc, char **argv, const char *key, const char *def_value)
+{
+	size_t key_len = strlen(key);
+	for (int idx = 0; idx < argc; idx++)
+	{
+		if ((strncmp(argv[idx], key, key_len) == 0) && (argv[idx][key_len] == '='))
+		{
+			return &argv[idx][key_len + 1];
+		}
+	}
+	return def_value;
+}
+
+/**
+ * @brief Set the simulation knobs shared by all benchmarks
+ *
+ */
+void bench_apply_sim_args(int argc, char **argv)
+{
+	g_sim_config.seed = bench_arg_u32(argc, argv, "seed", g_sim_config.seed);
+	g_sim_config.verbose = bench_arg_u32(argc, argv, "verbose", g_sim_config.verbose) != 0;
+	g_sim_config.gnss_ttff_ms = bench_arg_u32(argc, argv, "ttff", g_sim_config.gnss_ttff_ms);
+	g_sim_config.gnss_fix_percent = (uint8_t)bench_arg_u32(argc, argv, "fix", g_sim_config.gnss_fix_percent);
+	g_sim_config.motion_period_ms = bench_arg_u32(argc, argv, "motion", g_sim_config.motion_period_ms);
+	g_sim_config.trip_ms = bench_arg_u32(argc, argv, "trip", g_sim_config.trip_ms / 1000) * 1000;
+	g_sim_config.park_ms = bench_arg_u32(argc, argv, "park", g_sim_config.park_ms / 1000) * 1000;
+	g_sim_config.card_fail_percent = (uint8_t)bench_arg_u32(argc, argv, "fail", g_sim_config.card_fail_percent);
+	g_sim_config.card_mute_percent = (uint8_t)bench_arg_u32(argc, argv, "mute", g_sim_config.card_mute_percent);
+	g_sim_config.card_boot_ms = bench_arg_u32(argc, argv, "cardboot", g_sim_config.card_boot_ms);
+	g_sim_config.lora_ack_percent = (uint8_t)bench_arg_u32(argc, argv, "ack", g_sim_config.lora_ack_percent);
+	g_sim_config.lora_downlink_percent = (uint8_t)bench_arg_u32(argc, argv, "downlink", g_sim_config.lora_downlink_percent);
+	g_sim_config.lora_joinable = bench_arg_u32(argc, argv, "join", g_sim_config.lora_joinable) != 0;
+	g_sim_config.outage_start_ms = bench_arg_u32(argc, argv, "outage_at", g_sim_config.outage_start_ms / 1000) * 1000;
+	g_sim_config.outage_end_ms = g_sim_config.outage_start_ms + bench_arg_u32(argc, argv, "outage", 0) * 1000;
+	const char *country = bench_arg_str(argc, argv, "country", NULL);
+	if (country != NULL)
+	{
+		snprintf(g_sim_config.country, sizeof(g_sim_config.country), "%s", country);
+	}
+	const char *border = bench_arg_str(argc, argv, "border", NULL);
+	if (border != NULL)
+	{
+		snprintf(g_sim_config.border_country, sizeof(g_sim_config.border_country), "%s", border);
+	}
+	g_sim_config.border_percent = (uint8_t)bench_arg_u32(argc, argv, "border_pct", g_sim_config.border_percent);
+}
+
+/**
+ * @brief Run the application until the given number of STATUS events are handled
+ *
+ * @param cycles number of send intervals to simulate
+ */
+void bench_run_cycles(uint32_t cycles)
+{
+	while (true)
+	{
+		if (((g_task_event_type & STATUS) == STATUS) && (g_sim_stats.status_events >= cycles))
+		{
+			// Next cycle would start, stop here
+			return;
+		}
+		if (g_task_event_type != NO_EVENT)
+		{
+			sim_dispatch_events();
+			continue;
+		}
+		if (!sim_advance_to_next_event(UINT64_MAX))
+		{
+			return;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *name = argc > 1 ? argv[1] : "cycle";
+	for (const s_bench &bench : bench_list)
+	{
+		if (strcmp(bench.name, name) == 0)
+		{
+			return bench.run(argc > 1 ? argc - 2 : 0, argc > 1 ? &argv[2] : argv);
+		}
+	}
+	printf("Usage: %s <benchmark> [key=value ...]\n", argv[0]);
+	for (const s_bench &bench : bench_list)
+	{
+		printf("  %-12s %s\n", bench.name, bench.desc);
+	}
+	return 1;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file bench_parser.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Compares the single pass response extractor against the RAK_BLUES accessors,
+ *        checks the precision of the fixed-point coordinates against the float path
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+#include <chrono>
+
+/** Responses as the NoteCard sends them */
+static const char location_response[] = "{\"status\":\"GPS updated (58 sec, 41dB SNR, 9 sats) {gps-active} {gps-signal} {gps-sats} {gps}\","
+										"\"mode\":\"periodic\",\"lat\":35.6812362,\"lon\":139.7671248,\"time\":1760601234,\"dop\":1.3,\"max\":25}";
+static const char time_response[] = "{\"time\":1760601299,\"area\":\"Tokyo\",\"zone\":\"JST,Asia/Tokyo\",\"minutes\":540,"
+									"\"lat\":35.6854362,\"lon\":139.7640248,\"country\":\"JP\"}";
+static const char wireless_response[] = "{\"status\":\"{modem-on}\",\"mode\":\"auto\",\"method\":\"dual-primary-secondary\",\"apn\":\"internet\","
+										"\"count\":3,\"net\":{\"band\":\"LTE BAND 3\",\"rat\":\"lte\",\"rssi\":-70,\"bars\":2,\"mcc\":440,\"mnc\":10}}";
+
+/** Values read with the RAK_BLUES accessors, as blues.cpp did before */
+struct s_rak_values
+{
+	float lat;
+	float lon;
+	uint32_t time;
+	char str_value[128];
+	uint8_t sim_usage;
+	bool net_band;
+};
+
+static void rak_location(s_rak_values *values)
+{
+	if (rak_blues.has_entry((char *)"status") && rak_blues.get_string_entry((char *)"status", values->str_value, 128))
+	{
+		String gnss_status = String(values->str_value);
+		values->sim_usage = (gnss_status.indexOf("search") > 0) + (gnss_status.indexOf("inactive") > 0) + (gnss_status.indexOf("updated") > 0);
+	}
+	if (rak_blues.has_entry((char *)"lat") && rak_blues.has_entry((char *)"lon"))
+	{
+		rak_blues.get_float_entry((char *)"lat", values->lat);
+		rak_blues.get_float_entry((char *)"lon", values->lon);
+		if (rak_blues.has_entry((char *)"time"))
+		{
+			rak_blues.get_uint32_entry((char *)"time", values->time);
+		}
+	}
+}
+
+static void rak_time(s_rak_values *values)
+{
+	if (rak_blues.has_entry((char *)"lat") && rak_blues.has_entry((char *)"lon"))
+	{
+		if (rak_blues.has_entry((char *)"country"))
+		{
+			rak_blues.get_string_entry((char *)"country", values->str_value, 20);
+		}
+		rak_blues.get_float_entry((char *)"lat", values->lat);
+		rak_blues.get_float_entry((char *)"lon", values->lon);
+		if (rak_blues.has_entry((char *)"time"))
+		{
+			rak_blues.get_uint32_entry((char *)"time", values->time);
+		}
+	}
+}
+
+static void rak_wireless(s_rak_values *values)
+{
+	if (rak_blues.has_entry((char *)"apn"))
+	{
+		rak_blues.get_string_entry((char *)"apn", values->str_value, 128);
+	}
+	if (rak_blues.has_entry((char *)"method"))
+	{
+		char method_str[128];
+		rak_blues.get_string_entry((char *)"method", method_str, 128);
+		values->sim_usage = strcmp(method_str, "dual-primary-secondary") == 0 ? 3 : 0;
+	}
+	values->net_band = rak_blues.has_entry((char *)"net") && rak_blues.has_nested_entry((char *)"net", (char *)"band");
+}
+
+/** Response with the accessor sequence used for it */
+struct s_parser_case
+{
+	const char *name;
+	const char *response;
+	void (*rak)(s_rak_values *values);
+};
+
+static const s_parser_case parser_cases[] = {
+	{"card.location", location_response, rak_location},
+	{"card.time", time_response, rak_time},
+	{"card.wireless", wireless_response, rak_wireless},
+};
+
+/** Coordinates with a known value in 1e-7 degrees */
+struct s_precision_case
+{
+	const char *text;
+	int32_t expected;
+};
+
+static const s_precision_case precision_cases[] = {
+	{"35.6812362", 356812362},
+	{"-33.8688197", -338688197},
+	{"139.7671248", 1397671248},
+	{"-179.9999999", -1799999999},
+	{"179.9999999", 1799999999},
+	{"-0.0000001", -1},
+	{"0", 0},
+	{"0.0", 0},
+	{"12.5", 125000000},
+	{"-12", -120000000},
+	{"35.68123625", 356812363},
+	{"35.68123624", 356812362},
+	{"-35.68123625", -356812363},
+	{"89.99999995", 900000000},
+};
+
+/**
+ * @brief Parse a coordinate with the extractor
+ *
+ */
+static bool parse_coordinate(const char *text, int32_t *value)
+{
+	char json[64];
+	s_blues_response parsed;
+	snprintf(json, sizeof(json), "{\"lat\":%s,\"lon\":0}", text);
+	if (!blues_parse_response(json, &parsed) || !(parsed.fields & BLUES_HAS_LOCATION))
+	{
+		return false;
+	}
+	*value = parsed.lat;
+	return true;
+}
+
+/**
+ * @brief Parse a coordinate as blues.cpp did before, through float
+ *
+ */
+static int32_t float_coordinate(const char *text)
+{
+	float value = strtof(text, NULL);
+	return (int32_t)(value * 10000000);
+}
+
+/**
+ * @brief Check the fixed and the float path against known and random coordinates
+ *
+ * @return uint32_t number of wrong results of the fixed-point path
+ */
+static uint32_t parser_precision(uint32_t samples)
+{
+	uint32_t fixed_wrong = 0;
+	uint32_t float_wrong = 0;
+	uint32_t float_wrong_lpp = 0;
+	int32_t float_max_err = 0;
+	char text[24];
+	int32_t value;
+
+	for (const s_precision_case &test : precision_cases)
+	{
+		if (!parse_coordinate(test.text, &value) || (value != test.expected))
+		{
+			printf("  FAIL %s -> %ld, expected %ld\n", test.text, (long)value, (long)test.expected);
+			fixed_wrong++;
+		}
+	}
+
+	for (uint32_t idx = 0; idx < samples; idx++)
+	{
+		// Coordinate in 1e-7 degrees, printed with 7 decimals as the NoteCard does
+		int32_t expected = (int32_t)random(-1800000000L, 1800000000L);
+		uint32_t magnitude = expected < 0 ? -(uint32_t)expected : expected;
+		snprintf(text, sizeof(text), "%s%lu.%07lu", expected < 0 ? "-" : "", (unsigned long)(magnitude / 10000000), (unsigned long)(magnitude % 10000000));
+		if (!parse_coordinate(text, &value) || (value != expected))
+		{
+			if (fixed_wrong < 10)
+			{
+				printf("  FAIL %s -> %ld\n", text, (long)value);
+			}
+			fixed_wrong++;
+		}
+		int32_t float_value = float_coordinate(text);
+		int32_t err = float_value > expected ? float_value - expected : expected - float_value;
+		if (err != 0)
+		{
+			float_wrong++;
+		}
+		if (float_value / 10 != expected / 10)
+		{
+			float_wrong_lpp++;
+		}
+		if (err > float_max_err)
+		{
+			float_max_err = err;
+		}
+	}
+
+	uint32_t total = samples + sizeof(precision_cases) / sizeof(s_precision_case);
+	printf("Precision, %u coordinates\n", total);
+	printf("  fixed-point  %u wrong\n", fixed_wrong);
+	printf("  float        %u wrong, %u wrong at the 1e-6 LPP resolution, max error %.7f deg\n",
+		   float_wrong, float_wrong_lpp, float_max_err / 10000000.0);
+	return fixed_wrong;
+}
+
+/**
+ * @brief Response parser benchmark
+ *        Arguments: iter=N samples=N seed=N
+ *        Returns 1 if a coordinate is not converted exactly, can be used as a test.
+ *
+ */
+int bench_parser(int argc, char **argv)
+{
+	uint32_t iterations = bench_arg_u32(argc, argv, "iter", 20000);
+	uint32_t samples = bench_arg_u32(argc, argv, "samples", 100000);
+	bench_apply_sim_args(argc, argv);
+	sim_reset();
+
+	printf("Response         bytes  RAK_BLUES ns  extractor ns\n");
+	for (const s_parser_case &test : parser_cases)
+	{
+		s_rak_values values;
+		s_blues_response parsed;
+		memset(&values, 0, sizeof(values));
+		rak_blues.sim_set_response(test.response);
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t idx = 0; idx < iterations; idx++)
+		{
+			test.rak(&values);
+		}
+		auto middle = std::chrono::steady_clock::now();
+		for (uint32_t idx = 0; idx < iterations; idx++)
+		{
+			blues_parse_response(test.response, &parsed);
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		double rak_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count() / iterations;
+		double parse_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count() / iterations;
+		printf("  %-14s %5u %13.0f %13.0f\n", test.name, (unsigned)strlen(test.response), rak_ns, parse_ns);
+	}
+
+	return parser_precision(samples) == 0 ? 0 : 1;
+}
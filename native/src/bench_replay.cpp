@@ -0,0 +1,155 @@
+/**
+ * @file bench_replay.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Record a NoteCard transcript from the simulation and replay recorded transcripts
+ *        through init_blues(), blues_get_location() and blues_attn_reason()
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+#include <map>
+#include <string>
+
+/** Output file of the capture */
+static FILE *capture_out = NULL;
+
+static void write_capture_line(const char *line)
+{
+	fprintf(capture_out, "%s\n", line);
+}
+
+/**
+ * @brief Run a simulated session with capture enabled and write the transcript
+ *        in the same format as AT+BCAPX
+ *        Arguments: out=file cycles=N plus the simulation knobs
+ *
+ */
+int bench_capture(int argc, char **argv)
+{
+	const char *out = bench_arg_str(argc, argv, "out", "bcap.txt");
+	uint32_t cycles = bench_arg_u32(argc, argv, "cycles", 10);
+	bench_apply_sim_args(argc, argv);
+
+	save_blues_settings();
+	settings_flush();
+	blues_capture_start(true);
+	sim_boot();
+	bench_run_cycles(cycles);
+	blues_capture_stop();
+
+	capture_out = fopen(out, "w");
+	if (capture_out == NULL)
+	{
+		printf("Can't open %s\n", out);
+		return 1;
+	}
+	uint16_t lines = blues_capture_export(write_capture_line);
+	fprintf(capture_out, "BCAP:END,%d\n", lines);
+	fclose(capture_out);
+	printf("%d records written to %s\n", lines, out);
+	return 0;
+}
+
+static void print_payload(void)
+{
+	printf("    payload %2d bytes:", g_solution_data.getSize());
+	for (int idx = 0; idx < g_solution_data.getSize(); idx++)
+	{
+		printf(" %02X", g_solution_data.getBuffer()[idx]);
+	}
+	printf("\n");
+}
+
+/** Per request statistics of the recorded session */
+struct s_req_profile
+{
+	uint32_t count = 0;
+	uint32_t failed = 0;
+	uint32_t total_ms = 0;
+	uint32_t max_ms = 0;
+	uint32_t resp_bytes = 0;
+};
+
+/**
+ * @brief Replay a transcript. Each card.version record starts init_blues(), each card.location
+ *        record starts blues_get_location() and each card.attn query starts blues_attn_reason().
+ *        Records consumed by these functions are answered from the transcript, other records
+ *        are skipped.
+ *        Arguments: file=transcript saved=0|1
+ *
+ */
+int bench_replay(int argc, char **argv)
+{
+	const char *path = bench_arg_str(argc, argv, "file", "bcap.txt");
+	bench_apply_sim_args(argc, argv);
+
+	if (bench_arg_u32(argc, argv, "saved", 1) != 0)
+	{
+		save_blues_settings();
+		settings_flush();
+	}
+	sim_reset();
+	if (!sim_replay_load(path))
+	{
+		printf("No BCAP records found in %s\n", path);
+		return 1;
+	}
+
+	uint32_t skipped = 0;
+	while (sim_replay_cursor() < sim_replay_count())
+	{
+		const s_replay_record *record = sim_replay_record(sim_replay_cursor());
+		uint64_t start = sim_now_us();
+		if (record->req == "card.version")
+		{
+			bool result = init_blues();
+			printf("@%lu init_blues() = %s (%.0f ms)\n", (unsigned long)record->start_ms, result ? "true" : "false", (double)(sim_now_us() - start) / 1000.0);
+		}
+		else if (record->req == "card.location")
+		{
+			g_solution_data.reset();
+			bool result = blues_get_location();
+			printf("@%lu blues_get_location() = %s (%.0f ms)\n", (unsigned long)record->start_ms, result ? "true" : "false", (double)(sim_now_us() - start) / 1000.0);
+			print_payload();
+		}
+		else if ((record->req == "card.attn") && ((record->response.find("\"files\"") != std::string::npos) || (record->response.find("\"set\"") != std::string::npos)))
+		{
+			uint8_t reason = blues_attn_reason();
+			printf("@%lu blues_attn_reason() = %d (%.0f ms)\n", (unsigned long)record->start_ms, reason, (double)(sim_now_us() - start) / 1000.0);
+		}
+		else
+		{
+			sim_replay_skip();
+			skipped++;
+		}
+	}
+
+	// Profile of the recorded session
+	std::map<std::string, s_req_profile> profile;
+	for (size_t idx = 0; idx < sim_replay_count(); idx++)
+	{
+		const s_replay_record *record = sim_replay_record(idx);
+		s_req_profile &entry = profile[record->req];
+		entry.count++;
+		entry.failed += record->success ? 0 : 1;
+		entry.total_ms += record->duration_ms;
+		entry.max_ms = std::max(entry.max_ms, record->duration_ms);
+		entry.resp_bytes += (uint32_t)record->response.size();
+	}
+	printf("\nRecorded session: %u records, %u skipped, %u requests not found in transcript, %u matched by request body\n",
+		   (unsigned)sim_replay_count(), skipped, sim_replay_mismatches(), sim_replay_body_matches());
+	printf("%-22s %6s %6s %9s %7s %10s\n", "request", "count", "failed", "avg ms", "max ms", "avg bytes");
+	for (auto &entry : profile)
+	{
+		printf("%-22s %6u %6u %9.1f %7u %10.1f\n", entry.first.c_str(), entry.second.count, entry.second.failed,
+			   (double)entry.second.total_ms / entry.second.count, entry.second.max_ms,
+			   (double)entry.second.resp_bytes / entry.second.count);
+	}
+	sim_replay_stop();
+	return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file bench_serializer.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Compares requests built with RAK_BLUES against requests streamed from flash
+ *        with blues_send(), bytes built in RAM and time spent per request
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+#include <chrono>
+
+/** Payload used for note.add, size of a typical cycle */
+static uint8_t bench_payload[48];
+
+static void fill_attn_arm(void *arg)
+{
+	(void)arg;
+	rak_blues.add_string_entry((char *)"mode", (char *)"arm");
+}
+
+static void fill_location_off(void *arg)
+{
+	(void)arg;
+	rak_blues.add_string_entry((char *)"mode", (char *)"off");
+}
+
+static void fill_hub_set(void *arg)
+{
+	(void)arg;
+	rak_blues.add_string_entry((char *)"product", g_blues_settings.product_uid);
+	rak_blues.add_string_entry((char *)"mode", (char *)"minimum");
+	rak_blues.add_int32_entry((char *)"seconds", 600);
+	rak_blues.add_bool_entry((char *)"heartbeat", true);
+}
+
+static void write_hub_set(void *arg)
+{
+	(void)arg;
+	blues_write_string("product", g_blues_settings.product_uid);
+	blues_write_int("seconds", 600);
+}
+
+static void fill_note_add(void *arg)
+{
+	(void)arg;
+	char payload_b64[255];
+	rak_blues.add_string_entry((char *)"file", (char *)"data.qo");
+	rak_blues.add_nested_string_entry((char *)"body", (char *)"dev_eui", (char *)"ac1f09fffe000001");
+	rak_blues.myJB64Encode(payload_b64, (const char *)bench_payload, sizeof(bench_payload));
+	rak_blues.add_string_entry((char *)"payload", payload_b64);
+}
+
+static void write_note_add(void *arg)
+{
+	(void)arg;
+	blues_write_nested_string("body", "dev_eui", "ac1f09fffe000001");
+	blues_write_base64("payload", bench_payload, sizeof(bench_payload));
+}
+
+static bool rak_attn_arm(void) { return blues_request("card.attn", fill_attn_arm); }
+static bool rak_location_off(void) { return blues_request("card.location.mode", fill_location_off); }
+static bool rak_hub_set(void) { return blues_request("hub.set", fill_hub_set); }
+static bool rak_note_add(void) { return blues_request("note.add", fill_note_add); }
+
+static bool send_attn_arm(void) { return blues_send(BLUES_REQ("card.attn") BLUES_STR("mode", "arm")); }
+static bool send_location_off(void) { return blues_send(BLUES_REQ("card.location.mode") BLUES_STR("mode", "off")); }
+static bool send_hub_set(void) { return blues_send(BLUES_REQ("hub.set") BLUES_STR("mode", "minimum") BLUES_VAL("heartbeat", true), write_hub_set); }
+static bool send_note_add(void) { return blues_send(BLUES_REQ("note.add") BLUES_STR("file", "data.qo"), write_note_add); }
+
+/** Request sent on both paths */
+struct s_serializer_case
+{
+	const char *name;
+	bool (*rak)(void);
+	bool (*stream)(void);
+	uint16_t fixed_len; // Bytes of the streamed request that stay in flash
+};
+
+static const s_serializer_case serializer_cases[] = {
+	{"card.attn arm", rak_attn_arm, send_attn_arm, sizeof(BLUES_REQ("card.attn") BLUES_STR("mode", "arm")) - 1},
+	{"card.location.mode off", rak_location_off, send_location_off, sizeof(BLUES_REQ("card.location.mode") BLUES_STR("mode", "off")) - 1},
+	{"hub.set", rak_hub_set, send_hub_set, sizeof(BLUES_REQ("hub.set") BLUES_STR("mode", "minimum") BLUES_VAL("heartbeat", true)) - 1},
+	{"note.add 48 bytes", rak_note_add, send_note_add, sizeof(BLUES_REQ("note.add") BLUES_STR("file", "data.qo")) - 1},
+};
+
+/** Result of one path */
+struct s_serializer_result
+{
+	uint32_t failed;
+	double wire_bytes; // Request bytes sent to the NoteCard
+	double host_ns;	   // Host CPU time per request, NoteCard simulation included
+	double card_ms;	   // Virtual time per request
+};
+
+/**
+ * @brief Send a request repeatedly and measure it
+ *
+ */
+static s_serializer_result serializer_run(bool (*send)(void), uint32_t iterations)
+{
+	s_serializer_result result = {0, 0, 0, 0};
+	uint32_t bytes_start = g_sim_stats.bytes_tx;
+	uint64_t virtual_start = sim_now_us();
+	auto host_start = std::chrono::steady_clock::now();
+	for (uint32_t idx = 0; idx < iterations; idx++)
+	{
+		if (!send())
+		{
+			result.failed++;
+		}
+	}
+	auto host_end = std::chrono::steady_clock::now();
+	result.host_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(host_end - host_start).count() / iterations;
+	result.wire_bytes = (double)(g_sim_stats.bytes_tx - bytes_start) / iterations;
+	result.card_ms = (double)(sim_now_us() - virtual_start) / 1000.0 / iterations;
+	return result;
+}
+
+/**
+ * @brief Request serializer benchmark
+ *        Arguments: iter=N plus the simulation knobs
+ *        RAM is the request buffer that must exist before the transfer starts, the full JSON
+ *        text for RAK_BLUES (its JSON document comes on top), one I2C chunk for blues_send().
+ *
+ */
+int bench_serializer(int argc, char **argv)
+{
+	uint32_t iterations = bench_arg_u32(argc, argv, "iter", 2000);
+	bench_apply_sim_args(argc, argv);
+	sim_reset();
+	for (uint8_t idx = 0; idx < sizeof(bench_payload); idx++)
+	{
+		bench_payload[idx] = (uint8_t)(idx * 37 + 11);
+	}
+
+	printf("Request                   path      wire B  RAM B  flash B  host ns/req  card ms/req  failed\n");
+	for (const s_serializer_case &test : serializer_cases)
+	{
+		s_serializer_result rak = serializer_run(test.rak, iterations);
+		s_serializer_result stream = serializer_run(test.stream, iterations);
+		printf("  %-23s RAK_BLUES %7.1f %6.0f %8u %12.0f %12.2f %7u\n", test.name, rak.wire_bytes, rak.wire_bytes, 0, rak.host_ns, rak.card_ms, rak.failed);
+		printf("  %-23s stream    %7.1f %6u %8u %12.0f %12.2f %7u\n", "", stream.wire_bytes, BLUES_I2C_CHUNK, test.fixed_len, stream.host_ns, stream.card_ms, stream.failed);
+	}
+	return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file bench_settings.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Converts an old settings file, writes a burst of AT changes and reads the settings
+ *        back after a cut and a damaged record, checks that the newest valid settings are found
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_bench.h"
+#include "host_sim.h"
+#include <InternalFileSystem.h>
+using namespace Adafruit_LittleFS_Namespace;
+
+/**
+ * @brief Print the result of one step
+ *
+ * @param step name of the step
+ * @param ok result of the check
+ * @return uint32_t 1 if the check failed
+ */
+static uint32_t settings_step(const char *step, bool ok)
+{
+	s_settings_stats *stats = settings_stats();
+	printf("  %-30s %6u %6u %6u %6u  %s\n", step, stats->writes, stats->seq, stats->size, InternalFS._bytes_written, ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+/**
+ * @brief Read the settings as after a reboot
+ *
+ * @return true if saved settings were found
+ */
+static bool settings_reboot(void)
+{
+	g_blues_settings = s_blues_settings();
+	return read_blues_settings();
+}
+
+/**
+ * @brief Settings store benchmark
+ *        Arguments: burst=N number of AT commands in the burst
+ *
+ */
+int bench_settings(int argc, char **argv)
+{
+	uint32_t burst = bench_arg_u32(argc, argv, "burst", 20);
+	bench_apply_sim_args(argc, argv);
+	sim_reset();
+	init_user_at();
+	uint32_t failed = 0;
+
+	printf("Settings store                 writes    seq   size  flash bytes\n");
+
+	// Raw structure of the first firmware with its padding byte set as garbage on the flash
+	s_legacy_settings legacy;
+	memset(&legacy, 0xFF, sizeof(legacy));
+	legacy.valid_mark = 0xAA55;
+	snprintf(legacy.product_uid, sizeof(legacy.product_uid), "com.test.legacy:tracker");
+	legacy.conn_continous = false;
+	legacy.sim_usage = 2;
+	snprintf(legacy.ext_sim_apn, sizeof(legacy.ext_sim_apn), "legacy.apn");
+	legacy.motion_trigger = false;
+	File legacy_file(InternalFS);
+	legacy_file.open("BLUES", FILE_O_WRITE);
+	legacy_file.write((const uint8_t *)&legacy, sizeof(legacy));
+	legacy_file.close();
+	InternalFS._bytes_written = 0;
+
+	// Full flash, the record is not written and the old file is kept
+	InternalFS._full = true;
+	bool ok = settings_reboot() && settings_stats()->migrated && InternalFS.exists("BLUES") && (settings_stats()->writes == 0) &&
+			  (settings_stats()->failed == 1);
+	failed += settings_step("convert on full flash", ok);
+
+	// Space again, the pending record is written and the old file removed
+	InternalFS._full = false;
+	settings_flush();
+	ok = (settings_stats()->writes == 1) && !InternalFS.exists("BLUES") && settings_reboot() &&
+		 (strcmp(g_blues_settings.product_uid, legacy.product_uid) == 0) && (g_blues_settings.sim_usage == 2) &&
+		 (strcmp(g_blues_settings.ext_sim_apn, "legacy.apn") == 0) && !g_blues_settings.motion_trigger && (g_blues_settings.sync_count == 1);
+	failed += settings_step("convert old file", ok);
+
+	// Burst of AT commands, written once after the delay
+	uint32_t writes = settings_stats()->writes;
+	for (uint32_t idx = 0; idx < burst; idx++)
+	{
+		sim_at_command(idx & 1 ? "AT+BDEAD=10:6" : "AT+BDEAD=30:6");
+		sim_advance_us(100000);
+	}
+	sim_at_command("AT+BSYNC=5:30:2");
+	sim_advance_us((SETTINGS_SAVE_DELAY + 100) * 1000);
+	sim_dispatch_events();
+	ok = settings_stats()->writes == writes + 1;
+	failed += settings_step("AT burst", ok);
+	// The old file was written on each change
+	uint32_t legacy_bytes = (burst + 1) * sizeof(s_legacy_settings);
+
+	ok = settings_reboot() && (g_blues_settings.sync_count == 5) && (g_blues_settings.sync_age == 30) && (g_blues_settings.sync_priority == 2) &&
+		 (g_blues_settings.deadband == ((burst & 1) == 0 ? 10 : 30)) && (strcmp(g_blues_settings.ext_sim_apn, "legacy.apn") == 0);
+	failed += settings_step("read back", ok);
+
+	// Same settings again, nothing is written
+	writes = settings_stats()->writes;
+	save_blues_settings();
+	settings_flush();
+	failed += settings_step("unchanged save", settings_stats()->writes == writes);
+
+	// Power failure while the newest record was written, the older record is used
+	std::vector<uint8_t> &newest = InternalFS._files[settings_stats()->seq & 1 ? "BSET0" : "BSET1"];
+	newest.resize(newest.size() / 2);
+	ok = settings_reboot() && (settings_stats()->seq == 1) && (g_blues_settings.sync_count == 1);
+	failed += settings_step("cut record", ok);
+
+	// Damaged newest record, the older record is used
+	g_blues_settings.deadband = 55;
+	save_blues_settings();
+	settings_flush();
+	std::vector<uint8_t> &damaged = InternalFS._files[settings_stats()->seq & 1 ? "BSET0" : "BSET1"];
+	damaged[damaged.size() - 1] ^= 0x10;
+	ok = settings_reboot() && (settings_stats()->seq == 1) && (g_blues_settings.deadband == 0);
+	failed += settings_step("damaged record", ok);
+
+	// NoteCard setting followed by ATZ, written without the delay
+	sim_at_command("AT+BUID=com.test.flush:tracker-atz");
+	ok = settings_reboot() && (strcmp(g_blues_settings.product_uid, "com.test.flush:tracker-atz") == 0);
+	failed += settings_step("AT+BUID and ATZ", ok);
+
+	// Both records gone
+	settings_remove();
+	failed += settings_step("removed", !settings_reboot());
+
+	printf("  Old settings file %u bytes, %u bytes for the burst\n", (unsigned)sizeof(s_legacy_settings), legacy_bytes);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,502 @@
+/**
+ * @file host_arduino.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Virtual clock, software timers, GPIO and Serial for the native host build
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include <Wire.h>
+#include <WisBlock-API-V2.h>
+#include <Adafruit_BME680.h>
+#include "host_sim.h"
+#include <algorithm>
+#include <vector>
+
+s_sim_config g_sim_config;
+s_sim_stats g_sim_stats;
+
+HostSerial Serial;
+
+/** The simulated device runs from the battery, no USB host */
+static host_nrf_power host_power = {0};
+host_nrf_power *NRF_POWER = &host_power;
+
+TwoWire Wire;
+
+/** Virtual time in microseconds */
+static uint64_t sim_time_us = 0;
+
+/**
+ * @brief All timers ever created, the simulation checks them for expiry.
+ *        Function local, the application creates its timers during static initialization.
+ *
+ */
+static std::vector<SoftwareTimer *> &timer_list(void)
+{
+	static std::vector<SoftwareTimer *> timers;
+	return timers;
+}
+
+/** GPIO states */
+static uint8_t pin_state[64];
+
+/** Attached interrupt handlers */
+static void (*pin_isr[64])(void);
+
+/** PRNG state */
+static uint32_t prng_state = 1;
+
+uint64_t sim_now_us(void)
+{
+	return sim_time_us;
+}
+
+uint64_t sim_timer_next_expiry_us(void)
+{
+	uint64_t next = UINT64_MAX;
+	for (SoftwareTimer *timer : timer_list())
+	{
+		if (timer->_active)
+		{
+			// Relative to the 32 bit millis(), the expiry wraps after 49.7 days
+			int64_t delta_ms = (int32_t)(timer->_expires - millis());
+			uint64_t expires = delta_ms > 0 ? (sim_time_us / 1000 + delta_ms) * 1000 : sim_time_us;
+			next = std::min(next, expires);
+		}
+	}
+	return next;
+}
+
+void sim_timer_process_expired(void)
+{
+	uint32_t now = millis();
+	// Copy, a callback may start or stop other timers
+	std::vector<SoftwareTimer *> timers = timer_list();
+	for (SoftwareTimer *timer : timers)
+	{
+		if (timer->_active && ((int32_t)(now - timer->_expires) >= 0))
+		{
+			if (timer->_repeating)
+			{
+				timer->_expires += timer->_period;
+			}
+			else
+			{
+				timer->_active = false;
+			}
+			if (timer->_callback != NULL)
+			{
+				timer->_callback((TimerHandle_t)timer);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Advance the virtual clock, expire timers and let the NoteCard
+ *        produce its events on the way
+ *
+ * @param us time to advance in microseconds
+ */
+void sim_advance_us(uint64_t us)
+{
+	uint64_t target = sim_time_us + us;
+	while (true)
+	{
+		uint64_t next = std::min(sim_timer_next_expiry_us(), sim_card_next_event_us());
+		if (next > target)
+		{
+			break;
+		}
+		if (next > sim_time_us)
+		{
+			sim_time_us = next;
+		}
+		sim_timer_process_expired();
+		sim_card_process_events();
+	}
+	sim_time_us = target;
+}
+
+/**
+ * @brief Advance the virtual clock to the next timer or NoteCard event
+ *
+ * @param limit_us do not advance beyond this time
+ * @return true if an event was reached before the limit
+ */
+bool sim_advance_to_next_event(uint64_t limit_us)
+{
+	uint64_t next = std::min(sim_timer_next_expiry_us(), sim_card_next_event_us());
+	if (next > limit_us)
+	{
+		sim_time_us = std::max(sim_time_us, limit_us);
+		return false;
+	}
+	if (next > sim_time_us)
+	{
+		sim_time_us = next;
+	}
+	sim_timer_process_expired();
+	sim_card_process_events();
+	return true;
+}
+
+void sim_raise_interrupt(uint32_t pin)
+{
+	if ((pin < 64) && (pin_isr[pin] != NULL))
+	{
+		pin_isr[pin]();
+	}
+}
+
+uint32_t millis(void)
+{
+	return (uint32_t)(sim_time_us / 1000);
+}
+
+uint32_t micros(void)
+{
+	return (uint32_t)sim_time_us;
+}
+
+void delay(uint32_t ms)
+{
+	sim_advance_us((uint64_t)ms * 1000);
+}
+
+void pinMode(uint32_t pin, uint32_t mode)
+{
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint32_t pin, uint32_t value)
+{
+	if (pin < 64)
+	{
+		pin_state[pin] = value ? HIGH : LOW;
+	}
+}
+
+int digitalRead(uint32_t pin)
+{
+	return pin < 64 ? pin_state[pin] : LOW;
+}
+
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode)
+{
+	(void)mode;
+	if (pin < 64)
+	{
+		pin_isr[pin] = callback;
+	}
+}
+
+void detachInterrupt(uint32_t pin)
+{
+	if (pin < 64)
+	{
+		pin_isr[pin] = NULL;
+	}
+}
+
+/**
+ * @brief xorshift32, deterministic for a given seed
+ *
+ */
+static uint32_t prng_next(void)
+{
+	prng_state ^= prng_state << 13;
+	prng_state ^= prng_state >> 17;
+	prng_state ^= prng_state << 5;
+	return prng_state;
+}
+
+void randomSeed(unsigned long seed)
+{
+	prng_state = seed ? (uint32_t)seed : 1;
+}
+
+long random(long max)
+{
+	return max <= 0 ? 0 : (long)(prng_next() % (uint32_t)max);
+}
+
+long random(long min, long max)
+{
+	return max <= min ? min : min + random(max - min);
+}
+
+/*********************************************************************/
+/* Serial                                                            */
+/*********************************************************************/
+int HostSerial::printf(const char *format, ...)
+{
+	if (!g_sim_config.verbose)
+	{
+		return 0;
+	}
+	va_list args;
+	va_start(args, format);
+	int len = vprintf(format, args);
+	va_end(args);
+	return len;
+}
+
+size_t HostSerial::print(const char *str)
+{
+	return printf("%s", str);
+}
+
+size_t HostSerial::println(const char *str)
+{
+	return printf("%s\n", str);
+}
+
+size_t HostSerial::write(uint8_t data)
+{
+	return printf("%c", data);
+}
+
+int BLEUart::printf(const char *format, ...)
+{
+	(void)format;
+	return 0;
+}
+
+/*********************************************************************/
+/* Tasks                                                             */
+/*********************************************************************/
+long xTaskCreate(TaskFunction_t task, const char *name, uint16_t stack, void *arg, uint32_t priority, TaskHandle_t *handle)
+{
+	(void)task;
+	(void)name;
+	(void)stack;
+	(void)arg;
+	(void)priority;
+	if (handle != NULL)
+	{
+		*handle = NULL;
+	}
+	return pdPASS;
+}
+
+void vTaskDelay(uint32_t ticks)
+{
+	delay(ticks);
+}
+
+/** Handle of the semaphores, not NULL */
+static uint8_t host_semaphore;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+	return &host_semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+	return &host_semaphore;
+}
+
+long xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+	(void)semaphore;
+	return pdTRUE;
+}
+
+long xSemaphoreTake(SemaphoreHandle_t semaphore, uint32_t ticks)
+{
+	(void)semaphore;
+	(void)ticks;
+	return pdTRUE;
+}
+
+long xSemaphoreGiveRecursive(SemaphoreHandle_t mutex)
+{
+	(void)mutex;
+	return pdTRUE;
+}
+
+long xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, uint32_t ticks)
+{
+	(void)mutex;
+	(void)ticks;
+	return pdTRUE;
+}
+
+/*********************************************************************/
+/* Software timer                                                    */
+/*********************************************************************/
+SoftwareTimer::SoftwareTimer(void)
+{
+	timer_list().push_back(this);
+}
+
+SoftwareTimer::~SoftwareTimer(void)
+{
+	std::vector<SoftwareTimer *> &timers = timer_list();
+	timers.erase(std::remove(timers.begin(), timers.end(), this), timers.end());
+}
+
+void SoftwareTimer::begin(uint32_t ms, TimerCallbackFunction_t callback, void *timerID, bool repeating)
+{
+	_period = ms;
+	_callback = callback;
+	_id = timerID;
+	_repeating = repeating;
+	_active = false;
+}
+
+void SoftwareTimer::start(void)
+{
+	_expires = millis() + _period;
+	_active = true;
+}
+
+void SoftwareTimer::stop(void)
+{
+	_active = false;
+}
+
+void SoftwareTimer::reset(void)
+{
+	if (_active)
+	{
+		start();
+	}
+}
+
+void SoftwareTimer::setPeriod(uint32_t ms)
+{
+	// FreeRTOS xTimerChangePeriod starts the timer as well
+	_period = ms;
+	start();
+}
+
+/*********************************************************************/
+/* I2C, only the NoteCard answers                                    */
+/*********************************************************************/
+void TwoWire::beginTransmission(uint8_t address)
+{
+	_address = address;
+	_tx_len = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+	return write(&data, 1);
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len)
+{
+	size_t written = 0;
+	for (; (written < len) && (_tx_len < sizeof(_tx_buf)); written++)
+	{
+		_tx_buf[_tx_len++] = data[written];
+	}
+	return written;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+	(void)stop;
+	if (_address != SIM_CARD_I2C_ADDR)
+	{
+		return 2;
+	}
+	return sim_card_i2c_write(_tx_buf, _tx_len);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t len, bool stop)
+{
+	(void)stop;
+	_rx_pos = 0;
+	_rx_len = 0;
+	if ((address != SIM_CARD_I2C_ADDR) || (len > sizeof(_rx_buf)))
+	{
+		return 0;
+	}
+	_rx_len = sim_card_i2c_read(_rx_buf, len);
+	return (uint8_t)_rx_len;
+}
+
+int TwoWire::available(void)
+{
+	return (int)(_rx_len - _rx_pos);
+}
+
+int TwoWire::read(void)
+{
+	return _rx_pos < _rx_len ? _rx_buf[_rx_pos++] : -1;
+}
+
+/*********************************************************************/
+/* BME680                                                            */
+/*********************************************************************/
+bool Adafruit_BME680::begin(uint8_t addr, bool initSettings)
+{
+	(void)addr;
+	(void)initSettings;
+	return true;
+}
+
+uint32_t Adafruit_BME680::beginReading(void)
+{
+	_meas_end = millis() + g_sim_config.bme_conversion_ms;
+	return _meas_end;
+}
+
+int Adafruit_BME680::remainingReadingMillis(void)
+{
+	if (_meas_end == 0)
+	{
+		return -1;
+	}
+	int32_t remaining = (int32_t)(_meas_end - millis());
+	return remaining > 0 ? remaining : 0;
+}
+
+bool Adafruit_BME680::endReading(void)
+{
+	if (_meas_end == 0)
+	{
+		beginReading();
+	}
+	int remaining = remainingReadingMillis();
+	if (remaining > 0)
+	{
+		// The driver waits for the conversion to finish
+		delay(remaining);
+	}
+	_meas_end = 0;
+	temperature = 21.5f + (float)random(-20, 20) / 10.0f;
+	humidity = 48.0f + (float)random(-40, 40) / 10.0f;
+	pressure = 101325 + random(-300, 300);
+	return true;
+}
+
+bool Adafruit_BME680::performReading(void)
+{
+	return endReading();
+}
+
+/*********************************************************************/
+/* Reset the simulated world                                         */
+/*********************************************************************/
+void sim_reset_hardware(void)
+{
+	sim_time_us = 0;
+	memset(pin_state, 0, sizeof(pin_state));
+	memset(pin_isr, 0, sizeof(pin_isr));
+	randomSeed(g_sim_config.seed);
+	for (SoftwareTimer *timer : timer_list())
+	{
+		timer->_active = false;
+	}
+	g_sim_stats = s_sim_stats();
+}
@@ -0,0 +1,149 @@
+/**
+ * @file host_littlefs.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief RAM backed LittleFS stand-in for the native host build
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <InternalFileSystem.h>
+#include <algorithm>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+InternalFileSystem InternalFS;
+
+bool Adafruit_LittleFS::exists(char const *filepath)
+{
+	return _files.find(filepath) != _files.end();
+}
+
+bool Adafruit_LittleFS::remove(char const *filepath)
+{
+	return _files.erase(filepath) != 0;
+}
+
+bool Adafruit_LittleFS::rename(char const *oldfilepath, char const *newfilepath)
+{
+	auto file = _files.find(oldfilepath);
+	if (file == _files.end())
+	{
+		return false;
+	}
+	std::vector<uint8_t> data = file->second;
+	_files.erase(file);
+	_files[newfilepath] = data;
+	_commits++;
+	return true;
+}
+
+bool Adafruit_LittleFS::format(void)
+{
+	_files.clear();
+	return true;
+}
+
+bool File::open(char const *filename, uint8_t mode)
+{
+	close();
+	auto file = _fs->_files.find(filename);
+	if (file == _fs->_files.end())
+	{
+		if (mode == FILE_O_READ)
+		{
+			return false;
+		}
+		_data.clear();
+	}
+	else
+	{
+		_data = file->second;
+	}
+	_name = filename;
+	_writable = mode == FILE_O_WRITE;
+	// As the Adafruit wrapper, write mode appends to the end of the file
+	_pos = _writable ? (uint32_t)_data.size() : 0;
+	_open = true;
+	_dirty = _writable && (file == _fs->_files.end());
+	return true;
+}
+
+int File::read(void)
+{
+	uint8_t data;
+	return read(&data, 1) == 1 ? data : -1;
+}
+
+int File::read(void *buf, uint16_t nbyte)
+{
+	if (!_open)
+	{
+		return -1;
+	}
+	uint32_t len = std::min((uint32_t)nbyte, (uint32_t)(_data.size() - _pos));
+	memcpy(buf, &_data[_pos], len);
+	_pos += len;
+	return (int)len;
+}
+
+size_t File::write(uint8_t ch)
+{
+	return write(&ch, 1);
+}
+
+size_t File::write(uint8_t const *buf, size_t size)
+{
+	if (!_open || !_writable || _fs->_full)
+	{
+		return 0;
+	}
+	if (_pos + size > _data.size())
+	{
+		_data.resize(_pos + size);
+	}
+	memcpy(&_data[_pos], buf, size);
+	_pos += (uint32_t)size;
+	_fs->_bytes_written += (uint32_t)size;
+	_dirty = true;
+	return size;
+}
+
+bool File::seek(uint32_t pos)
+{
+	if (!_open || (pos > _data.size()))
+	{
+		return false;
+	}
+	_pos = pos;
+	return true;
+}
+
+bool File::truncate(uint32_t pos)
+{
+	if (!_open || !_writable)
+	{
+		return false;
+	}
+	_data.resize(pos);
+	_pos = std::min(_pos, pos);
+	_dirty = true;
+	return true;
+}
+
+void File::flush(void)
+{
+	if (_open && _dirty)
+	{
+		_fs->_files[_name] = _data;
+		_fs->_commits++;
+		_dirty = false;
+	}
+}
+
+void File::close(void)
+{
+	flush();
+	_open = false;
+}
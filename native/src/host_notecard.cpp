@@ -0,0 +1,1025 @@
+/**
+ * @file host_notecard.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Simulated Blues NoteCard and the RAK_BLUES stand-in talking to it
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <blues-minimal-i2c.h>
+#include "host_sim.h"
+#include <algorithm>
+
+/** Epoch of the simulated card clock at virtual time 0 */
+#define SIM_EPOCH 1790000000UL
+
+/** "Never" on the virtual clock */
+#define SIM_NEVER UINT64_MAX
+
+/** State of the simulated NoteCard */
+struct s_sim_card
+{
+	std::string location_mode = "off";
+	bool have_fix = false;
+	bool fix_in_window = false;
+	uint32_t fix_time = 0;
+	double fix_lat = 0;
+	double fix_lon = 0;
+	uint64_t gnss_on_at = 0;
+	uint64_t next_fix_at = SIM_NEVER;
+
+	bool attn_armed = false;
+	bool attn_motion = false;
+	bool attn_location = false;
+	std::string attn_files;
+
+	bool motion_on = false;
+	uint32_t motion_count = 0;
+	double moved_lat = 0; // Distance the asset moved with the motion events
+	double moved_lon = 0;
+	uint64_t next_motion_at = SIM_NEVER;
+
+	std::string hub_mode = "minimum";
+	std::string product = "com.my-company.my-name:my-project";
+	std::string method = "primary";
+	std::string apn;
+	uint32_t notes_pending = 0;
+	uint64_t sync_end_at = SIM_NEVER; // End of the last or running sync session
+};
+
+static s_sim_card card;
+
+/*********************************************************************/
+/* JSON helpers                                                      */
+/*********************************************************************/
+static size_t json_skip_ws(const std::string &json, size_t pos)
+{
+	while ((pos < json.size()) && isspace((unsigned char)json[pos]))
+	{
+		pos++;
+	}
+	return pos;
+}
+
+static size_t json_skip_string(const std::string &json, size_t pos)
+{
+	// pos is at the opening quote
+	for (pos++; pos < json.size(); pos++)
+	{
+		if (json[pos] == '\\')
+		{
+			pos++;
+		}
+		else if (json[pos] == '"')
+		{
+			return pos + 1;
+		}
+	}
+	return pos;
+}
+
+static size_t json_skip_value(const std::string &json, size_t pos)
+{
+	if (pos >= json.size())
+	{
+		return pos;
+	}
+	if (json[pos] == '"')
+	{
+		return json_skip_string(json, pos);
+	}
+	if ((json[pos] == '{') || (json[pos] == '['))
+	{
+		int depth = 0;
+		while (pos < json.size())
+		{
+			char c = json[pos];
+			if (c == '"')
+			{
+				pos = json_skip_string(json, pos);
+				continue;
+			}
+			if ((c == '{') || (c == '['))
+			{
+				depth++;
+			}
+			else if ((c == '}') || (c == ']'))
+			{
+				if (--depth == 0)
+				{
+					return pos + 1;
+				}
+			}
+			pos++;
+		}
+		return pos;
+	}
+	while ((pos < json.size()) && (json[pos] != ',') && (json[pos] != '}') && (json[pos] != ']'))
+	{
+		pos++;
+	}
+	return pos;
+}
+
+/**
+ * @brief Find a top level key of a JSON object
+ *
+ * @param json JSON object as text
+ * @param key key to search for
+ * @param raw value as JSON text
+ * @return true if the key exists
+ */
+bool sim_json_find(const std::string &json, const char *key, std::string &raw)
+{
+	size_t pos = json_skip_ws(json, 0);
+	if ((pos >= json.size()) || (json[pos] != '{'))
+	{
+		return false;
+	}
+	pos++;
+	while (true)
+	{
+		pos = json_skip_ws(json, pos);
+		if ((pos >= json.size()) || (json[pos] != '"'))
+		{
+			return false;
+		}
+		size_t key_end = json_skip_string(json, pos);
+		std::string this_key = json.substr(pos + 1, key_end - pos - 2);
+		pos = json_skip_ws(json, key_end);
+		if ((pos >= json.size()) || (json[pos] != ':'))
+		{
+			return false;
+		}
+		pos = json_skip_ws(json, pos + 1);
+		size_t value_end = json_skip_value(json, pos);
+		if (this_key == key)
+		{
+			raw = json.substr(pos, value_end - pos);
+			while (!raw.empty() && isspace((unsigned char)raw.back()))
+			{
+				raw.pop_back();
+			}
+			return true;
+		}
+		pos = json_skip_ws(json, value_end);
+		if ((pos >= json.size()) || (json[pos] != ','))
+		{
+			return false;
+		}
+		pos++;
+	}
+}
+
+std::string sim_json_unquote(const std::string &raw)
+{
+	if ((raw.size() < 2) || (raw[0] != '"'))
+	{
+		return raw;
+	}
+	std::string value;
+	for (size_t idx = 1; idx < raw.size() - 1; idx++)
+	{
+		if ((raw[idx] == '\\') && (idx + 1 < raw.size() - 1))
+		{
+			idx++;
+			value += raw[idx] == 'n' ? '\n' : raw[idx];
+		}
+		else
+		{
+			value += raw[idx];
+		}
+	}
+	return value;
+}
+
+static std::string json_quote(const char *value)
+{
+	std::string quoted = "\"";
+	for (const char *c = value; *c; c++)
+	{
+		if ((*c == '"') || (*c == '\\'))
+		{
+			quoted += '\\';
+		}
+		quoted += *c;
+	}
+	return quoted + "\"";
+}
+
+/*********************************************************************/
+/* RAK_BLUES stand-in                                                */
+/*********************************************************************/
+bool RAK_BLUES::start_req(char *request)
+{
+	_req_name = request;
+	_req_body.clear();
+	_nested.clear();
+	return true;
+}
+
+bool RAK_BLUES::send_req(char *response, uint16_t resp_len)
+{
+	std::string request = "{\"req\":" + json_quote(_req_name.c_str()) + _req_body;
+	for (auto &nested : _nested)
+	{
+		request += ",\"" + nested.first + "\":{" + nested.second + "}";
+	}
+	request += "}\n";
+
+	// The library writes the serialized request in I2C chunks, paced for the NoteCard
+	// receive buffer as the streamed path: 20 ms per chunk and 250 ms after 250 bytes
+	size_t segment = 0;
+	for (size_t sent = 0; sent < request.size(); sent += 30)
+	{
+		delay(20);
+		segment += std::min((size_t)30, request.size() - sent);
+		if (segment >= 250)
+		{
+			delay(250);
+			segment = 0;
+		}
+	}
+	_response = sim_card_transaction(request);
+	if (_response.empty())
+	{
+		return false;
+	}
+	if ((response != NULL) && (resp_len != 0))
+	{
+		snprintf(response, resp_len, "%s", _response.c_str());
+	}
+	std::string err;
+	return !sim_json_find(_response, "err", err);
+}
+
+void RAK_BLUES::add_raw_entry(const char *type, const std::string &value)
+{
+	_req_body += ",\"" + std::string(type) + "\":" + value;
+}
+
+void RAK_BLUES::add_raw_nested_entry(const char *type, const char *nested, const std::string &value)
+{
+	for (auto &entry : _nested)
+	{
+		if (entry.first == type)
+		{
+			entry.second += ",\"" + std::string(nested) + "\":" + value;
+			return;
+		}
+	}
+	_nested.push_back(std::make_pair(std::string(type), "\"" + std::string(nested) + "\":" + value));
+}
+
+void RAK_BLUES::add_string_entry(char *type, char *value)
+{
+	add_raw_entry(type, json_quote(value));
+}
+
+void RAK_BLUES::add_bool_entry(char *type, bool value)
+{
+	add_raw_entry(type, value ? "true" : "false");
+}
+
+void RAK_BLUES::add_int32_entry(char *type, int32_t value)
+{
+	add_raw_entry(type, std::to_string(value));
+}
+
+void RAK_BLUES::add_uint32_entry(char *type, uint32_t value)
+{
+	add_raw_entry(type, std::to_string(value));
+}
+
+void RAK_BLUES::add_float_entry(char *type, float value)
+{
+	char number[32];
+	snprintf(number, sizeof(number), "%g", value);
+	add_raw_entry(type, number);
+}
+
+void RAK_BLUES::add_nested_string_entry(char *type, char *nested, char *value)
+{
+	add_raw_nested_entry(type, nested, json_quote(value));
+}
+
+void RAK_BLUES::add_nested_int32_entry(char *type, char *nested, int32_t value)
+{
+	add_raw_nested_entry(type, nested, std::to_string(value));
+}
+
+void RAK_BLUES::add_nested_uint32_entry(char *type, char *nested, uint32_t value)
+{
+	add_raw_nested_entry(type, nested, std::to_string(value));
+}
+
+void RAK_BLUES::add_nested_bool_entry(char *type, char *nested, bool value)
+{
+	add_raw_nested_entry(type, nested, value ? "true" : "false");
+}
+
+bool RAK_BLUES::find_value(const char *type, const char *nested, std::string &raw)
+{
+	if (!sim_json_find(_response, type, raw))
+	{
+		return false;
+	}
+	if (nested == NULL)
+	{
+		return true;
+	}
+	std::string object = raw;
+	return sim_json_find(object, nested, raw);
+}
+
+bool RAK_BLUES::has_entry(char *type)
+{
+	std::string raw;
+	return find_value(type, NULL, raw);
+}
+
+bool RAK_BLUES::has_nested_entry(char *type, char *nested)
+{
+	std::string raw;
+	return find_value(type, nested, raw);
+}
+
+bool RAK_BLUES::get_string_entry(char *type, char *value, uint16_t value_size)
+{
+	std::string raw;
+	if (!find_value(type, NULL, raw))
+	{
+		return false;
+	}
+	snprintf(value, value_size, "%s", sim_json_unquote(raw).c_str());
+	return true;
+}
+
+bool RAK_BLUES::get_string_entry_from_array(char *type, char *value, uint16_t value_size)
+{
+	std::string raw;
+	if (!find_value(type, NULL, raw) || raw.empty() || (raw[0] != '['))
+	{
+		return false;
+	}
+	// Array members separated by comma, without quotes
+	std::string members;
+	for (char c : raw.substr(1, raw.size() - 2))
+	{
+		if (c != '"')
+		{
+			members += c;
+		}
+	}
+	snprintf(value, value_size, "%s", members.c_str());
+	return true;
+}
+
+bool RAK_BLUES::get_bool_entry(char *type, bool &value)
+{
+	std::string raw;
+	if (!find_value(type, NULL, raw))
+	{
+		return false;
+	}
+	value = raw == "true";
+	return true;
+}
+
+bool RAK_BLUES::get_int32_entry(char *type, int32_t &value)
+{
+	std::string raw;
+	if (!find_value(type, NULL, raw))
+	{
+		return false;
+	}
+	value = (int32_t)strtol(raw.c_str(), NULL, 10);
+	return true;
+}
+
+bool RAK_BLUES::get_uint32_entry(char *type, uint32_t &value)
+{
+	std::string raw;
+	if (!find_value(type, NULL, raw))
+	{
+		return false;
+	}
+	value = (uint32_t)strtoul(raw.c_str(), NULL, 10);
+	return true;
+}
+
+bool RAK_BLUES::get_float_entry(char *type, float &value)
+{
+	std::string raw;
+	if (!find_value(type, NULL, raw))
+	{
+		return false;
+	}
+	value = strtof(raw.c_str(), NULL);
+	return true;
+}
+
+bool RAK_BLUES::get_nested_string_entry(char *type, char *nested, char *value, uint16_t value_size)
+{
+	std::string raw;
+	if (!find_value(type, nested, raw))
+	{
+		return false;
+	}
+	snprintf(value, value_size, "%s", sim_json_unquote(raw).c_str());
+	return true;
+}
+
+bool RAK_BLUES::get_nested_int32_entry(char *type, char *nested, int32_t &value)
+{
+	std::string raw;
+	if (!find_value(type, nested, raw))
+	{
+		return false;
+	}
+	value = (int32_t)strtol(raw.c_str(), NULL, 10);
+	return true;
+}
+
+bool RAK_BLUES::get_nested_uint32_entry(char *type, char *nested, uint32_t &value)
+{
+	std::string raw;
+	if (!find_value(type, nested, raw))
+	{
+		return false;
+	}
+	value = (uint32_t)strtoul(raw.c_str(), NULL, 10);
+	return true;
+}
+
+bool RAK_BLUES::get_nested_bool_entry(char *type, char *nested, bool &value)
+{
+	std::string raw;
+	if (!find_value(type, nested, raw))
+	{
+		return false;
+	}
+	value = raw == "true";
+	return true;
+}
+
+size_t RAK_BLUES::myJB64Encode(char *encoded, const char *string, size_t len)
+{
+	static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	char *out = encoded;
+	size_t idx;
+	for (idx = 0; idx + 2 < len; idx += 3)
+	{
+		*out++ = b64[(string[idx] >> 2) & 0x3F];
+		*out++ = b64[((string[idx] & 0x3) << 4) | ((string[idx + 1] & 0xF0) >> 4)];
+		*out++ = b64[((string[idx + 1] & 0xF) << 2) | ((string[idx + 2] & 0xC0) >> 6)];
+		*out++ = b64[string[idx + 2] & 0x3F];
+	}
+	if (idx < len)
+	{
+		*out++ = b64[(string[idx] >> 2) & 0x3F];
+		if (idx == (len - 1))
+		{
+			*out++ = b64[((string[idx] & 0x3) << 4)];
+			*out++ = '=';
+		}
+		else
+		{
+			*out++ = b64[((string[idx] & 0x3) << 4) | ((string[idx + 1] & 0xF0) >> 4)];
+			*out++ = b64[((string[idx + 1] & 0xF) << 2)];
+		}
+		*out++ = '=';
+	}
+	*out = 0;
+	return (size_t)(out - encoded);
+}
+
+/*********************************************************************/
+/* Simulated NoteCard                                                */
+/** I2C model of the NoteCard, used by requests that are streamed without RAK_BLUES */
+static std::string i2c_request;
+static std::string i2c_response;
+static uint8_t i2c_read_len = 0;
+static bool i2c_nack = false;
+
+/*********************************************************************/
+static uint32_t card_epoch(void)
+{
+	return (uint32_t)(SIM_EPOCH + sim_now_us() / 1000000);
+}
+
+/**
+ * @brief Start a background sync session, a running session continues
+ *
+ */
+static void card_start_sync(void)
+{
+	g_sim_stats.hub_syncs++;
+	card.notes_pending = 0;
+	if ((card.sync_end_at == SIM_NEVER) || (card.sync_end_at <= sim_now_us()))
+	{
+		card.sync_end_at = sim_now_us() + (uint64_t)g_sim_config.card_sync_session_ms * 1000;
+	}
+}
+
+static void schedule_motion(void)
+{
+	if (g_sim_config.motion_period_ms == 0)
+	{
+		card.next_motion_at = SIM_NEVER;
+		return;
+	}
+	uint32_t period = g_sim_config.motion_period_ms / 2 + (uint32_t)random(g_sim_config.motion_period_ms);
+	card.next_motion_at = sim_now_us() + (uint64_t)period * 1000;
+	if (g_sim_config.trip_ms != 0)
+	{
+		// Motion only during the trips, move the event to the start of the next trip
+		uint64_t cycle_us = ((uint64_t)g_sim_config.trip_ms + g_sim_config.park_ms) * 1000;
+		uint64_t in_cycle_us = card.next_motion_at % cycle_us;
+		if (in_cycle_us >= (uint64_t)g_sim_config.trip_ms * 1000)
+		{
+			card.next_motion_at += cycle_us - in_cycle_us;
+		}
+	}
+}
+
+void sim_reset_card(void)
+{
+	card = s_sim_card();
+	i2c_request.clear();
+	i2c_response.clear();
+	i2c_read_len = 0;
+	i2c_nack = false;
+	schedule_motion();
+}
+
+/**
+ * @brief The card raises ATTN and disarms, as the real NoteCard does
+ *
+ */
+static void card_fire_attn(const char *file)
+{
+	card.attn_files = file;
+	card.attn_armed = false;
+	g_sim_stats.attn_irqs++;
+	sim_raise_interrupt(WB_IO5);
+}
+
+uint64_t sim_card_next_event_us(void)
+{
+	return std::min(card.next_fix_at, card.next_motion_at);
+}
+
+void sim_card_process_events(void)
+{
+	uint64_t now = sim_now_us();
+	if (card.next_fix_at <= now)
+	{
+		card.next_fix_at = SIM_NEVER;
+		card.have_fix = true;
+		card.fix_in_window = true;
+		card.fix_time = card_epoch();
+		card.fix_lat = g_sim_config.lat + card.moved_lat + (double)random(-50, 50) / 1e6;
+		card.fix_lon = g_sim_config.lon + card.moved_lon + (double)random(-50, 50) / 1e6;
+		g_sim_stats.gnss_fixes++;
+		if (card.attn_armed && card.attn_location)
+		{
+			card_fire_attn("location");
+		}
+	}
+	if (card.next_motion_at <= now)
+	{
+		schedule_motion();
+		// Each motion event moves the asset up to ~50m
+		card.moved_lat += (double)random(-450, 450) / 1e6;
+		card.moved_lon += (double)random(-450, 450) / 1e6;
+		if (card.motion_on)
+		{
+			card.motion_count++;
+			if (card.attn_armed && card.attn_motion)
+			{
+				card_fire_attn("motion");
+			}
+		}
+	}
+}
+
+static bool req_string(const std::string &request, const char *key, std::string &value)
+{
+	std::string raw;
+	if (!sim_json_find(request, key, raw))
+	{
+		return false;
+	}
+	value = sim_json_unquote(raw);
+	return true;
+}
+
+static bool req_true(const std::string &request, const char *key)
+{
+	std::string raw;
+	return sim_json_find(request, key, raw) && (raw == "true");
+}
+
+static void card_set_location_mode(const std::string &mode)
+{
+	if ((mode == "continuous") && (card.location_mode != "continuous"))
+	{
+		card.gnss_on_at = sim_now_us();
+		card.fix_in_window = false;
+		if (random(100) < g_sim_config.gnss_fix_percent)
+		{
+			uint32_t ttff = g_sim_config.gnss_ttff_ms * 8 / 10 + (uint32_t)random(g_sim_config.gnss_ttff_ms * 4 / 10 + 1);
+			card.next_fix_at = card.gnss_on_at + (uint64_t)ttff * 1000;
+		}
+		else
+		{
+			card.next_fix_at = SIM_NEVER;
+		}
+	}
+	else if (mode != "continuous")
+	{
+		card.next_fix_at = SIM_NEVER;
+		if (card.location_mode == "continuous")
+		{
+			g_sim_stats.gnss_on_us += sim_now_us() - card.gnss_on_at;
+		}
+	}
+	card.location_mode = mode;
+}
+
+static std::string card_location(void)
+{
+	char response[512];
+	uint32_t gnss_sec = (uint32_t)((sim_now_us() - card.gnss_on_at) / 1000000);
+	const char *status;
+	char status_buf[128];
+	if (card.location_mode == "off")
+	{
+		status = "GPS inactive {gps-inactive}";
+	}
+	else if (card.fix_in_window)
+	{
+		snprintf(status_buf, sizeof(status_buf), "GPS updated (%u sec, 41dB SNR, 9 sats) {gps-active} {gps-signal} {gps-sats} {gps}", (unsigned)gnss_sec);
+		status = status_buf;
+	}
+	else
+	{
+		snprintf(status_buf, sizeof(status_buf), "GPS search (%u sec, 30/34 dB SNR, 0/4 sats) {gps-active} {gps-signal} {gps-sats}", (unsigned)gnss_sec);
+		status = status_buf;
+	}
+	if (card.have_fix)
+	{
+		snprintf(response, sizeof(response), "{\"status\":\"%s\",\"mode\":\"%s\",\"lat\":%.7f,\"lon\":%.7f,\"time\":%u,\"dop\":1.3,\"max\":25}",
+				 status, card.location_mode.c_str(), card.fix_lat, card.fix_lon, (unsigned)card.fix_time);
+	}
+	else
+	{
+		snprintf(response, sizeof(response), "{\"status\":\"%s\",\"mode\":\"%s\",\"max\":25}", status, card.location_mode.c_str());
+	}
+	return response;
+}
+
+static std::string card_attn(const std::string &request)
+{
+	std::string mode;
+	if (req_string(request, "mode", mode))
+	{
+		size_t start = 0;
+		while (start <= mode.size())
+		{
+			size_t end = mode.find(',', start);
+			std::string token = mode.substr(start, end == std::string::npos ? std::string::npos : end - start);
+			if (token == "arm")
+			{
+				card.attn_armed = true;
+				card.attn_files.clear();
+			}
+			else if (token == "disarm")
+			{
+				card.attn_armed = false;
+			}
+			else if (token == "motion")
+			{
+				card.attn_motion = true;
+			}
+			else if (token == "-motion")
+			{
+				card.attn_motion = false;
+			}
+			else if (token == "location")
+			{
+				card.attn_location = true;
+			}
+			else if (token == "-location")
+			{
+				card.attn_location = false;
+			}
+			else if (token == "-all")
+			{
+				card.attn_motion = false;
+				card.attn_location = false;
+			}
+			if (end == std::string::npos)
+			{
+				break;
+			}
+			start = end + 1;
+		}
+		return "{}";
+	}
+	if (card.attn_files.empty())
+	{
+		return "{\"set\":true}";
+	}
+	return "{\"files\":[\"" + card.attn_files + "\"],\"set\":true}";
+}
+
+/**
+ * @brief Process one request on the simulated NoteCard
+ *
+ * @param request request as JSON text
+ * @return std::string response as JSON text, empty if the I2C transfer failed
+ */
+static std::string card_process(const std::string &request, uint32_t &latency_ms)
+{
+	std::string req;
+	std::string value;
+	char response[512];
+	latency_ms = g_sim_config.card_latency_ms;
+
+	req_string(request, "req", req);
+
+	if (req == "card.version")
+	{
+		snprintf(response, sizeof(response), "{\"version\":\"notecard-5.3.1.16292\",\"device\":\"%s\",\"name\":\"Blues Wireless Notecard\",\"sku\":\"NOTE-WBNAN\",\"board\":\"1.11\",\"api\":5}",
+				 g_sim_config.card_device);
+		return response;
+	}
+	if (req == "card.location.mode")
+	{
+		if (req_true(request, "delete"))
+		{
+			card.have_fix = false;
+		}
+		if (req_string(request, "mode", value))
+		{
+			card_set_location_mode(value);
+		}
+		return "{\"mode\":\"" + card.location_mode + "\"}";
+	}
+	if (req == "card.location")
+	{
+		return card_location();
+	}
+	if (req == "card.time")
+	{
+		// Near a border the modem camps on the tower of the other country from time to time
+		bool border = (g_sim_config.border_country[0] != 0) && (random(100) < g_sim_config.border_percent);
+		snprintf(response, sizeof(response), "{\"time\":%u,\"area\":\"Tokyo\",\"zone\":\"JST,Asia/Tokyo\",\"minutes\":540,\"lat\":%.7f,\"lon\":%.7f,\"country\":\"%s\"}",
+				 (unsigned)card_epoch(), g_sim_config.lat + (border ? -0.0057 : 0.0042), g_sim_config.lon - 0.0031,
+				 border ? g_sim_config.border_country : g_sim_config.country);
+		return response;
+	}
+	if (req == "card.attn")
+	{
+		return card_attn(request);
+	}
+	if (req == "card.motion.mode")
+	{
+		if (req_true(request, "start"))
+		{
+			card.motion_on = true;
+		}
+		if (req_true(request, "stop"))
+		{
+			card.motion_on = false;
+		}
+		return "{}";
+	}
+	if (req == "card.motion")
+	{
+		snprintf(response, sizeof(response), "{\"count\":%u,\"status\":\"%s\"}", (unsigned)card.motion_count, card.motion_count ? "moving" : "stable");
+		card.motion_count = 0;
+		return response;
+	}
+	if ((req == "card.location.track") || (req == "card.motion.sync") || (req == "card.motion.track") || (req == "card.wifi"))
+	{
+		return "{}";
+	}
+	if (req == "hub.set")
+	{
+		g_sim_stats.hub_sets++;
+		if (req_string(request, "product", value))
+		{
+			card.product = value;
+		}
+		if (req_string(request, "mode", value))
+		{
+			card.hub_mode = value;
+		}
+		return "{}";
+	}
+	if (req == "card.restore")
+	{
+		// Factory reset, the configuration is back to the defaults
+		s_sim_card defaults;
+		card.product = defaults.product;
+		card.hub_mode = defaults.hub_mode;
+		card.method = defaults.method;
+		card.apn = defaults.apn;
+		card.motion_on = false;
+		return "{}";
+	}
+	if (req == "hub.get")
+	{
+		return "{\"device\":\"" + std::string(g_sim_config.card_device) + "\",\"product\":\"" + card.product + "\",\"mode\":\"" + card.hub_mode + "\"}";
+	}
+	if (req == "card.wireless")
+	{
+		if (req_string(request, "method", value))
+		{
+			g_sim_stats.wireless_sets++;
+			card.method = value;
+		}
+		if (req_string(request, "apn", value))
+		{
+			card.apn = value;
+		}
+		std::string apn = card.apn.empty() ? "" : ",\"apn\":\"" + card.apn + "\"";
+		return "{\"status\":\"{modem-on}\",\"mode\":\"auto\",\"method\":\"" + card.method + "\"" + apn +
+			   ",\"count\":3,\"net\":{\"band\":\"LTE BAND 3\",\"rat\":\"lte\",\"rssi\":-70,\"bars\":2,\"mcc\":440,\"mnc\":10,\"lac\":4660,\"cid\":22136}}";
+	}
+	if (req == "hub.status")
+	{
+		return "{\"status\":\"connected (session open) {connected}\",\"connected\":true}";
+	}
+	if (req == "note.add")
+	{
+		if (sim_link_outage())
+		{
+			g_sim_stats.notes_failed++;
+			return "{\"err\":\"error adding note: storage unavailable {io}\"}";
+		}
+		g_sim_stats.notes_added++;
+		card.notes_pending++;
+		if (req_true(request, "sync"))
+		{
+			latency_ms = g_sim_config.card_sync_latency_ms;
+			card_start_sync();
+		}
+		return "{\"total\":1}";
+	}
+	if (req == "hub.sync")
+	{
+		latency_ms = g_sim_config.card_sync_latency_ms;
+		card_start_sync();
+		return "{}";
+	}
+	if (req == "hub.sync.status")
+	{
+		if (card.sync_end_at == SIM_NEVER)
+		{
+			return "{}";
+		}
+		if (card.sync_end_at > sim_now_us())
+		{
+			return "{\"status\":\"starting communications {sync-begin}\",\"sync\":true}";
+		}
+		snprintf(response, sizeof(response), "{\"status\":\"completed {sync-end}\",\"time\":%u,\"completed\":%u}",
+				 (unsigned)(card_epoch() - (sim_now_us() - card.sync_end_at) / 1000000), (unsigned)((sim_now_us() - card.sync_end_at) / 1000000));
+		return response;
+	}
+	return "{\"err\":\"unknown request: " + req + " {io}\"}";
+}
+
+/**
+ * @brief One I2C request/response exchange with the simulated NoteCard,
+ *        advances the virtual clock by the transfer and processing time
+ *
+ * @param request request as JSON text
+ * @return std::string response as JSON text, empty if the transfer failed
+ */
+std::string sim_card_transaction(const std::string &request)
+{
+	uint32_t latency_ms;
+	std::string response;
+	bool failed = false;
+	uint32_t bytes;
+	uint64_t cost_us;
+
+	if (sim_now_us() < (uint64_t)g_sim_config.card_boot_ms * 1000)
+	{
+		// NoteCard is still booting after the power-up and NAKs its address
+		g_sim_stats.transactions++;
+		g_sim_stats.failed++;
+		sim_advance_us(1000);
+		return response;
+	}
+
+	if (sim_replay_active() && sim_replay_answer(request, response, latency_ms))
+	{
+		// Recorded duration includes the I2C transfer
+		failed = response.empty();
+		bytes = (uint32_t)request.size() + (uint32_t)response.size() + 1;
+		cost_us = (uint64_t)latency_ms * 1000;
+	}
+	else
+	{
+		failed = random(100) < g_sim_config.card_fail_percent;
+		if (!failed)
+		{
+			response = card_process(request, latency_ms);
+		}
+		else
+		{
+			latency_ms = g_sim_config.card_latency_ms;
+		}
+		bytes = (uint32_t)request.size() + (uint32_t)response.size() + 1;
+		cost_us = (uint64_t)bytes * g_sim_config.i2c_us_per_byte + (uint64_t)latency_ms * 1000;
+	}
+
+	if (failed)
+	{
+		g_sim_stats.failed++;
+	}
+
+	g_sim_stats.transactions++;
+	g_sim_stats.bytes_tx += (uint32_t)request.size();
+	g_sim_stats.bytes_rx += failed ? 0 : (uint32_t)response.size() + 1;
+	g_sim_stats.card_busy_us += cost_us;
+
+	sim_advance_us(cost_us);
+	return response;
+}
+
+/**
+ * @brief I2C write to the NoteCard
+ * 		[len][data...] is a chunk of a request, the request is processed when it ends with a newline
+ * 		[0][len] asks for up to len bytes of the response
+ *
+ * @return uint8_t 0 on success, 2 (NACK) if the transaction failed
+ */
+uint8_t sim_card_i2c_write(const uint8_t *data, size_t len)
+{
+	if (len < 2)
+	{
+		return 2;
+	}
+	if (data[0] == 0)
+	{
+		if (i2c_nack)
+		{
+			i2c_nack = false;
+			return 2;
+		}
+		i2c_read_len = data[1];
+		return 0;
+	}
+	if ((size_t)data[0] + 1 != len)
+	{
+		return 2;
+	}
+	i2c_request.append((const char *)&data[1], data[0]);
+	if (i2c_request.back() == '\n')
+	{
+		i2c_response = sim_card_transaction(i2c_request);
+		i2c_request.clear();
+		if ((g_sim_config.card_mute_percent != 0) && (random(100) < g_sim_config.card_mute_percent))
+		{
+			// Request accepted but never answered, the host polls until it gives up
+			i2c_response.clear();
+			i2c_nack = false;
+			return 0;
+		}
+		i2c_nack = i2c_response.empty();
+		if (!i2c_nack)
+		{
+			i2c_response += '\n';
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief I2C read from the NoteCard, returns [available][len][data...]
+ *
+ * @return size_t number of bytes returned
+ */
+size_t sim_card_i2c_read(uint8_t *data, size_t len)
+{
+	if (len < 2)
+	{
+		return 0;
+	}
+	size_t good = std::min(std::min((size_t)i2c_read_len, i2c_response.size()), len - 2);
+	memset(&data[2], 0, len - 2);
+	memcpy(&data[2], i2c_response.data(), good);
+	i2c_response.erase(0, good);
+	data[0] = (uint8_t)std::min(i2c_response.size(), (size_t)255);
+	data[1] = (uint8_t)good;
+	i2c_read_len = 0;
+	return len;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file host_replay.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Replays a NoteCard transcript recorded with AT+BCAP / AT+BCAPX
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "host_sim.h"
+#include <vector>
+
+/** How far the replay looks ahead for a matching request */
+#define REPLAY_LOOKAHEAD 8
+
+static std::vector<s_replay_record> records;
+static size_t cursor = 0;
+static bool active = false;
+static uint32_t mismatches = 0;
+static uint32_t body_matches = 0;
+
+/**
+ * @brief Load a transcript. Lines that do not start with "BCAP:" are ignored,
+ *        so a complete terminal log of AT+BCAPX can be used.
+ *
+ * @param path file name
+ * @return true if at least one record was found
+ */
+bool sim_replay_load(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+	{
+		return false;
+	}
+	records.clear();
+	cursor = 0;
+	mismatches = 0;
+	body_matches = 0;
+
+	static char line[2048];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		char *start = strstr(line, "BCAP:");
+		if (start == NULL)
+		{
+			continue;
+		}
+		start += 5;
+		char *fields[4];
+		char *pos = start;
+		bool complete = true;
+		for (int idx = 0; idx < 4; idx++)
+		{
+			fields[idx] = pos;
+			pos = strchr(pos, ',');
+			if (pos == NULL)
+			{
+				complete = false;
+				break;
+			}
+			*pos++ = 0;
+		}
+		if (!complete)
+		{
+			// BCAP:END line or truncated record
+			continue;
+		}
+		size_t len = strlen(pos);
+		while ((len != 0) && ((pos[len - 1] == '\n') || (pos[len - 1] == '\r')))
+		{
+			pos[--len] = 0;
+		}
+		s_replay_record record;
+		record.start_ms = (uint32_t)strtoul(fields[0], NULL, 10);
+		record.duration_ms = (uint32_t)strtoul(fields[1], NULL, 10);
+		record.success = fields[2][0] == '1';
+		record.req = fields[3];
+
+		// Length prefixed request, older transcripts have the response right after the name
+		char *end;
+		size_t req_len = strtoul(pos, &end, 10);
+		if ((end != pos) && (*end == ',') && (strlen(end + 1) > req_len) && (end[1 + req_len] == ','))
+		{
+			record.request.assign(end + 1, req_len);
+			pos = end + 2 + req_len;
+		}
+		record.response = pos;
+		records.push_back(record);
+	}
+	fclose(file);
+	active = !records.empty();
+	return active;
+}
+
+bool sim_replay_active(void)
+{
+	return active;
+}
+
+void sim_replay_stop(void)
+{
+	active = false;
+}
+
+size_t sim_replay_cursor(void)
+{
+	return cursor;
+}
+
+size_t sim_replay_count(void)
+{
+	return records.size();
+}
+
+uint32_t sim_replay_mismatches(void)
+{
+	return mismatches;
+}
+
+uint32_t sim_replay_body_matches(void)
+{
+	return body_matches;
+}
+
+const s_replay_record *sim_replay_record(size_t idx)
+{
+	return idx < records.size() ? &records[idx] : NULL;
+}
+
+void sim_replay_skip(void)
+{
+	if (cursor < records.size())
+	{
+		cursor++;
+	}
+}
+
+/**
+ * @brief Answer a request from the transcript. The next record with the same
+ *        request within the look ahead window is used. Records without the
+ *        request body, or when no body matches, are matched by request name.
+ *
+ * @param request request as JSON text
+ * @param response recorded response, empty if the recorded transfer failed
+ * @param duration_ms recorded duration
+ * @return true if a matching record was found, false to let the simulation answer
+ */
+bool sim_replay_answer(const std::string &request, std::string &response, uint32_t &duration_ms)
+{
+	std::string raw;
+	sim_json_find(request, "req", raw);
+	std::string name = sim_json_unquote(raw);
+	std::string body = request;
+	while (!body.empty() && ((body.back() == '\n') || (body.back() == '\r')))
+	{
+		body.pop_back();
+	}
+
+	size_t found = records.size();
+	for (size_t idx = cursor; (idx < records.size()) && (idx < cursor + REPLAY_LOOKAHEAD); idx++)
+	{
+		if (records[idx].request == body)
+		{
+			found = idx;
+			body_matches++;
+			break;
+		}
+		if ((records[idx].req == name) && (found == records.size()))
+		{
+			found = idx;
+		}
+	}
+	if (found == records.size())
+	{
+		mismatches++;
+		return false;
+	}
+	cursor = found + 1;
+	response = records[found].response;
+	duration_ms = records[found].duration_ms;
+	return true;
+}
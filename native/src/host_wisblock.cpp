@@ -0,0 +1,471 @@
+/**
+ * @file host_wisblock.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief WisBlock API stand-in: event loop, application timer, simulated LoRaWAN link,
+ *        Cayenne LPP encoder and AT command dispatcher
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include "host_sim.h"
+
+volatile uint16_t g_task_event_type = NO_EVENT;
+
+s_lorawan_settings g_lorawan_settings;
+bool g_lpwan_has_joined = false;
+bool g_join_result = false;
+bool g_rx_fin_result = false;
+uint8_t g_rx_lora_data[256];
+uint16_t g_rx_data_len = 0;
+int16_t g_last_rssi = 0;
+int8_t g_last_snr = 0;
+
+bool g_enable_ble = false;
+bool g_ble_uart_is_connected = false;
+BLEUart g_ble_uart;
+
+char g_at_query_buf[ATQUERY_SIZE];
+
+/** Application timer, as the API sets it up with the send interval */
+static SoftwareTimer g_task_wakeup_timer;
+
+/** Simulated LoRaWAN TX cycle (TX, RX1, RX2) */
+static SoftwareTimer lora_tx_cycle;
+
+/** Simulated join procedure */
+static SoftwareTimer lora_join_cycle;
+
+/** Maximum payload size per data rate, EU868 */
+static const uint8_t max_payload_size[8] = {51, 51, 51, 115, 242, 242, 242, 242};
+
+void api_wake_loop(uint16_t reason)
+{
+	g_task_event_type |= reason;
+}
+
+void api_set_version(uint16_t sw_1, uint16_t sw_2, uint16_t sw_3)
+{
+	(void)sw_1;
+	(void)sw_2;
+	(void)sw_3;
+}
+
+static void periodic_wakeup(TimerHandle_t unused)
+{
+	(void)unused;
+	api_wake_loop(STATUS);
+}
+
+void api_timer_start(void)
+{
+	g_task_wakeup_timer.begin(g_lorawan_settings.send_repeat_time, periodic_wakeup, NULL, true);
+	g_task_wakeup_timer.start();
+}
+
+void api_timer_stop(void)
+{
+	g_task_wakeup_timer.stop();
+}
+
+void api_timer_restart(uint32_t new_time)
+{
+	g_task_wakeup_timer.stop();
+	g_task_wakeup_timer.begin(new_time, periodic_wakeup, NULL, true);
+	g_task_wakeup_timer.start();
+}
+
+void restart_advertising(uint16_t timeout)
+{
+	(void)timeout;
+}
+
+float read_batt(void)
+{
+	return 3900.0f + (float)random(-50, 50);
+}
+
+/*********************************************************************/
+/* LoRaWAN link                                                      */
+/*********************************************************************/
+static void lora_tx_finished(TimerHandle_t unused)
+{
+	(void)unused;
+	bool downlink = false;
+	if (g_lorawan_settings.confirmed_msg_enabled)
+	{
+		g_rx_fin_result = (random(100) < g_sim_config.lora_ack_percent) && !sim_link_outage();
+		downlink = g_rx_fin_result;
+	}
+	else
+	{
+		g_rx_fin_result = true;
+		// Unconfirmed uplinks get a downlink only now and then, e.g. with MAC commands
+		downlink = (random(100) < g_sim_config.lora_downlink_percent) && (random(100) < g_sim_config.lora_ack_percent) && !sim_link_outage();
+	}
+	if (downlink)
+	{
+		g_sim_stats.lora_ack++;
+		g_last_rssi = (int16_t)random(-120, -60);
+		// Weaker links have a lower SNR
+		g_last_snr = (int8_t)(random(-10, 10) - (100 - g_sim_config.lora_ack_percent) / 8);
+	}
+	if (downlink && !g_lorawan_settings.confirmed_msg_enabled)
+	{
+		g_rx_lora_data[0] = 0;
+		g_rx_data_len = 1;
+		api_wake_loop(LORA_DATA);
+	}
+	api_wake_loop(LORA_TX_FIN);
+}
+
+static void lora_join_finished(TimerHandle_t unused)
+{
+	(void)unused;
+	g_join_result = g_sim_config.lora_joinable;
+	g_lpwan_has_joined = g_join_result;
+	api_wake_loop(LORA_JOIN_FIN);
+}
+
+/**
+ * @brief Check if the simulated links are down
+ *
+ */
+bool sim_link_outage(void)
+{
+	return (millis() >= g_sim_config.outage_start_ms) && (millis() < g_sim_config.outage_end_ms);
+}
+
+void sim_reset_lorawan(void)
+{
+	g_lpwan_has_joined = false;
+	g_join_result = false;
+	g_rx_fin_result = false;
+	lora_tx_cycle.begin(g_sim_config.lora_tx_cycle_ms, lora_tx_finished, NULL, false);
+	lora_join_cycle.begin(6000, lora_join_finished, NULL, false);
+}
+
+int8_t init_lorawan(bool region_change)
+{
+	if (region_change)
+	{
+		g_sim_stats.region_changes++;
+	}
+	if (g_lorawan_settings.auto_join || region_change)
+	{
+		lmh_join();
+	}
+	return 0;
+}
+
+int8_t re_init_lorawan(void)
+{
+	return 0;
+}
+
+void lmh_join(void)
+{
+	lora_join_cycle.start();
+}
+
+lmh_error_status send_lora_packet(uint8_t *data, uint8_t size, uint8_t fport)
+{
+	(void)data;
+	(void)fport;
+	if (!g_lpwan_has_joined)
+	{
+		return LMH_ERROR;
+	}
+	if (lora_tx_cycle._active)
+	{
+		return LMH_BUSY;
+	}
+	if (size > max_payload_size[g_lorawan_settings.data_rate & 0x07])
+	{
+		g_sim_stats.lora_size_err++;
+		return LMH_ERROR;
+	}
+	g_sim_stats.lora_tx++;
+	g_sim_stats.lora_bytes += size;
+	lora_tx_cycle.start();
+	return LMH_SUCCESS;
+}
+
+bool send_p2p_packet(uint8_t *data, uint8_t size)
+{
+	(void)data;
+	g_sim_stats.lora_tx++;
+	g_sim_stats.lora_bytes += size;
+	return true;
+}
+
+/*********************************************************************/
+/* Application loop                                                  */
+/*********************************************************************/
+/**
+ * @brief Boot sequence of the WisBlock API: setup_app(), LoRaWAN init, init_app()
+ *
+ */
+void sim_boot(void)
+{
+	sim_reset();
+	setup_app();
+	if (g_lorawan_settings.auto_join)
+	{
+		init_lorawan();
+	}
+	init_app();
+}
+
+/**
+ * @brief Reset of the RAK4631 only, the NoteCard keeps its state and the flash its files
+ *
+ */
+void sim_reboot(void)
+{
+	sim_reset_hardware();
+	sim_reset_lorawan();
+	g_task_event_type = NO_EVENT;
+	boot_profile_reset();
+	setup_app();
+	if (g_lorawan_settings.auto_join)
+	{
+		init_lorawan();
+	}
+	init_app();
+}
+
+/**
+ * @brief One pass of the application handlers for the pending events,
+ *        the same order as the WisBlock API loop task after a wake up
+ *
+ */
+void sim_dispatch_events(void)
+{
+	if (g_task_event_type == NO_EVENT)
+	{
+		return;
+	}
+	g_sim_stats.app_events++;
+	uint64_t start = sim_now_us();
+	if ((g_task_event_type & STATUS) == STATUS)
+	{
+		g_sim_stats.status_events++;
+	}
+	uint16_t before = g_task_event_type;
+	app_event_handler();
+	lora_data_handler();
+	ble_data_handler();
+	g_sim_stats.handler_us += sim_now_us() - start;
+	if (g_task_event_type == before)
+	{
+		// Nobody handled it, drop it as the API would
+		g_task_event_type = NO_EVENT;
+	}
+	// The NoteCard worker runs when the loop waits, its BLUES_DONE wakes the loop again
+	start = sim_now_us();
+	blues_worker_run();
+	g_sim_stats.worker_us += sim_now_us() - start;
+	// The log drain task runs when the loop waits
+	log_ring_drain();
+}
+
+/*********************************************************************/
+/* AT command dispatcher                                             */
+/*********************************************************************/
+static char at_line[256];
+static uint16_t at_line_len = 0;
+
+/**
+ * @brief Execute a user AT command line like the WisBlock API parser does
+ *
+ * @param cmd command line, e.g. "AT+BMOD=1" or "AT+BMOD=?"
+ * @return int AT_SUCCESS or an AT_ERRNO_ code
+ */
+int sim_at_command(const char *cmd)
+{
+	char line[256];
+	snprintf(line, sizeof(line), "%s", cmd);
+	if (strncasecmp(line, "AT", 2) != 0)
+	{
+		return AT_ERRNO_NOSUPP;
+	}
+	char *name = &line[2];
+	char *param = strchr(name, '=');
+	if (param != NULL)
+	{
+		*param++ = 0;
+	}
+	for (int idx = 0; idx < g_user_at_cmd_num; idx++)
+	{
+		atcmd_t *at_cmd = &g_user_at_cmd_list[idx];
+		if (strcasecmp(name, at_cmd->cmd_name) != 0)
+		{
+			continue;
+		}
+		g_at_query_buf[0] = 0;
+		if (param == NULL)
+		{
+			return at_cmd->exec_cmd_no_para != NULL ? at_cmd->exec_cmd_no_para() : AT_ERRNO_NOSUPP;
+		}
+		if (strcmp(param, "?") == 0)
+		{
+			int result = at_cmd->query_cmd != NULL ? at_cmd->query_cmd() : AT_ERRNO_NOSUPP;
+			if (result == AT_SUCCESS)
+			{
+				Serial.printf("%s=%s\r\n", at_cmd->cmd_name, g_at_query_buf);
+			}
+			return result;
+		}
+		return at_cmd->exec_cmd != NULL ? at_cmd->exec_cmd(param) : AT_ERRNO_NOSUPP;
+	}
+	return AT_ERRNO_NOSUPP;
+}
+
+void at_serial_input(uint8_t cmd)
+{
+	if ((cmd == '\n') || (cmd == '\r'))
+	{
+		at_line[at_line_len] = 0;
+		if (at_line_len != 0)
+		{
+			int result = sim_at_command(at_line);
+			Serial.printf("%s\r\n", result == AT_SUCCESS ? "OK" : "ERROR");
+		}
+		at_line_len = 0;
+		return;
+	}
+	if (at_line_len < sizeof(at_line) - 1)
+	{
+		at_line[at_line_len++] = (char)cmd;
+	}
+}
+
+/*********************************************************************/
+/* Cayenne LPP                                                       */
+/*********************************************************************/
+WisCayenne::WisCayenne(uint8_t size) : _maxsize(size)
+{
+	_buffer = (uint8_t *)malloc(size);
+	_cursor = 0;
+}
+
+WisCayenne::~WisCayenne(void)
+{
+	free(_buffer);
+}
+
+void WisCayenne::reset(void)
+{
+	_cursor = 0;
+}
+
+uint8_t WisCayenne::getSize(void)
+{
+	return _cursor;
+}
+
+uint8_t *WisCayenne::getBuffer(void)
+{
+	return _buffer;
+}
+
+/**
+ * @brief Append a big endian value with its channel and type
+ *
+ */
+static uint8_t lpp_add(uint8_t *buffer, uint8_t &cursor, uint8_t maxsize, uint8_t channel, uint8_t type, uint32_t value, uint8_t size)
+{
+	if ((cursor + size + 2) > maxsize)
+	{
+		return 0;
+	}
+	buffer[cursor++] = channel;
+	buffer[cursor++] = type;
+	for (int idx = size - 1; idx >= 0; idx--)
+	{
+		buffer[cursor++] = (uint8_t)(value >> (idx * 8));
+	}
+	return cursor;
+}
+
+uint8_t WisCayenne::addDigitalInput(uint8_t channel, uint32_t value)
+{
+	return lpp_add(_buffer, _cursor, _maxsize, channel, LPP_DIGITAL_INPUT, value, 1);
+}
+
+uint8_t WisCayenne::addAnalogInput(uint8_t channel, float value)
+{
+	return lpp_add(_buffer, _cursor, _maxsize, channel, LPP_ANALOG_INPUT, (uint32_t)(int16_t)lroundf(value * 100), 2);
+}
+
+uint8_t WisCayenne::addPresence(uint8_t channel, uint32_t value)
+{
+	return lpp_add(_buffer, _cursor, _maxsize, channel, LPP_PRESENCE, value, 1);
+}
+
+uint8_t WisCayenne::addTemperature(uint8_t channel, float celsius)
+{
+	return lpp_add(_buffer, _cursor, _maxsize, channel, LPP_TEMPERATURE, (uint32_t)(int16_t)lroundf(celsius * 10), 2);
+}
+
+uint8_t WisCayenne::addRelativeHumidity(uint8_t channel, float rh)
+{
+	return lpp_add(_buffer, _cursor, _maxsize, channel, LPP_RELATIVE_HUMIDITY, (uint32_t)lroundf(rh * 2), 1);
+}
+
+uint8_t WisCayenne::addBarometricPressure(uint8_t channel, float hpa)
+{
+	return lpp_add(_buffer, _cursor, _maxsize, channel, LPP_BAROMETRIC_PRESSURE, (uint32_t)lroundf(hpa * 10), 2);
+}
+
+uint8_t WisCayenne::addVoltage(uint8_t channel, float voltage)
+{
+	return lpp_add(_buffer, _cursor, _maxsize, channel, LPP_VOLTAGE, (uint32_t)lroundf(voltage * 100), 2);
+}
+
+uint8_t WisCayenne::addGNSS_6(uint8_t channel, int32_t latitude, int32_t longitude, int32_t altitude)
+{
+	if ((_cursor + 13) > _maxsize)
+	{
+		return 0;
+	}
+	// Latitude and longitude are sent with 1e-6 resolution
+	lpp_add(_buffer, _cursor, _maxsize, channel, LPP_GPS6, (uint32_t)(latitude / 10), 4);
+	for (int idx = 3; idx >= 0; idx--)
+	{
+		_buffer[_cursor++] = (uint8_t)((uint32_t)(longitude / 10) >> (idx * 8));
+	}
+	for (int idx = 2; idx >= 0; idx--)
+	{
+		_buffer[_cursor++] = (uint8_t)((uint32_t)altitude >> (idx * 8));
+	}
+	return _cursor;
+}
+
+uint8_t WisCayenne::addDevID(uint8_t channel, uint8_t *dev_id)
+{
+	if ((_cursor + 6) > _maxsize)
+	{
+		return 0;
+	}
+	_buffer[_cursor++] = channel;
+	_buffer[_cursor++] = LPP_DEVID;
+	memcpy(&_buffer[_cursor], dev_id, 4);
+	_cursor += 4;
+	return _cursor;
+}
+
+/*********************************************************************/
+/* Reset the simulated world                                         */
+/*********************************************************************/
+void sim_reset(void)
+{
+	sim_reset_hardware();
+	sim_reset_card();
+	sim_reset_lorawan();
+	g_task_event_type = NO_EVENT;
+	boot_profile_reset();
+}
@@ -2,6 +2,10 @@
  * @file RAK1906_env.cpp
  * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
  * @brief BME680 sensor functions
+ * 		Between the uplinks the BME680 is sampled every env_interval seconds. Each sample
+ * 		starts a conversion and a one-shot timer reads it when it ends, so nobody waits for
+ * 		a conversion. The samples are kept as min, max, running mean and count per
+ * 		channel and are added to the next uplink together with the last values.
  * @version 0.1
  * @date 2021-05-29
  *
@@ -23,6 +27,41 @@ float _last_humid_rak1906 = 0;
 /** Last pressure read */
 float _last_pressure_rak1906 = 0;
 
+/** Flag if a conversion is running or not collected */
+static bool rak1906_running = false;
+/** Start of the running conversion */
+static uint32_t rak1906_start_ms = 0;
+/** Expected end of the running conversion */
+static uint32_t rak1906_end_ms = 0;
+/** Flag if the running conversion belongs to the GNSS window, it is left to rak1906_collect() */
+static bool rak1906_window = false;
+/** Flag if the last collected values are not in a payload yet */
+static bool rak1906_valid = false;
+/** Counters of the readings */
+static s_rak1906_stats rak1906_data;
+/** Flag if the sensor was found */
+static bool rak1906_found = false;
+
+/** Aggregates of the samples since the last uplink, updated in the NoteCard worker */
+static s_rak1906_range rak1906_ranges[RAK1906_CHANNELS];
+/** Number of samples in rak1906_ranges */
+static uint16_t rak1906_count = 0;
+/** Aggregates for the payload, kept until an uplink with them was sent */
+static s_rak1906_range rak1906_report[RAK1906_CHANNELS];
+/** Number of samples in rak1906_report */
+static uint16_t rak1906_report_count = 0;
+/** Flag if the aggregates went into the last payload, with or without the ranges */
+static bool rak1906_report_used = false;
+/** Flag if the ranges of the aggregates fit the last payload */
+static bool rak1906_report_added = false;
+
+#ifdef NRF52_SERIES
+/** Timer of the sampling between the uplinks */
+static SoftwareTimer rak1906_timer;
+/** One-shot timer to read a sample conversion when it ends */
+static SoftwareTimer rak1906_read_timer;
+#endif
+
 /**
  * @brief Initialize the BME680 sensor
  *
@@ -48,53 +87,362 @@ bool init_rak1906(void)
 	// As we do not use the BSEC library here, the gas value is useless and just consumes battery. Better to switch it off
 	bme.setGasHeater(0, 0); // switch off
 
+	rak1906_found = true;
 	return true;
 }
 
 /**
- * @brief Read environment data from BME680
- *     Data is added to Cayenne LPP payload as channels
- *     LPP_CHANNEL_HUMID_2, LPP_CHANNEL_TEMP_2,
- *     LPP_CHANNEL_PRESS_2 and LPP_CHANNEL_GAS_2
- *
+ * @brief Start a conversion
+ * 		The BME680 shares the I2C bus with the NoteCard, the worker holds the lock
  *
- * @return true if reading was successful
- * @return false if reading failed
  */
-bool read_rak1906()
+static void rak1906_begin(void)
 {
 	MYLOG("BME", "Start BME reading");
-	bme.beginReading();
-	time_t wait_start = millis();
-	bool read_success = false;
-	while ((millis() - wait_start) < 5000)
+	rak1906_start_ms = millis();
+	rak1906_end_ms = bme.beginReading();
+	rak1906_running = rak1906_end_ms != 0;
+	if (!rak1906_running)
+	{
+		MYLOG("BME", "BME start failed");
+	}
+}
+
+/**
+ * @brief Start a conversion, called by the NoteCard worker when the GNSS window opens
+ * 		A running sample conversion is not older than the conversion time, the window keeps it
+ *
+ */
+void rak1906_start(void)
+{
+	rak1906_window = true;
+	if (rak1906_running)
+	{
+		return;
+	}
+	rak1906_begin();
+}
+
+/**
+ * @brief Add the values of the last conversion to the aggregates
+ *
+ */
+static void rak1906_aggregate(void)
+{
+	float values[RAK1906_CHANNELS];
+	get_rak1906_values(values);
+	rak1906_count++;
+	for (uint8_t channel = 0; channel < RAK1906_CHANNELS; channel++)
 	{
-		if (bme.endReading())
+		s_rak1906_range *range = &rak1906_ranges[channel];
+		if (rak1906_count == 1)
 		{
-			read_success = true;
-			break;
+			range->min = values[channel];
+			range->max = values[channel];
+			range->mean = values[channel];
+			continue;
 		}
+		range->min = values[channel] < range->min ? values[channel] : range->min;
+		range->max = values[channel] > range->max ? values[channel] : range->max;
+		range->mean += (values[channel] - range->mean) / rak1906_count;
 	}
+}
 
+/**
+ * @brief Read the values of the running conversion and add them to the aggregates
+ * 		Waits only for the rest of an unfinished conversion
+ *
+ * @return true if the values were read
+ */
+static bool rak1906_read(void)
+{
+	uint32_t conversion = rak1906_end_ms - rak1906_start_ms;
+	bool read_success = bme.endReading();
+	rak1906_running = false;
+	rak1906_window = false;
+	energy_add(ENERGY_BME680, conversion);
 	if (!read_success)
 	{
-		MYLOG("BME", "BME timeout");
+		MYLOG("BME", "BME read failed");
 		return false;
 	}
 
 	_last_temp_rak1906 = bme.temperature;
 	_last_humid_rak1906 = bme.humidity;
 	_last_pressure_rak1906 = (float)(bme.pressure) / 100.0;
+	rak1906_aggregate();
+	return true;
+}
+
+/**
+ * @brief Add the aggregates of the samples to the aggregates of the next uplink
+ *
+ */
+static void rak1906_merge(void)
+{
+	if (rak1906_count == 0)
+	{
+		return;
+	}
+	for (uint8_t channel = 0; channel < RAK1906_CHANNELS; channel++)
+	{
+		s_rak1906_range *report = &rak1906_report[channel];
+		s_rak1906_range *range = &rak1906_ranges[channel];
+		if (rak1906_report_count == 0)
+		{
+			*report = *range;
+			continue;
+		}
+		report->min = range->min < report->min ? range->min : report->min;
+		report->max = range->max > report->max ? range->max : report->max;
+		report->mean += (range->mean - report->mean) * rak1906_count / (rak1906_report_count + rak1906_count);
+	}
+	rak1906_report_count += rak1906_count;
+	rak1906_count = 0;
+}
+
+/**
+ * @brief Collect the conversion, called by the NoteCard worker when the GNSS window closes
+ * 		The conversion finished long before, a conversion that was not started (e.g. during
+ * 		the GNSS backoff) is started now and waited for at most RAK1906_WAIT_MAX ms.
+ * 		The values and the aggregates of the samples are handed to read_rak1906().
+ *
+ * @return true if the values were read
+ */
+bool rak1906_collect(void)
+{
+	rak1906_start();
+	rak1906_window = false;
+	rak1906_valid = false;
+	if (!rak1906_running)
+	{
+		rak1906_data.timeouts++;
+		return false;
+	}
+	int32_t remaining = (int32_t)(rak1906_end_ms - millis());
+	uint32_t conversion = rak1906_end_ms - rak1906_start_ms;
+	if (remaining > RAK1906_WAIT_MAX)
+	{
+		MYLOG("BME", "BME timeout");
+		rak1906_running = false;
+		rak1906_data.timeouts++;
+		return false;
+	}
+	if (remaining > 0)
+	{
+		rak1906_data.wait_ms += remaining;
+		rak1906_data.saved_ms += conversion - remaining;
+	}
+	else
+	{
+		rak1906_data.early++;
+		rak1906_data.saved_ms += conversion;
+	}
+
+	uint32_t age = millis() - rak1906_start_ms;
+	if (!rak1906_read())
+	{
+		rak1906_data.timeouts++;
+		return false;
+	}
+	rak1906_data.readings++;
+	rak1906_data.age_ms = age > rak1906_data.age_ms ? age : rak1906_data.age_ms;
+
+	// The samples since the last uplink go with this reading, with the samples of skipped uplinks
+	rak1906_merge();
+	rak1906_valid = true;
+	return true;
+}
+
+/**
+ * @brief Arm the one-shot timer to read the running conversion when it ends
+ *
+ */
+static void rak1906_read_later(void)
+{
+#ifdef NRF52_SERIES
+	int32_t remaining = (int32_t)(rak1906_end_ms - millis());
+	rak1906_read_timer.setPeriod(remaining > 0 ? remaining : 1);
+	rak1906_read_timer.start();
+#endif
+}
+
+/**
+ * @brief NoteCard job of the sampling, on the interval start a conversion,
+ * 		on the read timer collect it
+ *
+ * @param job unused
+ * @return true if a conversion is running
+ */
+static bool rak1906_sample_job(s_blues_job *job)
+{
+	(void)job;
+	if (rak1906_window)
+	{
+		// Conversion of the GNSS window, collected at its end
+		return true;
+	}
+	if (rak1906_running)
+	{
+		if ((int32_t)(rak1906_end_ms - millis()) > 0)
+		{
+			rak1906_read_later();
+			return true;
+		}
+		if (rak1906_read())
+		{
+			rak1906_data.samples++;
+		}
+		return false;
+	}
+	rak1906_begin();
+	if (rak1906_running)
+	{
+		rak1906_read_later();
+	}
+	return rak1906_running;
+}
+
+/**
+ * @brief Sample the BME680 between the uplinks, called on the ENV_SAMPLE event
+ *
+ */
+void rak1906_sample(void)
+{
+	s_blues_job job = {};
+	job.run = rak1906_sample_job;
+	blues_worker_submit(&job);
+}
+
+#ifdef NRF52_SERIES
+/**
+ * @brief Timer callback of the interval and the read timer, posts ENV_SAMPLE to sample
+ * 		the BME680 in the NoteCard worker
+ *
+ */
+static void rak1906_timeout(TimerHandle_t unused)
+{
+	(void)unused;
+	app_event_post(ENV_SAMPLE);
+}
+#endif
+
+/**
+ * @brief Start or stop the sampling between the uplinks with the interval of the settings
+ * 		Without sampling the BME680 is read once per uplink
+ *
+ */
+void rak1906_schedule(void)
+{
+	if (!rak1906_found)
+	{
+		return;
+	}
+#ifdef NRF52_SERIES
+	static bool timer_ready = false;
+	if (!timer_ready)
+	{
+		rak1906_timer.begin(60000, rak1906_timeout, NULL, true);
+		rak1906_read_timer.begin(1000, rak1906_timeout, NULL, false);
+		timer_ready = true;
+	}
+	rak1906_timer.stop();
+	if (g_blues_settings.env_interval != 0)
+	{
+		MYLOG("BME", "Sample every %d s", g_blues_settings.env_interval);
+		rak1906_timer.setPeriod((uint32_t)g_blues_settings.env_interval * 1000);
+		rak1906_timer.start();
+	}
+#endif
+}
+
+/**
+ * @brief Add the environment data collected by rak1906_collect() to the payload
+ *     Data is added to Cayenne LPP payload as channels
+ *     LPP_CHANNEL_HUMID_2, LPP_CHANNEL_TEMP_2,
+ *     LPP_CHANNEL_PRESS_2 and LPP_CHANNEL_GAS_2
+ *     With more than one sample since the last uplink the aggregates
+ *     are added as well, if they fit the payload of the next uplink
+ *
+ *
+ * @return true if reading was successful
+ * @return false if reading failed
+ */
+bool read_rak1906()
+{
+	rak1906_report_used = false;
+	rak1906_report_added = false;
+	if (!rak1906_valid)
+	{
+		MYLOG("BME", "No BME reading");
+		return false;
+	}
+	rak1906_valid = false;
+	rak1906_report_used = true;
 
 	g_solution_data.addRelativeHumidity(LPP_CHANNEL_HUMID_2, _last_humid_rak1906);
 	g_solution_data.addTemperature(LPP_CHANNEL_TEMP_2, _last_temp_rak1906);
 	g_solution_data.addBarometricPressure(LPP_CHANNEL_PRESS_2, _last_pressure_rak1906);
 
 #if MY_DEBUG > 0
-	MYLOG("BME", "RH= %.2f T= %.2f P= %.3f", bme.humidity, bme.temperature, (float)(bme.pressure) / 100.0);
+	MYLOG("BME", "RH= %.2f T= %.2f P= %.3f", _last_humid_rak1906, _last_temp_rak1906, _last_pressure_rak1906);
 #endif
 
+	// A single sample is the reading itself
+	if (rak1906_report_count < 2)
+	{
 		return true;
+	}
+	uint8_t range_size = g_solution_data.getFormat() == PAYLOAD_LPP ? PAYLOAD_RANGE_LPP_SIZE : PAYLOAD_RANGE_SIZE;
+	if (g_solution_data.getSize() + range_size > uplink_max_payload())
+	{
+		MYLOG("BME", "%d samples do not fit the payload", rak1906_report_count);
+	}
+	else
+	{
+		g_solution_data.addSampleCount(LPP_CHANNEL_ENV_COUNT, rak1906_report_count);
+		g_solution_data.addRange(LPP_CHANNEL_TEMP_2, rak1906_report[RAK1906_TEMP].min, rak1906_report[RAK1906_TEMP].max,
+								 rak1906_report[RAK1906_TEMP].mean);
+		g_solution_data.addRange(LPP_CHANNEL_HUMID_2, rak1906_report[RAK1906_HUMID].min, rak1906_report[RAK1906_HUMID].max,
+								 rak1906_report[RAK1906_HUMID].mean);
+		g_solution_data.addRange(LPP_CHANNEL_PRESS_2, rak1906_report[RAK1906_PRESS].min, rak1906_report[RAK1906_PRESS].max,
+								 rak1906_report[RAK1906_PRESS].mean);
+		rak1906_report_added = true;
+#if MY_DEBUG > 0
+		MYLOG("BME", "%d samples T= %.2f .. %.2f", rak1906_report_count, rak1906_report[RAK1906_TEMP].min, rak1906_report[RAK1906_TEMP].max);
+#endif
+	}
+
+	return true;
+}
+
+/**
+ * @brief The uplink with the payload of read_rak1906() was sent, start new aggregates
+ * 		If the uplink was skipped (deadband or track), the aggregates go with the next uplink
+ *
+ */
+void rak1906_report_sent(void)
+{
+	if (!rak1906_report_used)
+	{
+		// No reading in this uplink, the aggregates wait for the next one
+		return;
+	}
+	if (rak1906_report_count >= 2)
+	{
+		if (rak1906_report_added)
+		{
+			rak1906_data.ranges++;
+			rak1906_data.reported += rak1906_report_count;
+		}
+		else
+		{
+			rak1906_data.dropped++;
+		}
+	}
+	rak1906_report_count = 0;
+	rak1906_report_used = false;
+	rak1906_report_added = false;
 }
 
 /**
@@ -109,3 +457,13 @@ void get_rak1906_values(float *values)
 	values[1] = _last_humid_rak1906;
 	values[2] = _last_pressure_rak1906;
 }
+
+/**
+ * @brief Get the counters of the BME680 readings
+ *
+ * @return s_rak1906_stats* counters
+ */
+s_rak1906_stats *rak1906_stats(void)
+{
+	return &rak1906_data;
+}
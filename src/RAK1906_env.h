@@ -12,9 +12,47 @@
 #define RAK1906_H
 #include <Arduino.h>
 
+/** Longest wait for a conversion that is not finished when it is collected */
+#define RAK1906_WAIT_MAX 500
+
+/** Counters of the BME680 readings */
+struct s_rak1906_stats
+{
+	uint32_t readings = 0; // Conversions collected
+	uint32_t early = 0;	   // Conversions finished before they were collected
+	uint32_t timeouts = 0; // Conversions not finished in time or failed
+	uint32_t saved_ms = 0; // Conversion time nobody waited for
+	uint32_t wait_ms = 0;  // Time waited for unfinished conversions
+	uint32_t age_ms = 0;   // Oldest conversion collected for an uplink, from its start
+	uint32_t samples = 0;  // Conversions of the sampling between the uplinks
+	uint32_t ranges = 0;   // Uplinks with the aggregates of the samples
+	uint32_t reported = 0; // Readings in the aggregates of the sent uplinks
+	uint32_t dropped = 0;  // Uplinks without the aggregates, they did not fit the payload
+};
+
+/** Channels of the aggregates, same order as get_rak1906_values() */
+#define RAK1906_TEMP 0
+#define RAK1906_HUMID 1
+#define RAK1906_PRESS 2
+#define RAK1906_CHANNELS 3
+
+/** Aggregate of one channel since the last uplink */
+struct s_rak1906_range
+{
+	float min;	// Lowest value
+	float max;	// Highest value
+	float mean; // Running mean
+};
+
 // Function declarations
 bool init_rak1906(void);
+void rak1906_start(void);
+bool rak1906_collect(void);
 bool read_rak1906(void);
+void rak1906_report_sent(void);
+void rak1906_schedule(void);
+void rak1906_sample(void);
 void get_rak1906_values(float *values);
+s_rak1906_stats *rak1906_stats(void);
 
 #endif // RAK1906_H
\ No newline at end of file
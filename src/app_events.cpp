@@ -0,0 +1,144 @@
+/**
+ * @file app_events.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Wake-up events without lost events
+ * 		Interrupts, timer callbacks and the handlers post events into an own pending word with
+ * 		atomic operations, g_task_event_type is only used to wake up the loop. The handlers take
+ * 		an event with an atomic clear, so an event that is posted while a handler runs is kept.
+ * 		Coalescing rule: an event posted while it is pending is merged with the pending one and
+ * 		counted, it is served by the handling that has not started yet. The time of the first
+ * 		post is kept to measure the time from the post to the start of the handling.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Events with counters, only the events of the application. The timer wake-up, the LoRa and the BLE
+ *  events are posted inside the WisBlock API, their post time and number of posts are not known */
+static const uint16_t app_event_bits[APP_EVENT_NUM] = {GNSS_FINISH, USE_CELLULAR, BLUES_ATTN, BLUES_DONE, SETTINGS_SAVE, ENV_SAMPLE, REGION_SWITCH};
+
+/** Names of the events for the AT command */
+static const char *app_event_names[APP_EVENT_NUM] = {"gnss_finish", "use_cellular", "blues_attn", "blues_done", "settings_save", "env_sample", "region_switch"};
+
+/** Events posted with app_event_post() and not yet taken */
+static volatile uint16_t app_events_pending = 0;
+
+/** Time of the first post of the pending events in us */
+static volatile uint32_t app_event_posted_us[APP_EVENT_NUM];
+
+/** Counters per event */
+static s_app_event_stats app_event_data[APP_EVENT_NUM];
+
+/**
+ * @brief Find the counters of an event
+ *
+ * @param event event bit
+ * @return uint8_t index, APP_EVENT_NUM if the event has no counters
+ */
+static uint8_t app_event_index(uint16_t event)
+{
+	uint8_t idx = 0;
+	while ((idx < APP_EVENT_NUM) && (app_event_bits[idx] != event))
+	{
+		idx++;
+	}
+	return idx;
+}
+
+/**
+ * @brief Post an event and wake up the loop, can be called from interrupts and timer callbacks
+ *
+ * @param event one event bit, e.g. BLUES_ATTN
+ */
+void app_event_post(uint16_t event)
+{
+	uint8_t idx = app_event_index(event);
+	// The handler reads the time only after it sees the bit, a pending event keeps the time of its first post
+	if ((idx < APP_EVENT_NUM) && !(__atomic_load_n(&app_events_pending, __ATOMIC_RELAXED) & event))
+	{
+		app_event_posted_us[idx] = micros();
+	}
+	uint16_t prev = __atomic_fetch_or(&app_events_pending, event, __ATOMIC_ACQ_REL);
+	// Not taken yet, the coming handling serves this post as well
+	bool merged = (prev & event) != 0;
+
+	if (idx < APP_EVENT_NUM)
+	{
+		__atomic_fetch_add(&app_event_data[idx].posted, 1, __ATOMIC_RELAXED);
+		if (merged)
+		{
+			__atomic_fetch_add(&app_event_data[idx].coalesced, 1, __ATOMIC_RELAXED);
+		}
+	}
+	api_wake_loop(event);
+}
+
+/**
+ * @brief Take an event for handling, only called from the handlers in the loop
+ * 		The event is cleared in the pending events and in g_task_event_type
+ *
+ * @param event one event bit, e.g. BLUES_ATTN
+ * @return true if the event was pending
+ */
+bool app_event_take(uint16_t event)
+{
+	uint16_t woken = __atomic_fetch_and(&g_task_event_type, (uint16_t)~event, __ATOMIC_ACQ_REL);
+	uint16_t posted = __atomic_fetch_and(&app_events_pending, (uint16_t)~event, __ATOMIC_ACQUIRE);
+	// For the own events the bit in g_task_event_type only wakes the loop
+	if (!(((woken & ~APP_EVENTS_OWN) | posted) & event))
+	{
+		return false;
+	}
+	uint8_t idx = app_event_index(event);
+	if (idx == APP_EVENT_NUM)
+	{
+		return true;
+	}
+	s_app_event_stats *stats = &app_event_data[idx];
+	stats->handled++;
+	if (posted & event)
+	{
+		uint32_t latency = micros() - app_event_posted_us[idx];
+		stats->total_us += latency;
+		stats->latency_num++;
+		if (latency > stats->max_us)
+		{
+			stats->max_us = latency;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Get the counters of an event
+ *
+ * @param idx index of the event
+ * @param name returns the name of the event
+ * @param event optional, returns the event bit
+ * @return const s_app_event_stats* counters or NULL if idx is out of range
+ */
+const s_app_event_stats *app_event_stats(uint8_t idx, const char **name, uint16_t *event)
+{
+	if (idx >= APP_EVENT_NUM)
+	{
+		return NULL;
+	}
+	*name = app_event_names[idx];
+	if (event != NULL)
+	{
+		*event = app_event_bits[idx];
+	}
+	return &app_event_data[idx];
+}
+
+/**
+ * @brief Clear the counters, pending events are kept
+ *
+ */
+void app_event_stats_reset(void)
+{
+	memset(app_event_data, 0, sizeof(app_event_data));
+}
@@ -21,6 +21,56 @@ RAK_BLUES rak_blues;
 
 char card_response[1024];
 
+/** Time after power-on until the NoteCard answers */
+#define BLUES_BOOT_MS 5000
+
+/** Wait time between two checks while the NoteCard boots */
+#define BLUES_BOOT_POLL_MS 250
+
+/**
+ * @brief Stream Product UID, connection mode and sync time into hub.set
+ *
+ */
+static void write_hub_set(void *arg)
+{
+	(void)arg;
+	blues_write_string("product", g_blues_settings.product_uid);
+	blues_write_string("mode", g_blues_settings.conn_continous ? "continuous" : "minimum");
+	// Set sync time to the sensor read time
+	blues_write_int("seconds", (g_lorawan_settings.send_repeat_time / 1000));
+}
+
+/**
+ * @brief Stream SIM selection and APN into card.wireless
+ *
+ */
+static void write_card_wireless(void *arg)
+{
+	(void)arg;
+	switch (g_blues_settings.sim_usage)
+	{
+	case 0:
+		// USING BLUES eSIM CARD
+		blues_write_string("method", "primary");
+		break;
+	case 1:
+		// USING EXTERNAL SIM CARD only
+		blues_write_string("apn", g_blues_settings.ext_sim_apn);
+		blues_write_string("method", "secondary");
+		break;
+	case 2:
+		// USING EXTERNAL SIM CARD as primary
+		blues_write_string("apn", g_blues_settings.ext_sim_apn);
+		blues_write_string("method", "dual-secondary-primary");
+		break;
+	case 3:
+		// USING EXTERNAL SIM CARD as secondary
+		blues_write_string("apn", g_blues_settings.ext_sim_apn);
+		blues_write_string("method", "dual-primary-secondary");
+		break;
+	}
+}
+
 /**
  * @brief Initialize Blues NoteCard
  *
@@ -34,144 +84,41 @@ bool init_blues(void)
 
 	pinMode(WB_IO5, INPUT);
 
-	bool request_success = false;
-
-	//  Check if Notecard is plugged in
-	for (int try_send = 0; try_send < 5; try_send++)
-	{
-		if (rak_blues.start_req((char *)"card.version"))
-		{
-			if (rak_blues.send_req())
-			{
-				if (rak_blues.has_entry((char *)"device"))
-				{
-					rak_blues.get_string_entry((char *)"device", card_response, 1024);
-					AT_PRINTF("+EVT:IMSI-%s", &card_response[4]);
-				}
-				else
-				{
-					MYLOG("BLUES", "Did not find Device");
-				}
-				request_success = true;
-				break;
-			}
-		}
-		else
-		{
-			MYLOG("BLUES", "start_req failed");
-		}
-	}
-
-	if (!request_success)
-	{
-		MYLOG("BLUES", "card.version request failed");
-		return false;
-	}
-	request_success = false;
-
-	/*******************************************************************************/
-	/** Reset all location and motion modes to non-active, just in case            */
-	/*******************************************************************************/
-	// Disable location (just in case)
-	for (int try_send = 0; try_send < 5; try_send++)
-	{
-		if (rak_blues.start_req((char *)"card.location.mode"))
-		{
-			rak_blues.add_string_entry((char *)"mode", (char *)"off");
-			if (rak_blues.send_req())
-			{
-				request_success = true;
-				break;
-			}
-		}
-	}
-	if (!request_success)
-	{
-		MYLOG("BLUES", "card.location.mode request failed");
-	}
-	request_success = false;
+	// Resume NoteCard capture if it was enabled before the reboot
+	blues_capture_init();
 
-	// Disable location tracking (just in case)
-	for (int try_send = 0; try_send < 5; try_send++)
-	{
-		if (rak_blues.start_req((char *)"card.location.track"))
-		{
-			rak_blues.add_bool_entry((char *)"stop", true);
-			if (rak_blues.send_req())
-			{
-				request_success = true;
-				break;
-			}
-		}
-	}
-	if (!request_success)
-	{
-		MYLOG("BLUES", "card.location.track request failed");
-	}
-	request_success = false;
+	// State of the NoteCard is not known yet
+	blues_shadow_reset();
 
-	// Disable motion mode (just in case)
-	for (int try_send = 0; try_send < 5; try_send++)
+	//  Check if Notecard is plugged in, after a power-up it NAKs until it has booted
+	while (!blues_request("card.version"))
 	{
-		if (rak_blues.start_req((char *)"card.motion.mode"))
+		if (millis() >= BLUES_BOOT_MS)
 		{
-			rak_blues.add_bool_entry((char *)"stop", true);
-			if (rak_blues.send_req())
-			{
-				request_success = true;
-				break;
-			}
+			return false;
 		}
+		delay(BLUES_BOOT_POLL_MS);
 	}
-	if (!request_success)
+	if (rak_blues.has_entry((char *)"device"))
 	{
-		MYLOG("BLUES", "card.motion.mode request failed");
+		rak_blues.get_string_entry((char *)"device", card_response, 1024);
+		AT_PRINTF("+EVT:IMSI-%s", &card_response[4]);
 	}
-	request_success = false;
-
-	// Disable motion sync (just in case)
-	for (int try_send = 0; try_send < 5; try_send++)
-	{
-		if (rak_blues.start_req((char *)"card.motion.sync"))
-		{
-			rak_blues.add_bool_entry((char *)"stop", true);
-			if (rak_blues.send_req())
-			{
-				request_success = true;
-				break;
-			}
-		}
-	}
-	if (!request_success)
+	else
 	{
-		MYLOG("BLUES", "card.motion.sync request failed");
+		MYLOG("BLUES", "Did not find Device");
+		card_response[0] = 0;
 	}
-	request_success = false;
+	// Identifies the NoteCard for the saved configuration
+	uint32_t device = blues_shadow_hash(0, card_response, strlen(card_response));
 
-	// Disable motion tracking (just in case)
-	for (int try_send = 0; try_send < 5; try_send++)
-	{
-		if (rak_blues.start_req((char *)"card.motion.track"))
-		{
-			rak_blues.add_bool_entry((char *)"stop", true);
-			if (rak_blues.send_req())
-			{
-				request_success = true;
-				break;
-			}
-		}
-	}
-	if (!request_success)
-	{
-		MYLOG("BLUES", "card.motion.track request failed");
-	}
+	// Disable location (just in case)
+	blues_switch_gnss_mode(false);
 
 	// Get the ProductUID from the saved settings
 	// If no settings are found, use NoteCard internal settings!
 	if (read_blues_settings())
 	{
-		request_success = false;
-
 		MYLOG("BLUES", "Found saved settings, override NoteCard internal settings!");
 		if (memcmp(g_blues_settings.product_uid, "com.my-company.my-name", 22) == 0)
 		{
@@ -180,161 +127,35 @@ bool init_blues(void)
 			memcpy(g_blues_settings.product_uid, PRODUCT_UID, 33);
 		}
 
-		MYLOG("BLUES", "Set Product ID and connection mode");
-		for (int try_send = 0; try_send < 5; try_send++)
-		{
-			if (rak_blues.start_req((char *)"hub.set"))
-			{
-				rak_blues.add_string_entry((char *)"product", g_blues_settings.product_uid);
-				if (g_blues_settings.conn_continous)
-				{
-					rak_blues.add_string_entry((char *)"mode", (char *)"continuous");
-				}
-				else
-				{
-					rak_blues.add_string_entry((char *)"mode", (char *)"minimum");
-				}
-				// Set sync time to the sensor read time
-				rak_blues.add_int32_entry((char *)"seconds", (g_lorawan_settings.send_repeat_time / 1000));
-				rak_blues.add_bool_entry((char *)"heartbeat", true);
-
-				if (rak_blues.send_req())
-				{
-					request_success = true;
-					break;
-				}
-			}
-			delay(100);
-		}
-		if (!request_success)
-		{
-			MYLOG("BLUES", "hub.set request failed");
-			return false;
-		}
-		request_success = false;
-
-		MYLOG("BLUES", "Set SIM and APN");
-		for (int try_send = 0; try_send < 5; try_send++)
-		{
-			if (rak_blues.start_req((char *)"card.wireless"))
-			{
-				rak_blues.add_string_entry((char *)"mode", (char *)"auto");
-
-				switch (g_blues_settings.sim_usage)
-				{
-				case 0:
-					// USING BLUES eSIM CARD
-					rak_blues.add_string_entry((char *)"method", (char *)"primary");
-					break;
-				case 1:
-					// USING EXTERNAL SIM CARD only
-					rak_blues.add_string_entry((char *)"apn", g_blues_settings.ext_sim_apn);
-					rak_blues.add_string_entry((char *)"method", (char *)"secondary");
-					break;
-				case 2:
-					// USING EXTERNAL SIM CARD as primary
-					rak_blues.add_string_entry((char *)"apn", g_blues_settings.ext_sim_apn);
-					rak_blues.add_string_entry((char *)"method", (char *)"dual-secondary-primary");
-					break;
-				case 3:
-					// USING EXTERNAL SIM CARD as secondary
-					rak_blues.add_string_entry((char *)"apn", g_blues_settings.ext_sim_apn);
-					rak_blues.add_string_entry((char *)"method", (char *)"dual-primary-secondary");
-					break;
-				}
-
-				if (rak_blues.send_req())
-				{
-					request_success = true;
-					break;
-				}
-			}
-		}
-		if (!request_success)
-		{
-			MYLOG("BLUES", "card.wireless request failed");
-			return false;
-		}
-		request_success = false;
-
-		// Enable motion trigger
-		for (int try_send = 0; try_send < 5; try_send++)
+		// Tracking, motion detection, Product ID and SIM, only what the NoteCard does not have
+		if (!blues_config_reconcile(device))
 		{
-			if (rak_blues.start_req((char *)"card.motion.mode"))
-			{
-				rak_blues.add_bool_entry((char *)"start", true);
-
-				// // Set sensitivity 25Hz, +/- 16G range, 7.8 milli-G sensitivity
-				// rak_blues.add_int32_entry((char *)"sensitivity", 1);
-				// Set sensitivity 1.6Hz, +/- 2G range, 1 milli-G sensitivity
-				rak_blues.add_int32_entry((char *)"sensitivity", -1);
-
-				if (rak_blues.send_req())
-				{
-					request_success = true;
-					break;
-				}
-			}
-			delay(100);
-		}
-		if (!request_success)
-		{
-			MYLOG("BLUES", "card.motion.mode request failed");
 			return false;
 		}
-		request_success = false;
 
 		// Enable GNSS mode
-		for (int try_send = 0; try_send < 5; try_send++)
+		if (!blues_switch_gnss_mode(false))
 		{
-			if (blues_switch_gnss_mode(false))
-			{
-				request_success = true;
-				break;
-			}
-
-			request_success = false;
 			MYLOG("BLUES", "card.location.mode delete last location");
 			// Clear last GPS location
-			for (int try_send = 0; try_send < 5; try_send++)
+			if (!blues_send(BLUES_REQ("card.location.mode") BLUES_VAL("delete", true)))
 			{
-				rak_blues.start_req((char *)"card.location.mode");
-				rak_blues.add_bool_entry((char *)"delete", true);
-				if (rak_blues.send_req())
-				{
-					request_success = true;
-					break;
-				}
+				MYLOG("BLUES", "card.location.mode delete last location request failed");
+				return false;
 			}
+			g_blues_shadow.location_mode = SHADOW_UNKNOWN;
+			blues_switch_gnss_mode(false);
 		}
-		if (!request_success)
-		{
-			MYLOG("BLUES", "card.location.mode delete last location request failed");
-			return false;
-		}
-		request_success = false;
 
 		/// \todo reset attn signal needs rework
 		if (g_blues_settings.motion_trigger)
 		{
-			for (int try_send = 0; try_send < 5; try_send++)
-			{
-				if (rak_blues.start_req((char *)"card.attn"))
-				{
-					rak_blues.add_string_entry((char *)"mode", (char *)"disarm");
-					if (rak_blues.send_req())
-					{
-						request_success = true;
-						break;
-					}
-				}
-			}
-			if (!request_success)
+			if (!blues_send(BLUES_REQ("card.attn") BLUES_STR("mode", "disarm")))
 			{
 				MYLOG("BLUES", "card.attn disarm request failed");
 				return false;
 			}
-			request_success = false;
+			g_blues_shadow.attn_armed = false;
 		}
 		else
 		{
@@ -350,233 +171,260 @@ bool init_blues(void)
 	}
 	else
 	{
+		/*******************************************************************************/
+		/** Reset all location and motion modes to non-active, just in case            */
+		/*******************************************************************************/
+		// Disable location tracking (just in case)
+		blues_send(BLUES_REQ("card.location.track") BLUES_VAL("stop", true));
+
+		// Disable motion mode (just in case)
+		g_blues_shadow.motion_mode = blues_send(BLUES_REQ("card.motion.mode") BLUES_VAL("stop", true)) ? SHADOW_OFF : SHADOW_UNKNOWN;
+
+		// Disable motion sync (just in case)
+		blues_send(BLUES_REQ("card.motion.sync") BLUES_VAL("stop", true));
+
+		// Disable motion tracking (just in case)
+		blues_send(BLUES_REQ("card.motion.track") BLUES_VAL("stop", true));
+
 		MYLOG("BLUES", "No saved Blues NoteCard settings, read existing settings");
-		for (int try_send = 0; try_send < 3; try_send++)
+		if (blues_send(BLUES_REQ("card.wireless"), NULL, NULL, card_response, sizeof(card_response)))
 		{
-			if (rak_blues.start_req((char *)"card.wireless"))
+			s_blues_response parsed;
+			blues_parse_response(card_response, &parsed);
+			if (parsed.fields & BLUES_HAS_APN)
 			{
-				if (rak_blues.send_req())
-				{
-					if (rak_blues.has_entry((char *)"apn"))
-					{
-						rak_blues.get_string_entry((char *)"apn", g_blues_settings.ext_sim_apn, 256);
-						MYLOG("BLUES", "Got APN %s", g_blues_settings.ext_sim_apn);
-					}
-					else
-					{
-						MYLOG("BLUES", "No APN from NoteCard");
-						// no entry, assume no APN
-						g_blues_settings.ext_sim_apn[0] = 0;
-					}
-					if (rak_blues.has_entry((char *)"method"))
-					{
-						MYLOG("BLUES", "Got Method from NoteCard");
-						char method_str[256];
-						rak_blues.get_string_entry((char *)"method", method_str, 256);
-						if (strcmp(method_str, "primary") == 0)
-						{
-							g_blues_settings.sim_usage = 0;
-						}
-						else if (strcmp(method_str, "secondary") == 0)
-						{
-							g_blues_settings.sim_usage = 1;
-						}
-						else if (strcmp(method_str, "dual-secondary-primary") == 0)
-						{
-							g_blues_settings.sim_usage = 2;
-						}
-						else if (strcmp(method_str, "dual-primary-secondary") == 0)
-						{
-							g_blues_settings.sim_usage = 3;
-						}
-						else
-						{
-							// no match, assume primary
-							g_blues_settings.sim_usage = 0;
-						}
-					}
-					else
-					{
-						MYLOG("BLUES", "No Method from NoteCard");
-						// no entry, assume primary
-						g_blues_settings.sim_usage = 0;
-					}
-					request_success = true;
-					break;
-				}
-				else
-				{
-					MYLOG("BLUES", "Send request failed : card.wireless");
-				}
+				snprintf(g_blues_settings.ext_sim_apn, sizeof(g_blues_settings.ext_sim_apn), "%.*s", parsed.apn_len, parsed.apn);
+				MYLOG("BLUES", "Got APN %s", g_blues_settings.ext_sim_apn);
+			}
+			else
+			{
+				MYLOG("BLUES", "No APN from NoteCard");
+				// no entry, assume no APN
+				g_blues_settings.ext_sim_apn[0] = 0;
+			}
+			if (parsed.fields & BLUES_HAS_METHOD)
+			{
+				MYLOG("BLUES", "Got Method from NoteCard");
+				// no match, assume primary
+				g_blues_settings.sim_usage = parsed.sim_usage != 0xFF ? parsed.sim_usage : 0;
 			}
 			else
 			{
-				MYLOG("BLUES", "Start request failed");
+				MYLOG("BLUES", "No Method from NoteCard");
+				// no entry, assume primary
+				g_blues_settings.sim_usage = 0;
 			}
 		}
-		request_success = false;
 
-		for (int try_send = 0; try_send < 3; try_send++)
+		if (blues_request("hub.get"))
 		{
-			if (rak_blues.start_req((char *)"hub.get"))
+			if (rak_blues.has_entry((char *)"product"))
+			{
+				MYLOG("BLUES", "Got Product from NoteCard");
+				rak_blues.get_string_entry((char *)"product", g_blues_settings.product_uid, 256);
+			}
+			else
+			{
+				MYLOG("BLUES", "No Product from NoteCard");
+				// no entry, assume no UID set
+				g_blues_settings.product_uid[0] = 0;
+			}
+			if (rak_blues.has_entry((char *)"mode"))
 			{
-				if (rak_blues.send_req())
+				MYLOG("BLUES", "Got Mode from NoteCard");
+				char mode_str[256];
+				rak_blues.get_string_entry((char *)"mode", mode_str, 256);
+				if (strcmp(mode_str, "minimum") == 0)
+				{
+					g_blues_settings.conn_continous = false;
+				}
+				else if (strcmp(mode_str, "continous") == 0)
 				{
-					if (rak_blues.has_entry((char *)"product"))
-					{
-						MYLOG("BLUES", "Got Product from NoteCard");
-						rak_blues.get_string_entry((char *)"product", g_blues_settings.product_uid, 256);
-					}
-					else
-					{
-						MYLOG("BLUES", "No Product from NoteCard");
-						// no entry, assume no UID set
-						g_blues_settings.product_uid[0] = 0;
-					}
-					if (rak_blues.has_entry((char *)"mode"))
-					{
-						MYLOG("BLUES", "Got Mode from NoteCard");
-						char mode_str[256];
-						rak_blues.get_string_entry((char *)"mode", mode_str, 256);
-						if (strcmp(mode_str, "minimum") == 0)
-						{
-							g_blues_settings.conn_continous = false;
-						}
-						else if (strcmp(mode_str, "continous") == 0)
-						{
-							g_blues_settings.conn_continous = true;
-						}
-						else if (strcmp(mode_str, "periodic") == 0)
-						{
-							g_blues_settings.conn_continous = true;
-						}
-						else
-						{
-							// no match, assume continous
-							g_blues_settings.conn_continous = true;
-						}
-					}
-					else
-					{
-						MYLOG("BLUES", "No Mode from NoteCard");
-						// no match, assume continous
-						g_blues_settings.conn_continous = true;
-					}
-					request_success = true;
-					break;
+					g_blues_settings.conn_continous = true;
+				}
+				else if (strcmp(mode_str, "periodic") == 0)
+				{
+					g_blues_settings.conn_continous = true;
 				}
 				else
 				{
-					MYLOG("BLUES", "Send request failed : hub.get");
+					// no match, assume continous
+					g_blues_settings.conn_continous = true;
 				}
 			}
 			else
 			{
-				MYLOG("BLUES", "Start request failed");
+				MYLOG("BLUES", "No Mode from NoteCard");
+				// no match, assume continous
+				g_blues_settings.conn_continous = true;
 			}
 		}
 	}
 
 #if IS_V2 == 1
-	request_success = false;
 	// Only for V2 cards, setup the WiFi network
 	MYLOG("BLUES", "Set WiFi");
-	for (int try_send = 0; try_send < 5; try_send++)
+	if (!blues_send(BLUES_REQ("card.wifi") BLUES_STR("ssid", "-") BLUES_STR("password", "-")
+						BLUES_STR("name", "-") BLUES_STR("org", "") BLUES_VAL("start", false)))
 	{
-		if (rak_blues.start_req((char *)"card.wifi"))
-		{
-			rak_blues.add_string_entry((char *)"ssid", (char *)"-");
-			rak_blues.add_string_entry((char *)"password", (char *)"-");
-			rak_blues.add_string_entry((char *)"name", (char *)"-");
-			rak_blues.add_string_entry((char *)"org", (char *)"");
-			rak_blues.add_bool_entry((char *)"start", false);
-
-			if (rak_blues.send_req())
-			{
-				request_success = true;
-				break;
-			}
-		}
-	}
-	if (!request_success)
-	{
-		MYLOG("BLUES", "card.wifi request failed");
 		return false;
 	}
 #endif
 	return true;
 }
 
+/** Payload for note.add */
+struct s_blues_payload
+{
+	uint8_t *data;
+	uint16_t data_len;
+	bool sync;
+};
+
+/** Notes added to the NoteCard since the last sync */
+static uint8_t notes_unsynced = 0;
+
+/** Time when the oldest unsynced note was added */
+static uint32_t oldest_unsynced_time = 0;
+
+/** Flag if a NoteHub sync was requested and its session time is not counted yet */
+static bool sync_pending = false;
+
+/** Time when the pending sync was requested */
+static uint32_t sync_requested_time = 0;
+
+/**
+ * @brief Remember the start of a NoteHub sync for the energy counters
+ *
+ */
+static void blues_sync_started(void)
+{
+	if (!sync_pending)
+	{
+		sync_pending = true;
+		sync_requested_time = millis();
+	}
+}
+
+/**
+ * @brief Stream sync flag, device EUI and payload into note.add
+ *
+ * @param arg pointer to s_blues_payload
+ */
+static void write_note_add(void *arg)
+{
+	s_blues_payload *payload = (s_blues_payload *)arg;
+
+	if (payload->sync)
+	{
+		blues_write_bool("sync", true);
+	}
+	char node_id[24];
+	sprintf(node_id, "%02x%02x%02x%02x%02x%02x%02x%02x",
+			g_lorawan_settings.node_device_eui[0], g_lorawan_settings.node_device_eui[1],
+			g_lorawan_settings.node_device_eui[2], g_lorawan_settings.node_device_eui[3],
+			g_lorawan_settings.node_device_eui[4], g_lorawan_settings.node_device_eui[5],
+			g_lorawan_settings.node_device_eui[6], g_lorawan_settings.node_device_eui[7]);
+	blues_write_nested_string("body", "dev_eui", node_id);
+	blues_write_base64("payload", payload->data, payload->data_len);
+}
+
+/**
+ * @brief Check if the oldest unsynced note waits longer than the maximum age
+ *
+ */
+static bool blues_sync_age_reached(void)
+{
+	return (notes_unsynced != 0) && (g_blues_settings.sync_age != 0) &&
+		   ((millis() - oldest_unsynced_time) >= (uint32_t)g_blues_settings.sync_age * 60000);
+}
+
 /**
  * @brief Send a data packet to NoteHub.IO
+ * 		The note stays in the NoteCard until the number of notes, the age of the oldest note
+ * 		or the priority of the packet requires a sync with NoteHub.
  *
  * @param data Payload as byte array (CayenneLPP formatted)
  * @param data_len Length of payload
+ * @param priority priority of the packet, UPLINK_PRIO_xxx
  * @return true if note could be sent to NoteCard
  * @return false if note send failed
  */
-bool blues_send_payload(uint8_t *data, uint16_t data_len)
+bool blues_send_payload(uint8_t *data, uint16_t data_len, uint8_t priority)
 {
-	char payload_b86[255];
-	bool request_success = false;
+	s_blues_payload payload = {data, data_len, false};
+	payload.sync = (notes_unsynced + 1 >= g_blues_settings.sync_count) || (priority >= g_blues_settings.sync_priority) || blues_sync_age_reached();
 
-	for (int try_send = 0; try_send < 5; try_send++)
+	if (!blues_send(BLUES_REQ("note.add") BLUES_STR("file", "data.qo"), write_note_add, &payload))
 	{
-		if (rak_blues.start_req((char *)"note.add"))
-		{
-			rak_blues.add_string_entry((char *)"file", (char *)"data.qo");
-			rak_blues.add_bool_entry((char *)"sync", true);
-			char node_id[24];
-			sprintf(node_id, "%02x%02x%02x%02x%02x%02x%02x%02x",
-					g_lorawan_settings.node_device_eui[0], g_lorawan_settings.node_device_eui[1],
-					g_lorawan_settings.node_device_eui[2], g_lorawan_settings.node_device_eui[3],
-					g_lorawan_settings.node_device_eui[4], g_lorawan_settings.node_device_eui[5],
-					g_lorawan_settings.node_device_eui[6], g_lorawan_settings.node_device_eui[7]);
-			rak_blues.add_nested_string_entry((char *)"body", (char *)"dev_eui", node_id);
-
-			rak_blues.myJB64Encode(payload_b86, (const char *)data, data_len);
-
-			rak_blues.add_string_entry((char *)"payload", payload_b86);
-
-			MYLOG("BLUES", "Finished parsing");
-
-			if (rak_blues.send_req())
-			{
-				AT_PRINTF("+EVT:TX_CELL_OK");
-				request_success = true;
-				break;
-			}
-		}
-	}
-	if (!request_success)
-	{
-		MYLOG("BLUES", "Send request failed");
 		AT_PRINTF("+EVT:TX_CELL_FAIL");
 		return false;
 	}
-
-	return request_success;
+	if (payload.sync)
+	{
+		notes_unsynced = 0;
+		blues_sync_started();
+	}
+	else
+	{
+		if (notes_unsynced == 0)
+		{
+			oldest_unsynced_time = millis();
+		}
+		notes_unsynced++;
+		MYLOG("BLUES", "%d notes wait for sync", notes_unsynced);
+	}
+	AT_PRINTF("+EVT:TX_CELL_OK");
+	return true;
 }
+
 /**
- * @brief Request NoteHub status, only for debug purposes
+ * @brief Sync with NoteHub if the oldest unsynced note waits longer than the maximum age
  *
  */
-void blues_hub_status(void)
+void blues_sync_check(void)
 {
-	bool request_success = false;
-	for (int try_send = 0; try_send < 5; try_send++)
+	if (blues_sync_age_reached())
 	{
-		rak_blues.start_req((char *)"hub.status");
-		if (rak_blues.send_req())
+		MYLOG("BLUES", "Sync %d notes", notes_unsynced);
+		if (blues_send(BLUES_REQ("hub.sync")))
 		{
-			request_success = true;
-			break;
+			notes_unsynced = 0;
+			blues_sync_started();
 		}
 	}
-	if (!request_success)
+}
+
+/**
+ * @brief Count the time of the last NoteHub sync session when it is completed
+ * 		The NoteCard syncs in the background, hub.sync.status reports how long ago the sync was completed
+ *
+ */
+void blues_sync_session(void)
+{
+	if (!sync_pending || !blues_send(BLUES_REQ("hub.sync.status"), NULL, NULL, card_response, sizeof(card_response)))
+	{
+		return;
+	}
+	s_blues_response parsed;
+	blues_parse_response(card_response, &parsed);
+	uint32_t elapsed_ms = millis() - sync_requested_time;
+	if (!(parsed.fields & BLUES_HAS_COMPLETED) || (parsed.completed * 1000 > elapsed_ms))
 	{
-		MYLOG("BLUES", "hub.status request failed");
+		// Still in the session, or the completion is of an earlier sync
+		return;
 	}
+	energy_add(ENERGY_SYNC, elapsed_ms - parsed.completed * 1000);
+	sync_pending = false;
+}
+
+/**
+ * @brief Request NoteHub status, only for debug purposes
+ *
+ */
+void blues_hub_status(void)
+{
+	blues_request("hub.status");
 }
 
 /**
@@ -588,266 +436,249 @@ void blues_hub_status(void)
  */
 bool blues_switch_gnss_mode(bool continuous_on)
 {
-	bool request_success = false;
+	uint8_t new_mode = continuous_on ? SHADOW_ON : SHADOW_OFF;
+	if (g_blues_shadow.location_mode == new_mode)
+	{
+		blues_shadow_skip(1);
+		return true;
+	}
 	MYLOG("BLUES", "Set location mode %s", continuous_on ? "continuous" : "off");
-	for (int try_send = 0; try_send < 5; try_send++)
+	// Set location acquisition time to the sensor read time
+	// MYLOG("BLUES", "Set location period %d", (g_lorawan_settings.send_repeat_time / 1000 / 2));
+	// rak_blues.add_int32_entry((char *)"seconds", (g_lorawan_settings.send_repeat_time / 1000 / 2));
+	bool result = continuous_on ? blues_send(BLUES_REQ("card.location.mode") BLUES_STR("mode", "continuous"))
+							   : blues_send(BLUES_REQ("card.location.mode") BLUES_STR("mode", "off"));
+	g_blues_shadow.location_mode = result ? new_mode : SHADOW_UNKNOWN;
+	return result;
+}
+
+/**
+ * @brief Set Product UID, connection mode and sync time, skipped if the NoteCard has them already
+ *
+ * @return true if the settings are set
+ */
+bool blues_set_hub(void)
+{
+	uint32_t hash = blues_config_hub_hash();
+	if (g_blues_shadow.hub_hash == hash)
 	{
-		if (rak_blues.start_req((char *)"card.location.mode"))
-		{
-			if (continuous_on)
-			{
-				// Continous GNSS mode
-				rak_blues.add_string_entry((char *)"mode", (char *)"continuous");
-			}
-			else
-			{
-				// GNSS off
-				rak_blues.add_string_entry((char *)"mode", (char *)"off");
-			}
-			// Set location acquisition time to the sensor read time
-			// MYLOG("BLUES", "Set location period %d", (g_lorawan_settings.send_repeat_time / 1000 / 2));
-			// rak_blues.add_int32_entry((char *)"seconds", (g_lorawan_settings.send_repeat_time / 1000 / 2));
-			if (rak_blues.send_req())
-			{
-				request_success = true;
-				break;
-			}
-		}
+		blues_shadow_skip(1);
+		return true;
 	}
-	if (!request_success)
+	bool result = blues_send(BLUES_REQ("hub.set") BLUES_VAL("heartbeat", true), write_hub_set);
+	g_blues_shadow.hub_hash = result ? hash : 0;
+	return result;
+}
+
+/**
+ * @brief Set SIM and APN, skipped if the NoteCard has them already
+ *
+ * @return true if the settings are set
+ */
+bool blues_set_wireless(void)
+{
+	uint32_t hash = blues_config_wireless_hash();
+	if (g_blues_shadow.wireless_hash == hash)
 	{
-		MYLOG("BLUES", "card.location.mode request failed");
-		return false;
+		blues_shadow_skip(1);
+		return true;
 	}
-	return true;
+	bool result = blues_send(BLUES_REQ("card.wireless") BLUES_STR("mode", "auto"), write_card_wireless);
+	g_blues_shadow.wireless_hash = result ? hash : 0;
+	return result;
 }
 
 /**
- * @brief Get the location information from the NoteCard
+ * @brief Read the location information from the NoteCard, only the requests, the packet is not changed
+ * 		Can run in the NoteCard worker, blues_apply_location() uses the result in the loop
  *
- * @return true if a location could be acquired
- * @return false if request failed or no location is available
+ * @param use_gnss false if GNSS was not switched on, only the tower location is requested
+ * @param location returns the GNSS and tower locations the NoteCard reported
+ * @return true if the NoteCard reported a GNSS or tower location
  */
-bool blues_get_location(void)
+bool blues_read_location(bool use_gnss, s_blues_location *location)
 {
-	bool result = false;
-	bool got_gnss_location = false;
-	bool request_success = false;
-	char str_value[128];
-	uint32_t last_gnss_update = (uint32_t)millis();
-	uint32_t current_card_time = last_gnss_update;
+	s_blues_response parsed;
+	memset(location, 0, sizeof(s_blues_location));
 
-	for (int try_send = 0; try_send < 5; try_send++)
+	if (use_gnss && blues_send(BLUES_REQ("card.location"), NULL, NULL, card_response, sizeof(card_response)))
 	{
-		rak_blues.start_req((char *)"card.location");
-		if (rak_blues.send_req())
+		blues_parse_response(card_response, &parsed);
+		// Check if the location is confirmed or an old location
+		switch (parsed.status)
 		{
-			// Check if the location is confirmed or an old location
-			if (rak_blues.has_entry((char *)"status"))
+		case GNSS_STATUS_SEARCH:
+			MYLOG("BLUES", "GNSS is searching!");
+			break;
+		case GNSS_STATUS_INACTIVE:
+			MYLOG("BLUES", "GNSS is inactive!");
+			break;
+		case GNSS_STATUS_UPDATED:
+			MYLOG("BLUES", "GNSS is updated!");
+			break;
+		}
+		if (parsed.fields & BLUES_HAS_LOCATION)
+		{
+			location->gnss = true;
+			location->gnss_lat = parsed.lat;
+			location->gnss_lon = parsed.lon;
+			location->gnss_time = (parsed.fields & BLUES_HAS_TIME) ? parsed.time : 0;
+
+			if (parsed.fields & BLUES_HAS_TIME)
 			{
-				if (rak_blues.get_string_entry((char *)"status", str_value, 128))
-				{
-					String gnss_status = String(str_value);
-					MYLOG("BLUES", "gnss_status >>%s<<", gnss_status.c_str());
-					if (gnss_status.indexOf("search") > 0)
-					{
-						MYLOG("BLUES", "GNSS is searching!");
-					}
-					if (gnss_status.indexOf("inactive") > 0)
-					{
-						MYLOG("BLUES", "GNSS is inactive!");
-					}
-					if (gnss_status.indexOf("updated") > 0)
-					{
-						MYLOG("BLUES", "GNSS is updated!");
-					}
-				}
+				MYLOG("BLUES", "Last GNSS update was %lu", (unsigned long)parsed.time);
 			}
-			if (rak_blues.has_entry((char *)"lat") && rak_blues.has_entry((char *)"lon"))
+		}
+	}
+
+	// Tower location is needed without GNSS location, the tower country only if the device might be in another cell
+	if ((!location->gnss || region_check_needed(location->gnss_lat, location->gnss_lon)) &&
+		blues_send(BLUES_REQ("card.time"), NULL, NULL, card_response, sizeof(card_response)))
+	{
+		blues_parse_response(card_response, &parsed);
+		if (parsed.fields & BLUES_HAS_LOCATION)
+		{
+			location->tower = true;
+			location->tower_lat = parsed.lat;
+			location->tower_lon = parsed.lon;
+			location->tower_time = (parsed.fields & BLUES_HAS_TIME) ? parsed.time : 0;
+			memcpy(location->country, parsed.country, sizeof(location->country));
+
+			if (parsed.fields & BLUES_HAS_TIME)
 			{
-				float blues_latitude;
-				float blues_longitude;
-				float blues_altitude = 0;
-				if (rak_blues.get_float_entry((char *)"lat", blues_latitude))
-				{
-					if (rak_blues.get_float_entry((char *)"lon", blues_longitude))
-					{
-						got_gnss_location = true;
-
-						if ((blues_latitude == 0.0) && (blues_longitude == 0.0))
-						{
-							MYLOG("BLUES", "No valid GPS data, report no location");
-						}
-						else
-						{
-							MYLOG("BLUES", "Got location Lat %.6f Long %0.6f", blues_latitude, blues_longitude);
-							g_solution_data.addGNSS_6(LPP_CHANNEL_GPS, (int32_t)(blues_latitude * 10000000), (int32_t)(blues_longitude * 10000000), (int32_t)blues_altitude);
-							g_solution_data.addPresence(LPP_CHANNEL_GPS_TOWER, false);
-							result = true;
-						}
-					}
-
-					if (rak_blues.has_entry((char *)"time"))
-					{
-						if (rak_blues.get_uint32_entry((char *)"time", last_gnss_update))
-						{
-							MYLOG("BLUES", "Last GNSS update was %ld", last_gnss_update);
-						}
-					}
-				}
+				MYLOG("BLUES", "Last card time was %lu", (unsigned long)parsed.time);
 			}
 		}
-
-		request_success = true;
-		break;
 	}
+	return location->gnss || location->tower;
+}
+
+/**
+ * @brief Add the location read by blues_read_location() to the packet and update the LoRaWAN region
+ *
+ * @param location GNSS and tower locations of the NoteCard
+ * @param position optional, returns the location that was added to the packet
+ * @return true if a location was added to the packet
+ * @return false if no valid location is available
+ */
+bool blues_apply_location(const s_blues_location *location, s_position *position)
+{
+	bool result = false;
 
-	if (!request_success)
+	if (location->gnss)
 	{
-		MYLOG("BLUES", "card.location request failed");
+		if ((location->gnss_lat == 0) && (location->gnss_lon == 0))
+		{
+			MYLOG("BLUES", "No valid GPS data, report no location");
+		}
+		else
+		{
+			MYLOG("BLUES", "Got location Lat %.7f Long %.7f", location->gnss_lat / 10000000.0, location->gnss_lon / 10000000.0);
+			g_solution_data.addGNSS_6(LPP_CHANNEL_GPS, location->gnss_lat, location->gnss_lon, 0);
+			g_solution_data.addPresence(LPP_CHANNEL_GPS_TOWER, false);
+			result = true;
+			if (position != NULL)
+			{
+				position->lat = location->gnss_lat;
+				position->lon = location->gnss_lon;
+				position->tower = false;
+				position->time = location->gnss_time;
+			}
+		}
 	}
 
 	// Blink green LED if we found a GNSS location
-	if (got_gnss_location)
+	if (location->gnss)
 	{
-		digitalWrite(LED_GREEN, HIGH);
+		led_write(LED_GREEN, HIGH);
 		blink_green.setPeriod(500);
 		blink_green.start();
 	}
 	else
 	{
 		blink_green.stop();
-		digitalWrite(LED_GREEN, LOW);
+		led_write(LED_GREEN, LOW);
 	}
-	request_success = false;
 
-	for (int try_send = 0; try_send < 5; try_send++)
+	if (location->tower)
 	{
-		rak_blues.start_req((char *)"card.time");
-		if (rak_blues.send_req())
+		// Try to set LoRaWAN band automatically, country is empty if the tower did not report it
+		region_update(location->country, location->gnss ? location->gnss_lat : location->tower_lat,
+					  location->gnss ? location->gnss_lon : location->tower_lon);
+
+		// If no location from GNSS use the tower location
+		if (!location->gnss)
 		{
-			if (rak_blues.has_entry((char *)"lat") && rak_blues.has_entry((char *)"lon"))
+			if ((location->tower_lat == 0) && (location->tower_lon == 0))
 			{
-				if (rak_blues.has_entry((char *)"country"))
-				{
-					rak_blues.get_string_entry((char *)"country", str_value, 20);
-					// Try to set LoRaWAN band automatically
-					if (strcmp(str_value, "PH") == 0)
-					{
-						MYLOG("BLUES", "Found PH");
-						if (g_lorawan_settings.lora_region != 10)
-						{
-							MYLOG("BLUES", "Switch to band 10");
-							g_lorawan_settings.lora_region = 10;
-							init_lorawan(true);
-						}
-					}
-					else if (strcmp(str_value, "JP") == 0)
-					{
-						MYLOG("BLUES", "Found JP");
-						if (g_lorawan_settings.lora_region != 8)
-						{
-							MYLOG("BLUES", "Switch to band 8");
-							g_lorawan_settings.lora_region = 8;
-							init_lorawan(true);
-						}
-					}
-					else if (strcmp(str_value, "US") == 0)
-					{
-						MYLOG("BLUES", "Found US");
-						if (g_lorawan_settings.lora_region != 5)
-						{
-							MYLOG("BLUES", "Switch to band 5");
-							g_lorawan_settings.lora_region = 5;
-							init_lorawan(true);
-						}
-					}
-					else if (strcmp(str_value, "AU") == 0)
-					{
-						MYLOG("BLUES", "Found AU");
-						if (g_lorawan_settings.lora_region != 6)
-						{
-							MYLOG("BLUES", "Switch to band 6");
-							g_lorawan_settings.lora_region = 6;
-							init_lorawan(true);
-						}
-					}
-					else if ((strcmp(str_value, "DE") == 0) ||
-							 (strcmp(str_value, "FR") == 0) ||
-							 (strcmp(str_value, "IT") == 0) ||
-							 (strcmp(str_value, "NL") == 0) ||
-							 (strcmp(str_value, "GB") == 0))
-					{
-						MYLOG("BLUES", "Found Europe");
-						if (g_lorawan_settings.lora_region != 4)
-						{
-							MYLOG("BLUES", "Switch to band 4");
-							g_lorawan_settings.lora_region = 4;
-							init_lorawan(true);
-						}
-					}
-				}
-
-				float blues_latitude;
-				float blues_longitude;
-				float blues_altitude = 0;
-
-				// If no location from GNSS use the tower location
-				if (!got_gnss_location)
-				{
-					if (rak_blues.get_float_entry((char *)"lat", blues_latitude))
-					{
-						if (rak_blues.get_float_entry((char *)"lon", blues_longitude))
-						{
-
-							if ((blues_latitude == 0.0) && (blues_longitude == 0.0))
-							{
-								MYLOG("BLUES", "No valid GPS data, report no location");
-							}
-							else
-							{
-								MYLOG("BLUES", "Got tower location Lat %.6f Long %0.6f", blues_latitude, blues_longitude);
-								g_solution_data.addGNSS_6(LPP_CHANNEL_GPS, (int32_t)(blues_latitude * 10000000), (int32_t)(blues_longitude * 10000000), (int32_t)blues_altitude);
-								g_solution_data.addPresence(LPP_CHANNEL_GPS_TOWER, true);
-								result = true;
-							}
-						}
-					}
-				}
-
-				if (rak_blues.has_entry((char *)"time"))
+				MYLOG("BLUES", "No valid GPS data, report no location");
+			}
+			else
+			{
+				MYLOG("BLUES", "Got tower location Lat %.7f Long %.7f", location->tower_lat / 10000000.0, location->tower_lon / 10000000.0);
+				g_solution_data.addGNSS_6(LPP_CHANNEL_GPS, location->tower_lat, location->tower_lon, 0);
+				g_solution_data.addPresence(LPP_CHANNEL_GPS_TOWER, true);
+				result = true;
+				if (position != NULL)
 				{
-					if (rak_blues.get_uint32_entry((char *)"time", current_card_time))
-					{
-						MYLOG("BLUES", "Last card time was %ld", current_card_time);
-					}
+					position->lat = location->tower_lat;
+					position->lon = location->tower_lon;
+					position->tower = true;
+					position->time = location->tower_time;
 				}
 			}
-			request_success = true;
-			break;
 		}
 	}
-	if (!request_success)
-	{
-		MYLOG("BLUES", "card.time request failed");
-	}
 	return result;
 }
 
-void blues_card_restore(void)
+/**
+ * @brief Get the location information from the NoteCard and add it to the packet
+ *
+ * @param use_gnss false if GNSS was not switched on, only the tower location is requested
+ * @param position optional, returns the location that was added to the packet
+ * @return true if a location could be acquired
+ * @return false if request failed or no location is available
+ */
+bool blues_get_location(bool use_gnss, s_position *position)
+{
+	s_blues_location location;
+	blues_read_location(use_gnss, &location);
+	return blues_apply_location(&location, position);
+}
+
+/**
+ * @brief Get the number of motion events since the last card.motion request
+ *
+ * @return uint32_t number of motion events, 0 if the request failed
+ */
+uint32_t blues_motion_count(void)
 {
-	for (int try_send = 0; try_send < 5; try_send++)
+	if (!blues_send(BLUES_REQ("card.motion"), NULL, NULL, card_response, sizeof(card_response)))
 	{
-		if (rak_blues.start_req((char *)"hub.status"))
-		{
-			rak_blues.add_bool_entry((char *)"delete", true);
-			rak_blues.add_bool_entry((char *)"connected", true);
-			if (rak_blues.send_req())
-			{
-				break;
-			}
-		}
+		return 0;
 	}
+	s_blues_response parsed;
+	blues_parse_response(card_response, &parsed);
+	MYLOG("BLUES", "card.motion count %ld", (long)parsed.count);
+	return parsed.count;
+}
+
+void blues_card_restore(void)
+{
+	blues_send(BLUES_REQ("hub.status") BLUES_VAL("delete", true) BLUES_VAL("connected", true));
+	blues_shadow_reset();
+	blues_config_forget();
+}
+
+/**
+ * @brief Stream the ATTN mode into card.attn
+ *
+ * @param arg mode string
+ */
+static void write_attn_mode(void *arg)
+{
+	blues_write_string("mode", (const char *)arg);
 }
 
 /**
@@ -860,103 +691,77 @@ void blues_card_restore(void)
  */
 bool blues_enable_attn(bool motion)
 {
-	bool request_success = false;
+	uint8_t new_modes = motion ? ATTN_MODE_MOTION : ATTN_MODE_LOCATION;
 
-	// Disarm before making changes
-	blues_disable_attn();
+	if (g_blues_shadow.attn_armed && (g_blues_shadow.attn_modes == new_modes))
+	{
+		// Disarm, mode and arm requests not needed
+		blues_shadow_skip(3);
+		return true;
+	}
 
-	if (motion)
+	if (g_blues_shadow.attn_modes == SHADOW_UNKNOWN)
 	{
-		MYLOG("BLUES", "Enable ATTN on motion");
-		for (int try_send = 0; try_send < 5; try_send++)
-		{
-			if (rak_blues.start_req((char *)"card.attn"))
-			{
-				rak_blues.add_string_entry((char *)"mode", (char *)"motion");
-				if (rak_blues.send_req(g_at_query_buf, ATQUERY_SIZE))
-				{
-					MYLOG("BLUES", "card.attn mode returned: %s", g_at_query_buf);
-					request_success = true;
-					break;
-				}
-			}
-		}
-		if (!request_success)
+		// Disarm before making changes
+		blues_disable_attn();
+
+		MYLOG("BLUES", "Enable ATTN on %s", motion ? "motion" : "location");
+		bool result = motion ? blues_send(BLUES_REQ("card.attn") BLUES_STR("mode", "motion"), NULL, NULL, card_response, sizeof(card_response))
+							 : blues_send(BLUES_REQ("card.attn") BLUES_STR("mode", "location"), NULL, NULL, card_response, sizeof(card_response));
+		if (!result)
 		{
-			MYLOG("BLUES", "card.attn request failed");
+			g_blues_shadow.attn_modes = SHADOW_UNKNOWN;
 			return false;
 		}
-		request_success = false;
+		MYLOG("BLUES", "card.attn mode returned: %s", card_response);
+		g_blues_shadow.attn_modes = new_modes;
 
-		MYLOG("BLUES", "Arm ATTN on motion");
-		for (int try_send = 0; try_send < 5; try_send++)
+		MYLOG("BLUES", "Arm ATTN on %s", motion ? "motion" : "location");
+		if (!blues_send(BLUES_REQ("card.attn") BLUES_STR("mode", "arm")))
 		{
-			if (rak_blues.start_req((char *)"card.attn"))
-			{
-				rak_blues.add_string_entry((char *)"mode", (char *)"arm");
-				if (rak_blues.send_req())
-				{
-					request_success = true;
-					break;
-				}
-			}
-		}
-		if (!request_success)
-		{
-			MYLOG("BLUES", "card.attn request failed");
 			return false;
 		}
-		delay(250);
-		MYLOG("BLUES", "Attach interrupt on motion");
-		detachInterrupt(WB_IO5);
-		attachInterrupt(WB_IO5, blues_attn_cb, RISING);
 	}
 	else
 	{
-		request_success = false;
-		MYLOG("BLUES", "Enable ATTN on location");
-		for (int try_send = 0; try_send < 5; try_send++)
+		// Mode is known, change only the differences and arm in one request
+		char attn_mode[40] = "arm";
+		uint8_t remove_modes = g_blues_shadow.attn_modes & ~new_modes;
+		uint8_t add_modes = new_modes & ~g_blues_shadow.attn_modes;
+		if (remove_modes & ATTN_MODE_MOTION)
 		{
-			if (rak_blues.start_req((char *)"card.attn"))
-			{
-				rak_blues.add_string_entry((char *)"mode", (char *)"location");
-				if (rak_blues.send_req(g_at_query_buf, ATQUERY_SIZE))
-				{
-					MYLOG("BLUES", "card.attn mode returned: %s", g_at_query_buf);
-					request_success = true;
-					break;
-				}
-			}
+			strcat(attn_mode, ",-motion");
 		}
-		if (!request_success)
+		if (remove_modes & ATTN_MODE_LOCATION)
 		{
-			MYLOG("BLUES", "card.attn request failed");
-			return false;
+			strcat(attn_mode, ",-location");
 		}
-
-		request_success = false;
-		MYLOG("BLUES", "Arm ATTN on location");
-		for (int try_send = 0; try_send < 5; try_send++)
+		if (add_modes & ATTN_MODE_MOTION)
 		{
-			if (rak_blues.start_req((char *)"card.attn"))
-			{
-				rak_blues.add_string_entry((char *)"mode", (char *)"arm");
-				if (rak_blues.send_req())
-				{
-					request_success = true;
-					break;
-				}
-			}
+			strcat(attn_mode, ",motion");
 		}
-		if (!request_success)
+		if (add_modes & ATTN_MODE_LOCATION)
 		{
-			MYLOG("BLUES", "card.attn request failed");
-			return false;
+			strcat(attn_mode, ",location");
 		}
-		MYLOG("BLUES", "Attach interrupt on location");
+		MYLOG("BLUES", "Set ATTN %s", attn_mode);
 		detachInterrupt(WB_IO5);
-		attachInterrupt(WB_IO5, blues_attn_cb, RISING);
+		if (!blues_send(BLUES_REQ("card.attn"), write_attn_mode, attn_mode))
+		{
+			g_blues_shadow.attn_modes = SHADOW_UNKNOWN;
+			return false;
+		}
+		g_blues_shadow.attn_modes = new_modes;
+		blues_shadow_skip(2);
+	}
+	g_blues_shadow.attn_armed = true;
+	if (motion)
+	{
+		delay(250);
 	}
+	MYLOG("BLUES", "Attach interrupt on %s", motion ? "motion" : "location");
+	detachInterrupt(WB_IO5);
+	attachInterrupt(WB_IO5, blues_attn_cb, RISING);
 	return true;
 }
 
@@ -971,24 +776,15 @@ bool blues_disable_attn(void)
 	MYLOG("BLUES", "Disable ATTN");
 	detachInterrupt(WB_IO5);
 
-	bool request_success = false;
-	for (int try_send = 0; try_send < 5; try_send++)
+	if (!g_blues_shadow.attn_armed && (g_blues_shadow.attn_modes == 0))
 	{
-		if (rak_blues.start_req((char *)"card.attn"))
-		{
-			rak_blues.add_string_entry((char *)"mode", (char *)"disarm,-all");
-			if (rak_blues.send_req())
-			{
-				request_success = true;
-				break;
-			}
-		}
-	}
-	if (!request_success)
-	{
-		MYLOG("BLUES", "card.attn request failed");
+		blues_shadow_skip(1);
+		return true;
 	}
-	return request_success;
+	g_blues_shadow.attn_armed = false;
+	bool result = blues_send(BLUES_REQ("card.attn") BLUES_STR("mode", "disarm,-all"));
+	g_blues_shadow.attn_modes = result ? 0 : SHADOW_UNKNOWN;
+	return result;
 }
 
 char attn_msg[256];
@@ -1003,23 +799,10 @@ char attn_msg[256];
  */
 uint8_t blues_attn_reason(void)
 {
-	bool request_success = false;
 	uint8_t result = 0;
-	for (int try_send = 0; try_send < 5; try_send++)
-	{
-		if (rak_blues.start_req((char *)"card.attn"))
-		{
-			if (rak_blues.send_req(g_at_query_buf, ATQUERY_SIZE))
-			{
-				MYLOG("BLUES", "card.attn mode returned: %s", g_at_query_buf);
-				request_success = true;
-				break;
-			}
-		}
-	}
-	if (request_success)
+	if (blues_request("card.attn", NULL, NULL, card_response, sizeof(card_response)))
 	{
-		MYLOG("BLUES", "card.attn check returned: %s", g_at_query_buf);
+		MYLOG("BLUES", "card.attn check returned: %s", card_response);
 		if (rak_blues.has_entry((char *)"files"))
 		{
 			rak_blues.get_string_entry_from_array((char *)"files", attn_msg, 255);
@@ -1044,10 +827,6 @@ uint8_t blues_attn_reason(void)
 			MYLOG("BLUES", "card.attn files missing");
 		}
 	}
-	else
-	{
-		MYLOG("BLUES", "Request creation failed");
-	}
 
 	return result;
 }
@@ -1059,7 +838,9 @@ uint8_t blues_attn_reason(void)
  */
 void blues_attn_cb(void)
 {
-	api_wake_loop(BLUES_ATTN);
+	// NoteCard disarms ATTN when it fires
+	g_blues_shadow.attn_armed = false;
+	app_event_post(BLUES_ATTN);
 }
 
 /**
@@ -1070,30 +851,12 @@ void blues_attn_cb(void)
  */
 bool blues_hub_connected(void)
 {
-	bool request_success = false;
-	bool cellular_connected = false;
-	for (int try_send = 0; try_send < 5; try_send++)
-	{
-		if (rak_blues.start_req((char *)"card.wireless"))
-		{
-			if (rak_blues.send_req())
-			{
-				if (rak_blues.has_entry((char *)"net"))
-				{
-					if (rak_blues.has_nested_entry((char *)"net", (char *)"band"))
-					{
-						cellular_connected = true;
-					}
-					request_success = true;
-					break;
-				}
-			}
-		}
-	}
-	if (!request_success)
+	if (!blues_send(BLUES_REQ("card.wireless"), NULL, NULL, card_response, sizeof(card_response)))
 	{
-		MYLOG("BLUES", "card.wireless request failed");
 		return false;
 	}
-	return cellular_connected;
+	// No retry if the modem is not registered, the next check will see it
+	s_blues_response parsed;
+	blues_parse_response(card_response, &parsed);
+	return (parsed.fields & BLUES_HAS_NET_BAND) != 0;
 }
\ No newline at end of file
@@ -0,0 +1,306 @@
+/**
+ * @file blues_capture.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Blues NoteCard request/response transcript recorder
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#ifdef NRF52_SERIES
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Filename of the transcript */
+static const char capture_file_name[] = "BCAP";
+
+/** Filename of the marker that capture is enabled, survives a reboot to capture init_blues() */
+static const char capture_flag_name[] = "BCAPON";
+
+/** File for the transcript */
+static File capture_file(InternalFS);
+#endif
+
+/** Maximum size of the transcript file, the RAK4631 has only 28 kByte for all files */
+#define CAPTURE_MAX_SIZE 3072
+
+/** Flag if capture is active */
+static bool capture_active = false;
+
+/** Name of the current request, kept without capture as well for the request histograms */
+static char capture_req_name[32];
+
+/** Start time of the current request */
+static uint32_t capture_req_start = 0;
+
+/** Response buffer while capture is active */
+static char capture_response[1024];
+
+/** Request as sent to the NoteCard while capture is active, longer requests are cut */
+static char capture_request[512];
+
+/** Length of the captured request */
+static uint16_t capture_request_len = 0;
+
+/**
+ * @brief Check if capture was enabled before the last reboot
+ *
+ */
+void blues_capture_init(void)
+{
+#ifdef NRF52_SERIES
+	capture_active = InternalFS.exists(capture_flag_name);
+	if (capture_active)
+	{
+		MYLOG("BCAP", "NoteCard capture active");
+	}
+#endif
+}
+
+/**
+ * @brief Start capture of NoteCard requests
+ *
+ * @param clear true to delete an existing transcript
+ * @return true if capture could be started
+ */
+bool blues_capture_start(bool clear)
+{
+#ifdef NRF52_SERIES
+	if (clear && InternalFS.exists(capture_file_name))
+	{
+		InternalFS.remove(capture_file_name);
+	}
+	if (!InternalFS.exists(capture_flag_name))
+	{
+		capture_file.open(capture_flag_name, FILE_O_WRITE);
+		capture_file.write((uint8_t)1);
+		capture_file.close();
+	}
+	capture_active = true;
+	MYLOG("BCAP", "NoteCard capture started");
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * @brief Stop capture of NoteCard requests, the transcript is kept
+ *
+ */
+void blues_capture_stop(void)
+{
+#ifdef NRF52_SERIES
+	if (InternalFS.exists(capture_flag_name))
+	{
+		InternalFS.remove(capture_flag_name);
+	}
+#endif
+	capture_active = false;
+	MYLOG("BCAP", "NoteCard capture stopped");
+}
+
+/**
+ * @brief Get capture status
+ *
+ * @return true if capture is active
+ */
+bool blues_capture_active(void)
+{
+	return capture_active;
+}
+
+/**
+ * @brief Get the size of the transcript
+ *
+ * @return uint32_t size in bytes
+ */
+uint32_t blues_capture_size(void)
+{
+	uint32_t size = 0;
+#ifdef NRF52_SERIES
+	if (capture_file.open(capture_file_name, FILE_O_READ))
+	{
+		size = capture_file.size();
+		capture_file.close();
+	}
+#endif
+	return size;
+}
+
+/**
+ * @brief Read the transcript line by line
+ *
+ * @param line_cb callback for each line
+ * @return uint16_t number of lines
+ */
+uint16_t blues_capture_export(void (*line_cb)(const char *line))
+{
+	uint16_t lines = 0;
+#ifdef NRF52_SERIES
+	if (!capture_file.open(capture_file_name, FILE_O_READ))
+	{
+		return 0;
+	}
+	uint16_t len = 0;
+	int data;
+	while ((data = capture_file.read()) >= 0)
+	{
+		if (data == '\n')
+		{
+			capture_response[len] = 0;
+			line_cb(capture_response);
+			lines++;
+			len = 0;
+		}
+		else if (len < sizeof(capture_response) - 1)
+		{
+			capture_response[len++] = (char)data;
+		}
+	}
+	capture_file.close();
+#endif
+	return lines;
+}
+
+/**
+ * @brief Append one request/response pair to the transcript
+ * 		Format: BCAP:<start ms>,<duration ms>,<success>,<name>,<request length>,<request>,<response>
+ * 		The request JSON contains commas, its length tells where the response starts.
+ *
+ */
+static void capture_record(bool success, const char *response)
+{
+#ifdef NRF52_SERIES
+	char line_head[80];
+	int head_len = snprintf(line_head, sizeof(line_head), "BCAP:%lu,%lu,%d,%s,%u,",
+							(unsigned long)capture_req_start, (unsigned long)(millis() - capture_req_start), success ? 1 : 0, capture_req_name,
+							capture_request_len);
+
+	capture_file.open(capture_file_name, FILE_O_WRITE);
+	if (capture_file.size() + head_len + capture_request_len + strlen(response) + 2 > CAPTURE_MAX_SIZE)
+	{
+		capture_file.close();
+		blues_capture_stop();
+		AT_PRINTF("+EVT:BCAP_FULL");
+		return;
+	}
+	capture_file.write((const uint8_t *)line_head, head_len);
+	capture_file.write((const uint8_t *)capture_request, capture_request_len);
+	capture_file.write((uint8_t)',');
+	// One line per record, the line ends in the response are replaced
+	const char *part = response;
+	for (const char *c = response;; c++)
+	{
+		if ((*c == '\n') || (*c == '\r') || (*c == 0))
+		{
+			capture_file.write((const uint8_t *)part, c - part);
+			if (*c == 0)
+			{
+				break;
+			}
+			capture_file.write((uint8_t)' ');
+			part = c + 1;
+		}
+	}
+	capture_file.write((uint8_t)'\n');
+	capture_file.close();
+#endif
+}
+
+/**
+ * @brief Start a NoteCard request, wraps RAK_BLUES::start_req()
+ *
+ * @param request name of the request
+ * @return true if the request could be created
+ */
+bool blues_start_req(const char *request)
+{
+	blues_capture_begin(request);
+	if (capture_active)
+	{
+		// RAK_BLUES does not expose its JSON document, the requests sent through it have no entries
+		int len = snprintf(capture_request, sizeof(capture_request), "{\"req\":\"%s\"}", request);
+		capture_request_len = (len < (int)sizeof(capture_request)) ? len : sizeof(capture_request) - 1;
+	}
+	return rak_blues.start_req((char *)request);
+}
+
+/**
+ * @brief Send a NoteCard request, wraps RAK_BLUES::send_req()
+ * 		If capture is active, the request and its response are added to the transcript
+ *
+ * @param response optional buffer for the response
+ * @param resp_len size of the response buffer
+ * @return true if the request was successful
+ */
+bool blues_send_req(char *response, uint16_t resp_len)
+{
+	uint32_t start_time = millis();
+	if (!capture_active)
+	{
+		bool success = rak_blues.send_req(response, resp_len);
+		// RAK_BLUES does not report the size of the request, the response size is only known with a buffer
+		uint16_t received = ((response != NULL) && (resp_len != 0)) ? strlen(response) + 1 : BLUES_PERF_UNKNOWN;
+		blues_perf_try(capture_req_name, millis() - start_time, BLUES_PERF_UNKNOWN, received, success);
+		return success;
+	}
+
+	capture_response[0] = 0;
+	bool success = rak_blues.send_req(capture_response, sizeof(capture_response));
+	blues_perf_try(capture_req_name, millis() - start_time, BLUES_PERF_UNKNOWN, strlen(capture_response) + 1, success);
+	if ((response != NULL) && (resp_len != 0))
+	{
+		snprintf(response, resp_len, "%s", capture_response);
+	}
+	capture_record(success, capture_response);
+	return success;
+}
+
+/**
+ * @brief Mark the start of a request that does not go through RAK_BLUES
+ *
+ * @param request name of the request
+ */
+void blues_capture_begin(const char *request)
+{
+	snprintf(capture_req_name, sizeof(capture_req_name), "%s", request);
+	capture_req_start = millis();
+	capture_request_len = 0;
+}
+
+/**
+ * @brief Add bytes of a streamed request to the transcript
+ * 		Line ends are dropped, the transcript has one line per record.
+ *
+ * @param data request bytes as sent to the NoteCard
+ * @param len number of bytes
+ */
+void blues_capture_request(const char *data, uint16_t len)
+{
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		if ((data[idx] != '\n') && (data[idx] != '\r') && (capture_request_len < sizeof(capture_request)))
+		{
+			capture_request[capture_request_len++] = data[idx];
+		}
+	}
+}
+
+/**
+ * @brief Add a request that does not go through RAK_BLUES to the transcript
+ *
+ * @param success result of the request
+ * @param response response of the NoteCard
+ */
+void blues_capture_end(bool success, const char *response)
+{
+	if (capture_active)
+	{
+		capture_record(success, response);
+	}
+}
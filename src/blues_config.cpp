@@ -0,0 +1,366 @@
+/**
+ * @file blues_config.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Reconciler of the NoteCard configuration
+ * 		The configuration is split in sections, each with a hash of its parameters: hub.set,
+ * 		card.wireless and the setup (tracking stopped, motion detection started). The hashes that
+ * 		the NoteCard has are saved together with a digest and the device ID of the NoteCard.
+ * 		On a warm boot with the same NoteCard and unchanged settings the digest matches and only
+ * 		hub.get is sent, to find a NoteCard that was restored or reconfigured from NoteHub.
+ * 		Otherwise only the sections with another hash are sent.
+ * 		For an unknown NoteCard card.wireless is read first, it restarts the modem if it is set.
+ * 		AT commands that change the settings run the reconciler in the NoteCard worker.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#ifdef NRF52_SERIES
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Filename of the saved configuration state */
+static const char config_file_name[] = "BCFG";
+#endif
+
+/** Marker of a valid saved state */
+#define CONFIG_MAGIC 0xC5C5
+/** Version of the setup requests, change it if the setup sends other requests */
+#define CONFIG_SETUP_VERSION 1
+
+/** Configuration the NoteCard has */
+struct s_blues_config_file
+{
+	uint16_t valid_mark;
+	uint16_t reserved;
+	uint32_t device;		// Hash of the device ID of the NoteCard
+	uint32_t hub_hash;		// Parameters of hub.set
+	uint32_t wireless_hash; // Parameters of card.wireless
+	uint32_t setup_hash;	// Version of the setup requests
+	uint32_t digest;		// Hash over all of the above
+};
+
+/** Saved state, loaded at boot */
+static s_blues_config_file config_saved;
+
+/** Hash of the device ID of the NoteCard, 0 before the boot configuration */
+static uint32_t config_device = 0;
+
+/** Counters of the reconciler */
+static s_blues_config_stats config_stats;
+
+/**
+ * @brief Hash of the hub.set parameters
+ *
+ * @return uint32_t hash
+ */
+uint32_t blues_config_hub_hash(void)
+{
+	uint32_t hash = blues_shadow_hash(0, g_blues_settings.product_uid, strlen(g_blues_settings.product_uid));
+	hash = blues_shadow_hash(hash, &g_blues_settings.conn_continous, sizeof(g_blues_settings.conn_continous));
+	return blues_shadow_hash(hash, &g_lorawan_settings.send_repeat_time, sizeof(g_lorawan_settings.send_repeat_time));
+}
+
+/**
+ * @brief Hash of the card.wireless parameters
+ *
+ * @return uint32_t hash
+ */
+uint32_t blues_config_wireless_hash(void)
+{
+	uint32_t hash = blues_shadow_hash(0, &g_blues_settings.sim_usage, sizeof(g_blues_settings.sim_usage));
+	return blues_shadow_hash(hash, g_blues_settings.ext_sim_apn, strlen(g_blues_settings.ext_sim_apn));
+}
+
+/**
+ * @brief Hash of the setup requests
+ *
+ * @return uint32_t hash
+ */
+static uint32_t blues_config_setup_hash(void)
+{
+	uint16_t version = CONFIG_SETUP_VERSION;
+	return blues_shadow_hash(0, &version, sizeof(version));
+}
+
+/**
+ * @brief Digest over the device and the sections
+ *
+ * @param config saved state
+ * @return uint32_t digest
+ */
+static uint32_t blues_config_digest(const s_blues_config_file *config)
+{
+	return blues_shadow_hash(0, &config->device, sizeof(uint32_t) * 4);
+}
+
+/**
+ * @brief Load the saved state, called once at boot
+ *
+ */
+static void blues_config_load(void)
+{
+	memset(&config_saved, 0, sizeof(s_blues_config_file));
+#ifdef NRF52_SERIES
+	File config_file(InternalFS);
+	if (config_file.open(config_file_name, FILE_O_READ))
+	{
+		if ((config_file.read((void *)&config_saved, sizeof(s_blues_config_file)) != sizeof(s_blues_config_file)) ||
+			(config_saved.valid_mark != CONFIG_MAGIC) || (config_saved.digest != blues_config_digest(&config_saved)))
+		{
+			MYLOG("BCFG", "Saved NoteCard configuration is invalid");
+			memset(&config_saved, 0, sizeof(s_blues_config_file));
+		}
+		config_file.close();
+	}
+#endif
+}
+
+/**
+ * @brief Save the sections the NoteCard has
+ *
+ */
+static void blues_config_save(void)
+{
+	s_blues_config_file config;
+	memset(&config, 0, sizeof(s_blues_config_file));
+	config.valid_mark = CONFIG_MAGIC;
+	config.device = config_device;
+	config.hub_hash = g_blues_shadow.hub_hash;
+	config.wireless_hash = g_blues_shadow.wireless_hash;
+	config.setup_hash = g_blues_shadow.setup_hash;
+	config.digest = blues_config_digest(&config);
+	if (memcmp(&config, &config_saved, sizeof(s_blues_config_file)) == 0)
+	{
+		return;
+	}
+	config_saved = config;
+#ifdef NRF52_SERIES
+	if (InternalFS.exists(config_file_name))
+	{
+		InternalFS.remove(config_file_name);
+	}
+	File config_file(InternalFS);
+	config_file.open(config_file_name, FILE_O_WRITE);
+	config_file.write((const uint8_t *)&config_saved, sizeof(s_blues_config_file));
+	config_file.close();
+	MYLOG("BCFG", "NoteCard configuration saved");
+#endif
+}
+
+/**
+ * @brief Stop the tracking modes and start the motion detection
+ *
+ * @return true if the setup was sent
+ */
+static bool blues_config_setup(void)
+{
+	// Disable location tracking (just in case)
+	blues_send(BLUES_REQ("card.location.track") BLUES_VAL("stop", true));
+
+	// Disable motion sync (just in case)
+	blues_send(BLUES_REQ("card.motion.sync") BLUES_VAL("stop", true));
+
+	// Disable motion tracking (just in case)
+	blues_send(BLUES_REQ("card.motion.track") BLUES_VAL("stop", true));
+
+	// Enable motion trigger
+	// Sensitivity -1 = 1.6Hz, +/- 2G range, 1 milli-G sensitivity (1 = 25Hz, +/- 16G range, 7.8 milli-G sensitivity)
+	if (!blues_send(BLUES_REQ("card.motion.mode") BLUES_VAL("start", true) BLUES_VAL("sensitivity", -1)))
+	{
+		g_blues_shadow.motion_mode = SHADOW_UNKNOWN;
+		return false;
+	}
+	g_blues_shadow.motion_mode = SHADOW_ON;
+	return true;
+}
+
+/**
+ * @brief Read card.wireless of an unknown NoteCard, the request is skipped if it has the settings already
+ *
+ */
+static void blues_config_read_wireless(void)
+{
+	char response[512];
+	if (!blues_send(BLUES_REQ("card.wireless"), NULL, NULL, response, sizeof(response)))
+	{
+		return;
+	}
+	s_blues_response parsed;
+	blues_parse_response(response, &parsed);
+	uint8_t sim_usage = (parsed.fields & BLUES_HAS_METHOD) && (parsed.sim_usage != 0xFF) ? parsed.sim_usage : 0;
+	// The APN is only sent with an external SIM
+	bool apn_match = (g_blues_settings.sim_usage == 0) ||
+					 ((parsed.fields & BLUES_HAS_APN) && (parsed.apn_len == strlen(g_blues_settings.ext_sim_apn)) &&
+					  (strncmp(parsed.apn, g_blues_settings.ext_sim_apn, parsed.apn_len) == 0));
+	if ((sim_usage == g_blues_settings.sim_usage) && apn_match)
+	{
+		MYLOG("BCFG", "NoteCard has the SIM settings already");
+		g_blues_shadow.wireless_hash = blues_config_wireless_hash();
+	}
+}
+
+/**
+ * @brief Check with hub.get that the NoteCard still has the Product UID and connection mode
+ * 		A card.restore or a change from NoteHub is not seen by the saved hashes
+ *
+ * @return true if product and mode match the settings
+ */
+static bool blues_config_hub_matches(void)
+{
+	char response[512];
+	if (!blues_send(BLUES_REQ("hub.get"), NULL, NULL, response, sizeof(response)))
+	{
+		return false;
+	}
+	s_blues_response parsed;
+	blues_parse_response(response, &parsed);
+	const char *mode = g_blues_settings.conn_continous ? "continuous" : "minimum";
+	return (parsed.fields & BLUES_HAS_PRODUCT) && (parsed.product_len == strlen(g_blues_settings.product_uid)) &&
+		   (strncmp(parsed.product, g_blues_settings.product_uid, parsed.product_len) == 0) && (parsed.fields & BLUES_HAS_MODE) &&
+		   (parsed.mode_len == strlen(mode)) && (strncmp(parsed.mode, mode, parsed.mode_len) == 0);
+}
+
+/**
+ * @brief Bring the NoteCard configuration in line with the settings
+ * 		At boot the saved state is used, afterwards the shadow of the running NoteCard
+ *
+ * @param device hash of the device ID from card.version, 0 to use the device of the boot
+ * @return true if the NoteCard has the configuration
+ */
+bool blues_config_reconcile(uint32_t device)
+{
+	if (device != 0)
+	{
+		config_device = device;
+		blues_config_load();
+		if (config_saved.device == device)
+		{
+			// Same NoteCard, the saved sections are known
+			g_blues_shadow.hub_hash = config_saved.hub_hash;
+			g_blues_shadow.wireless_hash = config_saved.wireless_hash;
+			g_blues_shadow.setup_hash = config_saved.setup_hash;
+			bool unchanged = (config_saved.hub_hash == blues_config_hub_hash()) && (config_saved.wireless_hash == blues_config_wireless_hash()) &&
+							 (config_saved.setup_hash == blues_config_setup_hash());
+			if (unchanged && blues_config_hub_matches())
+			{
+				// Warm boot, the motion detection is running since the setup
+				MYLOG("BCFG", "NoteCard configuration unchanged");
+				g_blues_shadow.motion_mode = SHADOW_ON;
+				blues_shadow_skip(6);
+				config_stats.warm++;
+				return true;
+			}
+			if (unchanged)
+			{
+				// Restored or changed from NoteHub, nothing of the saved state can be trusted
+				MYLOG("BCFG", "NoteCard lost its configuration, read the SIM settings");
+				g_blues_shadow.hub_hash = 0;
+				g_blues_shadow.wireless_hash = 0;
+				g_blues_shadow.setup_hash = 0;
+				config_stats.lost++;
+				blues_config_read_wireless();
+			}
+		}
+		else
+		{
+			MYLOG("BCFG", "Unknown NoteCard, read the SIM settings");
+			blues_config_read_wireless();
+		}
+	}
+	config_stats.reconciled++;
+	uint32_t skipped = blues_shadow_skipped();
+
+	if (g_blues_shadow.setup_hash == blues_config_setup_hash())
+	{
+		g_blues_shadow.motion_mode = SHADOW_ON;
+		blues_shadow_skip(4);
+	}
+	else
+	{
+		if (!blues_config_setup())
+		{
+			return false;
+		}
+		g_blues_shadow.setup_hash = blues_config_setup_hash();
+	}
+
+	MYLOG("BCFG", "Set Product ID and connection mode");
+	bool result = blues_set_hub();
+
+	MYLOG("BCFG", "Set SIM and APN");
+	result = blues_set_wireless() && result;
+
+	config_stats.skipped += blues_shadow_skipped() - skipped;
+	blues_config_save();
+	return result;
+}
+
+/**
+ * @brief NoteCard job of the AT commands
+ *
+ * @param job unused
+ * @return true if the NoteCard has the configuration
+ */
+static bool blues_config_job(s_blues_job *job)
+{
+	(void)job;
+	return blues_config_reconcile(0);
+}
+
+/**
+ * @brief Completion of blues_config_job()
+ *
+ * @param job result of the reconciler
+ */
+static void blues_config_done(s_blues_job *job)
+{
+	AT_PRINTF("+EVT:BLUES_CONFIG_%s", job->result ? "OK" : "FAIL");
+}
+
+/**
+ * @brief Apply changed settings without reboot, called by the AT commands
+ *
+ */
+void blues_config_update(void)
+{
+	if (config_device == 0)
+	{
+		// The boot configuration uses the new settings
+		return;
+	}
+	config_stats.live++;
+	s_blues_job job = {};
+	job.run = blues_config_job;
+	job.done = blues_config_done;
+	blues_worker_submit(&job);
+}
+
+/**
+ * @brief Forget the saved state, e.g. after a factory reset or a request from the user
+ *
+ */
+void blues_config_forget(void)
+{
+	memset(&config_saved, 0, sizeof(s_blues_config_file));
+#ifdef NRF52_SERIES
+	if (InternalFS.exists(config_file_name))
+	{
+		InternalFS.remove(config_file_name);
+	}
+#endif
+}
+
+/**
+ * @brief Get the counters of the reconciler
+ *
+ * @return s_blues_config_stats* counters
+ */
+s_blues_config_stats *blues_config_stats(void)
+{
+	return &config_stats;
+}
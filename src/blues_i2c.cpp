@@ -0,0 +1,342 @@
+/**
+ * @file blues_i2c.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief NoteCard requests streamed over I2C without a JSON document in RAM
+ * 		The fixed part of a request is a string literal in flash, the dynamic entries
+ * 		are written by the blues_write_xxx functions straight into the I2C chunk buffer.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Delay after each chunk, the NoteCard needs time to empty its I2C buffer (note-c uses the same pacing) */
+#define BLUES_I2C_CHUNK_DELAY 20
+/** Bytes of a segment, the NoteCard receive buffer is emptied after each segment */
+#define BLUES_I2C_SEGMENT 250
+/** Delay after each segment */
+#define BLUES_I2C_SEGMENT_DELAY 250
+/** Delay between polls for the response */
+#define BLUES_I2C_POLL_DELAY 5
+/** Maximum time to wait for the response, shorter if the request has less time left */
+#define BLUES_I2C_TIMEOUT 5000
+
+/** Chunk buffer, sent when it is full or the request is complete */
+static uint8_t chunk_buf[BLUES_I2C_CHUNK];
+
+/** Bytes in the chunk buffer */
+static uint8_t chunk_len = 0;
+
+/** Bytes sent since the last segment delay */
+static uint16_t segment_len = 0;
+
+/** I2C error during the current request */
+static bool chunk_error = false;
+
+/** Bytes sent and received in the last transaction */
+static uint16_t transaction_sent = 0;
+static uint16_t transaction_received = 0;
+
+/** Base64 alphabet */
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * @brief Send the chunk buffer to the NoteCard
+ *
+ */
+static void chunk_flush(void)
+{
+	if (chunk_len == 0)
+	{
+		return;
+	}
+	if (blues_capture_active())
+	{
+		blues_capture_request((const char *)chunk_buf, chunk_len);
+	}
+	if (!chunk_error)
+	{
+		Wire.beginTransmission(BLUES_I2C_ADDR);
+		Wire.write(chunk_len);
+		Wire.write(chunk_buf, chunk_len);
+		chunk_error = Wire.endTransmission() != 0;
+		transaction_sent += chunk_len;
+		delay(BLUES_I2C_CHUNK_DELAY);
+		segment_len += chunk_len;
+		if (segment_len >= BLUES_I2C_SEGMENT)
+		{
+			delay(BLUES_I2C_SEGMENT_DELAY);
+			segment_len = 0;
+		}
+	}
+	chunk_len = 0;
+}
+
+/**
+ * @brief Add one byte to the request
+ *
+ */
+static void chunk_put(char data)
+{
+	chunk_buf[chunk_len++] = (uint8_t)data;
+	if (chunk_len == BLUES_I2C_CHUNK)
+	{
+		chunk_flush();
+	}
+}
+
+/**
+ * @brief Add a block of bytes to the request
+ *
+ */
+static void chunk_write(const char *data, uint16_t len)
+{
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		chunk_put(data[idx]);
+	}
+}
+
+/**
+ * @brief Add a string to the request with quotes, escapes quotes and backslashes
+ *
+ */
+static void chunk_quoted(const char *value)
+{
+	chunk_put('"');
+	for (const char *c = value; *c != 0; c++)
+	{
+		if ((*c == '"') || (*c == '\\'))
+		{
+			chunk_put('\\');
+		}
+		chunk_put(*c);
+	}
+	chunk_put('"');
+}
+
+/**
+ * @brief Add the key of an entry to the request
+ *
+ */
+static void chunk_key(const char *key)
+{
+	chunk_put(',');
+	chunk_quoted(key);
+	chunk_put(':');
+}
+
+/**
+ * @brief Add a string entry to the request that is streamed
+ *
+ * @param key name of the entry
+ * @param value value of the entry
+ */
+void blues_write_string(const char *key, const char *value)
+{
+	chunk_key(key);
+	chunk_quoted(value);
+}
+
+/**
+ * @brief Add a bool entry to the request that is streamed
+ *
+ * @param key name of the entry
+ * @param value value of the entry
+ */
+void blues_write_bool(const char *key, bool value)
+{
+	chunk_key(key);
+	if (value)
+	{
+		chunk_write("true", 4);
+	}
+	else
+	{
+		chunk_write("false", 5);
+	}
+}
+
+/**
+ * @brief Add a number entry to the request that is streamed
+ *
+ * @param key name of the entry
+ * @param value value of the entry
+ */
+void blues_write_int(const char *key, int32_t value)
+{
+	char number[12];
+	int len = snprintf(number, sizeof(number), "%ld", (long)value);
+	chunk_key(key);
+	chunk_write(number, len);
+}
+
+/**
+ * @brief Add an object with one string entry to the request that is streamed
+ *
+ * @param key name of the object
+ * @param nested name of the entry inside the object
+ * @param value value of the entry
+ */
+void blues_write_nested_string(const char *key, const char *nested, const char *value)
+{
+	chunk_key(key);
+	chunk_put('{');
+	chunk_quoted(nested);
+	chunk_put(':');
+	chunk_quoted(value);
+	chunk_put('}');
+}
+
+/**
+ * @brief Add binary data as Base64 string to the request that is streamed
+ *
+ * @param key name of the entry
+ * @param data binary data
+ * @param len length of the data
+ */
+void blues_write_base64(const char *key, const uint8_t *data, uint16_t len)
+{
+	chunk_key(key);
+	chunk_put('"');
+	for (uint16_t idx = 0; idx < len; idx += 3)
+	{
+		uint32_t triple = (uint32_t)data[idx] << 16;
+		if (idx + 1 < len)
+		{
+			triple |= (uint32_t)data[idx + 1] << 8;
+		}
+		if (idx + 2 < len)
+		{
+			triple |= data[idx + 2];
+		}
+		chunk_put(base64_chars[(triple >> 18) & 0x3F]);
+		chunk_put(base64_chars[(triple >> 12) & 0x3F]);
+		chunk_put(idx + 1 < len ? base64_chars[(triple >> 6) & 0x3F] : '=');
+		chunk_put(idx + 2 < len ? base64_chars[triple & 0x3F] : '=');
+	}
+	chunk_put('"');
+}
+
+/**
+ * @brief Poll the NoteCard for the response
+ *
+ * @param response buffer for the response
+ * @param resp_len size of the buffer, a longer response is cut
+ * @param timeout_ms maximum time to wait for the response
+ * @return true if the complete response was received
+ * @return false if the NoteCard did not answer
+ */
+static bool blues_read_response(char *response, uint16_t resp_len, uint32_t timeout_ms)
+{
+	uint16_t resp_idx = 0;
+	uint8_t available = 0;
+	uint32_t start_time = millis();
+	if (timeout_ms > BLUES_I2C_TIMEOUT)
+	{
+		timeout_ms = BLUES_I2C_TIMEOUT;
+	}
+
+	response[0] = 0;
+	while (true)
+	{
+		// Ask for the bytes the NoteCard reported as available, 0 asks only for the number
+		uint8_t read_len = available > BLUES_I2C_CHUNK ? BLUES_I2C_CHUNK : available;
+		Wire.beginTransmission(BLUES_I2C_ADDR);
+		Wire.write((uint8_t)0);
+		Wire.write(read_len);
+		if (Wire.endTransmission() != 0)
+		{
+			return false;
+		}
+		if (Wire.requestFrom((uint8_t)BLUES_I2C_ADDR, (size_t)(read_len + 2)) != read_len + 2)
+		{
+			return false;
+		}
+		available = Wire.read();
+		uint8_t good = Wire.read();
+		for (uint8_t idx = 0; idx < good; idx++)
+		{
+			char data = (char)Wire.read();
+			transaction_received++;
+			if (data == '\n')
+			{
+				response[resp_idx] = 0;
+				return true;
+			}
+			if (resp_idx < resp_len - 1)
+			{
+				response[resp_idx++] = data;
+			}
+		}
+		if ((available == 0) && (good == 0))
+		{
+			if ((millis() - start_time) > timeout_ms)
+			{
+				response[resp_idx] = 0;
+				return false;
+			}
+			delay(BLUES_I2C_POLL_DELAY);
+		}
+	}
+}
+
+/**
+ * @brief Send one request to the NoteCard and wait for the response
+ *
+ * @param fixed fixed part of the request
+ * @param fixed_len length of the fixed part
+ * @param write optional function to stream the dynamic entries
+ * @param arg argument for the write function
+ * @param response buffer for the response
+ * @param resp_len size of the response buffer
+ * @param timeout_ms maximum time to wait for the response
+ * @return true if the NoteCard answered without error
+ */
+bool blues_transaction(const char *fixed, uint16_t fixed_len, blues_write_t write, void *arg, char *response, uint16_t resp_len, uint32_t timeout_ms)
+{
+	chunk_len = 0;
+	segment_len = 0;
+	chunk_error = false;
+	transaction_sent = 0;
+	transaction_received = 0;
+	energy_start(ENERGY_I2C);
+
+	chunk_write(fixed, fixed_len);
+	if (write != NULL)
+	{
+		write(arg);
+	}
+	chunk_write("}\n", 2);
+	chunk_flush();
+	if (chunk_error)
+	{
+		energy_stop(ENERGY_I2C);
+		MYLOG("BLUES", "I2C write failed");
+		response[0] = 0;
+		return false;
+	}
+
+	bool received = blues_read_response(response, resp_len, timeout_ms);
+	energy_stop(ENERGY_I2C);
+	if (!received)
+	{
+		MYLOG("BLUES", "No response");
+		return false;
+	}
+	return strstr(response, "\"err\"") == NULL;
+}
+
+/**
+ * @brief Get the size of the last transaction
+ *
+ * @param sent returns the bytes of the request
+ * @param received returns the bytes of the response
+ */
+void blues_transaction_bytes(uint16_t *sent, uint16_t *received)
+{
+	*sent = transaction_sent;
+	*received = transaction_received;
+}
@@ -0,0 +1,401 @@
+/**
+ * @file blues_parse.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Single pass extraction of the values of NoteCard responses
+ * 		The response text is scanned once, no JSON document is built. Coordinates are
+ * 		converted from the digits to fixed-point, without the precision loss of float.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Compare a key of the response against a literal */
+#define KEY_IS(name) ((key_len == sizeof(name) - 1) && (memcmp(key, name, sizeof(name) - 1) == 0))
+
+/**
+ * @brief Skip white space
+ *
+ */
+static const char *parse_skip_space(const char *p)
+{
+	while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))
+	{
+		p++;
+	}
+	return p;
+}
+
+/**
+ * @brief Get a string, escape sequences are kept
+ * 		If the string is not terminated, the length is 0
+ *
+ * @param p points to the opening quote
+ * @param start returns the first character of the string
+ * @param len returns the length of the string
+ * @return const char* behind the closing quote, NULL if the string is not terminated
+ */
+static const char *parse_string(const char *p, const char **start, uint16_t *len)
+{
+	*start = ++p;
+	*len = 0;
+	while (*p != '"')
+	{
+		if (*p == 0)
+		{
+			return NULL;
+		}
+		if ((*p == '\\') && (p[1] != 0))
+		{
+			p++;
+		}
+		p++;
+	}
+	*len = (uint16_t)(p - *start);
+	return p + 1;
+}
+
+/**
+ * @brief Skip a value of any type
+ *
+ * @param p points to the first character of the value
+ * @return const char* behind the value, NULL if the response ends inside the value
+ */
+static const char *parse_skip_value(const char *p)
+{
+	const char *start;
+	uint16_t len;
+	uint8_t depth = 0;
+	while (*p != 0)
+	{
+		if (*p == '"')
+		{
+			p = parse_string(p, &start, &len);
+			if (p == NULL)
+			{
+				return NULL;
+			}
+			if (depth == 0)
+			{
+				return p;
+			}
+			continue;
+		}
+		if ((*p == '{') || (*p == '['))
+		{
+			depth++;
+		}
+		else if ((*p == '}') || (*p == ']'))
+		{
+			if (depth == 0)
+			{
+				// End of the enclosing object
+				return p;
+			}
+			depth--;
+			if (depth == 0)
+			{
+				return p + 1;
+			}
+		}
+		else if ((*p == ',') && (depth == 0))
+		{
+			return p;
+		}
+		p++;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Convert a decimal number into fixed-point, rounded at the last kept decimal
+ *
+ * @param p points to the number
+ * @param decimals number of decimals to keep
+ * @param value returns the number * 10^decimals
+ * @return const char* behind the number
+ */
+static const char *parse_fixed(const char *p, uint8_t decimals, int32_t *value)
+{
+	bool negative = false;
+	uint32_t result = 0;
+	uint8_t digits = 0;
+
+	if (*p == '-')
+	{
+		negative = true;
+		p++;
+	}
+	while ((*p >= '0') && (*p <= '9'))
+	{
+		result = result * 10 + (*p++ - '0');
+	}
+	if (*p == '.')
+	{
+		p++;
+		while ((*p >= '0') && (*p <= '9'))
+		{
+			if (digits < decimals)
+			{
+				result = result * 10 + (*p - '0');
+			}
+			else if ((digits == decimals) && (*p >= '5'))
+			{
+				// Round half away from zero
+				result++;
+			}
+			digits++;
+			p++;
+		}
+	}
+	for (; digits < decimals; digits++)
+	{
+		result = result * 10;
+	}
+	*value = negative ? -(int32_t)result : (int32_t)result;
+	return p;
+}
+
+/**
+ * @brief Convert an unsigned integer
+ *
+ * @param p points to the number
+ * @param value returns the number
+ * @return const char* behind the number
+ */
+static const char *parse_uint32(const char *p, uint32_t *value)
+{
+	uint32_t result = 0;
+	while ((*p >= '0') && (*p <= '9'))
+	{
+		result = result * 10 + (*p++ - '0');
+	}
+	*value = result;
+	return p;
+}
+
+/**
+ * @brief Check if a string contains a word
+ *
+ */
+static bool parse_contains(const char *start, uint16_t len, const char *word)
+{
+	uint16_t word_len = strlen(word);
+	for (uint16_t idx = 0; idx + word_len <= len; idx++)
+	{
+		if (memcmp(&start[idx], word, word_len) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Get the next member of an object
+ *
+ * @param pp points behind the opening brace or behind the previous value,
+ * 		returns the start of the value or the position behind the closing brace
+ * @param key returns the key of the member
+ * @param key_len returns the length of the key
+ * @return int8_t 1 = member found, 0 = end of the object, -1 = syntax error or response cut
+ */
+static int8_t parse_member(const char **pp, const char **key, uint16_t *key_len)
+{
+	const char *p = parse_skip_space(*pp);
+	if (*p == ',')
+	{
+		p = parse_skip_space(p + 1);
+	}
+	if (*p == '}')
+	{
+		*pp = p + 1;
+		return 0;
+	}
+	if (*p != '"')
+	{
+		return -1;
+	}
+	p = parse_string(p, key, key_len);
+	if (p == NULL)
+	{
+		return -1;
+	}
+	p = parse_skip_space(p);
+	if (*p != ':')
+	{
+		return -1;
+	}
+	*pp = parse_skip_space(p + 1);
+	return 1;
+}
+
+/**
+ * @brief Extract the values of a card.location, card.time, card.wireless, card.motion, hub.get or hub.sync.status response in one pass
+ *
+ * @param json response text
+ * @param parsed returns the values, fields tells which values were found
+ * @return true if the response is a complete object
+ * @return false if the response is cut or not an object, values found before are kept
+ */
+bool blues_parse_response(const char *json, s_blues_response *parsed)
+{
+	const char *key;
+	uint16_t key_len;
+	const char *str;
+	uint16_t str_len;
+	bool has_lat = false;
+	bool has_lon = false;
+	int8_t member = -1;
+
+	memset(parsed, 0, sizeof(s_blues_response));
+	parsed->sim_usage = 0xFF;
+
+	const char *p = parse_skip_space(json);
+	if (*p != '{')
+	{
+		return false;
+	}
+	p++;
+
+	while ((member = parse_member(&p, &key, &key_len)) == 1)
+	{
+		if (KEY_IS("lat"))
+		{
+			p = parse_fixed(p, 7, &parsed->lat);
+			has_lat = true;
+		}
+		else if (KEY_IS("lon"))
+		{
+			p = parse_fixed(p, 7, &parsed->lon);
+			has_lon = true;
+		}
+		else if (KEY_IS("time"))
+		{
+			p = parse_uint32(p, &parsed->time);
+			parsed->fields |= BLUES_HAS_TIME;
+		}
+		else if (KEY_IS("count"))
+		{
+			p = parse_uint32(p, &parsed->count);
+			parsed->fields |= BLUES_HAS_COUNT;
+		}
+		else if (KEY_IS("completed"))
+		{
+			p = parse_uint32(p, &parsed->completed);
+			parsed->fields |= BLUES_HAS_COMPLETED;
+		}
+		else if (KEY_IS("dop"))
+		{
+			int32_t dop;
+			p = parse_fixed(p, 2, &dop);
+			parsed->dop = (uint16_t)dop;
+			parsed->fields |= BLUES_HAS_DOP;
+		}
+		else if ((*p == '"') && KEY_IS("status"))
+		{
+			p = parse_string(p, &str, &str_len);
+			if (parse_contains(str, str_len, "inactive"))
+			{
+				parsed->status = GNSS_STATUS_INACTIVE;
+			}
+			else if (parse_contains(str, str_len, "search"))
+			{
+				parsed->status = GNSS_STATUS_SEARCH;
+			}
+			else if (parse_contains(str, str_len, "updated"))
+			{
+				parsed->status = GNSS_STATUS_UPDATED;
+			}
+			parsed->fields |= BLUES_HAS_STATUS;
+		}
+		else if ((*p == '"') && KEY_IS("country"))
+		{
+			p = parse_string(p, &str, &str_len);
+			if (str_len == 2)
+			{
+				parsed->country[0] = str[0];
+				parsed->country[1] = str[1];
+				parsed->fields |= BLUES_HAS_COUNTRY;
+			}
+		}
+		else if ((*p == '"') && KEY_IS("apn"))
+		{
+			p = parse_string(p, &parsed->apn, &str_len);
+			parsed->apn_len = str_len > 255 ? 255 : (uint8_t)str_len;
+			parsed->fields |= BLUES_HAS_APN;
+		}
+		else if ((*p == '"') && KEY_IS("product"))
+		{
+			p = parse_string(p, &parsed->product, &str_len);
+			parsed->product_len = str_len > 255 ? 255 : (uint8_t)str_len;
+			parsed->fields |= BLUES_HAS_PRODUCT;
+		}
+		else if ((*p == '"') && KEY_IS("mode"))
+		{
+			p = parse_string(p, &parsed->mode, &str_len);
+			parsed->mode_len = str_len > 255 ? 255 : (uint8_t)str_len;
+			parsed->fields |= BLUES_HAS_MODE;
+		}
+		else if ((*p == '"') && KEY_IS("method"))
+		{
+			p = parse_string(p, &str, &str_len);
+			if ((str_len == 7) && (memcmp(str, "primary", 7) == 0))
+			{
+				parsed->sim_usage = 0;
+			}
+			else if ((str_len == 9) && (memcmp(str, "secondary", 9) == 0))
+			{
+				parsed->sim_usage = 1;
+			}
+			else if ((str_len == 22) && (memcmp(str, "dual-secondary-primary", 22) == 0))
+			{
+				parsed->sim_usage = 2;
+			}
+			else if ((str_len == 22) && (memcmp(str, "dual-primary-secondary", 22) == 0))
+			{
+				parsed->sim_usage = 3;
+			}
+			parsed->fields |= BLUES_HAS_METHOD;
+		}
+		else if ((*p == '{') && KEY_IS("net"))
+		{
+			// Only the presence of the band is needed
+			int8_t nested;
+			p++;
+			while ((nested = parse_member(&p, &key, &key_len)) == 1)
+			{
+				if (KEY_IS("band"))
+				{
+					parsed->fields |= BLUES_HAS_NET_BAND;
+				}
+				p = parse_skip_value(p);
+				if (p == NULL)
+				{
+					break;
+				}
+			}
+			if (nested < 0)
+			{
+				p = NULL;
+			}
+		}
+		else
+		{
+			p = parse_skip_value(p);
+		}
+		if (p == NULL)
+		{
+			member = -1;
+			break;
+		}
+	}
+
+	if (has_lat && has_lon)
+	{
+		parsed->fields |= BLUES_HAS_LOCATION;
+	}
+	return member == 0;
+}
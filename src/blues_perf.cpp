@@ -0,0 +1,145 @@
+/**
+ * @file blues_perf.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Histograms of the NoteCard requests per request name
+ * 		Each round trip to the NoteCard is counted with its time and the bytes sent and received,
+ * 		each request with its retries and if it failed after all tries.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Upper limits of the time buckets in ms, the last bucket has no limit */
+static const uint16_t perf_ms_limits[BLUES_PERF_MS_BUCKETS - 1] = {10, 20, 50, 100, 200, 500, 1000};
+
+/** Upper limits of the size buckets in bytes, the last bucket has no limit */
+static const uint16_t perf_size_limits[BLUES_PERF_SIZE_BUCKETS - 1] = {32, 64, 128, 256, 512};
+
+/** Counters per request name, the last entry collects the names that did not fit */
+static s_blues_perf perf_data[BLUES_PERF_NAMES];
+
+/**
+ * @brief Find the counters of a request name, a new name gets the next free entry
+ *
+ * @param request name of the request
+ * @return s_blues_perf* counters
+ */
+static s_blues_perf *perf_find(const char *request)
+{
+	uint8_t idx = 0;
+	for (; idx < BLUES_PERF_NAMES - 1; idx++)
+	{
+		if (perf_data[idx].name[0] == 0)
+		{
+			snprintf(perf_data[idx].name, sizeof(perf_data[idx].name), "%s", request);
+			break;
+		}
+		if (strncmp(perf_data[idx].name, request, sizeof(perf_data[idx].name) - 1) == 0)
+		{
+			break;
+		}
+	}
+	if (idx == BLUES_PERF_NAMES - 1)
+	{
+		snprintf(perf_data[idx].name, sizeof(perf_data[idx].name), "other");
+	}
+	return &perf_data[idx];
+}
+
+/**
+ * @brief Find the bucket of a value
+ *
+ * @param value time or size
+ * @param limits upper limits of the buckets
+ * @param num number of buckets
+ * @return uint8_t bucket
+ */
+static uint8_t perf_bucket(uint32_t value, const uint16_t *limits, uint8_t num)
+{
+	uint8_t bucket = 0;
+	while ((bucket < num - 1) && (value >= limits[bucket]))
+	{
+		bucket++;
+	}
+	return bucket;
+}
+
+/**
+ * @brief Count one round trip to the NoteCard
+ *
+ * @param request name of the request
+ * @param time_ms time of the round trip
+ * @param sent bytes of the request, BLUES_PERF_UNKNOWN if not known
+ * @param received bytes of the response, BLUES_PERF_UNKNOWN if not known
+ * @param success true if the NoteCard answered without error
+ */
+void blues_perf_try(const char *request, uint32_t time_ms, uint16_t sent, uint16_t received, bool success)
+{
+	s_blues_perf *perf = perf_find(request);
+	perf->tries++;
+	if (!success)
+	{
+		perf->errors++;
+	}
+	perf->total_ms += time_ms;
+	if (time_ms > perf->max_ms)
+	{
+		perf->max_ms = time_ms;
+	}
+	perf->time_hist[perf_bucket(time_ms, perf_ms_limits, BLUES_PERF_MS_BUCKETS)]++;
+	if (sent != BLUES_PERF_UNKNOWN)
+	{
+		perf->sent += sent;
+		perf->sent_hist[perf_bucket(sent, perf_size_limits, BLUES_PERF_SIZE_BUCKETS)]++;
+	}
+	if (received != BLUES_PERF_UNKNOWN)
+	{
+		perf->received += received;
+		perf->received_hist[perf_bucket(received, perf_size_limits, BLUES_PERF_SIZE_BUCKETS)]++;
+	}
+}
+
+/**
+ * @brief Count a request that went through the retry policy
+ *
+ * @param request name of the request
+ * @param tries number of round trips
+ * @param success true if the request was successful
+ */
+void blues_perf_request(const char *request, uint8_t tries, bool success)
+{
+	s_blues_perf *perf = perf_find(request);
+	perf->requests++;
+	perf->retries += tries > 1 ? tries - 1 : 0;
+	if (!success)
+	{
+		perf->failures++;
+	}
+}
+
+/**
+ * @brief Get the counters of a request name
+ *
+ * @param idx index of the entry
+ * @return const s_blues_perf* counters or NULL if idx is out of range or the entry is not used
+ */
+const s_blues_perf *blues_perf_stats(uint8_t idx)
+{
+	if ((idx >= BLUES_PERF_NAMES) || (perf_data[idx].name[0] == 0))
+	{
+		return NULL;
+	}
+	return &perf_data[idx];
+}
+
+/**
+ * @brief Clear all counters
+ *
+ */
+void blues_perf_reset(void)
+{
+	memset(perf_data, 0, sizeof(perf_data));
+}
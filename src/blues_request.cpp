@@ -0,0 +1,272 @@
+/**
+ * @file blues_request.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Blues NoteCard request execution with per request retry policy
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/**
+ * @brief Retry policy for a NoteCard request
+ *        attempts  maximum number of tries
+ *        budget_ms no new try is started after this time, a streamed try waits for the
+ *                  response only for the rest of the budget. A try through RAK_BLUES
+ *                  waits with the timeout of the library and can end after the budget.
+ *        backoff_ms wait time after the first failed try, doubled after each further failure
+ *
+ */
+struct s_blues_policy
+{
+	const char *request;
+	uint8_t attempts;
+	uint16_t budget_ms;
+	uint16_t backoff_ms;
+};
+
+/** Retry policies, the last entry is the default for all other requests */
+static const s_blues_policy blues_policies[] = {
+	// Detection of the NoteCard, retry only a few times
+	{"card.version", 3, 1000, 50},
+	// Queries, a stale answer is useless, keep the cycle short
+	{"card.location", 3, 600, 25},
+	{"card.time", 3, 600, 25},
+	{"card.wireless", 3, 1000, 50},
+	{"hub.status", 2, 500, 50},
+	{"card.attn", 4, 800, 25},
+	// Modem is busy while connecting, give it more time between tries
+	{"note.add", 3, 5000, 500},
+	{"hub.sync", 3, 5000, 500},
+	// Configuration requests
+	{NULL, 5, 2000, 50},
+};
+
+#define BLUES_POLICY_NUM (sizeof(blues_policies) / sizeof(s_blues_policy))
+
+/** Counters per policy */
+static s_blues_req_stats blues_req_stats[BLUES_POLICY_NUM];
+
+/** Request built with RAK_BLUES */
+struct s_blues_rak_req
+{
+	const char *request;
+	blues_fill_t fill;
+	void *arg;
+	char *response;
+	uint16_t resp_len;
+};
+
+/** Request streamed to the NoteCard */
+struct s_blues_raw_req
+{
+	const char *request;
+	const char *fixed;
+	uint16_t fixed_len;
+	blues_write_t write;
+	void *arg;
+	char *response;
+	uint16_t resp_len;
+	uint32_t budget_ms;
+};
+
+/** Response buffer for streamed requests if the caller does not need the response */
+static char raw_response[256];
+
+/**
+ * @brief Find the policy for a request
+ *
+ * @param request name of the request
+ * @return uint8_t index into blues_policies
+ */
+static uint8_t blues_find_policy(const char *request)
+{
+	uint8_t idx = 0;
+	for (; idx < BLUES_POLICY_NUM - 1; idx++)
+	{
+		if (strcmp(blues_policies[idx].request, request) == 0)
+		{
+			break;
+		}
+	}
+	return idx;
+}
+
+/**
+ * @brief Execute a request, retry according to the policy of the request
+ *
+ * @param request name of the request
+ * @param try_once function that sends the request once
+ * @param ctx argument for try_once
+ * @param budget_ms optional, set to the rest of the time budget before each try
+ * @return true if the request was successful
+ * @return false if all tries failed or the time budget is used up
+ */
+static bool blues_execute(const char *request, bool (*try_once)(void *ctx), void *ctx, uint32_t *budget_ms)
+{
+	uint8_t policy_idx = blues_find_policy(request);
+	const s_blues_policy *policy = &blues_policies[policy_idx];
+	s_blues_req_stats *stats = &blues_req_stats[policy_idx];
+	uint32_t start_time = millis();
+	uint32_t backoff = policy->backoff_ms;
+
+	stats->requests++;
+	for (uint8_t try_send = 0; try_send < policy->attempts; try_send++)
+	{
+		uint32_t elapsed = millis() - start_time;
+		if (elapsed >= policy->budget_ms)
+		{
+			blues_perf_request(request, try_send, false);
+			break;
+		}
+		stats->attempts++;
+		if (budget_ms != NULL)
+		{
+			*budget_ms = policy->budget_ms - elapsed;
+		}
+		if (try_once(ctx))
+		{
+			stats->busy_ms += millis() - start_time;
+			blues_perf_request(request, try_send + 1, true);
+			return true;
+		}
+
+		// Wait with random jitter, the NoteCard might be busy with the modem
+		uint32_t wait_time = backoff + random(backoff / 2 + 1);
+		if ((try_send + 1 == policy->attempts) || (millis() - start_time + wait_time > policy->budget_ms))
+		{
+			blues_perf_request(request, try_send + 1, false);
+			break;
+		}
+		stats->backoff_ms += wait_time;
+		delay(wait_time);
+		backoff = backoff * 2;
+	}
+	stats->failures++;
+	stats->busy_ms += millis() - start_time;
+	MYLOG("BLUES", "%s request failed", request);
+	return false;
+}
+
+/**
+ * @brief Build a request with RAK_BLUES and send it once
+ * 		RAK_BLUES waits for the response with its own timeout.
+ *
+ * @param ctx pointer to s_blues_rak_req
+ */
+static bool blues_try_rak(void *ctx)
+{
+	s_blues_rak_req *req = (s_blues_rak_req *)ctx;
+	if (!blues_start_req(req->request))
+	{
+		return false;
+	}
+	if (req->fill != NULL)
+	{
+		req->fill(req->arg);
+	}
+	return blues_send_req(req->response, req->resp_len);
+}
+
+/**
+ * @brief Stream a request to the NoteCard once
+ * 		Waits for the response only for the rest of the time budget.
+ *
+ * @param ctx pointer to s_blues_raw_req
+ */
+static bool blues_try_raw(void *ctx)
+{
+	s_blues_raw_req *req = (s_blues_raw_req *)ctx;
+	blues_capture_begin(req->request);
+	uint32_t start_time = millis();
+	bool result = blues_transaction(req->fixed, req->fixed_len, req->write, req->arg, req->response, req->resp_len, req->budget_ms);
+	uint16_t sent;
+	uint16_t received;
+	blues_transaction_bytes(&sent, &received);
+	blues_perf_try(req->request, millis() - start_time, sent, received, result);
+	blues_capture_end(result, req->response);
+	return result;
+}
+
+/**
+ * @brief Send a request to the NoteCard, retry according to the policy of the request
+ * 		The request is rebuilt with the fill function before each try.
+ * 		After success the parsed response is available through rak_blues.
+ * 		The time budget only stops further tries, each try waits with the RAK_BLUES timeout.
+ *
+ * @param request name of the request
+ * @param fill function to add the entries of the request, can be NULL
+ * @param arg argument for the fill function
+ * @param response optional buffer for the response
+ * @param resp_len size of the response buffer
+ * @return true if the request was successful
+ * @return false if all tries failed or the time budget is used up
+ */
+bool blues_request(const char *request, blues_fill_t fill, void *arg, char *response, uint16_t resp_len)
+{
+	s_blues_rak_req req = {request, fill, arg, response, resp_len};
+	return blues_execute(request, blues_try_rak, &req, NULL);
+}
+
+/**
+ * @brief Stream a request to the NoteCard, retry according to the policy of the request
+ * 		The fixed part is sent from flash, the dynamic entries are streamed by the write
+ * 		function directly into the I2C chunks. The response is not parsed into
+ * 		rak_blues, use blues_parse_response() or blues_request() to get its values.
+ *
+ * @param fixed fixed part of the request, starts with BLUES_REQ(name)
+ * @param fixed_len length of the fixed part
+ * @param write optional function to stream the dynamic entries
+ * @param arg argument for the write function
+ * @param response optional buffer for the response
+ * @param resp_len size of the response buffer
+ * @return true if the request was successful
+ * @return false if all tries failed or the time budget is used up
+ */
+bool blues_request_raw(const char *fixed, uint16_t fixed_len, blues_write_t write, void *arg, char *response, uint16_t resp_len)
+{
+	// Name of the request for the policy, fixed starts with {"req":"
+	char request[32];
+	uint8_t name_len = 0;
+	for (const char *c = fixed + 8; (*c != '"') && (*c != 0) && (name_len < sizeof(request) - 1); c++)
+	{
+		request[name_len++] = *c;
+	}
+	request[name_len] = 0;
+
+	if ((response == NULL) || (resp_len == 0))
+	{
+		response = raw_response;
+		resp_len = sizeof(raw_response);
+	}
+	s_blues_raw_req req = {request, fixed, fixed_len, write, arg, response, resp_len, 0};
+	return blues_execute(request, blues_try_raw, &req, &req.budget_ms);
+}
+
+/**
+ * @brief Get the counters of a retry policy
+ *
+ * @param idx index of the policy
+ * @param name returns the request name of the policy, "other" for the default policy
+ * @return const s_blues_req_stats* counters or NULL if idx is out of range
+ */
+const s_blues_req_stats *blues_request_stats(uint8_t idx, const char **name)
+{
+	if (idx >= BLUES_POLICY_NUM)
+	{
+		return NULL;
+	}
+	*name = blues_policies[idx].request != NULL ? blues_policies[idx].request : "other";
+	return &blues_req_stats[idx];
+}
+
+/**
+ * @brief Reset the counters of all retry policies
+ *
+ */
+void blues_request_stats_reset(void)
+{
+	memset(blues_req_stats, 0, sizeof(blues_req_stats));
+}
@@ -0,0 +1,76 @@
+/**
+ * @file blues_shadow.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Shadow of the NoteCard configuration, used to skip requests that would not change anything
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Last known state of the NoteCard */
+s_blues_shadow g_blues_shadow;
+
+/** Number of NoteCard requests that were skipped */
+static uint32_t skipped_requests = 0;
+
+/**
+ * @brief Forget the known NoteCard state, e.g. after a factory reset
+ * 		or a request from the user that might have changed it
+ *
+ */
+void blues_shadow_reset(void)
+{
+	g_blues_shadow.location_mode = SHADOW_UNKNOWN;
+	g_blues_shadow.motion_mode = SHADOW_UNKNOWN;
+	g_blues_shadow.attn_modes = SHADOW_UNKNOWN;
+	g_blues_shadow.attn_armed = false;
+	g_blues_shadow.hub_hash = 0;
+	g_blues_shadow.wireless_hash = 0;
+	g_blues_shadow.setup_hash = 0;
+}
+
+/**
+ * @brief Count skipped requests
+ *
+ * @param requests number of requests that were not sent
+ */
+void blues_shadow_skip(uint8_t requests)
+{
+	skipped_requests += requests;
+}
+
+/**
+ * @brief Get the number of skipped requests
+ *
+ * @return uint32_t skipped requests since start
+ */
+uint32_t blues_shadow_skipped(void)
+{
+	return skipped_requests;
+}
+
+/**
+ * @brief FNV-1a hash over request parameters
+ *
+ * @param hash start value, 0 for the first block
+ * @param data parameter
+ * @param len size of the parameter
+ * @return uint32_t hash, never 0
+ */
+uint32_t blues_shadow_hash(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	if (hash == 0)
+	{
+		hash = 2166136261UL;
+	}
+	for (size_t idx = 0; idx < len; idx++)
+	{
+		hash ^= bytes[idx];
+		hash *= 16777619UL;
+	}
+	return hash != 0 ? hash : 1;
+}
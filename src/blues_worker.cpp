@@ -0,0 +1,226 @@
+/**
+ * @file blues_worker.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief NoteCard worker task
+ * 		The requests to the NoteCard with their retries and delays run in an own task, the loop
+ * 		keeps handling the LoRaWAN events. The loop submits a job into a bounded queue, the worker
+ * 		runs the jobs in order with the NoteCard locked and posts BLUES_DONE, the loop then calls
+ * 		the completion function of each finished job. Packet, LoRaWAN and LED state are only
+ * 		changed by the completion functions in the loop.
+ * 		Without the worker (ESP32) or with a full queue the job runs in the loop as before.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Job slots, used in the order of the indices below */
+static s_blues_job worker_jobs[BLUES_WORKER_QUEUE];
+
+/** Jobs submitted by the loop */
+static volatile uint32_t jobs_submitted = 0;
+
+/** Jobs finished by the worker */
+static volatile uint32_t jobs_finished = 0;
+
+/** Jobs completed by the loop, their slots are free */
+static volatile uint32_t jobs_completed = 0;
+
+/** Flag if the worker task is running */
+static bool worker_running = false;
+
+/** Counters of the worker */
+static s_blues_worker_stats worker_stats;
+
+#ifdef NRF52_SERIES
+/** Wakes up the worker after a submit */
+static SemaphoreHandle_t worker_wake = NULL;
+
+/** Lock of the NoteCard, the worker and the AT commands use the same I2C transactions and buffers */
+static SemaphoreHandle_t blues_mutex = NULL;
+
+/**
+ * @brief Worker task, runs the jobs whenever the loop submitted one
+ *
+ */
+static void blues_worker_task(void *arg)
+{
+	(void)arg;
+	while (true)
+	{
+		xSemaphoreTake(worker_wake, portMAX_DELAY);
+		blues_worker_run();
+	}
+}
+#endif
+
+/**
+ * @brief Start the worker task, called after init_blues()
+ *
+ */
+void blues_worker_init(void)
+{
+#ifdef NRF52_SERIES
+	blues_mutex = xSemaphoreCreateRecursiveMutex();
+	worker_wake = xSemaphoreCreateBinary();
+	if ((blues_mutex == NULL) || (worker_wake == NULL))
+	{
+		MYLOG("WORK", "No memory for the worker, NoteCard requests run in the loop");
+		return;
+	}
+	// Above the idle task, the loop runs with the same priority
+	worker_running = xTaskCreate(blues_worker_task, "BLUES", 2048, NULL, tskIDLE_PRIORITY + 1, NULL) == pdPASS;
+	MYLOG("WORK", "NoteCard worker %s", worker_running ? "started" : "failed");
+#endif
+}
+
+/**
+ * @brief Lock the NoteCard, can be called again by the task that holds the lock
+ *
+ */
+void blues_lock(void)
+{
+#ifdef NRF52_SERIES
+	if (blues_mutex != NULL)
+	{
+		xSemaphoreTakeRecursive(blues_mutex, portMAX_DELAY);
+	}
+#endif
+}
+
+/**
+ * @brief Unlock the NoteCard
+ *
+ */
+void blues_unlock(void)
+{
+#ifdef NRF52_SERIES
+	if (blues_mutex != NULL)
+	{
+		xSemaphoreGiveRecursive(blues_mutex);
+	}
+#endif
+}
+
+/**
+ * @brief Queue a job for the worker, only called from the loop
+ * 		Without worker or with a full queue the job and its completion run immediately
+ *
+ * @param job job to copy into the queue
+ * @return true if the job was queued
+ * @return false if the job ran in the loop
+ */
+bool blues_worker_submit(const s_blues_job *job)
+{
+	uint32_t submitted = jobs_submitted;
+	if (!worker_running || ((submitted - jobs_completed) >= BLUES_WORKER_QUEUE))
+	{
+		worker_stats.inline_jobs++;
+		s_blues_job inline_job = *job;
+		blues_lock();
+		inline_job.result = inline_job.run(&inline_job);
+		blues_unlock();
+		if (inline_job.done != NULL)
+		{
+			inline_job.done(&inline_job);
+		}
+		return false;
+	}
+
+	s_blues_job *slot = &worker_jobs[submitted % BLUES_WORKER_QUEUE];
+	*slot = *job;
+	slot->submit_ms = millis();
+	// The worker reads the slot only after it sees the new index
+	__atomic_store_n(&jobs_submitted, submitted + 1, __ATOMIC_RELEASE);
+	worker_stats.submitted++;
+	uint8_t depth = blues_worker_depth();
+	if (depth > worker_stats.max_depth)
+	{
+		worker_stats.max_depth = depth;
+	}
+#ifdef NRF52_SERIES
+	xSemaphoreGive(worker_wake);
+#endif
+	return true;
+}
+
+/**
+ * @brief Run the queued jobs, called by the worker task
+ *
+ */
+void blues_worker_run(void)
+{
+	uint32_t finished = jobs_finished;
+	while (finished != __atomic_load_n(&jobs_submitted, __ATOMIC_ACQUIRE))
+	{
+		s_blues_job *job = &worker_jobs[finished % BLUES_WORKER_QUEUE];
+		job->start_ms = millis();
+		blues_lock();
+		job->result = job->run(job);
+		blues_unlock();
+		job->end_ms = millis();
+		finished++;
+		// The loop reads the result only after it sees the new index
+		__atomic_store_n(&jobs_finished, finished, __ATOMIC_RELEASE);
+		app_event_post(BLUES_DONE);
+	}
+}
+
+/**
+ * @brief Call the completion functions of the finished jobs, called from the loop on BLUES_DONE
+ *
+ */
+void blues_worker_complete(void)
+{
+	uint32_t completed = jobs_completed;
+	while (completed != __atomic_load_n(&jobs_finished, __ATOMIC_ACQUIRE))
+	{
+		s_blues_job *job = &worker_jobs[completed % BLUES_WORKER_QUEUE];
+		uint32_t latency = job->end_ms - job->submit_ms;
+		worker_stats.wait_ms += job->start_ms - job->submit_ms;
+		worker_stats.run_ms += job->end_ms - job->start_ms;
+		if (latency > worker_stats.max_ms)
+		{
+			worker_stats.max_ms = latency;
+		}
+		worker_stats.completed++;
+		// The slot stays used until the completion returns, it can submit new jobs
+		if (job->done != NULL)
+		{
+			job->done(job);
+		}
+		completed++;
+		__atomic_store_n(&jobs_completed, completed, __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * @brief Get the number of jobs that are waiting, running or not completed
+ *
+ * @return uint8_t jobs in the queue
+ */
+uint8_t blues_worker_depth(void)
+{
+	return (uint8_t)(jobs_submitted - jobs_completed);
+}
+
+/**
+ * @brief Get the counters of the worker
+ *
+ * @return const s_blues_worker_stats* counters
+ */
+const s_blues_worker_stats *blues_worker_stats(void)
+{
+	return &worker_stats;
+}
+
+/**
+ * @brief Clear the counters, queued jobs are kept
+ *
+ */
+void blues_worker_stats_reset(void)
+{
+	memset(&worker_stats, 0, sizeof(worker_stats));
+}
@@ -0,0 +1,94 @@
+/**
+ * @file boot_profile.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Times of the boot phases
+ * 		Each phase is recorded with its start and end in ms since the reset. Phases can overlap,
+ * 		the NoteCard configuration runs in the worker while the loop starts LoRaWAN.
+ * 		Only the first run of a phase is kept, a rejoin does not change the join time.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Names of the phases for the AT command */
+static const char *boot_phase_names[BOOT_NUM] = {"serial", "api", "app", "settings", "rak1906", "blues", "lorawan", "join", "uplink"};
+
+/** Times of the phases */
+static s_boot_phase boot_phases[BOOT_NUM];
+
+/**
+ * @brief Check if a USB host is connected, without it the serial wait is skipped
+ *
+ * @return true if the USB supply is detected or it can't be checked
+ */
+bool boot_usb_present(void)
+{
+#ifdef NRF52_SERIES
+	return (NRF_POWER->USBREGSTATUS & POWER_USBREGSTATUS_VBUSDETECT_Msk) != 0;
+#endif
+#ifdef ESP32
+	// USB is connected through a UART bridge, Serial does not wait
+	return true;
+#endif
+}
+
+/**
+ * @brief Record the start of a phase
+ *
+ * @param phase BOOT_xxx
+ */
+void boot_phase_start(uint8_t phase)
+{
+	if (boot_phases[phase].started)
+	{
+		return;
+	}
+	boot_phases[phase].start_ms = millis();
+	boot_phases[phase].started = true;
+}
+
+/**
+ * @brief Record the end of a phase, a phase that was not started starts at the reset
+ *
+ * @param phase BOOT_xxx
+ */
+void boot_phase_end(uint8_t phase)
+{
+	if (boot_phases[phase].finished)
+	{
+		return;
+	}
+	boot_phases[phase].end_ms = millis();
+	boot_phases[phase].started = true;
+	boot_phases[phase].finished = true;
+	MYLOG("BOOT", "%s finished after %ld ms", boot_phase_names[phase], (long)(boot_phases[phase].end_ms - boot_phases[phase].start_ms));
+}
+
+/**
+ * @brief Get the times of a phase
+ *
+ * @param phase BOOT_xxx
+ * @param name returns the name of the phase
+ * @return const s_boot_phase* times or NULL if phase is out of range
+ */
+const s_boot_phase *boot_phase(uint8_t phase, const char **name)
+{
+	if (phase >= BOOT_NUM)
+	{
+		return NULL;
+	}
+	*name = boot_phase_names[phase];
+	return &boot_phases[phase];
+}
+
+/**
+ * @brief Clear all phases
+ *
+ */
+void boot_profile_reset(void)
+{
+	memset(boot_phases, 0, sizeof(boot_phases));
+}
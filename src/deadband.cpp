@@ -0,0 +1,143 @@
+/**
+ * @file deadband.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Suppress uplinks if the position did not change more than the deadband since the last
+ * 		reported position. The distance is calculated in fixed-point, without float and sqrt.
+ * 		A keep-alive uplink is sent after a number of suppressed uplinks.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** 1e-7 degree latitude in cm, Q16 */
+#define DEADBAND_CM_Q16 72954
+/** Coordinate difference that is always outside the deadband, 1 degree */
+#define DEADBAND_FAR 10000000
+/** Step of the cosine table in 1e-7 degrees, 5 degrees */
+#define COS_STEP 50000000
+
+/** cos() of 0 to 90 degrees in steps of 5 degrees, Q15 */
+static const uint16_t cos_table[19] = {32768, 32643, 32270, 31651, 30792, 29698, 28378, 26842, 25102, 23170,
+									   21063, 18795, 16384, 13848, 11207, 8481, 5690, 2856, 0};
+
+/** Last reported position */
+static s_position last_position;
+
+/** Flag if a position was reported */
+static bool has_last_position = false;
+
+/** Uplinks suppressed since the last reported position */
+static uint8_t suppressed_count = 0;
+
+/** Counters of the deadband */
+static s_deadband_stats dead_stats;
+
+/**
+ * @brief Get cos() of a latitude by linear interpolation of the table
+ *
+ * @param lat latitude in 1e-7 degrees
+ * @return uint32_t cos(lat) Q15
+ */
+static uint32_t deadband_cos(int32_t lat)
+{
+	uint32_t abs_lat = lat < 0 ? -(uint32_t)lat : (uint32_t)lat;
+	if (abs_lat >= 900000000)
+	{
+		return 0;
+	}
+	uint8_t idx = abs_lat / COS_STEP;
+	// Position between two table entries, Q16
+	uint32_t fraction = (abs_lat % COS_STEP) / 763;
+	return cos_table[idx] - (((uint32_t)(cos_table[idx] - cos_table[idx + 1]) * fraction) >> 16);
+}
+
+/**
+ * @brief Get the squared distance between two positions, equirectangular approximation
+ * 		Exact enough for distances up to some km, larger distances saturate
+ *
+ * @param lat1 latitude of the first position in 1e-7 degrees
+ * @param lon1 longitude of the first position in 1e-7 degrees
+ * @param lat2 latitude of the second position in 1e-7 degrees
+ * @param lon2 longitude of the second position in 1e-7 degrees
+ * @return uint64_t squared distance in cm², UINT64_MAX if the positions are more than 1 degree apart
+ */
+uint64_t deadband_distance_sq(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+	int32_t d_lat = (int32_t)((int64_t)lat2 - lat1);
+	int64_t d_lon_64 = (int64_t)lon2 - lon1;
+	// Across the date line
+	if (d_lon_64 > 1800000000LL)
+	{
+		d_lon_64 -= 3600000000LL;
+	}
+	else if (d_lon_64 < -1800000000LL)
+	{
+		d_lon_64 += 3600000000LL;
+	}
+	int32_t d_lon = (int32_t)d_lon_64;
+	if ((d_lat > DEADBAND_FAR) || (d_lat < -DEADBAND_FAR) || (d_lon > DEADBAND_FAR) || (d_lon < -DEADBAND_FAR))
+	{
+		return UINT64_MAX;
+	}
+
+	// Scale the longitude difference with cos() of the mean latitude
+	int32_t mean_lat = (int32_t)(((int64_t)lat1 + lat2) / 2);
+	int32_t d_x = (int32_t)(((int64_t)d_lon * deadband_cos(mean_lat)) >> 15);
+
+	int64_t x_cm = ((int64_t)d_x * DEADBAND_CM_Q16) >> 16;
+	int64_t y_cm = ((int64_t)d_lat * DEADBAND_CM_Q16) >> 16;
+	return (uint64_t)(x_cm * x_cm + y_cm * y_cm);
+}
+
+/**
+ * @brief Check if an uplink with a position should be sent
+ *
+ * @param position new position
+ * @param forced true to send in any case, e.g. for a motion state change
+ * @param size size of the uplink, counted as saved if it is suppressed
+ * @return true if the uplink should be sent, the position is the new reference
+ * @return false if the position is within the deadband, the uplink is suppressed
+ */
+bool deadband_report(s_position *position, bool forced, uint8_t size)
+{
+	uint16_t deadband = g_blues_settings.deadband;
+	bool report = forced || (deadband == 0) || !has_last_position || (position->tower != last_position.tower);
+	if (!report)
+	{
+		uint64_t limit_cm = (uint64_t)deadband * 100;
+		report = deadband_distance_sq(last_position.lat, last_position.lon, position->lat, position->lon) > limit_cm * limit_cm;
+	}
+	if (!report && (suppressed_count >= g_blues_settings.keepalive))
+	{
+		MYLOG("DEAD", "Keep-alive after %d suppressed uplinks", suppressed_count);
+		dead_stats.keepalive++;
+		report = true;
+	}
+
+	if (!report)
+	{
+		suppressed_count++;
+		dead_stats.suppressed++;
+		dead_stats.bytes_saved += size;
+		MYLOG("DEAD", "Position within %dm, suppress uplink", deadband);
+		return false;
+	}
+	last_position = *position;
+	has_last_position = true;
+	suppressed_count = 0;
+	dead_stats.reported++;
+	return true;
+}
+
+/**
+ * @brief Get the counters of the deadband
+ *
+ * @return s_deadband_stats* counters
+ */
+s_deadband_stats *deadband_stats(void)
+{
+	return &dead_stats;
+}
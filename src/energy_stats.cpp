@@ -0,0 +1,287 @@
+/**
+ * @file energy_stats.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Time-in-state accounting of the energy use
+ * 		The time with GNSS on, in NoteHub sync sessions, LoRa TX and RX, NoteCard I2C transactions,
+ * 		BME680 conversions and with the LEDs on is counted since boot and over all boots.
+ * 		The totals are saved in the internal file system once per hour.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#ifdef NRF52_SERIES
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Filename of the saved totals */
+static const char energy_file_name[] = "ENRG";
+#endif
+
+/** Marker of valid saved totals */
+#define ENERGY_MAGIC 0xE5E5
+/** Totals are saved after this time */
+#define ENERGY_SAVE_INTERVAL 3600000
+
+/** Saved totals */
+struct s_energy_file
+{
+	uint16_t valid_mark;
+	uint16_t boots;
+	uint32_t uptime_s;
+	uint32_t total_s[ENERGY_NUM];
+};
+
+/** Names of the states */
+static const char *energy_names[ENERGY_NUM] = {"gnss", "sync", "lora_tx", "lora_rx", "i2c", "bme680", "led_blue", "led_green"};
+
+/** Totals of the previous boots */
+static s_energy_file energy_saved;
+
+/** Time in the states since boot, without the running periods */
+static uint32_t state_ms[ENERGY_NUM];
+
+/** Start of the running periods */
+static uint32_t state_start[ENERGY_NUM];
+
+/** Bit mask of the running states */
+static volatile uint16_t state_active = 0;
+
+/** Time-on-air of the LoRa uplink in the TX cycle */
+static uint32_t lora_airtime = 0;
+
+/** Time of the last save and the last diagnostic uplink */
+static uint32_t last_save_ms = 0;
+static uint32_t last_report_ms = 0;
+
+/** Counters with the running periods */
+static s_energy_stats energy_stats_data;
+
+/**
+ * @brief Load the totals of the previous boots and count this boot
+ *
+ */
+void energy_init(void)
+{
+	memset(&energy_saved, 0, sizeof(s_energy_file));
+#ifdef NRF52_SERIES
+	File energy_file(InternalFS);
+	if (energy_file.open(energy_file_name, FILE_O_READ))
+	{
+		if ((energy_file.read((void *)&energy_saved, sizeof(s_energy_file)) != sizeof(s_energy_file)) || (energy_saved.valid_mark != ENERGY_MAGIC))
+		{
+			MYLOG("ENRG", "Saved totals are invalid");
+			memset(&energy_saved, 0, sizeof(s_energy_file));
+		}
+		energy_file.close();
+	}
+#endif
+	energy_saved.boots++;
+	energy_save(true);
+	last_report_ms = millis();
+	MYLOG("ENRG", "Boot %d, %ld s running", energy_saved.boots, (long)energy_saved.uptime_s);
+}
+
+/**
+ * @brief Start a period in a state, ignored if the state is already running
+ *
+ * @param state ENERGY_xxx
+ */
+void energy_start(uint8_t state)
+{
+	if (!(state_active & (1 << state)))
+	{
+		state_start[state] = millis();
+		// The NoteCard worker counts ENERGY_I2C, the loop the other states
+		__atomic_fetch_or(&state_active, (uint16_t)(1 << state), __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * @brief End a period in a state, ignored if the state is not running
+ *
+ * @param state ENERGY_xxx
+ */
+void energy_stop(uint8_t state)
+{
+	if (state_active & (1 << state))
+	{
+		__atomic_fetch_and(&state_active, (uint16_t)~(1 << state), __ATOMIC_RELAXED);
+		state_ms[state] += millis() - state_start[state];
+	}
+}
+
+/**
+ * @brief Add a period that was measured or calculated elsewhere
+ *
+ * @param state ENERGY_xxx
+ * @param time_ms length of the period
+ */
+void energy_add(uint8_t state, uint32_t time_ms)
+{
+	state_ms[state] += time_ms;
+}
+
+/**
+ * @brief Remember the time-on-air of an uplink that starts a LoRa TX cycle
+ *
+ * @param size payload size
+ */
+void energy_lora_sent(uint8_t size)
+{
+	lora_airtime = link_airtime_ms(size);
+}
+
+/**
+ * @brief Count TX and RX of the finished LoRa TX cycle
+ * 		A confirmed uplink without ACK used all retries
+ *
+ * @param ack true if the uplink was ACK'ed or an unconfirmed uplink was sent
+ */
+void energy_lora_finished(bool ack)
+{
+	if (lora_airtime == 0)
+	{
+		return;
+	}
+	bool lorawan = g_lorawan_settings.lorawan_enable;
+	bool confirmed = lorawan && g_lorawan_settings.confirmed_msg_enabled;
+	uint32_t transmissions = (confirmed && !ack) ? LINK_LORA_RETRIES : 1;
+	state_ms[ENERGY_LORA_TX] += lora_airtime * transmissions;
+	if (lorawan)
+	{
+		state_ms[ENERGY_LORA_RX] += (confirmed && ack) ? (transmissions - 1) * link_rx_ms(false) + link_rx_ms(true) : transmissions * link_rx_ms(false);
+	}
+	lora_airtime = 0;
+}
+
+/**
+ * @brief Save the totals, without forced only once per hour to limit the flash wear
+ *
+ * @param forced true to save now
+ */
+void energy_save(bool forced)
+{
+	if (!forced && ((millis() - last_save_ms) < ENERGY_SAVE_INTERVAL))
+	{
+		return;
+	}
+	last_save_ms = millis();
+#ifdef NRF52_SERIES
+	s_energy_stats *stats = energy_stats();
+	s_energy_file totals;
+	totals.valid_mark = ENERGY_MAGIC;
+	totals.boots = stats->boots;
+	totals.uptime_s = stats->total_uptime_s;
+	memcpy(totals.total_s, stats->total_s, sizeof(totals.total_s));
+
+	if (InternalFS.exists(energy_file_name))
+	{
+		InternalFS.remove(energy_file_name);
+	}
+	File energy_file(InternalFS);
+	energy_file.open(energy_file_name, FILE_O_WRITE);
+	energy_file.write((const uint8_t *)&totals, sizeof(s_energy_file));
+	energy_file.close();
+	MYLOG("ENRG", "Totals saved");
+#endif
+}
+
+/**
+ * @brief Clear the counters of this boot and the saved totals
+ *
+ */
+void energy_clear(void)
+{
+	memset(&energy_saved, 0, sizeof(s_energy_file));
+	memset(state_ms, 0, sizeof(state_ms));
+	uint32_t now = millis();
+	for (uint8_t state = 0; state < ENERGY_NUM; state++)
+	{
+		state_start[state] = now;
+	}
+	// Uptime counts from now on
+	energy_saved.uptime_s = (uint32_t)-(now / 1000);
+	energy_saved.boots = 1;
+	energy_save(true);
+}
+
+/**
+ * @brief Queue a diagnostic uplink with the totals if the interval set with AT+BDIAG passed
+ * 		The record is sent with the next uplink over LoRaWAN or cellular from the uplink queue
+ *
+ */
+void energy_report(void)
+{
+	energy_save(false);
+	if ((g_blues_settings.diag_interval == 0) || ((millis() - last_report_ms) < (uint32_t)g_blues_settings.diag_interval * 3600000))
+	{
+		return;
+	}
+	last_report_ms = millis();
+
+	s_energy_stats *stats = energy_stats();
+	uint32_t values[ENERGY_NUM + 2];
+	values[0] = stats->boots;
+	values[1] = stats->total_uptime_s;
+	memcpy(&values[2], stats->total_s, sizeof(stats->total_s));
+	uint8_t record[PAYLOAD_MAX_SIZE];
+	uint8_t len = payload_encode_diag(values, ENERGY_NUM + 2, record, sizeof(record));
+	if ((len != 0) && uplink_queue_add(record, len, UPLINK_PRIO_PERIODIC))
+	{
+		MYLOG("ENRG", "Diagnostic uplink queued, %d bytes", len);
+	}
+}
+
+/**
+ * @brief Name of a state for the AT command
+ *
+ * @param state ENERGY_xxx
+ */
+const char *energy_state_name(uint8_t state)
+{
+	return state < ENERGY_NUM ? energy_names[state] : "";
+}
+
+/**
+ * @brief Get the time in the states, running periods are included
+ *
+ * @return s_energy_stats* counters
+ */
+s_energy_stats *energy_stats(void)
+{
+	uint32_t now = millis();
+	for (uint8_t state = 0; state < ENERGY_NUM; state++)
+	{
+		energy_stats_data.boot_ms[state] = state_ms[state] + ((state_active & (1 << state)) ? now - state_start[state] : 0);
+		energy_stats_data.total_s[state] = energy_saved.total_s[state] + energy_stats_data.boot_ms[state] / 1000;
+	}
+	energy_stats_data.uptime_s = now / 1000;
+	energy_stats_data.total_uptime_s = energy_saved.uptime_s + energy_stats_data.uptime_s;
+	energy_stats_data.boots = energy_saved.boots;
+	return &energy_stats_data;
+}
+
+/**
+ * @brief Switch an LED and count the time it is on
+ *
+ * @param pin LED_BLUE or LED_GREEN
+ * @param level HIGH or LOW
+ */
+void led_write(uint8_t pin, uint8_t level)
+{
+	digitalWrite(pin, level);
+	uint8_t state = pin == LED_BLUE ? ENERGY_LED_BLUE : ENERGY_LED_GREEN;
+	if (level == HIGH)
+	{
+		energy_start(state);
+	}
+	else
+	{
+		energy_stop(state);
+	}
+}
@@ -0,0 +1,166 @@
+/**
+ * @file gnss_window.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Length of the GNSS acquisition window learned from the time-to-fix of the last attempts
+ * 		After repeated attempts without a fix (indoors) GNSS is skipped for an exponentially
+ * 		growing number of send intervals, the tower location is used instead.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Longest GNSS window, used without history and after the first failed attempt */
+#define GNSS_WINDOW_MAX 120000
+/** Shortest GNSS window */
+#define GNSS_WINDOW_MIN 20000
+/** Time added to the longest time-to-fix of the history */
+#define GNSS_WINDOW_MARGIN 10000
+/** Number of fixes needed before the window is shortened */
+#define GNSS_MIN_FIXES 2
+/** Failed attempts in a row before GNSS attempts are skipped */
+#define GNSS_BACKOFF_AFTER 2
+/** Maximum backoff, 2^5 = 32 skipped send intervals */
+#define GNSS_BACKOFF_MAX 5
+
+/** Time-to-fix of the last attempts in ms, 0 = no fix */
+static uint32_t gnss_history[GNSS_HISTORY];
+
+/** Next entry in the history */
+static uint8_t gnss_history_idx = 0;
+
+/** Failed attempts in a row */
+static uint8_t gnss_fail_count = 0;
+
+/** Send intervals left to skip */
+static uint16_t gnss_skip_left = 0;
+
+/** Start of the running attempt, 0 = no attempt running */
+static uint32_t gnss_attempt_start = 0;
+
+/** Window length of the running attempt */
+static uint32_t gnss_attempt_window = 0;
+
+/** Counters of the GNSS attempts */
+static s_gnss_window_stats gnss_stats;
+
+/**
+ * @brief Calculate the window length from the history
+ *
+ * @return uint32_t window length in ms
+ */
+static uint32_t gnss_window_length(void)
+{
+	// After the first failure, try once more with the full window before backing off
+	if (gnss_fail_count == 1)
+	{
+		return GNSS_WINDOW_MAX;
+	}
+
+	uint8_t fixes = 0;
+	uint32_t longest = 0;
+	for (uint8_t idx = 0; idx < GNSS_HISTORY; idx++)
+	{
+		if (gnss_history[idx] != 0)
+		{
+			fixes++;
+			if (gnss_history[idx] > longest)
+			{
+				longest = gnss_history[idx];
+			}
+		}
+	}
+	if (fixes < GNSS_MIN_FIXES)
+	{
+		return GNSS_WINDOW_MAX;
+	}
+
+	uint32_t window = longest + longest / 4 + GNSS_WINDOW_MARGIN;
+	if (window < GNSS_WINDOW_MIN)
+	{
+		return GNSS_WINDOW_MIN;
+	}
+	if (window > GNSS_WINDOW_MAX)
+	{
+		return GNSS_WINDOW_MAX;
+	}
+	return window;
+}
+
+/**
+ * @brief Start a GNSS attempt
+ *
+ * @param forced true to start even during the backoff, used for motion events
+ * @return uint32_t length of the GNSS window in ms, 0 if GNSS should not be started
+ */
+uint32_t gnss_window_start(bool forced)
+{
+	if ((gnss_skip_left != 0) && !forced)
+	{
+		gnss_skip_left--;
+		gnss_stats.skipped++;
+		MYLOG("GNSS", "Backoff, skip GNSS, %d intervals left", gnss_skip_left);
+		return 0;
+	}
+	gnss_attempt_start = millis();
+	if (gnss_attempt_start == 0)
+	{
+		gnss_attempt_start = 1;
+	}
+	gnss_attempt_window = gnss_window_length();
+	gnss_stats.attempts++;
+	MYLOG("GNSS", "Window %ld ms", (long)gnss_attempt_window);
+	return gnss_attempt_window;
+}
+
+/**
+ * @brief Finish the running GNSS attempt and record the result
+ *
+ * @param fix true if the NoteCard reported a location fix during the window
+ */
+void gnss_window_finish(bool fix)
+{
+	if (gnss_attempt_start == 0)
+	{
+		return;
+	}
+	uint32_t on_time = millis() - gnss_attempt_start;
+	gnss_attempt_start = 0;
+	gnss_stats.on_time += on_time;
+
+	if (fix)
+	{
+		gnss_history[gnss_history_idx] = on_time == 0 ? 1 : on_time;
+		gnss_fail_count = 0;
+		gnss_skip_left = 0;
+		gnss_stats.fixes++;
+		MYLOG("GNSS", "Fix after %ld ms", (long)on_time);
+	}
+	else
+	{
+		gnss_history[gnss_history_idx] = 0;
+		if (gnss_fail_count < 0xFF)
+		{
+			gnss_fail_count++;
+		}
+		if (gnss_fail_count >= GNSS_BACKOFF_AFTER)
+		{
+			uint8_t exponent = gnss_fail_count - GNSS_BACKOFF_AFTER;
+			gnss_skip_left = 1 << (exponent > GNSS_BACKOFF_MAX ? GNSS_BACKOFF_MAX : exponent);
+		}
+		MYLOG("GNSS", "No fix in %ld ms, %d failures, skip %d intervals", (long)on_time, gnss_fail_count, gnss_skip_left);
+	}
+	gnss_history_idx = (gnss_history_idx + 1) % GNSS_HISTORY;
+}
+
+/**
+ * @brief Get the counters of the GNSS attempts
+ *
+ * @return s_gnss_window_stats* counters
+ */
+s_gnss_window_stats *gnss_window_stats(void)
+{
+	return &gnss_stats;
+}
@@ -0,0 +1,340 @@
+/**
+ * @file link_model.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Cost model to choose between LoRaWAN and cellular for an uplink.
+ * 		LoRaWAN is tracked with the ACK ratio, the SNR/RSSI of the ACKs, the time-on-air at the
+ * 		current datarate and the duty-cycle budget, cellular with the success ratio of note.add.
+ * 		The expected energy of "LoRaWAN first, cellular after a NAK" is compared with the
+ * 		energy of "cellular only". Unconfirmed uplinks are sent once without fallback, their
+ * 		ratio follows the SNR of the downlinks.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Ratios are Q8, 256 = 100% */
+#define LINK_Q8_ONE 256
+/** Weight of a new result in the ratios, 1/8 */
+#define LINK_EWMA_SHIFT 3
+/** Power while sending LoRa, SX1262 at +22 dBm, 118 mA at 3.3 V */
+#define LINK_LORA_TX_MW 390
+/** Energy of the RX windows after a transmission */
+#define LINK_LORA_RX_MJ 10
+/** Energy of a cellular session, LTE-M attach, sync and detach, ~12 s at ~1 W */
+#define LINK_CELL_SESSION_MJ 12000
+/** ACK ratio from which LoRaWAN is reliable and the cellular heartbeat is not needed, 90% */
+#define LINK_RELIABLE_Q8 230
+/** Every n-th uplink sent over cellular tries LoRaWAN to update the ACK ratio */
+#define LINK_PROBE_INTERVAL 8
+/** Duty-cycle budget, 1% of one hour in ms */
+#define LINK_DUTY_MAX_MS 36000
+
+/** Demodulation floor of SF7 to SF12 in 0.1 dB */
+static const int16_t snr_floor[6] = {-75, -100, -125, -150, -175, -200};
+
+/** State of the link model */
+static uint16_t lora_ack_q8 = 192;	  // ACK ratio of confirmed uplinks, start with 75%
+static uint16_t cell_ok_q8 = 230;	  // Success ratio of note.add, start with 90%
+static int16_t lora_snr_x10 = 0;	  // SNR of the ACKs or downlinks in 0.1 dB
+static int16_t lora_rssi = 0;		  // RSSI of the ACKs or downlinks in dBm
+static bool lora_has_snr = false;	  // SNR of an ACK or downlink was received
+static uint32_t lora_airtime_ms = 0;  // Time-on-air of the last uplink
+static uint32_t duty_budget_ms = LINK_DUTY_MAX_MS;
+static uint32_t duty_last_ms = 0;	  // Time of the last budget refill
+static uint8_t probe_count = 0;		  // Uplinks over cellular since the last probe
+
+/** Counters of the link model */
+static s_link_stats link_stats_data;
+
+/**
+ * @brief Spreading factor and bandwidth of the datarate of the current region
+ *
+ * @param datarate LoRaWAN datarate
+ * @param bw_khz returns the bandwidth in kHz
+ * @return uint8_t spreading factor, 0 for FSK
+ */
+static uint8_t link_sf(uint8_t datarate, uint16_t *bw_khz)
+{
+	*bw_khz = 125;
+	if (g_lorawan_settings.lora_region == 5)
+	{
+		// US915, DR0..DR3 are SF10..SF7, DR4 is SF8 at 500 kHz
+		if (datarate >= 4)
+		{
+			*bw_khz = 500;
+			return 8;
+		}
+		return 10 - datarate;
+	}
+	if (datarate <= 5)
+	{
+		return 12 - datarate;
+	}
+	if (datarate == 6)
+	{
+		*bw_khz = 250;
+		return 7;
+	}
+	return 0;
+}
+
+/**
+ * @brief Time-on-air of an uplink, explicit header, CRC, coding rate 4/5, 8 symbols preamble
+ *
+ * @param size application payload
+ * @return uint32_t time-on-air in ms
+ */
+uint32_t link_airtime_ms(uint8_t size)
+{
+	uint16_t bw_khz;
+	uint8_t sf = link_sf(g_lorawan_settings.data_rate, &bw_khz);
+	// LoRaWAN header, FPort and MIC
+	int32_t length = size + 13;
+	if (sf == 0)
+	{
+		// FSK 50 kbps, preamble, sync word, length and CRC
+		return ((length + 10) * 8) / 50 + 1;
+	}
+	uint32_t symbol_us = ((uint32_t)1 << sf) * 1000 / bw_khz;
+	uint8_t low_dr = ((sf >= 11) && (bw_khz == 125)) ? 1 : 0;
+	int32_t bits = 8 * length - 4 * sf + 28 + 16;
+	int32_t per_block = 4 * (sf - 2 * low_dr);
+	int32_t blocks = bits > 0 ? (bits + per_block - 1) / per_block : 0;
+	uint32_t symbols_x4 = 4 * (8 + blocks * 5) + 49;
+	return (symbols_x4 * symbol_us / 4 + 999) / 1000;
+}
+
+/**
+ * @brief Receiver on-time of the RX windows after one transmission
+ * 		Without downlink both windows are open for the preamble timeout of 8 symbols,
+ * 		with a downlink RX1 receives the frame of an empty ACK
+ *
+ * @param downlink true if a downlink was received
+ * @return uint32_t time in ms
+ */
+uint32_t link_rx_ms(bool downlink)
+{
+	if (downlink)
+	{
+		return link_airtime_ms(0);
+	}
+	uint16_t bw_khz;
+	uint8_t sf = link_sf(g_lorawan_settings.data_rate, &bw_khz);
+	if (sf == 0)
+	{
+		return 2;
+	}
+	return 2 * ((8 * ((uint32_t)1 << sf) * 1000 / bw_khz + 999) / 1000);
+}
+
+/**
+ * @brief Check if the region has a duty-cycle limit, EU433, RU864 and EU868
+ *
+ */
+static bool link_duty_limited(void)
+{
+	uint8_t region = g_lorawan_settings.lora_region;
+	return (region == 0) || (region == 2) || (region == 4);
+}
+
+/**
+ * @brief Chance from the SNR margin to the demodulation floor of the datarate
+ *
+ * @return uint16_t chance Q8, 100% if no SNR is known yet or the datarate is FSK
+ */
+static uint16_t link_snr_chance(void)
+{
+	uint16_t bw_khz;
+	uint8_t sf = link_sf(g_lorawan_settings.data_rate, &bw_khz);
+	if (!lora_has_snr || (sf < 7))
+	{
+		return LINK_Q8_ONE;
+	}
+	// 0% at 5 dB below the floor, 100% at 5 dB above the floor
+	int32_t margin = lora_snr_x10 - snr_floor[sf - 7] + 50;
+	return margin <= 0 ? 0 : (margin >= 100 ? LINK_Q8_ONE : margin * LINK_Q8_ONE / 100);
+}
+
+/**
+ * @brief Chance that a LoRaWAN uplink is ACK'ed
+ * 		The ACK ratio, lowered if the SNR of the ACKs is close to the demodulation floor of the datarate
+ *
+ * @return uint16_t chance Q8
+ */
+static uint16_t link_lora_chance(void)
+{
+	uint16_t chance = lora_ack_q8;
+	uint16_t snr_chance = link_snr_chance();
+	return snr_chance < chance ? snr_chance : chance;
+}
+
+/**
+ * @brief Choose the path of the next uplink
+ *
+ * @param size payload size
+ * @param priority priority of the uplink, UPLINK_PRIO_xxx
+ * @param cellular true if the NoteCard is available
+ * @return uint8_t LINK_LORA to send over LoRaWAN with cellular as fallback, LINK_CELLULAR to send only over cellular
+ */
+uint8_t link_choose(uint8_t size, uint8_t priority, bool cellular)
+{
+	// Refill the duty-cycle budget with 1% of the elapsed time
+	uint32_t now = millis();
+	duty_budget_ms += (now - duty_last_ms) / 100;
+	duty_last_ms = now;
+	if (duty_budget_ms > LINK_DUTY_MAX_MS)
+	{
+		duty_budget_ms = LINK_DUTY_MAX_MS;
+	}
+
+	bool confirmed = g_lorawan_settings.confirmed_msg_enabled;
+	lora_airtime_ms = link_airtime_ms(size);
+	uint16_t chance = link_lora_chance();
+	// Unconfirmed uplinks are sent once and a lost one is not sent again over cellular
+	uint32_t missed = confirmed ? LINK_Q8_ONE - chance : 0;
+
+	// Energy of one transmission, failed confirmed uplinks use all retries
+	uint32_t tx_mj = lora_airtime_ms * LINK_LORA_TX_MW / 1000 + LINK_LORA_RX_MJ;
+	uint32_t attempts_q8 = LINK_Q8_ONE + missed * (LINK_LORA_RETRIES - 1);
+	// Notes that are not synced immediately share the session
+	uint32_t cell_mj = LINK_CELL_SESSION_MJ;
+	if ((priority < g_blues_settings.sync_priority) && (g_blues_settings.sync_count > 1))
+	{
+		cell_mj = cell_mj / g_blues_settings.sync_count;
+	}
+	// Failed cellular uplinks are queued and sent again
+	cell_mj = cell_mj * LINK_Q8_ONE / (cell_ok_q8 > 16 ? cell_ok_q8 : 16);
+
+	link_stats_data.lora_mj = (tx_mj * attempts_q8 + cell_mj * missed) / LINK_Q8_ONE;
+	link_stats_data.cell_mj = cell_mj;
+
+	uint8_t path = LINK_LORA;
+	if (cellular)
+	{
+		uint32_t duty_needed = confirmed ? lora_airtime_ms * (LINK_LORA_RETRIES + 1) / 2 : lora_airtime_ms;
+		if (link_duty_limited() && (duty_budget_ms < duty_needed))
+		{
+			MYLOG("LINK", "Duty-cycle budget %lu ms, use cellular", (unsigned long)duty_budget_ms);
+			path = LINK_CELLULAR;
+		}
+		else if (link_stats_data.cell_mj < link_stats_data.lora_mj)
+		{
+			path = LINK_CELLULAR;
+		}
+	}
+
+	if (path == LINK_CELLULAR)
+	{
+		probe_count++;
+		if (probe_count >= LINK_PROBE_INTERVAL)
+		{
+			// Try LoRaWAN from time to time, the coverage might be back
+			probe_count = 0;
+			link_stats_data.probes++;
+			path = LINK_LORA;
+		}
+	}
+	MYLOG("LINK", "ACK %d%%, LoRaWAN %lu mJ, cellular %lu mJ, use %s", chance * 100 / LINK_Q8_ONE,
+		  (unsigned long)link_stats_data.lora_mj, (unsigned long)link_stats_data.cell_mj, path == LINK_LORA ? "LoRaWAN" : "cellular");
+	if (path == LINK_LORA)
+	{
+		link_stats_data.lora_chosen++;
+	}
+	else
+	{
+		link_stats_data.cell_chosen++;
+	}
+	return path;
+}
+
+/**
+ * @brief Add the SNR and RSSI of the last received frame to the averages
+ *
+ */
+static void link_lora_signal(void)
+{
+	int16_t snr_x10 = g_last_snr * 10;
+	if (!lora_has_snr)
+	{
+		lora_snr_x10 = snr_x10;
+		lora_rssi = g_last_rssi;
+		lora_has_snr = true;
+	}
+	lora_snr_x10 += (snr_x10 - lora_snr_x10) / 4;
+	lora_rssi += (g_last_rssi - lora_rssi) / 4;
+}
+
+/**
+ * @brief Record the result of a LoRaWAN uplink, called on TX_FIN
+ * 		An unconfirmed uplink has no ACK, only its time-on-air is counted
+ *
+ * @param ack true if the uplink was ACK'ed
+ */
+void link_lora_result(bool ack)
+{
+	if (!g_lorawan_settings.confirmed_msg_enabled)
+	{
+		duty_budget_ms = duty_budget_ms > lora_airtime_ms ? duty_budget_ms - lora_airtime_ms : 0;
+		return;
+	}
+	lora_ack_q8 = lora_ack_q8 - (lora_ack_q8 >> LINK_EWMA_SHIFT) + ((ack ? LINK_Q8_ONE : 0) >> LINK_EWMA_SHIFT);
+	uint32_t used = lora_airtime_ms * (ack ? 1 : LINK_LORA_RETRIES);
+	duty_budget_ms = duty_budget_ms > used ? duty_budget_ms - used : 0;
+	if (ack)
+	{
+		link_lora_signal();
+	}
+}
+
+/**
+ * @brief Record a downlink
+ * 		Without confirmed uplinks there are no ACKs, the ratio follows the SNR margin of the downlinks
+ *
+ */
+void link_lora_downlink(void)
+{
+	if (g_lorawan_settings.confirmed_msg_enabled)
+	{
+		// The ACK of the uplink brings the SNR
+		return;
+	}
+	link_lora_signal();
+	lora_ack_q8 = lora_ack_q8 - (lora_ack_q8 >> LINK_EWMA_SHIFT) + (link_snr_chance() >> LINK_EWMA_SHIFT);
+}
+
+/**
+ * @brief Record the result of a cellular uplink
+ *
+ * @param success true if the note was added
+ */
+void link_cell_result(bool success)
+{
+	cell_ok_q8 = cell_ok_q8 - (cell_ok_q8 >> LINK_EWMA_SHIFT) + ((success ? LINK_Q8_ONE : 0) >> LINK_EWMA_SHIFT);
+}
+
+/**
+ * @brief Check if LoRaWAN is reliable enough that no cellular heartbeat is needed
+ *
+ */
+bool link_lora_reliable(void)
+{
+	return link_lora_chance() >= LINK_RELIABLE_Q8;
+}
+
+/**
+ * @brief Get the state and the counters of the link model
+ *
+ * @return s_link_stats* counters, the ratios are updated with the call
+ */
+s_link_stats *link_stats(void)
+{
+	link_stats_data.lora_ack = lora_ack_q8 * 100 / LINK_Q8_ONE;
+	link_stats_data.cell_ok = cell_ok_q8 * 100 / LINK_Q8_ONE;
+	link_stats_data.snr_x10 = lora_snr_x10;
+	link_stats_data.rssi = lora_rssi;
+	link_stats_data.duty_budget_ms = duty_budget_ms;
+	return &link_stats_data;
+}
@@ -0,0 +1,420 @@
+/**
+ * @file log_ring.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Deferred debug log, lock-free ring of binary log records
+ * 		Writers from tasks, timer callbacks and interrupts reserve their record with a
+ * 		compare-and-swap on the head and mark it complete by writing the first word last.
+ * 		The only reader is the drain task, it formats the records and sends them to Serial
+ * 		and BLE, or sends them as hex for native/log_decode.py.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#define LOG_RING_MASK (LOG_RING_WORDS - 1)
+/** Time between two drains of the ring */
+#define LOG_DRAIN_PERIOD 20
+/** Longest text of a log line */
+#define LOG_TEXT_MAX 256
+
+/** Ring of the log records */
+static uint32_t log_ring[LOG_RING_WORDS];
+
+/** Next word to reserve, only increases */
+static uint32_t log_head = 0;
+
+/** Next word to read, only increases */
+static uint32_t log_tail = 0;
+
+/** Output mode, LOG_MODE_xxx */
+static uint8_t log_mode = LOG_MODE_TEXT;
+
+/** Counters of the ring */
+static s_log_stats log_stats;
+
+/**
+ * @brief Reserve the words of a record
+ *
+ * @param words size of the record
+ * @param writer returns the position of the record
+ * @return true if the record fits into the ring
+ * @return false if the ring is full, the record is dropped
+ */
+bool log_ring_reserve(uint16_t words, s_log_writer *writer)
+{
+	uint32_t head = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+	uint32_t used;
+	do
+	{
+		used = head + words - __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE);
+		if ((words > LOG_RECORD_MAX) || (used > LOG_RING_WORDS))
+		{
+			__atomic_fetch_add(&log_stats.dropped, 1, __ATOMIC_RELAXED);
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&log_head, &head, head + words, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	if (used > log_stats.max_used)
+	{
+		log_stats.max_used = used;
+	}
+	writer->start = head;
+	writer->pos = head + LOG_HEADER_WORDS;
+	writer->end = head + words;
+	writer->types = 0;
+	writer->count = 0;
+	return true;
+}
+
+/**
+ * @brief Store a word of the record, words beyond the reserved size are ignored
+ *
+ */
+void log_put_word(s_log_writer *writer, uint32_t value)
+{
+	if (writer->pos < writer->end)
+	{
+		log_ring[writer->pos++ & LOG_RING_MASK] = value;
+	}
+}
+
+/**
+ * @brief Store a float or double argument
+ *
+ */
+void log_put_double(s_log_writer *writer, double value)
+{
+	uint32_t words[2];
+	memcpy(words, &value, sizeof(words));
+	writer->types |= LOG_ARG_DOUBLE << (2 * writer->count++);
+	log_put_word(writer, words[0]);
+	log_put_word(writer, words[1]);
+}
+
+/**
+ * @brief Size of a string argument in words, with the terminating 0
+ *
+ */
+uint16_t log_str_words(const char *value)
+{
+	uint16_t len = 0;
+	if (value != NULL)
+	{
+		while ((len < LOG_STR_MAX) && (value[len] != 0))
+		{
+			len++;
+		}
+	}
+	return (len + 4) / 4;
+}
+
+/**
+ * @brief Store a string argument, cut at the end of the reserved words if it changed since the reservation
+ *
+ */
+void log_put_str(s_log_writer *writer, const char *value)
+{
+	writer->types |= LOG_ARG_STR << (2 * writer->count++);
+	uint16_t len = 0;
+	bool end = (value == NULL);
+	while (!end && (writer->pos < writer->end))
+	{
+		uint32_t word = 0;
+		for (uint8_t byte = 0; byte < 4; byte++)
+		{
+			char c = end ? 0 : value[len];
+			if ((c == 0) || (len == LOG_STR_MAX) || ((byte == 3) && (writer->pos + 1 == writer->end)))
+			{
+				c = 0;
+				end = true;
+			}
+			else
+			{
+				len++;
+			}
+			word |= (uint32_t)(uint8_t)c << (8 * byte);
+		}
+		log_put_word(writer, word);
+	}
+	if (value == NULL)
+	{
+		log_put_word(writer, 0);
+	}
+}
+
+/**
+ * @brief Complete the record, the first word is written last
+ *
+ */
+void log_ring_commit(s_log_writer *writer, const char *tag, const char *format)
+{
+	// Fill words that were not used, e.g. by a string that got shorter
+	while (writer->pos < writer->end)
+	{
+		log_put_word(writer, 0);
+	}
+	uint32_t words = writer->end - writer->start;
+	uintptr_t pointers[2] = {(uintptr_t)tag, (uintptr_t)format};
+	uint32_t header[LOG_HEADER_WORDS];
+	header[0] = ((uint32_t)LOG_COMMIT << 24) | ((uint32_t)writer->count << 16) | words;
+	header[1] = writer->types;
+	header[2] = millis();
+	memcpy(&header[3], pointers, sizeof(pointers));
+	for (uint8_t idx = 1; idx < LOG_HEADER_WORDS; idx++)
+	{
+		log_ring[(writer->start + idx) & LOG_RING_MASK] = header[idx];
+	}
+	__atomic_store_n(&log_ring[writer->start & LOG_RING_MASK], header[0], __ATOMIC_RELEASE);
+	__atomic_fetch_add(&log_stats.records, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Take the oldest complete record out of the ring, only called by the drain
+ *
+ * @param record buffer for the record
+ * @param max_words size of the buffer
+ * @return uint16_t size of the record in words, 0 if there is no complete record
+ */
+uint16_t log_ring_read(uint32_t *record, uint16_t max_words)
+{
+	uint32_t tail = log_tail;
+	uint32_t header = __atomic_load_n(&log_ring[tail & LOG_RING_MASK], __ATOMIC_ACQUIRE);
+	if ((header >> 24) != LOG_COMMIT)
+	{
+		return 0;
+	}
+	uint16_t words = header & 0xFFFF;
+	for (uint16_t idx = 0; idx < words; idx++)
+	{
+		if (idx < max_words)
+		{
+			record[idx] = log_ring[(tail + idx) & LOG_RING_MASK];
+		}
+		log_ring[(tail + idx) & LOG_RING_MASK] = 0;
+	}
+	__atomic_store_n(&log_tail, tail + words, __ATOMIC_RELEASE);
+	return words <= max_words ? words : 0;
+}
+
+/**
+ * @brief Format one argument with the conversion of the format
+ *
+ * @param spec conversion without length modifier, e.g. "%-5d"
+ * @param conversion conversion character
+ * @param type LOG_ARG_xxx
+ * @param arg first word of the argument
+ * @param text output
+ * @param len size of the output
+ * @return int number of characters
+ */
+static int log_format_arg(char *spec, char conversion, uint8_t type, const uint32_t *arg, char *text, uint16_t len)
+{
+	uint8_t spec_len = strlen(spec);
+	double value_double;
+	memcpy(&value_double, arg, sizeof(double));
+
+	if ((type == LOG_ARG_STR) || (conversion == 's'))
+	{
+		spec[spec_len] = 's';
+		spec[spec_len + 1] = 0;
+		return snprintf(text, len, spec, type == LOG_ARG_STR ? (const char *)arg : "?");
+	}
+	if (strchr("fFeEgGaA", conversion) != NULL)
+	{
+		spec[spec_len] = conversion;
+		spec[spec_len + 1] = 0;
+		return snprintf(text, len, spec, type == LOG_ARG_DOUBLE ? value_double : (double)(int32_t)arg[0]);
+	}
+	if (conversion == 'c')
+	{
+		spec[spec_len] = 'c';
+		spec[spec_len + 1] = 0;
+		return snprintf(text, len, spec, (int)arg[0]);
+	}
+	// Integers are formatted as long
+	spec[spec_len] = 'l';
+	spec[spec_len + 1] = conversion;
+	spec[spec_len + 2] = 0;
+	if ((conversion == 'd') || (conversion == 'i'))
+	{
+		return snprintf(text, len, spec, type == LOG_ARG_DOUBLE ? (long)value_double : (long)(int32_t)arg[0]);
+	}
+	return snprintf(text, len, spec, type == LOG_ARG_DOUBLE ? (unsigned long)value_double : (unsigned long)arg[0]);
+}
+
+/**
+ * @brief Build the text of a record, the same as printf with the format and the arguments
+ *
+ * @param record record from log_ring_read()
+ * @param text buffer for the text
+ * @param len size of the buffer
+ * @param tag returns the tag
+ * @return uint16_t length of the text
+ */
+uint16_t log_format(const uint32_t *record, char *text, uint16_t len, const char **tag)
+{
+	uintptr_t pointers[2];
+	memcpy(pointers, &record[3], sizeof(pointers));
+	*tag = (const char *)pointers[0];
+	const char *format = (const char *)pointers[1];
+	uint8_t count = (record[0] >> 16) & 0xFF;
+	uint16_t words = record[0] & 0xFFFF;
+	uint32_t types = record[1];
+	uint16_t arg_pos = LOG_HEADER_WORDS;
+	uint8_t arg = 0;
+	uint16_t out = 0;
+
+	for (const char *p = format; (*p != 0) && (out < len - 1); p++)
+	{
+		if ((*p != '%') || (p[1] == 0))
+		{
+			text[out++] = *p;
+			continue;
+		}
+		if (p[1] == '%')
+		{
+			text[out++] = '%';
+			p++;
+			continue;
+		}
+		// Flags, width and precision are kept, the length modifier is replaced
+		char spec[24];
+		uint8_t spec_len = 0;
+		spec[spec_len++] = *p++;
+		while ((*p != 0) && (strchr("-+ #0123456789.", *p) != NULL) && (spec_len < sizeof(spec) - 4))
+		{
+			spec[spec_len++] = *p++;
+		}
+		spec[spec_len] = 0;
+		while ((*p != 0) && (strchr("hlzjtL", *p) != NULL))
+		{
+			p++;
+		}
+		if (*p == 0)
+		{
+			break;
+		}
+		if ((arg >= count) || (arg_pos >= words))
+		{
+			// Argument is missing, show the conversion
+			text[out++] = '?';
+			continue;
+		}
+		uint8_t type = (types >> (2 * arg)) & 3;
+		int written = log_format_arg(spec, *p, type, &record[arg_pos], &text[out], len - out);
+		if (written > 0)
+		{
+			out = (out + written < len - 1) ? out + written : len - 1;
+		}
+		arg++;
+		if (type == LOG_ARG_DOUBLE)
+		{
+			arg_pos += 2;
+		}
+		else if (type == LOG_ARG_STR)
+		{
+			arg_pos += log_str_words((const char *)&record[arg_pos]);
+		}
+		else
+		{
+			arg_pos++;
+		}
+	}
+	text[out] = 0;
+	return out;
+}
+
+#ifdef NRF52_SERIES
+/**
+ * @brief Drain the ring whenever no other task runs
+ *
+ */
+static void log_drain_task(void *arg)
+{
+	(void)arg;
+	while (true)
+	{
+		log_ring_drain();
+		vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD));
+	}
+}
+#endif
+
+/**
+ * @brief Start the task that drains the ring, it runs with the priority of the idle task
+ *
+ */
+void log_ring_init(void)
+{
+#ifdef NRF52_SERIES
+	xTaskCreate(log_drain_task, "LOG", 512, NULL, tskIDLE_PRIORITY, NULL);
+#endif
+}
+
+/**
+ * @brief Send all complete records to Serial and BLE
+ * 		As text, or in binary mode as "LOG:" with the hex words of the record for native/log_decode.py
+ *
+ */
+void log_ring_drain(void)
+{
+	// Static, the drain task has only 512 words of stack and is the only caller
+	static uint32_t record[LOG_RECORD_MAX];
+	static char text[LOG_TEXT_MAX];
+	const char *tag;
+	uint16_t words;
+	while ((words = log_ring_read(record, LOG_RECORD_MAX)) != 0)
+	{
+		if (log_mode == LOG_MODE_BINARY)
+		{
+			Serial.print("LOG:");
+			for (uint16_t idx = 0; idx < words; idx++)
+			{
+				Serial.printf("%08lX", (unsigned long)record[idx]);
+			}
+			Serial.println();
+			continue;
+		}
+		log_format(record, text, sizeof(text), &tag);
+		PRINTF("[%s] %s\n", tag, text);
+#ifdef NRF52_SERIES
+		if (g_ble_uart_is_connected)
+		{
+			g_ble_uart.printf("%s\n", text);
+		}
+#endif
+	}
+}
+
+/**
+ * @brief Select text or binary output
+ *
+ * @param mode LOG_MODE_xxx
+ */
+void log_ring_set_mode(uint8_t mode)
+{
+	log_mode = mode;
+}
+
+/**
+ * @brief Get the output mode
+ *
+ * @return uint8_t LOG_MODE_xxx
+ */
+uint8_t log_ring_get_mode(void)
+{
+	return log_mode;
+}
+
+/**
+ * @brief Get the counters of the ring
+ *
+ * @return s_log_stats* counters
+ */
+s_log_stats *log_ring_stats(void)
+{
+	return &log_stats;
+}
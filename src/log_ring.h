@@ -0,0 +1,141 @@
+/**
+ * @file log_ring.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Deferred debug log, MYLOG stores tag, format and raw arguments in a ring buffer
+ * 		The text is built later from the idle task, so logging does not block the caller.
+ * 		Record: [0xA5 | count | words] [types] [time ms] [tag] [format] [arguments]
+ * 		Integer arguments use 1 word, float and double 2 words, strings are copied with
+ * 		their terminating 0, padded to full words and cut after LOG_STR_MAX characters.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LOG_RING_H_
+#define _LOG_RING_H_
+
+#include <Arduino.h>
+
+/** Size of the ring in 32 bit words, must be a power of 2 */
+#define LOG_RING_WORDS 1024
+/** Largest record in words, larger records are dropped */
+#define LOG_RECORD_MAX 96
+/** Longest string argument, longer strings are cut */
+#define LOG_STR_MAX 64
+/** Marker of a complete record in the first word */
+#define LOG_COMMIT 0xA5
+/** Words of a pointer, tag and format are stored as pointers */
+#define LOG_PTR_WORDS (sizeof(void *) / 4)
+/** Words in front of the arguments */
+#define LOG_HEADER_WORDS (3 + 2 * LOG_PTR_WORDS)
+
+/** Types of the arguments, 2 bits per argument in the types word */
+#define LOG_ARG_INT 0
+#define LOG_ARG_DOUBLE 1
+#define LOG_ARG_STR 2
+
+/** Log output modes */
+#define LOG_MODE_TEXT 0
+#define LOG_MODE_BINARY 1
+
+/** Position and argument types while a record is written */
+struct s_log_writer
+{
+	uint32_t start;
+	uint32_t pos;
+	uint32_t end;
+	uint32_t types;
+	uint8_t count;
+};
+
+/** Counters of the log ring */
+struct s_log_stats
+{
+	uint32_t records;  // Records written
+	uint32_t dropped;  // Records dropped because the ring was full
+	uint32_t max_used; // Most words used in the ring
+};
+
+bool log_ring_reserve(uint16_t words, s_log_writer *writer);
+void log_ring_commit(s_log_writer *writer, const char *tag, const char *format);
+void log_put_word(s_log_writer *writer, uint32_t value);
+void log_put_double(s_log_writer *writer, double value);
+void log_put_str(s_log_writer *writer, const char *value);
+uint16_t log_str_words(const char *value);
+uint16_t log_ring_read(uint32_t *record, uint16_t max_words);
+uint16_t log_format(const uint32_t *record, char *text, uint16_t len, const char **tag);
+void log_ring_init(void);
+void log_ring_drain(void);
+void log_ring_set_mode(uint8_t mode);
+uint8_t log_ring_get_mode(void);
+s_log_stats *log_ring_stats(void);
+
+/** Size of an argument in words, integers, char, bool and enums */
+template <typename T>
+inline uint16_t log_arg_size(T value)
+{
+	(void)value;
+	return 1;
+}
+inline uint16_t log_arg_size(float value)
+{
+	(void)value;
+	return 2;
+}
+inline uint16_t log_arg_size(double value)
+{
+	(void)value;
+	return 2;
+}
+inline uint16_t log_arg_size(const char *value) { return log_str_words(value); }
+inline uint16_t log_arg_size(char *value) { return log_str_words(value); }
+
+/** Store an argument, integers, char, bool and enums */
+template <typename T>
+inline void log_put_arg(s_log_writer *writer, T value)
+{
+	writer->types |= LOG_ARG_INT << (2 * writer->count++);
+	log_put_word(writer, (uint32_t)value);
+}
+inline void log_put_arg(s_log_writer *writer, float value) { log_put_double(writer, value); }
+inline void log_put_arg(s_log_writer *writer, double value) { log_put_double(writer, value); }
+inline void log_put_arg(s_log_writer *writer, const char *value) { log_put_str(writer, value); }
+inline void log_put_arg(s_log_writer *writer, char *value) { log_put_str(writer, value); }
+
+inline uint16_t log_args_size(void) { return 0; }
+template <typename T, typename... Args>
+inline uint16_t log_args_size(T value, Args... args)
+{
+	return log_arg_size(value) + log_args_size(args...);
+}
+
+inline void log_put_args(s_log_writer *writer) { (void)writer; }
+template <typename T, typename... Args>
+inline void log_put_args(s_log_writer *writer, T value, Args... args)
+{
+	log_put_arg(writer, value);
+	log_put_args(writer, args...);
+}
+
+/**
+ * @brief Store a log line in the ring, the text is built when the ring is drained
+ * 		Does not wait, if the ring is full the line is dropped
+ *
+ * @param tag tag of the line, must be a string literal
+ * @param format printf format, must be a string literal
+ * @param args up to 16 arguments
+ */
+template <typename... Args>
+inline void log_ring_printf(const char *tag, const char *format, Args... args)
+{
+	static_assert(sizeof...(Args) <= 16, "Too many arguments for MYLOG");
+	s_log_writer writer;
+	if (log_ring_reserve(LOG_HEADER_WORDS + log_args_size(args...), &writer))
+	{
+		log_put_args(&writer, args...);
+		log_ring_commit(&writer, tag, format);
+	}
+}
+
+#endif // _LOG_RING_H_
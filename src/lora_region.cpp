@@ -0,0 +1,302 @@
+/**
+ * @file lora_region.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Selection of the LoRaWAN region from the country of the cell tower
+ * 		The country table is built by the compiler into a direct indexed table,
+ * 		two letters of the country code give the position, no search at runtime.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** LoRaWAN regions as numbered in g_lorawan_settings.lora_region */
+#define REGION_EU433 0
+#define REGION_CN470 1
+#define REGION_RU864 2
+#define REGION_IN865 3
+#define REGION_EU868 4
+#define REGION_US915 5
+#define REGION_AU915 6
+#define REGION_KR920 7
+#define REGION_AS923_1 8
+#define REGION_AS923_2 9
+#define REGION_AS923_3 10
+#define REGION_AS923_4 11
+/** Country without a known region, fits into 4 bits */
+#define REGION_UNKNOWN 0x0F
+
+/** Index of a country code in the lookup table */
+#define COUNTRY_INDEX(code) (((code)[0] - 'A') * 26 + ((code)[1] - 'A'))
+#define COUNTRY_NUM (26 * 26)
+
+/** Country and the LoRaWAN region used there */
+struct s_country_region
+{
+	uint16_t index;
+	uint8_t region;
+};
+
+/** Source of the lookup table, if a country allows several plans the common one is used */
+static constexpr s_country_region country_regions[] = {
+	// Europe, Middle East and Africa
+	{COUNTRY_INDEX("AD"), REGION_EU868}, {COUNTRY_INDEX("AE"), REGION_EU868}, {COUNTRY_INDEX("AL"), REGION_EU868}, {COUNTRY_INDEX("AM"), REGION_EU868},
+	{COUNTRY_INDEX("AO"), REGION_EU868}, {COUNTRY_INDEX("AT"), REGION_EU868}, {COUNTRY_INDEX("AZ"), REGION_EU868}, {COUNTRY_INDEX("BA"), REGION_EU868},
+	{COUNTRY_INDEX("BE"), REGION_EU868}, {COUNTRY_INDEX("BG"), REGION_EU868}, {COUNTRY_INDEX("BH"), REGION_EU868}, {COUNTRY_INDEX("BW"), REGION_EU868},
+	{COUNTRY_INDEX("BY"), REGION_EU868}, {COUNTRY_INDEX("CH"), REGION_EU868}, {COUNTRY_INDEX("CI"), REGION_EU868}, {COUNTRY_INDEX("CM"), REGION_EU868},
+	{COUNTRY_INDEX("CY"), REGION_EU868}, {COUNTRY_INDEX("CZ"), REGION_EU868}, {COUNTRY_INDEX("DE"), REGION_EU868}, {COUNTRY_INDEX("DJ"), REGION_EU868},
+	{COUNTRY_INDEX("DK"), REGION_EU868}, {COUNTRY_INDEX("DZ"), REGION_EU868}, {COUNTRY_INDEX("EE"), REGION_EU868}, {COUNTRY_INDEX("EG"), REGION_EU868},
+	{COUNTRY_INDEX("ES"), REGION_EU868}, {COUNTRY_INDEX("ET"), REGION_EU868}, {COUNTRY_INDEX("FI"), REGION_EU868}, {COUNTRY_INDEX("FO"), REGION_EU868},
+	{COUNTRY_INDEX("FR"), REGION_EU868}, {COUNTRY_INDEX("GB"), REGION_EU868}, {COUNTRY_INDEX("GE"), REGION_EU868}, {COUNTRY_INDEX("GF"), REGION_EU868},
+	{COUNTRY_INDEX("GH"), REGION_EU868}, {COUNTRY_INDEX("GI"), REGION_EU868}, {COUNTRY_INDEX("GL"), REGION_EU868}, {COUNTRY_INDEX("GP"), REGION_EU868},
+	{COUNTRY_INDEX("GR"), REGION_EU868}, {COUNTRY_INDEX("HR"), REGION_EU868}, {COUNTRY_INDEX("HU"), REGION_EU868}, {COUNTRY_INDEX("IE"), REGION_EU868},
+	{COUNTRY_INDEX("IQ"), REGION_EU868}, {COUNTRY_INDEX("IR"), REGION_EU868}, {COUNTRY_INDEX("IS"), REGION_EU868}, {COUNTRY_INDEX("IT"), REGION_EU868},
+	{COUNTRY_INDEX("JO"), REGION_EU868}, {COUNTRY_INDEX("KE"), REGION_EU868}, {COUNTRY_INDEX("KW"), REGION_EU868}, {COUNTRY_INDEX("KZ"), REGION_EU868},
+	{COUNTRY_INDEX("LB"), REGION_EU868}, {COUNTRY_INDEX("LI"), REGION_EU868}, {COUNTRY_INDEX("LS"), REGION_EU868}, {COUNTRY_INDEX("LT"), REGION_EU868},
+	{COUNTRY_INDEX("LU"), REGION_EU868}, {COUNTRY_INDEX("LV"), REGION_EU868}, {COUNTRY_INDEX("LY"), REGION_EU868}, {COUNTRY_INDEX("MA"), REGION_EU868},
+	{COUNTRY_INDEX("MC"), REGION_EU868}, {COUNTRY_INDEX("MD"), REGION_EU868}, {COUNTRY_INDEX("ME"), REGION_EU868}, {COUNTRY_INDEX("MG"), REGION_EU868},
+	{COUNTRY_INDEX("MK"), REGION_EU868}, {COUNTRY_INDEX("MQ"), REGION_EU868}, {COUNTRY_INDEX("MT"), REGION_EU868}, {COUNTRY_INDEX("MU"), REGION_EU868},
+	{COUNTRY_INDEX("MW"), REGION_EU868}, {COUNTRY_INDEX("MZ"), REGION_EU868}, {COUNTRY_INDEX("NA"), REGION_EU868}, {COUNTRY_INDEX("NG"), REGION_EU868},
+	{COUNTRY_INDEX("NL"), REGION_EU868}, {COUNTRY_INDEX("NO"), REGION_EU868}, {COUNTRY_INDEX("OM"), REGION_EU868}, {COUNTRY_INDEX("PL"), REGION_EU868},
+	{COUNTRY_INDEX("PT"), REGION_EU868}, {COUNTRY_INDEX("QA"), REGION_EU868}, {COUNTRY_INDEX("RE"), REGION_EU868}, {COUNTRY_INDEX("RO"), REGION_EU868},
+	{COUNTRY_INDEX("RS"), REGION_EU868}, {COUNTRY_INDEX("RW"), REGION_EU868}, {COUNTRY_INDEX("SA"), REGION_EU868}, {COUNTRY_INDEX("SC"), REGION_EU868},
+	{COUNTRY_INDEX("SE"), REGION_EU868}, {COUNTRY_INDEX("SI"), REGION_EU868}, {COUNTRY_INDEX("SK"), REGION_EU868}, {COUNTRY_INDEX("SM"), REGION_EU868},
+	{COUNTRY_INDEX("SN"), REGION_EU868}, {COUNTRY_INDEX("TN"), REGION_EU868}, {COUNTRY_INDEX("TR"), REGION_EU868}, {COUNTRY_INDEX("TZ"), REGION_EU868},
+	{COUNTRY_INDEX("UA"), REGION_EU868}, {COUNTRY_INDEX("UG"), REGION_EU868}, {COUNTRY_INDEX("UZ"), REGION_EU868}, {COUNTRY_INDEX("VA"), REGION_EU868},
+	{COUNTRY_INDEX("YT"), REGION_EU868}, {COUNTRY_INDEX("ZA"), REGION_EU868}, {COUNTRY_INDEX("ZM"), REGION_EU868}, {COUNTRY_INDEX("ZW"), REGION_EU868},
+	{COUNTRY_INDEX("IL"), REGION_AS923_4},
+	{COUNTRY_INDEX("RU"), REGION_RU864},
+	// North America
+	{COUNTRY_INDEX("AS"), REGION_US915}, {COUNTRY_INDEX("CA"), REGION_US915}, {COUNTRY_INDEX("GU"), REGION_US915}, {COUNTRY_INDEX("MP"), REGION_US915},
+	{COUNTRY_INDEX("MX"), REGION_US915}, {COUNTRY_INDEX("PR"), REGION_US915}, {COUNTRY_INDEX("UM"), REGION_US915}, {COUNTRY_INDEX("US"), REGION_US915},
+	{COUNTRY_INDEX("VI"), REGION_US915},
+	{COUNTRY_INDEX("CU"), REGION_AS923_3},
+	// Central and South America, Oceania
+	{COUNTRY_INDEX("AR"), REGION_AU915}, {COUNTRY_INDEX("AU"), REGION_AU915}, {COUNTRY_INDEX("BO"), REGION_AU915}, {COUNTRY_INDEX("BR"), REGION_AU915},
+	{COUNTRY_INDEX("CL"), REGION_AU915}, {COUNTRY_INDEX("CO"), REGION_AU915}, {COUNTRY_INDEX("CR"), REGION_AU915}, {COUNTRY_INDEX("DO"), REGION_AU915},
+	{COUNTRY_INDEX("EC"), REGION_AU915}, {COUNTRY_INDEX("GT"), REGION_AU915}, {COUNTRY_INDEX("HN"), REGION_AU915}, {COUNTRY_INDEX("NI"), REGION_AU915},
+	{COUNTRY_INDEX("NZ"), REGION_AU915}, {COUNTRY_INDEX("PA"), REGION_AU915}, {COUNTRY_INDEX("PE"), REGION_AU915}, {COUNTRY_INDEX("PY"), REGION_AU915},
+	{COUNTRY_INDEX("SV"), REGION_AU915}, {COUNTRY_INDEX("UY"), REGION_AU915}, {COUNTRY_INDEX("VE"), REGION_AU915},
+	// Asia
+	{COUNTRY_INDEX("CN"), REGION_CN470},
+	{COUNTRY_INDEX("IN"), REGION_IN865},
+	{COUNTRY_INDEX("KR"), REGION_KR920},
+	{COUNTRY_INDEX("BD"), REGION_AS923_1}, {COUNTRY_INDEX("BN"), REGION_AS923_1}, {COUNTRY_INDEX("FJ"), REGION_AS923_1}, {COUNTRY_INDEX("HK"), REGION_AS923_1},
+	{COUNTRY_INDEX("JP"), REGION_AS923_1}, {COUNTRY_INDEX("KH"), REGION_AS923_1}, {COUNTRY_INDEX("LA"), REGION_AS923_1}, {COUNTRY_INDEX("LK"), REGION_AS923_1},
+	{COUNTRY_INDEX("MM"), REGION_AS923_1}, {COUNTRY_INDEX("MN"), REGION_AS923_1}, {COUNTRY_INDEX("MO"), REGION_AS923_1}, {COUNTRY_INDEX("MY"), REGION_AS923_1},
+	{COUNTRY_INDEX("PG"), REGION_AS923_1}, {COUNTRY_INDEX("PK"), REGION_AS923_1}, {COUNTRY_INDEX("SG"), REGION_AS923_1}, {COUNTRY_INDEX("TH"), REGION_AS923_1},
+	{COUNTRY_INDEX("TW"), REGION_AS923_1},
+	{COUNTRY_INDEX("ID"), REGION_AS923_2}, {COUNTRY_INDEX("VN"), REGION_AS923_2},
+	{COUNTRY_INDEX("PH"), REGION_AS923_3},
+};
+
+#define COUNTRY_REGION_NUM (sizeof(country_regions) / sizeof(s_country_region))
+
+/**
+ * @brief Region of a country index, evaluated by the compiler
+ *
+ */
+static constexpr uint8_t region_of(uint16_t index, size_t entry = 0)
+{
+	return entry == COUNTRY_REGION_NUM ? REGION_UNKNOWN
+									   : (country_regions[entry].index == index ? country_regions[entry].region : region_of(index, entry + 1));
+}
+
+/**
+ * @brief Two regions packed into one byte, lower nibble for the even index
+ *
+ */
+static constexpr uint8_t region_pair(uint16_t pair)
+{
+	return (uint8_t)(region_of(pair * 2) | (region_of(pair * 2 + 1) << 4));
+}
+
+/** List of indices 0..N-1 to expand the table, C++11 has no std::index_sequence */
+template <uint16_t... I>
+struct s_index_list
+{
+};
+template <uint16_t N, uint16_t... I>
+struct s_make_index : s_make_index<N - 1, N - 1, I...>
+{
+};
+template <uint16_t... I>
+struct s_make_index<0, I...>
+{
+	typedef s_index_list<I...> type;
+};
+
+/** Lookup table, one nibble per possible country code, 338 bytes in flash */
+template <typename T>
+struct s_region_table;
+template <uint16_t... I>
+struct s_region_table<s_index_list<I...>>
+{
+	static constexpr uint8_t packed[sizeof...(I)] = {region_pair(I)...};
+};
+template <uint16_t... I>
+constexpr uint8_t s_region_table<s_index_list<I...>>::packed[sizeof...(I)];
+
+typedef s_region_table<s_make_index<COUNTRY_NUM / 2>::type> region_table;
+
+static_assert(region_of(COUNTRY_INDEX("DE")) == REGION_EU868, "Region table broken");
+static_assert(region_of(COUNTRY_INDEX("PH")) == REGION_AS923_3, "Region table broken");
+static_assert(region_of(COUNTRY_INDEX("ZZ")) == REGION_UNKNOWN, "Region table broken");
+
+/**
+ * @brief Get the LoRaWAN region of a country
+ *
+ * @param country ISO 3166 alpha-2 country code
+ * @return uint8_t region or REGION_UNKNOWN
+ */
+uint8_t region_for_country(const char *country)
+{
+	if ((country[0] < 'A') || (country[0] > 'Z') || (country[1] < 'A') || (country[1] > 'Z'))
+	{
+		return REGION_UNKNOWN;
+	}
+	uint16_t index = COUNTRY_INDEX(country);
+	return (region_table::packed[index / 2] >> ((index & 1) * 4)) & 0x0F;
+}
+
+/** Tower reports of the new region needed before the region is switched */
+#define REGION_CONFIRM_COUNT 3
+/** Minimum time between two region switches, 6 hours */
+#define REGION_MIN_DWELL (6 * 60 * 60 * 1000UL)
+/** Distance in 1e-7 degrees a GNSS fix must move before the tower country is checked again, ~5km */
+#define REGION_CHECK_DISTANCE 450000
+
+/** State of the region selection */
+struct s_region_state
+{
+	bool checked;		  // Tower country was checked at least once
+	int32_t check_lat;	  // Position of the last check in 1e-7 degrees
+	int32_t check_lon;	  // Position of the last check in 1e-7 degrees
+	uint8_t candidate;	  // Region reported by the tower that differs from the used region
+	uint8_t confirmed;	  // Number of reports of the candidate region in a row
+	bool switched;		  // Region was switched at least once
+	uint32_t switch_time; // Time of the last switch
+};
+
+static s_region_state region_state = {false, 0, 0, REGION_UNKNOWN, 0, false, 0};
+
+/**
+ * @brief Check if the tower country should be requested
+ * 		Needed if the device moved far enough to be in another cell
+ * 		or if a new region waits for confirmation
+ *
+ * @param lat latitude of the GNSS fix in 1e-7 degrees
+ * @param lon longitude of the GNSS fix in 1e-7 degrees
+ * @return true if the country should be checked
+ */
+bool region_check_needed(int32_t lat, int32_t lon)
+{
+	if (!region_state.checked || (region_state.candidate != REGION_UNKNOWN))
+	{
+		return true;
+	}
+	// Box instead of distance, longitude degrees get shorter towards the poles, so it only checks earlier
+	return (abs(lat - region_state.check_lat) > REGION_CHECK_DISTANCE) || (abs(lon - region_state.check_lon) > REGION_CHECK_DISTANCE);
+}
+
+/**
+ * @brief Update the LoRaWAN region from the country of the cell tower
+ * 		The region is switched after the new region was reported REGION_CONFIRM_COUNT
+ * 		times in a row and not earlier than REGION_MIN_DWELL after the last switch,
+ * 		a device at a border does not switch back and forth.
+ * 		The LoRaWAN stack is initialized again with the REGION_SWITCH event, not inside the
+ * 		location handling. Until the join in the new region no uplink uses the old band.
+ *
+ * @param country ISO 3166 alpha-2 country code of the tower
+ * @param lat latitude of the device in 1e-7 degrees
+ * @param lon longitude of the device in 1e-7 degrees
+ * @return true if the region was switched
+ */
+bool region_update(const char *country, int32_t lat, int32_t lon)
+{
+	region_state.checked = true;
+	region_state.check_lat = lat;
+	region_state.check_lon = lon;
+
+	uint8_t region = region_for_country(country);
+	if ((region == REGION_UNKNOWN) || (region == g_lorawan_settings.lora_region))
+	{
+		region_state.candidate = REGION_UNKNOWN;
+		region_state.confirmed = 0;
+		return false;
+	}
+
+	if (region != region_state.candidate)
+	{
+		region_state.candidate = region;
+		region_state.confirmed = 0;
+	}
+	region_state.confirmed++;
+	MYLOG("REG", "Found %c%c, region %d reported %d times", country[0], country[1], region, region_state.confirmed);
+	if ((region_state.confirmed < REGION_CONFIRM_COUNT) ||
+		(region_state.switched && ((millis() - region_state.switch_time) < REGION_MIN_DWELL)))
+	{
+		return false;
+	}
+
+	MYLOG("REG", "Switch to band %d", region);
+	g_lorawan_settings.lora_region = region;
+	region_state.candidate = REGION_UNKNOWN;
+	region_state.confirmed = 0;
+	region_state.switched = true;
+	region_state.switch_time = millis();
+	g_lpwan_has_joined = false;
+	app_event_post(REGION_SWITCH);
+	return true;
+}
+
+/** Maximum application payload per region and DR0..DR7, without repeater, 0 if the DR is not used for uplinks */
+static const uint8_t region_payload[12][8] = {
+	{51, 51, 51, 115, 222, 222, 222, 222}, // EU433
+	{51, 51, 51, 115, 222, 222, 0, 0},	   // CN470
+	{51, 51, 51, 115, 222, 222, 222, 222}, // RU864
+	{51, 51, 51, 115, 222, 222, 0, 222},   // IN865
+	{51, 51, 51, 115, 222, 222, 222, 222}, // EU868
+	{11, 53, 125, 242, 242, 0, 0, 0},	   // US915
+	{51, 51, 51, 115, 242, 242, 242, 0},   // AU915
+	{51, 51, 51, 115, 222, 222, 0, 0},	   // KR920
+	{51, 51, 51, 115, 222, 222, 222, 222}, // AS923-1, without dwell time limit
+	{51, 51, 51, 115, 222, 222, 222, 222}, // AS923-2
+	{51, 51, 51, 115, 222, 222, 222, 222}, // AS923-3
+	{51, 51, 51, 115, 222, 222, 222, 222}, // AS923-4
+};
+
+/**
+ * @brief Get the maximum payload of an uplink with the current region and datarate
+ * 		With ADR the network can lower the datarate, the payload of DR0 is used
+ *
+ * @return uint8_t maximum payload in bytes
+ */
+uint8_t region_max_payload(void)
+{
+	uint8_t region = g_lorawan_settings.lora_region;
+	uint8_t datarate = g_lorawan_settings.adr_enabled ? 0 : g_lorawan_settings.data_rate;
+	if ((region >= 12) || (datarate >= 8) || (region_payload[region][datarate] == 0))
+	{
+		// Unknown region or datarate, smallest payload of all regions
+		return 11;
+	}
+	return region_payload[region][datarate];
+}
+
+/**
+ * @brief Get the maximum payload of the next uplink
+ * 		Cellular and LoRa P2P take the largest payload
+ *
+ * @return uint8_t maximum payload in bytes
+ */
+uint8_t uplink_max_payload(void)
+{
+	if (g_lorawan_settings.lorawan_enable && g_lpwan_has_joined)
+	{
+		return region_max_payload();
+	}
+	return PAYLOAD_MAX_SIZE;
+}
@@ -12,7 +12,7 @@
 #include "main.h"
 
 /** LoRaWAN packet */
-WisCayenne g_solution_data(255);
+TrackerPayload g_solution_data(255);
 
 /** Received package for parsing */
 uint8_t rcvd_data[256];
@@ -31,6 +31,12 @@ bool has_rak1906 = false;
 /** Flag is Blues Notecard was found */
 bool has_blues = false;
 
+/** Flag if the NoteCard detection job is queued or running */
+static bool blues_detecting = false;
+
+/** Flag if the missing NoteCard was reported */
+static bool blues_missing = false;
+
 #ifdef NRF52_SERIES
 SoftwareTimer delayed_sending;
 void delayed_cellular(TimerHandle_t unused);
@@ -65,6 +71,55 @@ bool gnss_active = false;
 
 uint8_t send_counter = 0;
 
+/** Flag if the GNSS was started by a motion event */
+bool motion_triggered = false;
+
+/** Flag if the NoteCard reported a location fix during the GNSS window */
+bool gnss_fix_received = false;
+
+/** Flag if GNSS was skipped in this send interval because of the backoff */
+bool gnss_skipped = false;
+
+/** Priority of the current packet in the uplink queue */
+uint8_t packet_priority = UPLINK_PRIO_PERIODIC;
+
+/** Flag if the current packet was ACK'ed over LoRaWAN */
+bool packet_delivered = false;
+
+/** Flag if a queued packet is in the LoRaWAN TX cycle */
+bool lora_queue_pending = false;
+
+/** Sequence number of the queued packet in the LoRaWAN TX cycle */
+uint16_t lora_queue_seq = 0;
+
+/** Flag if a queued packet is sent by the NoteCard worker */
+bool cell_queue_pending = false;
+
+/** Sequence number of the queued packet sent by the NoteCard worker */
+uint16_t cell_queue_seq = 0;
+
+/** Queued packets sent over cellular since the last cellular uplink */
+uint8_t cell_queue_sent = 0;
+
+/** Flags of the NoteCard jobs */
+#define JOB_MOVING 0x01	  // Device was moving at the end of the GNSS window
+#define JOB_USE_GNSS 0x02 // GNSS was switched on in the GNSS window
+#define JOB_MOTION 0x04	  // GNSS window was started by a motion event
+#define JOB_BME 0x08	  // BME680 conversion runs during the GNSS window
+
+void send_queued_lora(void);
+void send_queued_cellular(void);
+void start_gnss(bool forced);
+static void blues_detect(void);
+static bool job_init_blues(s_blues_job *job);
+static void blues_ready(s_blues_job *job);
+static bool job_read_location(s_blues_job *job);
+static bool job_send_cellular(s_blues_job *job);
+static bool job_attn_reason(s_blues_job *job);
+static void location_read(s_blues_job *job);
+static void cellular_sent(s_blues_job *job);
+static void attn_checked(s_blues_job *job);
+
 /**
  * @brief Initial setup of the application (before LoRaWAN and BLE setup)
  *
@@ -74,32 +129,46 @@ void setup_app(void)
 #ifdef _CUSTOM_BOARD_
 	// Initialize the built in LED
 	pinMode(LED_GREEN, OUTPUT);
-	digitalWrite(LED_GREEN, LOW);
+	led_write(LED_GREEN, LOW);
 
 	// Initialize the connection status LED
 	pinMode(LED_BLUE, OUTPUT);
-	digitalWrite(LED_BLUE, HIGH);
+	led_write(LED_BLUE, HIGH);
 #endif
 	Serial.begin(115200);
+	boot_phase_start(BOOT_SERIAL);
 	time_t serial_timeout = millis();
-	// On nRF52840 the USB serial is not available immediately
-	while (!Serial)
+	// On nRF52840 the USB serial is not available immediately, without USB host there is nothing to wait for
+	while (!Serial && boot_usb_present())
 	{
 		if ((millis() - serial_timeout) < 5000)
 		{
 			delay(100);
-			digitalWrite(LED_GREEN, !digitalRead(LED_GREEN));
+			led_write(LED_GREEN, !digitalRead(LED_GREEN));
 		}
 		else
 		{
 			break;
 		}
 	}
-	digitalWrite(LED_GREEN, LOW);
+	led_write(LED_GREEN, LOW);
+	boot_phase_end(BOOT_SERIAL);
+
+#if MY_DEBUG > 0
+	// Debug output is sent from the log ring when the application is idle
+	log_ring_init();
+#endif
 
 	// Set firmware version
 	api_set_version(SW_VERSION_1, SW_VERSION_2, SW_VERSION_3);
 	g_enable_ble = true;
+
+	// The WisBlock API starts LoRaWAN and BLE next
+	boot_phase_start(BOOT_API);
+	if (g_lorawan_settings.auto_join)
+	{
+		boot_phase_start(BOOT_JOIN);
+	}
 }
 
 /**
@@ -110,6 +179,8 @@ void setup_app(void)
  */
 bool init_app(void)
 {
+	boot_phase_end(BOOT_API);
+	boot_phase_start(BOOT_APP);
 	MYLOG("APP", "init_app");
 
 	Serial.println("++++++++++++++++++++++++++++++++++++++++++++++++++++++++++");
@@ -118,25 +189,33 @@ bool init_app(void)
 	Serial.println("++++++++++++++++++++++++++++++++++++++++++++++++++++++++++");
 
 	// Initialize User AT commands
+	boot_phase_start(BOOT_SETTINGS);
 	init_user_at();
 
+	// Load uplinks that could not be sent before the reset
+	uplink_queue_init();
+
+	// Load the energy counters of the previous boots
+	energy_init();
+	boot_phase_end(BOOT_SETTINGS);
+
 	// Check if RAK1906 is available
+	boot_phase_start(BOOT_RAK1906);
 	has_rak1906 = init_rak1906();
 	if (has_rak1906)
 	{
 		AT_PRINTF("+EVT:RAK1906");
+		// Sample the environment between the uplinks
+		rak1906_schedule();
 	}
+	boot_phase_end(BOOT_RAK1906);
 
-	// Initialize Blues Notecard
-	has_blues = init_blues();
-	if (!has_blues)
-	{
-		AT_PRINTF("+EVT:CELLULAR_ERROR");
-	}
-	else
-	{
-		AT_PRINTF("+EVT:RAK13102");
-	}
+	// NoteCard requests run in the worker task, the NoteCard is configured while LoRaWAN starts
+	blues_worker_init();
+	blues_detect();
+
+	// Select the uplink payload format
+	g_solution_data.setFormat(g_blues_settings.payload_format);
 
 	pinMode(WB_IO2, OUTPUT);
 	digitalWrite(WB_IO2, LOW);
@@ -148,7 +227,7 @@ bool init_app(void)
 	// Initialize delayed sending timer
 	delayed_sending.begin(15000, delayed_cellular, NULL, false);
 
-	// Set GNSS scan time to 2 minutes
+	// Set GNSS scan time to 2 minutes, shortened by gnss_window_start() from the time-to-fix history
 	wait_gnss.begin(120000, waited_location, NULL, false);
 #endif
 #ifdef ESP32
@@ -162,7 +241,10 @@ bool init_app(void)
 		if (g_lorawan_settings.lorawan_enable)
 		{
 			API_LOG("API", "Auto join is enabled, start LoRaWAN and join");
+			boot_phase_start(BOOT_LORAWAN);
+			boot_phase_start(BOOT_JOIN);
 			init_lorawan();
+			boot_phase_end(BOOT_LORAWAN);
 		}
 	}
 
@@ -175,7 +257,7 @@ bool init_app(void)
 	// Don't wait for join to start the application timer
 	MYLOG("APP", "api_timer_start");
 	api_timer_start();
-	api_wake_loop(STATUS);
+	app_event_post(STATUS);
 
 	// Initialize LED toggle timer
 #ifdef NRF52_SERIES
@@ -186,6 +268,7 @@ bool init_app(void)
 // no init for ESP32 ticker
 #endif
 
+	boot_phase_end(BOOT_APP);
 	return true;
 }
 
@@ -199,12 +282,16 @@ bool init_app(void)
 void app_event_handler(void)
 {
 	// Timer triggered event
-	if ((g_task_event_type & STATUS) == STATUS)
+	if (app_event_take(STATUS))
 	{
-		g_task_event_type &= N_STATUS;
-
 		MYLOG("APP", "Timer wakeup, start GNSS");
 
+		// A NoteCard that did not answer at boot is checked again with each send interval
+		if (!has_blues && !blues_detecting)
+		{
+			blues_detect();
+		}
+
 		if (gnss_active)
 		{
 			MYLOG("APP", "GNSS already active");
@@ -212,263 +299,97 @@ void app_event_handler(void)
 		else
 		{
 			MYLOG("APP", "GNSS inactive, start it");
-			gnss_active = true;
-
-			// Enable GNSS
-			blues_switch_gnss_mode(true);
-
-			// Enable Location event
-			if (!blues_enable_attn(false))
-			{
-				MYLOG("APP", "Rearm location trigger failed");
-			}
-
-			api_timer_stop();
-
-			wait_gnss.start();
-
-			digitalWrite(LED_BLUE, HIGH);
-			blink_blue.start();
+			start_gnss(false);
 		}
 	}
 
 	// GNSS finished event
-	if ((g_task_event_type & GNSS_FINISH) == GNSS_FINISH)
+	if (app_event_take(GNSS_FINISH))
 	{
-		g_task_event_type &= N_GNSS_FINISH;
-
 		blink_blue.stop();
-		digitalWrite(LED_BLUE, LOW);
+		led_write(LED_BLUE, LOW);
 
 		MYLOG("APP", "GNSS wait finished");
 		gnss_active = false;
-		api_timer_start();
-
-		// Reset the packet
-		g_solution_data.reset();
-
-		if (!blues_get_location())
-		{
-			MYLOG("APP", "Failed to get location");
-			// blink_green.stop();
-		}
-		else
-		{
-			// blink_green.setPeriod(500);
-			// blink_green.start();
-		}
-
-		// Disable GNSS
-		blues_switch_gnss_mode(false);
-
-		// Enable motion trigger
-		if (!blues_enable_attn(true))
-		{
-			MYLOG("APP", "Rearm location trigger failed");
-		}
-
-		// Get battery level
-		float batt_level_f = read_batt();
-		g_solution_data.addVoltage(LPP_CHANNEL_BATT, batt_level_f / 1000.0);
-
-		// Read sensors and battery
-		if (has_rak1906)
-		{
-			read_rak1906();
-		}
-
-		bool check_rejoin = false;
-
-		if (g_lpwan_has_joined)
-		{
-			/*************************************************************************************/
-			/*                                                                                   */
-			/* If the device is setup for LoRaWAN, try first to send the data as confirmed       */
-			/* packet. If the sending fails, retry over cellular modem                           */
-			/*                                                                                   */
-			/* If the device is setup for LoRa P2P, send always as P2P packet AND over the       */
-			/* cellular modem                                                           */
-			/*                                                                                   */
-			/*************************************************************************************/
-			if (g_lorawan_settings.lorawan_enable)
-			{
-				lmh_error_status result = send_lora_packet(g_solution_data.getBuffer(), g_solution_data.getSize());
-				switch (result)
-				{
-				case LMH_SUCCESS:
-					MYLOG("APP", "Packet enqueued");
-
-					// Periodically send a packet over cellular as well
-					// Resets automatically if LoRaWAN packet got no ACK
-					if (send_counter >= 20)
-					{
-						MYLOG("APP", "Start cellular heartbeat sending");
-						// Send over cellular connection
-						delayed_sending.start();
-					}
-					break;
-				case LMH_BUSY:
-					re_init_lorawan();
-					result = send_lora_packet(g_solution_data.getBuffer(), g_solution_data.getSize());
-					if (result != LMH_SUCCESS)
-					{
-						// Send over cellular connection
-						delayed_sending.start();
-						check_rejoin = true;
-						send_fail++;
-						MYLOG("APP", "LoRa transceiver is busy");
-						AT_PRINTF("+EVT:BUSY\n");
-					}
-					break;
-				case LMH_ERROR:
-					re_init_lorawan();
-					result = send_lora_packet(g_solution_data.getBuffer(), g_solution_data.getSize());
-					if (result != LMH_SUCCESS)
-					{
-						// Send over cellular connection
-						delayed_sending.start();
-						check_rejoin = true;
-						send_fail++;
-						AT_PRINTF("+EVT:SIZE_ERROR\n");
-						MYLOG("APP", "Packet error, too big to send with current DR");
-					}
-					break;
-				}
-			}
-			else
-			{
-				// Add unique identifier in front of the P2P packet, here we use the DevEUI
-				g_solution_data.addDevID(LPP_CHANNEL_DEVID, &g_lorawan_settings.node_device_eui[4]);
-
-				// Send packet over LoRa
-				// if (send_p2p_packet(packet_buffer, g_solution_data.getSize() + 8))
-				if (send_p2p_packet(g_solution_data.getBuffer(), g_solution_data.getSize()))
-				{
-					MYLOG("APP", "Packet enqueued");
-				}
-				else
-				{
-					AT_PRINTF("+EVT:SIZE_ERROR\n");
-					MYLOG("APP", "Packet too big");
-				}
-
-				// Send as well over cellular connection
-				delayed_sending.start();
-			}
-		}
-		else
-		{
-			// delayed_sending.start();
-			g_task_event_type |= USE_CELLULAR;
-			if (g_lorawan_settings.lorawan_enable)
-			{
-				check_rejoin = true;
-				send_fail++;
-			}
-			MYLOG("APP", "Network not joined, skip sending over LoRaWAN");
-		}
-
-		if (check_rejoin)
-		{
-			// Check how many times we send over LoRaWAN failed and retry to join LNS after 10 times failing
-			if (send_fail >= 10)
-			{
-				// Too many failed sendings, try to rejoin
-				MYLOG("APP", "Retry to join LNS");
-				send_fail = 0;
-				// int8_t init_result = re_init_lorawan();
-				g_lpwan_has_joined = false;
-				lmh_join();
-			}
-		}
+		energy_stop(ENERGY_GNSS);
+
+		// Record the time-to-fix for the next window
+		gnss_window_finish(gnss_fix_received);
+		gnss_fix_received = false;
+
+		// Flags of this window, a motion event can start the next window before the location is read
+		s_blues_job job = {};
+		job.run = job_read_location;
+		job.done = location_read;
+		job.flags = (motion_state_get() == MOTION_MOVING ? JOB_MOVING : 0) | (gnss_skipped ? 0 : JOB_USE_GNSS) | (motion_triggered ? JOB_MOTION : 0) |
+					(has_rak1906 ? JOB_BME : 0);
+		motion_triggered = false;
+		gnss_skipped = false;
+		blues_worker_submit(&job);
 	}
 
 	// Send over Blues event
-	if ((g_task_event_type & USE_CELLULAR) == USE_CELLULAR)
+	if (app_event_take(USE_CELLULAR))
 	{
 		send_counter = 0;
-		g_task_event_type &= N_USE_CELLULAR;
 
 		if (has_blues)
 		{
-			// Send over cellular connection
-			MYLOG("APP", "Get hub sync status:");
-			blues_hub_status();
-
+			// Send over cellular connection, the worker sends a copy of the packet
+			s_blues_job job = {};
+			job.run = job_send_cellular;
+			job.done = cellular_sent;
+			job.priority = packet_priority;
+			job.size = g_solution_data.getSize();
 			g_solution_data.addDevID(0, &g_lorawan_settings.node_device_eui[4]);
-			blues_send_payload(g_solution_data.getBuffer(), g_solution_data.getSize());
-
-			// Request sync with NoteHub
-			rak_blues.start_req((char *)"hub.sync");
-			rak_blues.send_req();
-
-			if (!g_lpwan_has_joined)
-			{
-				send_fail++;
-				MYLOG("APP", "Cellular count w/o Join %d", send_fail);
-			}
-			// Check how many times we send over cellular data and retry to join LNS after 10 times failing
-			if ((send_fail >= 10) && g_lorawan_settings.lorawan_enable)
-			{
-				// Try to rejoin
-				MYLOG("APP", "Retry to join LNS");
-				send_fail = 0;
-				// int8_t init_result = re_init_lorawan();
-				g_lpwan_has_joined = false;
-				lmh_join();
-			}
+			job.len = g_solution_data.getSize();
+			memcpy(job.packet, g_solution_data.getBuffer(), job.len);
+			blues_worker_submit(&job);
 		}
 		else
 		{
 			MYLOG("APP", "Skip USE_CELLULAR, no NoteCard available");
+			// Keep the packet until LoRaWAN is back
+			if (!packet_delivered && g_lorawan_settings.lorawan_enable)
+			{
+				uplink_queue_add(g_solution_data.getBuffer(), g_solution_data.getSize(), packet_priority);
+			}
 		}
 	}
 	// Blues ATTN event
-	if ((g_task_event_type & BLUES_ATTN) == BLUES_ATTN)
+	if (app_event_take(BLUES_ATTN))
 	{
-		g_task_event_type &= N_BLUES_ATTN;
-
 		MYLOG("APP", "ATTN triggered");
 
-		uint8_t attn_reason = blues_attn_reason();
-
-		switch (attn_reason)
-		{
-			// Motion detected
-		case 1:
-			if (gnss_active)
-			{
-				MYLOG("APP", "GNSS already active");
-			}
-			else
-			{
-				MYLOG("APP", "GNSS inactive, start it");
-				gnss_active = true;
-
-				// Enable GNSS
-				blues_switch_gnss_mode(true);
+		s_blues_job job = {};
+		job.run = job_attn_reason;
+		job.done = attn_checked;
+		blues_worker_submit(&job);
+	}
 
-				// Enable Location event
-				if (!blues_enable_attn(false))
-				{
-					MYLOG("APP", "Rearm location trigger failed");
-				}
+	// NoteCard worker finished jobs
+	if (app_event_take(BLUES_DONE))
+	{
+		blues_worker_complete();
+	}
 
-				api_timer_stop();
+	// No more setting changes, write them to flash
+	if (app_event_take(SETTINGS_SAVE))
+	{
+		settings_flush();
+	}
 
-				wait_gnss.start();
+	// Environment sample between the uplinks
+	if (app_event_take(ENV_SAMPLE))
+	{
+		rak1906_sample();
+	}
 
-				digitalWrite(LED_BLUE, HIGH);
-				blink_blue.start();
-			}
-			break;
-			// Location fix (We ignore if motion and location found are reported together)
-		case 2:
-		case 3:
-			wait_gnss.stop();
-			g_task_event_type |= GNSS_FINISH;
-			break;
-		}
+	// Region of the cell tower changed, start the LoRaWAN stack in the new region
+	if (app_event_take(REGION_SWITCH))
+	{
+		MYLOG("APP", "Initialize LoRaWAN for region %d", g_lorawan_settings.lora_region);
+		init_lorawan(true);
 	}
 }
 
@@ -480,12 +401,10 @@ void ble_data_handler(void)
 {
 	if (g_enable_ble)
 	{
-		if ((g_task_event_type & BLE_DATA) == BLE_DATA)
+		if (app_event_take(BLE_DATA))
 		{
 			MYLOG("AT", "RECEIVED BLE");
 			// BLE UART data arrived
-			g_task_event_type &= N_BLE_DATA;
-
 			while (g_ble_uart.available() > 0)
 			{
 				at_serial_input(uint8_t(g_ble_uart.read()));
@@ -503,14 +422,17 @@ void ble_data_handler(void)
 void lora_data_handler(void)
 {
 	// LoRa Join finished handling
-	if ((g_task_event_type & LORA_JOIN_FIN) == LORA_JOIN_FIN)
+	if (app_event_take(LORA_JOIN_FIN))
 	{
-		g_task_event_type &= N_LORA_JOIN_FIN;
 		if (g_join_result)
 		{
 			MYLOG("APP", "Successfully joined network");
 			AT_PRINTF("+EVT:JOINED");
+			boot_phase_end(BOOT_JOIN);
 			send_fail = 0;
+
+			// LoRaWAN is back, send queued packets
+			send_queued_lora();
 		}
 		else
 		{
@@ -520,9 +442,8 @@ void lora_data_handler(void)
 	}
 
 	// LoRa data handling
-	if ((g_task_event_type & LORA_DATA) == LORA_DATA)
+	if (app_event_take(LORA_DATA))
 	{
-		g_task_event_type &= N_LORA_DATA;
 		MYLOG("APP", "Received package over LoRa");
 		char log_buff[g_rx_data_len * 3] = {0};
 		uint8_t log_idx = 0;
@@ -532,13 +453,12 @@ void lora_data_handler(void)
 			log_idx += 3;
 		}
 		MYLOG("APP", "%s", log_buff);
+		link_lora_downlink();
 	}
 
 	// LoRa TX finished handling
-	if ((g_task_event_type & LORA_TX_FIN) == LORA_TX_FIN)
+	if (app_event_take(LORA_TX_FIN))
 	{
-		g_task_event_type &= N_LORA_TX_FIN;
-
 		MYLOG("APP", "LPWAN TX cycle %s", g_rx_fin_result ? "finished ACK" : "failed NAK");
 		if (g_lorawan_settings.confirmed_msg_enabled)
 		{
@@ -548,11 +468,22 @@ void lora_data_handler(void)
 		{
 			AT_PRINTF("+EVT:TX_FINISHED");
 		}
+		if (g_lorawan_settings.lorawan_enable)
+		{
+			link_lora_result(g_rx_fin_result);
+		}
+		energy_lora_finished(g_rx_fin_result);
 		if (!g_rx_fin_result)
 		{
-			if (g_lorawan_settings.lorawan_enable)
+			if (lora_queue_pending)
+			{
+				// Queued packet stays in the queue
+				lora_queue_pending = false;
+			}
+			else if (g_lorawan_settings.lorawan_enable)
 			{
-				delayed_sending.start();
+				// TX cycle is finished, send over cellular without delay
+				app_event_post(USE_CELLULAR);
 			}
 
 			// Increase fail send counter
@@ -563,8 +494,578 @@ void lora_data_handler(void)
 		{
 			send_fail = 0;
 			send_counter++;
+			boot_phase_end(BOOT_UPLINK);
+
+			if (lora_queue_pending)
+			{
+				uplink_queue_remove(lora_queue_seq);
+				lora_queue_pending = false;
+			}
+			else
+			{
+				packet_delivered = true;
+			}
+
+			// LoRaWAN link is working, send the next queued packet
+			send_queued_lora();
+		}
+	}
+}
+
+/**
+ * @brief Queue the detection and configuration of the NoteCard
+ *
+ */
+static void blues_detect(void)
+{
+	blues_detecting = true;
+	s_blues_job job = {};
+	job.run = job_init_blues;
+	job.done = blues_ready;
+	blues_worker_submit(&job);
+}
+
+/**
+ * @brief NoteCard job, check and configure the NoteCard after the boot
+ *
+ * @param job unused
+ * @return true if the NoteCard is available
+ */
+static bool job_init_blues(s_blues_job *job)
+{
+	(void)job;
+	boot_phase_start(BOOT_BLUES);
+	bool result = init_blues();
+	boot_phase_end(BOOT_BLUES);
+	return result;
+}
+
+/**
+ * @brief Completion of job_init_blues()
+ *
+ * @param job result of the NoteCard configuration
+ */
+static void blues_ready(s_blues_job *job)
+{
+	blues_detecting = false;
+	has_blues = job->result;
+	if (has_blues)
+	{
+		AT_PRINTF("+EVT:RAK13102");
+	}
+	else if (!blues_missing)
+	{
+		// Reported once, the detection is repeated with the next send interval
+		blues_missing = true;
+		AT_PRINTF("+EVT:CELLULAR_ERROR");
+	}
+}
+
+/**
+ * @brief NoteCard job, read the motion count and the location at the end of the GNSS window
+ *
+ * @param job flags of the window, returns the motion count in value and the location
+ * @return true if the NoteCard reported a location
+ */
+static bool job_read_location(s_blues_job *job)
+{
+	// The BME680 conversion was started with the GNSS window and is finished
+	if (job->flags & JOB_BME)
+	{
+		rak1906_collect();
+	}
+
+	// While moving the NoteCard counts the motion events, otherwise the ATTN reports motion
+	job->value = (job->flags & JOB_MOVING) ? blues_motion_count() : 0;
+	return blues_read_location(job->flags & JOB_USE_GNSS, &job->location);
+}
+
+/**
+ * @brief NoteCard job, switch GNSS off, sync the waiting notes and rearm the motion trigger
+ *
+ * @param job flags of the window
+ * @return true if the motion trigger is armed
+ */
+static bool job_window_end(s_blues_job *job)
+{
+	// Disable GNSS
+	if (job->flags & JOB_USE_GNSS)
+	{
+		blues_switch_gnss_mode(false);
+	}
+
+	// Sync notes that wait too long, while GNSS is off
+	blues_sync_session();
+	blues_sync_check();
+
+	// Enable motion trigger
+	if (!blues_enable_attn(true))
+	{
+		MYLOG("APP", "Rearm location trigger failed");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Completion of job_read_location(), build and send the packet of the GNSS window
+ *
+ * @param job motion count and location
+ */
+static void location_read(s_blues_job *job)
+{
+	motion_state_update(job->value);
+	api_timer_restart(motion_state_interval());
+
+	// Reset the packet
+	g_solution_data.reset();
+	bool motion_packet = job->flags & JOB_MOTION;
+	packet_priority = motion_packet ? UPLINK_PRIO_MOTION : UPLINK_PRIO_PERIODIC;
+	packet_delivered = false;
+
+	s_position position;
+	bool has_position = blues_apply_location(&job->location, &position);
+	if (!has_position)
+	{
+		MYLOG("APP", "Failed to get location");
+	}
+
+	// Report a change of the motion state
+	bool state_changed = motion_state_changed();
+	if (state_changed)
+	{
+		g_solution_data.addDigitalInput(LPP_CHANNEL_MOTION, motion_state_get());
+	}
+
+	// Get battery level
+	float batt_level_f = read_batt();
+	g_solution_data.addVoltage(LPP_CHANNEL_BATT, batt_level_f / 1000.0);
+
+	// Add the BME680 values collected at the end of the GNSS window
+	if (has_rak1906)
+	{
+		read_rak1906();
+	}
+
+	// After the sensors, the payload does not wait for the sync
+	if (gnss_active)
+	{
+		// A motion event started the next window, it switches GNSS off at its end
+		MYLOG("APP", "Next GNSS window started, keep GNSS on");
+	}
+	else
+	{
+		s_blues_job window = {};
+		window.run = job_window_end;
+		window.flags = job->flags;
+		blues_worker_submit(&window);
+	}
+
+	// Queue the energy counters if a diagnostic uplink is due
+	energy_report();
+
+	bool check_rejoin = false;
+	bool uplink_skipped = false;
+
+	// Skip the uplink if the position did not change, motion triggered packets and state changes are always sent
+	if (has_position && !deadband_report(&position, state_changed || motion_packet, g_solution_data.getSize()))
+	{
+		MYLOG("APP", "Position unchanged, skip uplink");
+		uplink_skipped = true;
+	}
+	// While moving the fixes are collected and sent together
+	else if (has_position && !track_report(&position, state_changed || motion_packet))
+	{
+		MYLOG("APP", "Fix added to the track, skip uplink");
+		uplink_skipped = true;
+	}
+	else if (g_lpwan_has_joined)
+	{
+		/*************************************************************************************/
+		/*                                                                                   */
+		/* If the device is setup for LoRaWAN, try first to send the data as confirmed       */
+		/* packet. If the sending fails, retry over cellular modem                           */
+		/*                                                                                   */
+		/* If the device is setup for LoRa P2P, send always as P2P packet AND over the       */
+		/* cellular modem                                                           */
+		/*                                                                                   */
+		/*************************************************************************************/
+		if (g_lorawan_settings.lorawan_enable && (link_choose(g_solution_data.getSize(), packet_priority, has_blues) == LINK_CELLULAR))
+		{
+			// Failed confirmed uplinks cost more than the cellular uplink
+			MYLOG("APP", "Cellular is cheaper, skip LoRaWAN");
+			app_event_post(USE_CELLULAR);
+		}
+		else if (g_lorawan_settings.lorawan_enable)
+		{
+			energy_lora_sent(g_solution_data.getSize());
+			lmh_error_status result = send_lora_packet(g_solution_data.getBuffer(), g_solution_data.getSize());
+			switch (result)
+			{
+			case LMH_SUCCESS:
+				MYLOG("APP", "Packet enqueued");
+
+				// Periodically send a packet over cellular as well, not needed with a reliable LoRaWAN link
+				// Resets automatically if LoRaWAN packet got no ACK
+				if ((send_counter >= 20) && !link_lora_reliable())
+				{
+					MYLOG("APP", "Start cellular heartbeat sending");
+					// Send over cellular connection
+					delayed_sending.start();
+				}
+				break;
+			case LMH_BUSY:
+				if (lora_queue_pending)
+				{
+					// Radio is busy with a queued packet, send over cellular
+					delayed_sending.start();
+					break;
+				}
+				re_init_lorawan();
+				result = send_lora_packet(g_solution_data.getBuffer(), g_solution_data.getSize());
+				if (result != LMH_SUCCESS)
+				{
+					// Send over cellular connection
+					delayed_sending.start();
+					check_rejoin = true;
+					send_fail++;
+					MYLOG("APP", "LoRa transceiver is busy");
+					AT_PRINTF("+EVT:BUSY\n");
+				}
+				break;
+			case LMH_ERROR:
+				re_init_lorawan();
+				result = send_lora_packet(g_solution_data.getBuffer(), g_solution_data.getSize());
+				if (result != LMH_SUCCESS)
+				{
+					// Send over cellular connection
+					delayed_sending.start();
+					check_rejoin = true;
+					send_fail++;
+					AT_PRINTF("+EVT:SIZE_ERROR\n");
+					MYLOG("APP", "Packet error, too big to send with current DR");
+				}
+				break;
+			}
+		}
+		else
+		{
+			// Add unique identifier in front of the P2P packet, here we use the DevEUI
+			g_solution_data.addDevID(LPP_CHANNEL_DEVID, &g_lorawan_settings.node_device_eui[4]);
+
+			// Send packet over LoRa
+			energy_lora_sent(g_solution_data.getSize());
+			// if (send_p2p_packet(packet_buffer, g_solution_data.getSize() + 8))
+			if (send_p2p_packet(g_solution_data.getBuffer(), g_solution_data.getSize()))
+			{
+				MYLOG("APP", "Packet enqueued");
+			}
+			else
+			{
+				AT_PRINTF("+EVT:SIZE_ERROR\n");
+				MYLOG("APP", "Packet too big");
+			}
+
+			// Send as well over cellular connection
+			delayed_sending.start();
+		}
+	}
+	else
+	{
+		// delayed_sending.start();
+		app_event_post(USE_CELLULAR);
+		if (g_lorawan_settings.lorawan_enable)
+		{
+			check_rejoin = true;
+			send_fail++;
+		}
+		MYLOG("APP", "Network not joined, skip sending over LoRaWAN");
+	}
+
+	// The BME680 aggregates of a skipped uplink go with the next uplink
+	if (has_rak1906 && !uplink_skipped)
+	{
+		rak1906_report_sent();
+	}
+
+	if (check_rejoin)
+	{
+		// Check how many times we send over LoRaWAN failed and retry to join LNS after 10 times failing
+		if (send_fail >= 10)
+		{
+			// Too many failed sendings, try to rejoin
+			MYLOG("APP", "Retry to join LNS");
+			send_fail = 0;
+			// int8_t init_result = re_init_lorawan();
+			g_lpwan_has_joined = false;
+			lmh_join();
+		}
+	}
+}
+
+/**
+ * @brief NoteCard job, send the current packet over cellular
+ *
+ * @param job packet with the DevID
+ * @return true if the packet was sent
+ */
+static bool job_send_cellular(s_blues_job *job)
+{
+#if MY_DEBUG > 0
+	MYLOG("APP", "Get hub sync status:");
+	blues_hub_status();
+#endif
+	return blues_send_payload(job->packet, job->len, job->priority);
+}
+
+/**
+ * @brief Completion of job_send_cellular(), keep the packet if it was not sent
+ *
+ * @param job packet and result
+ */
+static void cellular_sent(s_blues_job *job)
+{
+	link_cell_result(job->result);
+	if (job->result)
+	{
+		boot_phase_end(BOOT_UPLINK);
+		// Cellular link is working, send queued packets as well
+		cell_queue_sent = 0;
+		send_queued_cellular();
+	}
+	else if (!packet_delivered)
+	{
+		uplink_queue_add(job->packet, job->size, job->priority);
+	}
+
+	if (!g_lpwan_has_joined)
+	{
+		send_fail++;
+		MYLOG("APP", "Cellular count w/o Join %d", send_fail);
+	}
+	// Check how many times we send over cellular data and retry to join LNS after 10 times failing
+	if ((send_fail >= 10) && g_lorawan_settings.lorawan_enable)
+	{
+		// Try to rejoin
+		MYLOG("APP", "Retry to join LNS");
+		send_fail = 0;
+		// int8_t init_result = re_init_lorawan();
+		g_lpwan_has_joined = false;
+		lmh_join();
+	}
+}
+
+/**
+ * @brief NoteCard job, get the reason of the ATTN interrupt
+ *
+ * @param job returns the reason in value
+ * @return true
+ */
+static bool job_attn_reason(s_blues_job *job)
+{
+	job->value = blues_attn_reason();
+	return true;
+}
+
+/**
+ * @brief Completion of job_attn_reason(), start GNSS on motion or finish the window on a fix
+ *
+ * @param job reason of the ATTN interrupt
+ */
+static void attn_checked(s_blues_job *job)
+{
+	switch (job->value)
+	{
+		// Motion detected
+	case 1:
+		if (!motion_state_event())
+		{
+			MYLOG("APP", "Already moving");
+		}
+		else if (gnss_active)
+		{
+			MYLOG("APP", "GNSS already active");
+		}
+		else if (g_blues_settings.motion_trigger)
+		{
+			MYLOG("APP", "GNSS inactive, start it");
+			motion_triggered = true;
+			start_gnss(true);
+		}
+		else
+		{
+			// No location on motion, but use the send interval for moving
+			api_timer_restart(motion_state_interval());
+		}
+		break;
+		// Location fix (We ignore if motion and location found are reported together)
+	case 2:
+	case 3:
+		if (!gnss_active)
+		{
+			// ATTN is switched back to motion after the location was read
+			MYLOG("APP", "Location fix after the GNSS window");
+			break;
+		}
+		wait_gnss.stop();
+		gnss_fix_received = true;
+		app_event_post(GNSS_FINISH);
+		break;
+	}
+}
+
+/**
+ * @brief NoteCard job, start the BME680 conversion, switch GNSS on and arm the location trigger
+ *
+ * @param job flags of the window
+ * @return true if the location trigger is armed
+ */
+static bool job_gnss_on(s_blues_job *job)
+{
+	// The conversion finishes during the window, its values are collected at the end
+	if (job->flags & JOB_BME)
+	{
+		rak1906_start();
+	}
+
+	// Enable GNSS
+	blues_switch_gnss_mode(true);
+
+	// Enable Location event
+	if (!blues_enable_attn(false))
+	{
+		MYLOG("APP", "Rearm location trigger failed");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Start a GNSS window, its length is learned from the time-to-fix of the last windows
+ * 		During the backoff after failed windows GNSS is not started and the tower location is sent
+ *
+ * @param forced true to start GNSS even during the backoff
+ */
+void start_gnss(bool forced)
+{
+	uint32_t window = gnss_window_start(forced);
+	if (window == 0)
+	{
+		gnss_skipped = true;
+		app_event_post(GNSS_FINISH);
+		return;
+	}
+
+	gnss_active = true;
+	energy_start(ENERGY_GNSS);
+
+	s_blues_job job = {};
+	job.run = job_gnss_on;
+	job.flags = has_rak1906 ? JOB_BME : 0;
+	blues_worker_submit(&job);
+
+	api_timer_stop();
+
+	wait_gnss.setPeriod(window);
+	wait_gnss.start();
+
+	led_write(LED_BLUE, HIGH);
+	blink_blue.start();
+}
+
+/**
+ * @brief Send the next queued packet over LoRaWAN
+ * 		Only one packet can be in the TX cycle, the next one is sent after the ACK
+ *
+ */
+void send_queued_lora(void)
+{
+	if (lora_queue_pending || !g_lorawan_settings.lorawan_enable || !g_lpwan_has_joined)
+	{
+		return;
+	}
+	uint8_t queued_packet[256];
+	uint8_t len = uplink_queue_peek(queued_packet, &lora_queue_seq);
+	if ((len == 0) || (cell_queue_pending && (lora_queue_seq == cell_queue_seq)))
+	{
+		return;
+	}
+	energy_lora_sent(len);
+	if (send_lora_packet(queued_packet, len) == LMH_SUCCESS)
+	{
+		MYLOG("APP", "Queued packet #%d enqueued", lora_queue_seq);
+		lora_queue_pending = true;
+	}
+}
+
+/**
+ * @brief NoteCard job, send a queued packet over cellular
+ *
+ * @param job queued packet with the DevID
+ * @return true if the packet was sent
+ */
+static bool job_send_queued(s_blues_job *job)
+{
+	return blues_send_payload(job->packet, job->len, job->priority);
+}
+
+/**
+ * @brief Completion of job_send_queued(), remove the packet and send the next one
+ *
+ * @param job queued packet and result
+ */
+static void queued_sent(s_blues_job *job)
+{
+	cell_queue_pending = false;
+	if (!job->result)
+	{
+		// Try again after the next cellular uplink
+		cell_queue_sent = UPLINK_DRAIN_MAX;
+		return;
+	}
+	uplink_queue_remove(job->seq);
+	cell_queue_sent++;
+	send_queued_cellular();
+}
+
+/**
+ * @brief Send queued packets over cellular
+ * 		One packet at a time is sent by the worker, its completion sends the next one
+ *
+ */
+void send_queued_cellular(void)
+{
+	static bool draining = false;
+	// Without the worker the completions run inside the loop below
+	if (draining)
+	{
+		return;
+	}
+	draining = true;
+	while (!cell_queue_pending && (cell_queue_sent < UPLINK_DRAIN_MAX))
+	{
+		s_blues_job job = {};
+		uint16_t len = uplink_queue_peek(job.packet, &job.seq, &job.priority);
+		if ((len == 0) || (lora_queue_pending && (job.seq == lora_queue_seq)))
+		{
+			break;
+		}
+		// Add the DevID as for the cellular packets
+		job.packet[len++] = 0;
+		job.packet[len++] = LPP_DEVID;
+		memcpy(&job.packet[len], &g_lorawan_settings.node_device_eui[4], 4);
+		len += 4;
+		job.len = len;
+		job.run = job_send_queued;
+		job.done = queued_sent;
+		cell_queue_pending = true;
+		cell_queue_seq = job.seq;
+		if (blues_worker_submit(&job))
+		{
+			break;
 		}
 	}
+	draining = false;
 }
 
 /**
@@ -574,7 +1075,7 @@ void lora_data_handler(void)
  */
 void delayed_cellular(TimerHandle_t unused)
 {
-	api_wake_loop(USE_CELLULAR);
+	app_event_post(USE_CELLULAR);
 }
 
 /**
@@ -584,12 +1085,12 @@ void delayed_cellular(TimerHandle_t unused)
  */
 void waited_location(TimerHandle_t unused)
 {
-	api_wake_loop(GNSS_FINISH);
+	app_event_post(GNSS_FINISH);
 }
 
 void toggle_blue(TimerHandle_t unused)
 {
-	digitalWrite(LED_BLUE, !digitalRead(LED_BLUE));
+	led_write(LED_BLUE, !digitalRead(LED_BLUE));
 }
 
 void toggle_green(TimerHandle_t unused)
@@ -597,12 +1098,12 @@ void toggle_green(TimerHandle_t unused)
 	int status = digitalRead(LED_GREEN);
 	if (status == HIGH)
 	{
-		digitalWrite(LED_GREEN, LOW);
+		led_write(LED_GREEN, LOW);
 		blink_green.setPeriod(4500);
 	}
 	else
 	{
-		digitalWrite(LED_GREEN, HIGH);
+		led_write(LED_GREEN, HIGH);
 		blink_green.setPeriod(500);
 	}
 	blink_green.start();
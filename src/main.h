@@ -18,6 +18,8 @@
 #include <WiFi.h>
 #endif
 #include "RAK1906_env.h"
+#include "tracker_payload.h"
+#include "log_ring.h"
 #include <ArduinoJson.h>
 
 // Debug output set to 0 to disable app debug output
@@ -27,20 +29,8 @@
 
 #ifdef NRF52_SERIES
 #if MY_DEBUG > 0
-#define MYLOG(tag, ...)                     \
-	do                                      \
-	{                                       \
-		if (tag)                            \
-			PRINTF("[%s] ", tag);           \
-		PRINTF(__VA_ARGS__);                \
-		PRINTF("\n");                       \
-		Serial.flush();                     \
-		if (g_ble_uart_is_connected)        \
-		{                                   \
-			g_ble_uart.printf(__VA_ARGS__); \
-			g_ble_uart.printf("\n");        \
-		}                                   \
-	} while (0)
+// Stored in the log ring, the text is sent to Serial and BLE by the log drain task
+#define MYLOG(tag, ...) log_ring_printf(tag, __VA_ARGS__)
 #else
 #define MYLOG(...)
 #endif
@@ -86,6 +76,14 @@ void lora_data_handler(void);
 #define N_BLUES_ATTN   0b1011111111111111
 #define GNSS_FINISH    0b0010000000000000
 #define N_GNSS_FINISH  0b1101111111111111
+#define BLUES_DONE     0b0001000000000000
+#define N_BLUES_DONE   0b1110111111111111
+#define SETTINGS_SAVE   0b0000100000000000
+#define N_SETTINGS_SAVE 0b1111011111111111
+#define ENV_SAMPLE      0b0000010000000000
+#define N_ENV_SAMPLE    0b1111101111111111
+#define REGION_SWITCH   0b0000001000000000
+#define N_REGION_SWITCH 0b1111110111111111
 
 // Cayenne LPP Channel numbers per sensor value
 #define LPP_CHANNEL_BATT 1		 // Base Board
@@ -95,9 +93,22 @@ void lora_data_handler(void);
 #define LPP_CHANNEL_GAS_2 9		 // RAK1906
 #define LPP_CHANNEL_GPS 10		 // RAK13102
 #define LPP_CHANNEL_GPS_TOWER 11 // RAK13102
+#define LPP_CHANNEL_MOTION 12	 // Motion state
+
+// RAK1906 aggregates of the samples since the last uplink
+#define LPP_CHANNEL_ENV_COUNT 14 // Number of samples
+#define LPP_CHANNEL_HUMID_2_MIN 15
+#define LPP_CHANNEL_HUMID_2_MAX 16
+#define LPP_CHANNEL_HUMID_2_MEAN 17
+#define LPP_CHANNEL_TEMP_2_MIN 18
+#define LPP_CHANNEL_TEMP_2_MAX 19
+#define LPP_CHANNEL_TEMP_2_MEAN 20
+#define LPP_CHANNEL_PRESS_2_MIN 21
+#define LPP_CHANNEL_PRESS_2_MAX 22
+#define LPP_CHANNEL_PRESS_2_MEAN 23
 
 // Globals
-extern WisCayenne g_solution_data;
+extern TrackerPayload g_solution_data;
 #ifdef NRF52_SERIES
 extern SoftwareTimer blink_green;
 #endif
@@ -114,6 +125,15 @@ struct s_blues_settings
 	uint8_t sim_usage = 0;										 // 0 int SIM, 1 ext SIM, 2 ext int SIM, 3 int ext SIM
 	char ext_sim_apn[256] = "internet";							 // APN to be used with external SIM
 	bool motion_trigger = true;									 // Send data on motion trigger
+	uint8_t sync_count = 1;										 // Sync with NoteHub after this number of notes
+	uint16_t sync_age = 60;										 // Sync with NoteHub if a note waits longer than this (minutes), 0 = no limit
+	uint8_t sync_priority = 1;									 // Sync with NoteHub immediately for notes with this or higher priority
+	uint16_t deadband = 0;										 // Suppress uplinks if the position moved less than this (meters), 0 = off
+	uint8_t keepalive = 6;										 // Send an uplink after this number of suppressed uplinks
+	uint8_t payload_format = PAYLOAD_LPP;						 // Uplink payload format, 0 Cayenne LPP, 1 compact
+	uint8_t track_fixes = 1;									 // Fixes sent together in one uplink while moving, 0 or 1 = off
+	uint8_t diag_interval = 0;									 // Send the energy counters every n hours, 0 = off
+	uint16_t env_interval = 0;									 // Sample the BME680 every n seconds between the uplinks, 0 = off
 };
 
 #include <blues-minimal-i2c.h>
@@ -122,11 +142,24 @@ bool init_blues(void);
 // bool start_req(char *request);
 // bool send_req(void);
 void blues_hub_status(void);
-bool blues_get_location(void);
+void blues_sync_session(void);
+/** Position of an uplink */
+struct s_position
+{
+	int32_t lat;   // Latitude in 1e-7 degrees
+	int32_t lon;   // Longitude in 1e-7 degrees
+	bool tower;	   // Location of the cell tower, not GNSS
+	uint32_t time; // Epoch seconds of the location, 0 if unknown
+};
+bool blues_get_location(bool use_gnss = true, s_position *position = NULL);
+uint32_t blues_motion_count(void);
 bool blues_enable_attn(bool motion);
 bool blues_disable_attn(void);
-bool blues_send_payload(uint8_t *data, uint16_t data_len);
+bool blues_send_payload(uint8_t *data, uint16_t data_len, uint8_t priority);
+void blues_sync_check(void);
 bool blues_switch_gnss_mode(bool continuous_on);
+bool blues_set_hub(void);
+bool blues_set_wireless(void);
 void blues_card_restore(void);
 void blues_attn_cb(void);
 uint8_t blues_attn_reason(void);
@@ -134,8 +167,470 @@ bool blues_hub_connected(void);
 extern RAK_BLUES rak_blues;
 extern s_blues_settings g_blues_settings;
 
+// NoteCard transcript capture
+void blues_capture_init(void);
+bool blues_capture_start(bool clear);
+void blues_capture_stop(void);
+bool blues_capture_active(void);
+uint32_t blues_capture_size(void);
+uint16_t blues_capture_export(void (*line_cb)(const char *line));
+bool blues_start_req(const char *request);
+bool blues_send_req(char *response = NULL, uint16_t resp_len = 0);
+void blues_capture_begin(const char *request);
+void blues_capture_request(const char *data, uint16_t len);
+void blues_capture_end(bool success, const char *response);
+
+// Shadow of the NoteCard state
+#define SHADOW_UNKNOWN 0xFF
+#define SHADOW_OFF 0
+#define SHADOW_ON 1
+#define ATTN_MODE_MOTION 0x01
+#define ATTN_MODE_LOCATION 0x02
+struct s_blues_shadow
+{
+	uint8_t location_mode = SHADOW_UNKNOWN; // GNSS off or continuous
+	uint8_t motion_mode = SHADOW_UNKNOWN;	// Motion detection stopped or started
+	uint8_t attn_modes = SHADOW_UNKNOWN;	// ATTN_MODE_xxx bits
+	volatile bool attn_armed = false;		// ATTN is armed, the NoteCard disarms when it fires
+	uint32_t hub_hash = 0;					// Parameters of the last hub.set, 0 = unknown
+	uint32_t wireless_hash = 0;				// Parameters of the last card.wireless, 0 = unknown
+	uint32_t setup_hash = 0;				// Version of the tracking and motion setup, 0 = unknown
+};
+extern s_blues_shadow g_blues_shadow;
+void blues_shadow_reset(void);
+void blues_shadow_skip(uint8_t requests);
+uint32_t blues_shadow_skipped(void);
+uint32_t blues_shadow_hash(uint32_t hash, const void *data, size_t len);
+
+// Reconciler of the NoteCard configuration
+struct s_blues_config_stats
+{
+	uint16_t warm = 0;		 // Boots without configuration requests
+	uint16_t reconciled = 0; // Boots and AT changes that compared the sections
+	uint16_t live = 0;		 // AT changes applied without reboot
+	uint16_t lost = 0;		 // Boots where hub.get showed a restored or changed NoteCard
+	uint32_t skipped = 0;	 // Configuration requests that were not sent
+};
+uint32_t blues_config_hub_hash(void);
+uint32_t blues_config_wireless_hash(void);
+bool blues_config_reconcile(uint32_t device);
+void blues_config_update(void);
+void blues_config_forget(void);
+s_blues_config_stats *blues_config_stats(void);
+
+// Store and forward queue for uplinks
+/** Maximum number of queued uplinks */
+#define UPLINK_QUEUE_MAX 48
+/** Maximum number of queued uplinks sent over cellular in one go */
+#define UPLINK_DRAIN_MAX 16
+/** Uplink priorities, higher priorities are sent first */
+#define UPLINK_PRIO_PERIODIC 0
+#define UPLINK_PRIO_MOTION 1
+/** Counters of the uplink queue */
+struct s_uplink_queue_stats
+{
+	uint32_t queued;  // Uplinks added to the queue
+	uint32_t sent;	  // Queued uplinks sent
+	uint32_t dropped; // Uplinks dropped because the queue was full
+};
+void uplink_queue_init(void);
+bool uplink_queue_add(uint8_t *data, uint8_t len, uint8_t priority);
+uint8_t uplink_queue_peek(uint8_t *data, uint16_t *seq, uint8_t *priority = NULL);
+void uplink_queue_remove(uint16_t seq);
+void uplink_queue_clear(void);
+uint8_t uplink_queue_count(void);
+s_uplink_queue_stats *uplink_queue_stats(void);
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *data, uint16_t len);
+
+// NoteCard requests with retry policy
+/** Counters of a retry policy */
+struct s_blues_req_stats
+{
+	uint32_t requests;	 // Requests sent
+	uint32_t attempts;	 // Tries including retries
+	uint32_t failures;	 // Requests failed after all tries
+	uint32_t backoff_ms; // Time spent waiting between tries
+	uint32_t busy_ms;	 // Time spent in the requests including waiting
+};
+typedef void (*blues_fill_t)(void *arg);
+bool blues_request(const char *request, blues_fill_t fill = NULL, void *arg = NULL, char *response = NULL, uint16_t resp_len = 0);
+const s_blues_req_stats *blues_request_stats(uint8_t idx, const char **name);
+void blues_request_stats_reset(void);
+
+// Histograms of the NoteCard requests per request name
+/** Request names with own counters, the last one is shared by all further names */
+#define BLUES_PERF_NAMES 24
+/** Buckets of the round trip time, <10, <20, <50, <100, <200, <500, <1000, >=1000 ms */
+#define BLUES_PERF_MS_BUCKETS 8
+/** Buckets of the request and response size, <32, <64, <128, <256, <512, >=512 bytes */
+#define BLUES_PERF_SIZE_BUCKETS 6
+/** Size of a request or response that is not known, RAK_BLUES does not report the request size */
+#define BLUES_PERF_UNKNOWN 0xFFFF
+/** Counters of a request name */
+struct s_blues_perf
+{
+	char name[24];
+	uint32_t requests;								 // Requests through the retry policy
+	uint32_t tries;									 // Round trips to the NoteCard
+	uint32_t retries;								 // Round trips after the first try of a request
+	uint32_t errors;								 // Round trips without answer or with error
+	uint32_t failures;								 // Requests failed after all tries
+	uint32_t total_ms;								 // Time of all round trips
+	uint32_t max_ms;								 // Longest round trip
+	uint32_t sent;									 // Bytes of all requests with known size
+	uint32_t received;								 // Bytes of all responses with known size
+	uint32_t time_hist[BLUES_PERF_MS_BUCKETS];		 // Round trips per time bucket
+	uint32_t sent_hist[BLUES_PERF_SIZE_BUCKETS];	 // Requests per size bucket
+	uint32_t received_hist[BLUES_PERF_SIZE_BUCKETS]; // Responses per size bucket
+};
+void blues_perf_try(const char *request, uint32_t time_ms, uint16_t sent, uint16_t received, bool success);
+void blues_perf_request(const char *request, uint8_t tries, bool success);
+const s_blues_perf *blues_perf_stats(uint8_t idx);
+void blues_perf_reset(void);
+
+// NoteCard requests built at compile time and streamed to the NoteCard
+/** I2C address of the NoteCard */
+#define BLUES_I2C_ADDR 0x17
+/** Bytes per I2C write, the Wire buffer holds 32 bytes including the length byte */
+#define BLUES_I2C_CHUNK 30
+/** Start of a request, the literals are concatenated by the compiler and stay in flash */
+#define BLUES_REQ(name) "{\"req\":\"" name "\""
+/** String entry of a request */
+#define BLUES_STR(key, value) ",\"" key "\":\"" value "\""
+/** Bool or number entry of a request */
+#define BLUES_VAL(key, value) ",\"" key "\":" #value
+typedef void (*blues_write_t)(void *arg);
+bool blues_request_raw(const char *fixed, uint16_t fixed_len, blues_write_t write = NULL, void *arg = NULL, char *response = NULL, uint16_t resp_len = 0);
+/**
+ * @brief Send a request built with BLUES_REQ/BLUES_STR/BLUES_VAL, retry according to the policy of the request
+ * 		The length of the fixed part is known at compile time.
+ *
+ * @param fixed fixed part of the request
+ * @param write optional function to stream the dynamic entries with blues_write_xxx
+ * @param arg argument for the write function
+ * @param response optional buffer for the response
+ * @param resp_len size of the response buffer
+ * @return true if the request was successful
+ */
+template <size_t N>
+inline bool blues_send(const char (&fixed)[N], blues_write_t write = NULL, void *arg = NULL, char *response = NULL, uint16_t resp_len = 0)
+{
+	return blues_request_raw(fixed, N - 1, write, arg, response, resp_len);
+}
+bool blues_transaction(const char *fixed, uint16_t fixed_len, blues_write_t write, void *arg, char *response, uint16_t resp_len, uint32_t timeout_ms);
+void blues_transaction_bytes(uint16_t *sent, uint16_t *received);
+void blues_write_string(const char *key, const char *value);
+void blues_write_bool(const char *key, bool value);
+void blues_write_int(const char *key, int32_t value);
+void blues_write_nested_string(const char *key, const char *nested, const char *value);
+void blues_write_base64(const char *key, const uint8_t *data, uint16_t len);
+
+// Single pass extraction of card.location, card.time, card.wireless, card.motion and hub.get responses
+/** Fields found in the response */
+#define BLUES_HAS_LOCATION 0x01
+#define BLUES_HAS_TIME 0x02
+#define BLUES_HAS_STATUS 0x04
+#define BLUES_HAS_DOP 0x08
+#define BLUES_HAS_COUNTRY 0x10
+#define BLUES_HAS_APN 0x20
+#define BLUES_HAS_METHOD 0x40
+#define BLUES_HAS_NET_BAND 0x80
+#define BLUES_HAS_COUNT 0x100
+#define BLUES_HAS_COMPLETED 0x200
+#define BLUES_HAS_PRODUCT 0x400
+#define BLUES_HAS_MODE 0x800
+/** GNSS status from card.location */
+enum blues_gnss_status
+{
+	GNSS_STATUS_UNKNOWN = 0,
+	GNSS_STATUS_INACTIVE,
+	GNSS_STATUS_SEARCH,
+	GNSS_STATUS_UPDATED
+};
+/** Values of a NoteCard response */
+struct s_blues_response
+{
+	uint16_t fields;	 // BLUES_HAS_xxx
+	int32_t lat;		 // Latitude in 1e-7 degrees, the scale of addGNSS_6
+	int32_t lon;		 // Longitude in 1e-7 degrees
+	uint32_t time;		 // Epoch seconds
+	uint8_t status;		 // blues_gnss_status
+	uint16_t dop;		 // Dilution of precision * 100
+	char country[3];	 // ISO 3166 country code of the cell tower
+	uint8_t sim_usage;	 // SIM selection from method, same values as s_blues_settings.sim_usage
+	const char *apn;	 // APN, points into the response, not terminated
+	uint8_t apn_len;	 // Length of the APN
+	uint32_t count;		 // Motion events from card.motion
+	uint32_t completed;	 // Seconds since the last sync was completed, from hub.sync.status
+	const char *product; // Product UID from hub.get, points into the response, not terminated
+	uint8_t product_len; // Length of the Product UID
+	const char *mode;	 // Mode string, e.g. the connection mode from hub.get, points into the response, not terminated
+	uint8_t mode_len;	 // Length of the mode
+};
+bool blues_parse_response(const char *json, s_blues_response *parsed);
+
+// LoRaWAN region from the country of the cell tower
+uint8_t region_for_country(const char *country);
+bool region_check_needed(int32_t lat, int32_t lon);
+bool region_update(const char *country, int32_t lat, int32_t lon);
+uint8_t region_max_payload(void);
+uint8_t uplink_max_payload(void);
+
+// Adaptive GNSS acquisition window
+/** Number of attempts kept in the time-to-fix history */
+#define GNSS_HISTORY 8
+/** Counters of the GNSS attempts */
+struct s_gnss_window_stats
+{
+	uint32_t attempts; // GNSS windows started
+	uint32_t fixes;	   // GNSS windows with a fix
+	uint32_t skipped;  // Send intervals without GNSS because of the backoff
+	uint32_t on_time;  // Sum of the GNSS window times in ms
+};
+uint32_t gnss_window_start(bool forced);
+void gnss_window_finish(bool fix);
+s_gnss_window_stats *gnss_window_stats(void);
+
+// Position deadband for uplinks
+/** Counters of the deadband */
+struct s_deadband_stats
+{
+	uint32_t reported;	  // Uplinks with a position that were sent
+	uint32_t suppressed;  // Uplinks suppressed inside the deadband
+	uint32_t keepalive;	  // Uplinks sent as keep-alive inside the deadband
+	uint32_t bytes_saved; // Payload bytes of the suppressed uplinks
+};
+uint64_t deadband_distance_sq(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2);
+bool deadband_report(s_position *position, bool forced, uint8_t size);
+s_deadband_stats *deadband_stats(void);
+
+// Track of the fixes while moving
+/** Counters of the track batching */
+struct s_track_stats
+{
+	uint32_t held;	  // Fixes added to a track instead of sending an uplink
+	uint32_t tracks;  // Uplinks sent with a track
+	uint32_t dropped; // Fixes dropped because the position had no time
+};
+bool track_report(s_position *position, bool forced);
+s_track_stats *track_stats(void);
+
+// Choice between LoRaWAN and cellular
+#define LINK_LORA 0
+#define LINK_CELLULAR 1
+/** Transmissions of a confirmed uplink without ACK, LoRaMAC default */
+#define LINK_LORA_RETRIES 8
+/** State and counters of the link model */
+struct s_link_stats
+{
+	uint32_t lora_chosen;	 // Uplinks sent over LoRaWAN first
+	uint32_t cell_chosen;	 // Uplinks sent only over cellular
+	uint32_t probes;		 // Uplinks sent over LoRaWAN to check the coverage
+	uint32_t lora_mj;		 // Expected energy of the last uplink over LoRaWAN with cellular fallback
+	uint32_t cell_mj;		 // Expected energy of the last uplink over cellular
+	uint32_t duty_budget_ms; // Remaining duty-cycle budget
+	uint8_t lora_ack;		 // ACK ratio in %
+	uint8_t cell_ok;		 // Cellular success ratio in %
+	int16_t snr_x10;		 // SNR of the ACKs or downlinks in 0.1 dB
+	int16_t rssi;			 // RSSI of the ACKs or downlinks in dBm
+};
+uint32_t link_airtime_ms(uint8_t size);
+uint32_t link_rx_ms(bool downlink);
+uint8_t link_choose(uint8_t size, uint8_t priority, bool cellular);
+void link_lora_result(bool ack);
+void link_lora_downlink(void);
+void link_cell_result(bool success);
+bool link_lora_reliable(void);
+s_link_stats *link_stats(void);
+
+// Time-in-state accounting of the energy use
+#define ENERGY_GNSS 0	   // GNSS in continuous mode
+#define ENERGY_SYNC 1	   // Modem in a NoteHub sync session
+#define ENERGY_LORA_TX 2   // LoRa transmitting
+#define ENERGY_LORA_RX 3   // LoRa RX windows
+#define ENERGY_I2C 4	   // NoteCard I2C transactions
+#define ENERGY_BME680 5	   // BME680 conversion
+#define ENERGY_LED_BLUE 6  // Blue LED on
+#define ENERGY_LED_GREEN 7 // Green LED on
+#define ENERGY_NUM 8
+/** Time in each state, since boot and since the counters were cleared */
+struct s_energy_stats
+{
+	uint32_t boot_ms[ENERGY_NUM];  // Time in the state since boot
+	uint32_t total_s[ENERGY_NUM];  // Time in the state over all boots
+	uint32_t uptime_s;			   // Time since boot
+	uint32_t total_uptime_s;	   // Time running over all boots
+	uint16_t boots;				   // Boots since the counters were cleared
+};
+void energy_init(void);
+void energy_start(uint8_t state);
+void energy_stop(uint8_t state);
+void energy_add(uint8_t state, uint32_t time_ms);
+void energy_lora_sent(uint8_t size);
+void energy_lora_finished(bool ack);
+void energy_save(bool forced);
+void energy_clear(void);
+void energy_report(void);
+const char *energy_state_name(uint8_t state);
+s_energy_stats *energy_stats(void);
+void led_write(uint8_t pin, uint8_t level);
+
+// Wake-up events with atomic post and take
+/** Events that are only posted with app_event_post(), their bit in g_task_event_type only wakes the loop */
+#define APP_EVENTS_OWN (GNSS_FINISH | USE_CELLULAR | BLUES_ATTN | BLUES_DONE | SETTINGS_SAVE | ENV_SAMPLE | REGION_SWITCH)
+/** Events with counters, the events in APP_EVENTS_OWN */
+#define APP_EVENT_NUM 7
+/** Counters of an event */
+struct s_app_event_stats
+{
+	uint32_t posted;	  // Posts with app_event_post()
+	uint32_t coalesced;	  // Posts merged with a pending post
+	uint32_t handled;	  // Events taken by the handlers
+	uint32_t latency_num; // Handled posts with a time
+	uint32_t total_us;	  // Time from the first post to the handling
+	uint32_t max_us;	  // Longest time from the first post to the handling
+};
+void app_event_post(uint16_t event);
+bool app_event_take(uint16_t event);
+const s_app_event_stats *app_event_stats(uint8_t idx, const char **name, uint16_t *event = NULL);
+void app_event_stats_reset(void);
+
+// NoteCard worker task
+/** Jobs that can wait for the worker */
+#define BLUES_WORKER_QUEUE 8
+struct s_blues_job;
+/** Job function, runs in the worker with the NoteCard locked */
+typedef bool (*blues_job_run_t)(s_blues_job *job);
+/** Completion function, runs in the loop after the job */
+typedef void (*blues_job_done_t)(s_blues_job *job);
+/** GNSS and tower location read in the worker */
+struct s_blues_location
+{
+	bool gnss;			 // NoteCard reported a GNSS location
+	int32_t gnss_lat;	 // Latitude in 1e-7 degrees
+	int32_t gnss_lon;	 // Longitude in 1e-7 degrees
+	uint32_t gnss_time;	 // Epoch seconds, 0 if unknown
+	bool tower;			 // NoteCard reported a tower location
+	int32_t tower_lat;	 // Latitude in 1e-7 degrees
+	int32_t tower_lon;	 // Longitude in 1e-7 degrees
+	uint32_t tower_time; // Epoch seconds, 0 if unknown
+	char country[3];	 // ISO 3166 country code of the tower, empty if not reported
+};
+/** Request to the NoteCard worker, copied into the queue */
+struct s_blues_job
+{
+	blues_job_run_t run;		// Job function
+	blues_job_done_t done;		// Completion function, NULL if none
+	bool result;				// Result of the job function
+	uint8_t flags;				// Flags of the caller
+	uint8_t priority;			// Uplink priority of the packet
+	uint8_t size;				// Bytes of the packet without the DevID
+	uint16_t len;				// Bytes in packet
+	uint16_t seq;				// Sequence number of a queued packet
+	uint32_t value;				// Value of the caller or the job
+	uint32_t submit_ms;			// Time of the submit
+	uint32_t start_ms;			// Start of the job
+	uint32_t end_ms;			// End of the job
+	s_blues_location location;	// Location read by the job
+	uint8_t packet[264];		// Packet to send, with the DevID
+};
+/** Counters of the worker */
+struct s_blues_worker_stats
+{
+	uint32_t submitted;	  // Jobs queued for the worker
+	uint32_t inline_jobs; // Jobs that ran in the loop, no worker or queue full
+	uint32_t completed;	  // Jobs completed in the loop
+	uint8_t max_depth;	  // Most jobs that waited at the same time
+	uint32_t wait_ms;	  // Time from the submit to the start of the jobs
+	uint32_t run_ms;	  // Time the worker used for the jobs
+	uint32_t max_ms;	  // Longest time from the submit to the end of a job
+};
+void blues_worker_init(void);
+bool blues_worker_submit(const s_blues_job *job);
+void blues_worker_run(void);
+void blues_worker_complete(void);
+uint8_t blues_worker_depth(void);
+const s_blues_worker_stats *blues_worker_stats(void);
+void blues_worker_stats_reset(void);
+void blues_lock(void);
+void blues_unlock(void);
+bool blues_read_location(bool use_gnss, s_blues_location *location);
+bool blues_apply_location(const s_blues_location *location, s_position *position);
+
+// Boot phase profiler
+enum boot_phase_ids
+{
+	BOOT_SERIAL = 0, // Wait for the USB serial
+	BOOT_API,		 // LoRaWAN and BLE init of the WisBlock API
+	BOOT_APP,		 // init_app()
+	BOOT_SETTINGS,	 // AT commands, uplink queue and energy counters
+	BOOT_RAK1906,	 // BME680 init
+	BOOT_BLUES,		 // NoteCard configuration in the worker
+	BOOT_LORAWAN,	 // LoRaWAN init without auto join
+	BOOT_JOIN,		 // Start of LoRaWAN until joined
+	BOOT_UPLINK,	 // Reset until the first uplink was sent
+	BOOT_NUM
+};
+/** Times of a boot phase in ms since the reset */
+struct s_boot_phase
+{
+	uint32_t start_ms;
+	uint32_t end_ms;
+	bool started;
+	bool finished;
+};
+bool boot_usb_present(void);
+void boot_phase_start(uint8_t phase);
+void boot_phase_end(uint8_t phase);
+const s_boot_phase *boot_phase(uint8_t phase, const char **name);
+void boot_profile_reset(void);
+
+// Motion state driven send interval
+enum motion_states
+{
+	MOTION_STATIONARY = 0,
+	MOTION_MOVING,
+	MOTION_PARKED
+};
+bool motion_state_event(void);
+bool motion_state_update(uint32_t count);
+uint8_t motion_state_get(void);
+const char *motion_state_name(void);
+bool motion_state_changed(void);
+uint32_t motion_state_interval(void);
+
 // User AT commands
 void init_user_at(void);
 bool read_blues_settings(void);
 void save_blues_settings(void);
+
+// Settings records in flash
+/** Time without a new change before the settings are written */
+#define SETTINGS_SAVE_DELAY 2000
+/** Counters of the settings store */
+struct s_settings_stats
+{
+	uint32_t requests = 0;	// Saves requested by the AT commands
+	uint32_t writes = 0;	// Records written to flash
+	uint32_t unchanged = 0; // Saves without a change to the last record
+	uint16_t seq = 0;		// Sequence number of the last record
+	uint16_t size = 0;		// Size of the last record
+	bool migrated = false;	// Settings were converted from the old file at this boot
+	uint32_t failed = 0;	// Records that could not be written
+};
+/** Raw structure saved by the first firmware in the BLUES file, never change it */
+struct s_legacy_settings
+{
+	uint16_t valid_mark;
+	char product_uid[256];
+	bool conn_continous;
+	uint8_t sim_usage;
+	char ext_sim_apn[256];
+	bool motion_trigger;
+};
+bool settings_read(s_blues_settings *settings);
+void settings_save(void);
+void settings_flush(void);
+void settings_remove(void);
+s_settings_stats *settings_stats(void);
 #endif // _MAIN_H_
\ No newline at end of file
@@ -0,0 +1,174 @@
+/**
+ * @file motion_state.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Stationary / moving / parked state of the asset, fed by the NoteCard motion events
+ * 		and the card.motion counts. The send interval follows the state, short while moving,
+ * 		the AT+SENDINT interval while stationary and long while parked.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Send interval while moving is the send interval divided by this */
+#define MOTION_MOVING_DIVIDER 4
+/** Shortest send interval while moving */
+#define MOTION_MOVING_MIN 60000
+/** Send interval while parked is the send interval multiplied by this */
+#define MOTION_PARKED_FACTOR 6
+/** Longest send interval while parked, 24 hours */
+#define MOTION_PARKED_MAX 86400000
+/** Motion events in a send interval that count as moving */
+#define MOTION_MIN_COUNT 2
+/** Send intervals without motion before moving becomes stationary */
+#define MOTION_STOP_INTERVALS 2
+/** Send intervals without motion before stationary becomes parked */
+#define MOTION_PARK_INTERVALS 6
+
+/** Names of the states for the log and AT+BMOTION */
+static const char *motion_state_names[] = {"STATIONARY", "MOVING", "PARKED"};
+
+/** Current state */
+static uint8_t motion_state = MOTION_STATIONARY;
+
+/** Send intervals without motion in a row */
+static uint16_t motion_quiet = 0;
+
+/** State changed since the last uplink */
+static bool motion_changed = false;
+
+/**
+ * @brief Switch to a new state and report it
+ *
+ */
+static void motion_state_set(uint8_t new_state)
+{
+	if (new_state == motion_state)
+	{
+		return;
+	}
+	MYLOG("MOTION", "%s -> %s", motion_state_names[motion_state], motion_state_names[new_state]);
+	motion_state = new_state;
+	motion_quiet = 0;
+	motion_changed = true;
+	AT_PRINTF("+EVT:%s", motion_state_names[new_state]);
+}
+
+/**
+ * @brief Handle a motion ATTN of the NoteCard
+ *
+ * @return true if the asset started to move, a location should be sent now
+ * @return false if the asset is already moving, the short send interval covers it
+ */
+bool motion_state_event(void)
+{
+	if (motion_state == MOTION_MOVING)
+	{
+		return false;
+	}
+	motion_state_set(MOTION_MOVING);
+	return true;
+}
+
+/**
+ * @brief Update the state at the end of a send interval
+ * 		While stationary or parked, motion is reported by the ATTN, count is not used
+ *
+ * @param count motion events counted by the NoteCard since the last card.motion request
+ * @return true if the send interval changed
+ */
+bool motion_state_update(uint32_t count)
+{
+	uint8_t old_state = motion_state;
+
+	if (count >= MOTION_MIN_COUNT)
+	{
+		motion_quiet = 0;
+		motion_state_set(MOTION_MOVING);
+	}
+	else
+	{
+		if (motion_quiet < 0xFFFF)
+		{
+			motion_quiet++;
+		}
+		if ((motion_state == MOTION_MOVING) && (motion_quiet >= MOTION_STOP_INTERVALS))
+		{
+			motion_state_set(MOTION_STATIONARY);
+		}
+		else if ((motion_state == MOTION_STATIONARY) && (motion_quiet >= MOTION_PARK_INTERVALS))
+		{
+			motion_state_set(MOTION_PARKED);
+		}
+	}
+	return old_state != motion_state;
+}
+
+/**
+ * @brief Get the current state
+ *
+ * @return uint8_t MOTION_STATIONARY, MOTION_MOVING or MOTION_PARKED
+ */
+uint8_t motion_state_get(void)
+{
+	return motion_state;
+}
+
+/**
+ * @brief Get the name of the current state
+ *
+ */
+const char *motion_state_name(void)
+{
+	return motion_state_names[motion_state];
+}
+
+/**
+ * @brief Check if the state changed since the last call
+ *
+ * @return true if the state changed and should be reported in the next uplink
+ */
+bool motion_state_changed(void)
+{
+	bool changed = motion_changed;
+	motion_changed = false;
+	return changed;
+}
+
+/**
+ * @brief Get the send interval for the current state
+ *
+ * @return uint32_t send interval in ms
+ */
+uint32_t motion_state_interval(void)
+{
+	uint32_t interval = g_lorawan_settings.send_repeat_time;
+	switch (motion_state)
+	{
+	case MOTION_MOVING:
+		interval = interval / MOTION_MOVING_DIVIDER;
+		if (interval < MOTION_MOVING_MIN)
+		{
+			interval = MOTION_MOVING_MIN;
+		}
+		// Never longer than the configured interval
+		if (interval > g_lorawan_settings.send_repeat_time)
+		{
+			interval = g_lorawan_settings.send_repeat_time;
+		}
+		break;
+	case MOTION_PARKED:
+		if (interval > MOTION_PARKED_MAX / MOTION_PARKED_FACTOR)
+		{
+			interval = interval > MOTION_PARKED_MAX ? interval : MOTION_PARKED_MAX;
+		}
+		else
+		{
+			interval = interval * MOTION_PARKED_FACTOR;
+		}
+		break;
+	}
+	return interval;
+}
@@ -0,0 +1,461 @@
+/**
+ * @file settings_store.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Flash records of the Blues settings
+ * 		The settings are written as a record with a header (schema version, sequence number,
+ * 		length, CRC) and one tag-length-value entry per setting. Two files are used in turn,
+ * 		a new record is written into the file that does not have the newest record. A record
+ * 		that was cut by a power failure fails the CRC check and the older record is used.
+ * 		Unknown tags are skipped and missing tags keep their default, so fields can be added
+ * 		without losing the saved settings. The old BLUES file with the raw structure is
+ * 		converted once. Changes are written after SETTINGS_SAVE_DELAY ms without another
+ * 		change, a burst of AT commands is written once.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#ifdef NRF52_SERIES
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Filenames of the two record slots */
+static const char *settings_file_names[2] = {"BSET0", "BSET1"};
+
+/** Filename of the raw structure of older firmware */
+static const char legacy_file_name[] = "BLUES";
+
+/** Starts the write after the last change */
+static SoftwareTimer settings_timer;
+#endif
+
+/** Marker of a settings record */
+#define SETTINGS_MAGIC 0x5354
+/** Schema version, records of older versions are written again in this version */
+#define SETTINGS_VERSION 1
+/** Largest record, two strings of 255 characters and the other fields */
+#define SETTINGS_RECORD_MAX 600
+
+/** Tags of the settings, never reuse or change the number of a tag */
+enum settings_tags
+{
+	TAG_PRODUCT_UID = 1,
+	TAG_CONN_CONTINOUS,
+	TAG_SIM_USAGE,
+	TAG_EXT_SIM_APN,
+	TAG_MOTION_TRIGGER,
+	TAG_SYNC_COUNT,
+	TAG_SYNC_AGE,
+	TAG_SYNC_PRIORITY,
+	TAG_DEADBAND,
+	TAG_KEEPALIVE,
+	TAG_PAYLOAD_FORMAT,
+	TAG_TRACK_FIXES,
+	TAG_DIAG_INTERVAL,
+	TAG_ENV_INTERVAL
+};
+
+/** Header of a record */
+struct s_settings_header
+{
+	uint16_t magic;
+	uint8_t version;
+	uint8_t reserved;
+	uint16_t seq;
+	uint16_t len;
+	uint16_t crc;
+};
+
+/** Setting of a tag, strings are stored without the terminating 0 */
+struct s_settings_field
+{
+	uint8_t tag;
+	bool string;
+	uint16_t offset;
+	uint16_t size;
+};
+
+/** Settings in the records */
+static const s_settings_field settings_fields[] = {
+	{TAG_PRODUCT_UID, true, offsetof(s_blues_settings, product_uid), sizeof(s_blues_settings::product_uid)},
+	{TAG_CONN_CONTINOUS, false, offsetof(s_blues_settings, conn_continous), sizeof(s_blues_settings::conn_continous)},
+	{TAG_SIM_USAGE, false, offsetof(s_blues_settings, sim_usage), sizeof(s_blues_settings::sim_usage)},
+	{TAG_EXT_SIM_APN, true, offsetof(s_blues_settings, ext_sim_apn), sizeof(s_blues_settings::ext_sim_apn)},
+	{TAG_MOTION_TRIGGER, false, offsetof(s_blues_settings, motion_trigger), sizeof(s_blues_settings::motion_trigger)},
+	{TAG_SYNC_COUNT, false, offsetof(s_blues_settings, sync_count), sizeof(s_blues_settings::sync_count)},
+	{TAG_SYNC_AGE, false, offsetof(s_blues_settings, sync_age), sizeof(s_blues_settings::sync_age)},
+	{TAG_SYNC_PRIORITY, false, offsetof(s_blues_settings, sync_priority), sizeof(s_blues_settings::sync_priority)},
+	{TAG_DEADBAND, false, offsetof(s_blues_settings, deadband), sizeof(s_blues_settings::deadband)},
+	{TAG_KEEPALIVE, false, offsetof(s_blues_settings, keepalive), sizeof(s_blues_settings::keepalive)},
+	{TAG_PAYLOAD_FORMAT, false, offsetof(s_blues_settings, payload_format), sizeof(s_blues_settings::payload_format)},
+	{TAG_TRACK_FIXES, false, offsetof(s_blues_settings, track_fixes), sizeof(s_blues_settings::track_fixes)},
+	{TAG_DIAG_INTERVAL, false, offsetof(s_blues_settings, diag_interval), sizeof(s_blues_settings::diag_interval)},
+	{TAG_ENV_INTERVAL, false, offsetof(s_blues_settings, env_interval), sizeof(s_blues_settings::env_interval)},
+};
+
+/** Number of settings in the records */
+#define SETTINGS_FIELDS (sizeof(settings_fields) / sizeof(s_settings_field))
+
+/** Buffer for a record */
+static uint8_t settings_record[SETTINGS_RECORD_MAX];
+
+/** Slot of the newest record, -1 if there is none */
+static int8_t settings_slot = -1;
+
+/** CRC of the entries of the newest record */
+static uint16_t settings_crc = 0;
+
+/** Flag if g_blues_settings has changes that are not written */
+static bool settings_dirty = false;
+
+/** Counters of the settings store */
+static s_settings_stats settings_data;
+
+/**
+ * @brief CRC over the header without the CRC field and the entries
+ *
+ */
+static uint16_t settings_record_crc(const s_settings_header *header, const uint8_t *data)
+{
+	uint16_t crc = crc16_ccitt(0xFFFF, (const uint8_t *)header, offsetof(s_settings_header, crc));
+	return crc16_ccitt(crc, data, header->len);
+}
+
+/**
+ * @brief Write the settings as tag-length-value entries behind the header
+ *
+ * @param settings settings to write
+ * @return uint16_t length of the entries
+ */
+static uint16_t settings_encode(const s_blues_settings *settings)
+{
+	uint8_t *entry = &settings_record[sizeof(s_settings_header)];
+	for (uint8_t idx = 0; idx < SETTINGS_FIELDS; idx++)
+	{
+		const s_settings_field *field = &settings_fields[idx];
+		const uint8_t *value = (const uint8_t *)settings + field->offset;
+		uint8_t len = field->string ? (uint8_t)strnlen((const char *)value, field->size - 1) : (uint8_t)field->size;
+		*entry++ = field->tag;
+		*entry++ = len;
+		memcpy(entry, value, len);
+		entry += len;
+	}
+	return (uint16_t)(entry - &settings_record[sizeof(s_settings_header)]);
+}
+
+/**
+ * @brief Set the settings from the tag-length-value entries, unknown tags are skipped
+ *
+ * @param settings settings to set, fields without a tag keep their value
+ * @param data entries
+ * @param len length of the entries
+ */
+static void settings_decode(s_blues_settings *settings, const uint8_t *data, uint16_t len)
+{
+	uint16_t pos = 0;
+	while ((pos + 2) <= len)
+	{
+		uint8_t tag = data[pos];
+		uint8_t entry_len = data[pos + 1];
+		pos += 2;
+		if ((pos + entry_len) > len)
+		{
+			break;
+		}
+		for (uint8_t idx = 0; idx < SETTINGS_FIELDS; idx++)
+		{
+			const s_settings_field *field = &settings_fields[idx];
+			if (field->tag != tag)
+			{
+				continue;
+			}
+			uint8_t *value = (uint8_t *)settings + field->offset;
+			if (field->string && (entry_len < field->size))
+			{
+				memcpy(value, &data[pos], entry_len);
+				value[entry_len] = 0;
+			}
+			else if (!field->string && (entry_len == field->size))
+			{
+				memcpy(value, &data[pos], entry_len);
+			}
+			break;
+		}
+		pos += entry_len;
+	}
+}
+
+#ifdef NRF52_SERIES
+/**
+ * @brief Read and check the record of a slot into settings_record
+ *
+ * @param slot 0 or 1
+ * @param header returns the header of the record
+ * @return true if the record is valid
+ */
+static bool settings_load_slot(uint8_t slot, s_settings_header *header)
+{
+	File settings_file(InternalFS);
+	if (!settings_file.open(settings_file_names[slot], FILE_O_READ))
+	{
+		return false;
+	}
+	bool valid = (settings_file.read((void *)header, sizeof(s_settings_header)) == sizeof(s_settings_header)) &&
+				 (header->magic == SETTINGS_MAGIC) && (header->len <= (SETTINGS_RECORD_MAX - sizeof(s_settings_header))) &&
+				 (settings_file.read((void *)&settings_record[sizeof(s_settings_header)], header->len) == header->len) &&
+				 (settings_record_crc(header, &settings_record[sizeof(s_settings_header)]) == header->crc);
+	settings_file.close();
+	if (!valid)
+	{
+		MYLOG("SET", "Settings record %d is invalid", slot);
+	}
+	return valid;
+}
+
+/**
+ * @brief Convert the raw structure of older firmware, older versions saved fewer fields
+ *
+ * @param settings returns the settings
+ * @return true if the old file had valid settings
+ */
+static bool settings_migrate(s_blues_settings *settings)
+{
+	File legacy_file(InternalFS);
+	if (!legacy_file.open(legacy_file_name, FILE_O_READ))
+	{
+		return false;
+	}
+	s_legacy_settings legacy;
+	uint32_t file_len = legacy_file.size();
+	int len = legacy_file.read((void *)&legacy, sizeof(s_legacy_settings));
+	legacy_file.close();
+	// The file holds the complete structure including its padding, nothing else is valid
+	if ((file_len != sizeof(s_legacy_settings)) || (len != (int)sizeof(s_legacy_settings)) || (legacy.valid_mark != 0xAA55))
+	{
+		MYLOG("SET", "Old settings file is invalid, %ld bytes", (long)file_len);
+		return false;
+	}
+	// Only the fields of the first version are copied, the newer fields keep their default
+	s_blues_settings converted;
+	memcpy(converted.product_uid, legacy.product_uid, sizeof(converted.product_uid));
+	converted.product_uid[sizeof(converted.product_uid) - 1] = 0;
+	converted.conn_continous = legacy.conn_continous;
+	converted.sim_usage = legacy.sim_usage;
+	memcpy(converted.ext_sim_apn, legacy.ext_sim_apn, sizeof(converted.ext_sim_apn));
+	converted.ext_sim_apn[sizeof(converted.ext_sim_apn) - 1] = 0;
+	converted.motion_trigger = legacy.motion_trigger;
+	*settings = converted;
+	MYLOG("SET", "Converted %d bytes of old settings", len);
+	return true;
+}
+#endif
+
+/**
+ * @brief Write the record into the slot without the newest record
+ *        A failed write keeps the settings pending, the next flush tries again
+ *
+ * @param settings settings to write
+ * @return true if the record was written or is unchanged
+ */
+static bool settings_write(const s_blues_settings *settings)
+{
+	s_settings_header header;
+	header.magic = SETTINGS_MAGIC;
+	header.version = SETTINGS_VERSION;
+	header.reserved = 0;
+	header.seq = settings_data.seq + 1;
+	header.len = settings_encode(settings);
+	header.crc = settings_record_crc(&header, &settings_record[sizeof(s_settings_header)]);
+	uint16_t entries_crc = crc16_ccitt(0xFFFF, &settings_record[sizeof(s_settings_header)], header.len);
+	if ((settings_slot >= 0) && (entries_crc == settings_crc) && ((sizeof(s_settings_header) + header.len) == settings_data.size))
+	{
+		// Same entries as the newest record, nothing to write
+		settings_dirty = false;
+		settings_data.unchanged++;
+		return true;
+	}
+	memcpy(settings_record, &header, sizeof(s_settings_header));
+	uint8_t slot = settings_slot == 0 ? 1 : 0;
+#ifdef NRF52_SERIES
+	if (InternalFS.exists(settings_file_names[slot]))
+	{
+		InternalFS.remove(settings_file_names[slot]);
+	}
+	File settings_file(InternalFS);
+	bool written = settings_file.open(settings_file_names[slot], FILE_O_WRITE) &&
+				   (settings_file.write(settings_record, sizeof(s_settings_header) + header.len) == (sizeof(s_settings_header) + header.len));
+	settings_file.close();
+	if (!written)
+	{
+		// A cut record would fail the CRC check anyway, remove it to free the flash
+		if (InternalFS.exists(settings_file_names[slot]))
+		{
+			InternalFS.remove(settings_file_names[slot]);
+		}
+		settings_dirty = true;
+		settings_data.failed++;
+		MYLOG("SET", "Failed to write settings record %d in slot %d", header.seq, slot);
+		return false;
+	}
+	MYLOG("SET", "Saved settings record %d in slot %d, %d bytes", header.seq, slot, (int)(sizeof(s_settings_header) + header.len));
+	// A converted old file is removed only after its settings are in a record
+	if (InternalFS.exists(legacy_file_name))
+	{
+		InternalFS.remove(legacy_file_name);
+	}
+#endif
+	settings_dirty = false;
+	settings_slot = slot;
+	settings_crc = entries_crc;
+	settings_data.seq = header.seq;
+	settings_data.size = sizeof(s_settings_header) + header.len;
+	settings_data.writes++;
+	return true;
+}
+
+/**
+ * @brief Read the newest valid record, converts the old settings file if there is no record
+ *
+ * @param settings returns the settings, fields without a saved value keep their default
+ * @return true if saved settings were found
+ */
+bool settings_read(s_blues_settings *settings)
+{
+#ifdef NRF52_SERIES
+	s_settings_header headers[2];
+	bool valid[2];
+	valid[0] = settings_load_slot(0, &headers[0]);
+	valid[1] = settings_load_slot(1, &headers[1]);
+	settings_slot = -1;
+	if (valid[0] && valid[1])
+	{
+		// Newer sequence number, works across the wrap around
+		settings_slot = (int16_t)(headers[1].seq - headers[0].seq) > 0 ? 1 : 0;
+	}
+	else if (valid[0] || valid[1])
+	{
+		settings_slot = valid[0] ? 0 : 1;
+	}
+
+	if (settings_slot < 0)
+	{
+		if (!settings_migrate(settings))
+		{
+			return false;
+		}
+		// Write the record now, a failed write is tried again with the next flush
+		settings_data.migrated = true;
+		settings_write(settings);
+		return true;
+	}
+
+	// Only the newest record is in the buffer after reading both slots
+	s_settings_header *header = &headers[settings_slot];
+	if (!settings_load_slot(settings_slot, header))
+	{
+		return false;
+	}
+	settings_decode(settings, &settings_record[sizeof(s_settings_header)], header->len);
+	settings->valid_mark = 0xAA55;
+	settings_crc = crc16_ccitt(0xFFFF, &settings_record[sizeof(s_settings_header)], header->len);
+	settings_data.seq = header->seq;
+	settings_data.size = sizeof(s_settings_header) + header->len;
+	if (header->version != SETTINGS_VERSION)
+	{
+		MYLOG("SET", "Settings version %d, write version %d", header->version, SETTINGS_VERSION);
+		settings_write(settings);
+	}
+	return true;
+#endif
+#ifdef ESP32
+	// The ESP32 keeps the settings in Preferences
+	(void)settings;
+	return false;
+#endif
+}
+
+#ifdef NRF52_SERIES
+/**
+ * @brief Timer callback, posts SETTINGS_SAVE to write the settings in the loop
+ *
+ */
+static void settings_timeout(TimerHandle_t unused)
+{
+	(void)unused;
+	app_event_post(SETTINGS_SAVE);
+}
+#endif
+
+/**
+ * @brief Request a write of g_blues_settings, each request restarts the delay
+ *
+ */
+void settings_save(void)
+{
+	settings_data.requests++;
+	settings_dirty = true;
+#ifdef NRF52_SERIES
+	static bool timer_ready = false;
+	if (!timer_ready)
+	{
+		settings_timer.begin(SETTINGS_SAVE_DELAY, settings_timeout, NULL, false);
+		timer_ready = true;
+	}
+	settings_timer.start();
+#endif
+}
+
+/**
+ * @brief Write g_blues_settings if it has changes that are not written
+ *
+ */
+void settings_flush(void)
+{
+	if (!settings_dirty)
+	{
+		return;
+	}
+#ifdef NRF52_SERIES
+	settings_timer.stop();
+#endif
+	settings_write(&g_blues_settings);
+}
+
+/**
+ * @brief Remove the records and the old settings file
+ *
+ */
+void settings_remove(void)
+{
+#ifdef NRF52_SERIES
+	settings_timer.stop();
+	for (uint8_t slot = 0; slot < 2; slot++)
+	{
+		if (InternalFS.exists(settings_file_names[slot]))
+		{
+			InternalFS.remove(settings_file_names[slot]);
+		}
+	}
+	if (InternalFS.exists(legacy_file_name))
+	{
+		InternalFS.remove(legacy_file_name);
+	}
+#endif
+	settings_dirty = false;
+	settings_slot = -1;
+	settings_data.size = 0;
+}
+
+/**
+ * @brief Get the counters of the settings store
+ *
+ * @return s_settings_stats* counters
+ */
+s_settings_stats *settings_stats(void)
+{
+	return &settings_data;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file track_batch.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Collect the GNSS fixes while moving and send them together in one track record.
+ * 		The newest fix is sent with the status values, the older fixes as differences.
+ * 		The track is sent when it has the configured number of fixes or when the next fix
+ * 		might not fit into the maximum payload of the current datarate.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Room kept for the difference of the next fix, 3 bytes each for time, latitude and longitude + margin */
+#define TRACK_DELTA_RESERVE 12
+
+/** Fixes waiting for the next uplink, oldest first */
+static s_track_fix track_list[PAYLOAD_TRACK_MAX];
+
+/** Number of waiting fixes */
+static uint8_t track_count = 0;
+
+/** Size of the differences between the waiting fixes */
+static uint16_t track_size = 0;
+
+/** Counters of the track batching */
+static s_track_stats track_stats_data;
+
+/**
+ * @brief Check if an uplink with a position should be sent or if the fix is added to the track
+ * 		If the uplink is sent, the waiting fixes are added to it as track record
+ *
+ * @param position new position
+ * @param forced true to send in any case, e.g. for a motion state change
+ * @return true if the uplink should be sent
+ * @return false if the fix was added to the track, the uplink is skipped
+ */
+bool track_report(s_position *position, bool forced)
+{
+	s_track_fix fix = {position->lat / 10, position->lon / 10, position->time};
+	uint8_t max_fixes = g_blues_settings.track_fixes > PAYLOAD_TRACK_MAX ? PAYLOAD_TRACK_MAX : g_blues_settings.track_fixes;
+	bool batch = (max_fixes > 1) && (g_solution_data.getFormat() == PAYLOAD_COMPACT) &&
+				 (motion_state_get() == MOTION_MOVING) && !position->tower && (position->time != 0);
+	uint8_t max_size = uplink_max_payload();
+
+	if (batch && !forced && (track_count + 1 < max_fixes))
+	{
+		uint16_t delta = track_count > 0 ? payload_track_delta_size(&fix, &track_list[track_count - 1]) : 0;
+		if (g_solution_data.getSize() + PAYLOAD_TRACK_HEADER + track_size + delta + TRACK_DELTA_RESERVE <= max_size)
+		{
+			track_list[track_count++] = fix;
+			track_size += delta;
+			track_stats_data.held++;
+			MYLOG("TRACK", "Fix %d of %d added to the track", track_count, max_fixes);
+			return false;
+		}
+	}
+
+	if (track_count > 0)
+	{
+		if (position->time != 0)
+		{
+			g_solution_data.addTrack(position->time, track_list, track_count, max_size);
+			track_stats_data.tracks++;
+			MYLOG("TRACK", "Send track with %d older fixes, %d bytes", track_count, g_solution_data.getSize());
+		}
+		else
+		{
+			// Without time of the new position the differences are unknown
+			track_stats_data.dropped += track_count;
+			MYLOG("TRACK", "No time for the position, drop %d fixes", track_count);
+		}
+		track_count = 0;
+		track_size = 0;
+	}
+	return true;
+}
+
+/**
+ * @brief Get the counters of the track batching
+ *
+ * @return s_track_stats* counters
+ */
+s_track_stats *track_stats(void)
+{
+	return &track_stats_data;
+}
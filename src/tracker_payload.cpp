@@ -0,0 +1,848 @@
+/**
+ * @file tracker_payload.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Compact bit-packed payload of the tracker, replaces Cayenne LPP
+ * 		Byte 0 is 0xA0 | record type << 2 | schema version, byte 1 the map of the included fields.
+ * 		The fields follow bit-packed, MSB first, in the order of the field map.
+ * 		Field         Bits  Encoding
+ * 		Latitude      28    1e-6 degrees, signed
+ * 		Longitude     29    1e-6 degrees, signed
+ * 		Battery       8     10 mV, offset 2.50 V
+ * 		Temperature   11    0.1 °C, offset -40.0 °C
+ * 		Humidity      8     0.5 %RH
+ * 		Pressure      13    0.1 hPa, offset 300.0 hPa
+ * 		Motion        2     motion state
+ * 		Range         8     number of samples, then min, max and mean of the temperature,
+ * 		                    humidity and pressure that are in the record, in their encoding
+ * 		The tower flag has no bits, it is only the field map bit.
+ * 		A track record has the status fields of the newest fix, then byte aligned the time of the
+ * 		newest fix (4 bytes, MSB first), the number of older fixes and per older fix the zig-zag
+ * 		varint difference of time, latitude and longitude to the next newer fix.
+ * 		A diagnostic record has no field map, it has the number of values and the values as unsigned varints.
+ * 		For cellular and LoRa P2P the DevID is appended as in LPP, [channel][0xFF][4 bytes].
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#define BITS_LAT 28
+#define BITS_LON 29
+#define BITS_BATTERY 8
+#define BITS_TEMPERATURE 11
+#define BITS_HUMIDITY 8
+#define BITS_PRESSURE 13
+#define BITS_MOTION 2
+#define BITS_RANGE_COUNT 8
+
+/** Offsets of the unsigned fields, in the unit of the field */
+#define OFFSET_BATTERY 250
+#define OFFSET_TEMPERATURE 400
+#define OFFSET_PRESSURE 3000
+
+
+/** Bit position while packing or unpacking */
+struct s_bit_cursor
+{
+	uint8_t *buffer;
+	uint16_t bit;
+	uint16_t max_bits;
+};
+
+/**
+ * @brief Append a value MSB first
+ *
+ */
+static void bits_put(s_bit_cursor *cursor, uint32_t value, uint8_t bits)
+{
+	for (int8_t idx = bits - 1; idx >= 0; idx--)
+	{
+		uint8_t mask = 0x80 >> (cursor->bit & 7);
+		if ((value >> idx) & 1)
+		{
+			cursor->buffer[cursor->bit >> 3] |= mask;
+		}
+		else
+		{
+			cursor->buffer[cursor->bit >> 3] &= ~mask;
+		}
+		cursor->bit++;
+	}
+}
+
+/**
+ * @brief Read an unsigned value MSB first
+ *
+ */
+static uint32_t bits_get(s_bit_cursor *cursor, uint8_t bits)
+{
+	uint32_t value = 0;
+	for (uint8_t idx = 0; idx < bits; idx++)
+	{
+		value = (value << 1) | ((cursor->buffer[cursor->bit >> 3] >> (7 - (cursor->bit & 7))) & 1);
+		cursor->bit++;
+	}
+	return value;
+}
+
+/**
+ * @brief Read a signed value MSB first
+ *
+ */
+static int32_t bits_get_signed(s_bit_cursor *cursor, uint8_t bits)
+{
+	uint32_t value = bits_get(cursor, bits);
+	if (value & (1UL << (bits - 1)))
+	{
+		value |= ~((1UL << bits) - 1);
+	}
+	return (int32_t)value;
+}
+
+/**
+ * @brief Limit a value to the range of an unsigned field
+ *
+ */
+static uint32_t bits_clamp(int32_t value, uint8_t bits)
+{
+	if (value < 0)
+	{
+		return 0;
+	}
+	if ((uint32_t)value > (1UL << bits) - 1)
+	{
+		return (1UL << bits) - 1;
+	}
+	return (uint32_t)value;
+}
+
+/**
+ * @brief Zig-zag encoding of a difference, small negative values get small codes
+ *
+ */
+static uint32_t zigzag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * @brief Number of bytes of a varint
+ *
+ */
+static uint8_t varint_size(uint32_t value)
+{
+	uint8_t size = 1;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+/**
+ * @brief Write a varint, 7 bits per byte, LSB first, bit 7 set if more bytes follow
+ *
+ */
+static uint8_t varint_put(uint8_t *buffer, uint32_t value)
+{
+	uint8_t idx = 0;
+	while (value >= 0x80)
+	{
+		buffer[idx++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	buffer[idx++] = (uint8_t)value;
+	return idx;
+}
+
+/**
+ * @brief Read an unsigned varint
+ *
+ * @param buffer payload
+ * @param idx position in the payload, moved behind the varint
+ * @param len length of the payload
+ * @param value returns the value
+ * @return true if the varint is complete
+ */
+static bool varint_get_unsigned(const uint8_t *buffer, uint8_t *idx, uint8_t len, uint32_t *value)
+{
+	uint32_t raw = 0;
+	for (uint8_t shift = 0; shift < 35; shift += 7)
+	{
+		if (*idx >= len)
+		{
+			return false;
+		}
+		uint8_t byte = buffer[(*idx)++];
+		raw |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			*value = raw;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Read a zig-zag varint
+ *
+ * @param buffer payload
+ * @param idx position in the payload, moved behind the varint
+ * @param len length of the payload
+ * @param value returns the value
+ * @return true if the varint is complete
+ */
+static bool varint_get(const uint8_t *buffer, uint8_t *idx, uint8_t len, int32_t *value)
+{
+	uint32_t raw;
+	if (!varint_get_unsigned(buffer, idx, len, &raw))
+	{
+		return false;
+	}
+	*value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+	return true;
+}
+
+/**
+ * @brief Size of the difference between two fixes in a track record
+ *
+ * @param newer newer fix
+ * @param older older fix
+ * @return uint8_t number of bytes
+ */
+uint8_t payload_track_delta_size(const s_track_fix *newer, const s_track_fix *older)
+{
+	return varint_size(zigzag((int32_t)(newer->time - older->time))) + varint_size(zigzag(newer->lat - older->lat)) +
+		   varint_size(zigzag(newer->lon - older->lon));
+}
+
+/**
+ * @brief Number of bits of a status record
+ *
+ */
+static uint16_t payload_bits(uint16_t fields)
+{
+	uint16_t bits = 16;
+	if (fields & PAYLOAD_HAS_POSITION)
+	{
+		bits += BITS_LAT + BITS_LON;
+	}
+	if (fields & PAYLOAD_HAS_BATTERY)
+	{
+		bits += BITS_BATTERY;
+	}
+	if (fields & PAYLOAD_HAS_TEMPERATURE)
+	{
+		bits += BITS_TEMPERATURE;
+	}
+	if (fields & PAYLOAD_HAS_HUMIDITY)
+	{
+		bits += BITS_HUMIDITY;
+	}
+	if (fields & PAYLOAD_HAS_PRESSURE)
+	{
+		bits += BITS_PRESSURE;
+	}
+	if (fields & PAYLOAD_HAS_MOTION)
+	{
+		bits += BITS_MOTION;
+	}
+	if (fields & PAYLOAD_HAS_RANGE)
+	{
+		bits += BITS_RANGE_COUNT;
+		if (fields & PAYLOAD_HAS_TEMPERATURE)
+		{
+			bits += 3 * BITS_TEMPERATURE;
+		}
+		if (fields & PAYLOAD_HAS_HUMIDITY)
+		{
+			bits += 3 * BITS_HUMIDITY;
+		}
+		if (fields & PAYLOAD_HAS_PRESSURE)
+		{
+			bits += 3 * BITS_PRESSURE;
+		}
+	}
+	return bits;
+}
+
+/**
+ * @brief Encode a status or track record
+ *
+ * @param values values to encode, values out of the range of a field are limited
+ * @param buffer buffer for the record
+ * @param buf_len size of the buffer
+ * @return uint8_t length of the record, 0 if the buffer is too small
+ */
+uint8_t payload_encode(const s_payload_fields *values, uint8_t *buffer, uint8_t buf_len)
+{
+	uint16_t fields = values->fields;
+	bool track = (fields & PAYLOAD_HAS_TRACK) && (fields & PAYLOAD_HAS_POSITION);
+	uint8_t trailer = (fields & PAYLOAD_HAS_DEVID) ? 6 : 0;
+	uint8_t len = (payload_bits(fields) + 7) / 8;
+	if (track)
+	{
+		len += PAYLOAD_TRACK_HEADER;
+	}
+	if (len + trailer > buf_len)
+	{
+		return 0;
+	}
+
+	s_bit_cursor cursor = {buffer, 0, (uint16_t)(buf_len * 8)};
+	memset(buffer, 0, len);
+	bits_put(&cursor, PAYLOAD_MARKER | ((track ? PAYLOAD_RECORD_TRACK : PAYLOAD_RECORD_STATUS) << 2) | PAYLOAD_VERSION, 8);
+	bits_put(&cursor, fields & 0xFF, 8);
+	if (fields & PAYLOAD_HAS_POSITION)
+	{
+		bits_put(&cursor, (uint32_t)values->lat, BITS_LAT);
+		bits_put(&cursor, (uint32_t)values->lon, BITS_LON);
+	}
+	if (fields & PAYLOAD_HAS_BATTERY)
+	{
+		bits_put(&cursor, bits_clamp((int32_t)values->battery - OFFSET_BATTERY, BITS_BATTERY), BITS_BATTERY);
+	}
+	if (fields & PAYLOAD_HAS_TEMPERATURE)
+	{
+		bits_put(&cursor, bits_clamp((int32_t)values->temperature + OFFSET_TEMPERATURE, BITS_TEMPERATURE), BITS_TEMPERATURE);
+	}
+	if (fields & PAYLOAD_HAS_HUMIDITY)
+	{
+		bits_put(&cursor, values->humidity, BITS_HUMIDITY);
+	}
+	if (fields & PAYLOAD_HAS_PRESSURE)
+	{
+		bits_put(&cursor, bits_clamp((int32_t)values->pressure - OFFSET_PRESSURE, BITS_PRESSURE), BITS_PRESSURE);
+	}
+	if (fields & PAYLOAD_HAS_MOTION)
+	{
+		bits_put(&cursor, values->motion, BITS_MOTION);
+	}
+	if (fields & PAYLOAD_HAS_RANGE)
+	{
+		bits_put(&cursor, values->range_count, BITS_RANGE_COUNT);
+		for (uint8_t idx = 0; (idx < 3) && (fields & PAYLOAD_HAS_TEMPERATURE); idx++)
+		{
+			bits_put(&cursor, bits_clamp((int32_t)values->temperature_range[idx] + OFFSET_TEMPERATURE, BITS_TEMPERATURE), BITS_TEMPERATURE);
+		}
+		for (uint8_t idx = 0; (idx < 3) && (fields & PAYLOAD_HAS_HUMIDITY); idx++)
+		{
+			bits_put(&cursor, values->humidity_range[idx], BITS_HUMIDITY);
+		}
+		for (uint8_t idx = 0; (idx < 3) && (fields & PAYLOAD_HAS_PRESSURE); idx++)
+		{
+			bits_put(&cursor, bits_clamp((int32_t)values->pressure_range[idx] - OFFSET_PRESSURE, BITS_PRESSURE), BITS_PRESSURE);
+		}
+	}
+	uint8_t idx = (cursor.bit + 7) / 8;
+
+	if (track)
+	{
+		// Older fixes that do not fit are dropped
+		uint8_t limit = buf_len - trailer;
+		if ((values->max_size != 0) && (values->max_size < limit))
+		{
+			limit = values->max_size;
+		}
+		buffer[idx++] = (uint8_t)(values->time >> 24);
+		buffer[idx++] = (uint8_t)(values->time >> 16);
+		buffer[idx++] = (uint8_t)(values->time >> 8);
+		buffer[idx++] = (uint8_t)values->time;
+		uint8_t count_idx = idx++;
+		uint8_t count = 0;
+		s_track_fix newer = {values->lat, values->lon, values->time};
+		while ((count < values->track_count) && (count < PAYLOAD_TRACK_MAX))
+		{
+			const s_track_fix *older = &values->track[count];
+			if (idx + payload_track_delta_size(&newer, older) > limit)
+			{
+				break;
+			}
+			idx += varint_put(&buffer[idx], zigzag((int32_t)(newer.time - older->time)));
+			idx += varint_put(&buffer[idx], zigzag(newer.lat - older->lat));
+			idx += varint_put(&buffer[idx], zigzag(newer.lon - older->lon));
+			newer = *older;
+			count++;
+		}
+		buffer[count_idx] = count;
+	}
+
+	if (fields & PAYLOAD_HAS_DEVID)
+	{
+		buffer[idx++] = 0;
+		buffer[idx++] = LPP_DEVID;
+		memcpy(&buffer[idx], values->dev_id, 4);
+		idx += 4;
+	}
+	return idx;
+}
+
+/**
+ * @brief Decode a status or track record, reference for the decoder in Decoder.js
+ *
+ * @param buffer received payload
+ * @param len length of the payload
+ * @param values returns the values
+ * @return true if the payload is a complete record of a known type and version
+ */
+bool payload_decode(const uint8_t *buffer, uint8_t len, s_payload_fields *values)
+{
+	memset(values, 0, sizeof(s_payload_fields));
+	if (len < 2)
+	{
+		return false;
+	}
+	bool track;
+	if (buffer[0] == (PAYLOAD_MARKER | (PAYLOAD_RECORD_STATUS << 2) | PAYLOAD_VERSION))
+	{
+		track = false;
+	}
+	else if (buffer[0] == (PAYLOAD_MARKER | (PAYLOAD_RECORD_TRACK << 2) | PAYLOAD_VERSION))
+	{
+		track = true;
+	}
+	else
+	{
+		return false;
+	}
+	uint16_t fields = buffer[1];
+	uint16_t bits = payload_bits(fields);
+	if ((bits > len * 8) || (track && !(fields & PAYLOAD_HAS_POSITION)))
+	{
+		return false;
+	}
+
+	s_bit_cursor cursor = {(uint8_t *)buffer, 16, (uint16_t)(len * 8)};
+	if (fields & PAYLOAD_HAS_POSITION)
+	{
+		values->lat = bits_get_signed(&cursor, BITS_LAT);
+		values->lon = bits_get_signed(&cursor, BITS_LON);
+	}
+	if (fields & PAYLOAD_HAS_BATTERY)
+	{
+		values->battery = bits_get(&cursor, BITS_BATTERY) + OFFSET_BATTERY;
+	}
+	if (fields & PAYLOAD_HAS_TEMPERATURE)
+	{
+		values->temperature = (int16_t)bits_get(&cursor, BITS_TEMPERATURE) - OFFSET_TEMPERATURE;
+	}
+	if (fields & PAYLOAD_HAS_HUMIDITY)
+	{
+		values->humidity = bits_get(&cursor, BITS_HUMIDITY);
+	}
+	if (fields & PAYLOAD_HAS_PRESSURE)
+	{
+		values->pressure = bits_get(&cursor, BITS_PRESSURE) + OFFSET_PRESSURE;
+	}
+	if (fields & PAYLOAD_HAS_MOTION)
+	{
+		values->motion = bits_get(&cursor, BITS_MOTION);
+	}
+	if (fields & PAYLOAD_HAS_RANGE)
+	{
+		values->range_count = bits_get(&cursor, BITS_RANGE_COUNT);
+		for (uint8_t idx = 0; (idx < 3) && (fields & PAYLOAD_HAS_TEMPERATURE); idx++)
+		{
+			values->temperature_range[idx] = (int16_t)bits_get(&cursor, BITS_TEMPERATURE) - OFFSET_TEMPERATURE;
+		}
+		for (uint8_t idx = 0; (idx < 3) && (fields & PAYLOAD_HAS_HUMIDITY); idx++)
+		{
+			values->humidity_range[idx] = bits_get(&cursor, BITS_HUMIDITY);
+		}
+		for (uint8_t idx = 0; (idx < 3) && (fields & PAYLOAD_HAS_PRESSURE); idx++)
+		{
+			values->pressure_range[idx] = bits_get(&cursor, BITS_PRESSURE) + OFFSET_PRESSURE;
+		}
+	}
+	uint8_t idx = (cursor.bit + 7) / 8;
+
+	if (track)
+	{
+		if (len < idx + PAYLOAD_TRACK_HEADER)
+		{
+			return false;
+		}
+		values->time = ((uint32_t)buffer[idx] << 24) | ((uint32_t)buffer[idx + 1] << 16) | ((uint32_t)buffer[idx + 2] << 8) | buffer[idx + 3];
+		uint8_t count = buffer[idx + 4];
+		idx += PAYLOAD_TRACK_HEADER;
+		if (count > PAYLOAD_TRACK_MAX)
+		{
+			return false;
+		}
+		s_track_fix newer = {values->lat, values->lon, values->time};
+		for (uint8_t fix = 0; fix < count; fix++)
+		{
+			int32_t d_time;
+			int32_t d_lat;
+			int32_t d_lon;
+			if (!varint_get(buffer, &idx, len, &d_time) || !varint_get(buffer, &idx, len, &d_lat) || !varint_get(buffer, &idx, len, &d_lon))
+			{
+				return false;
+			}
+			newer.time -= d_time;
+			newer.lat -= d_lat;
+			newer.lon -= d_lon;
+			values->track[fix] = newer;
+		}
+		values->track_count = count;
+		fields |= PAYLOAD_HAS_TRACK;
+	}
+
+	// DevID appended for cellular and LoRa P2P
+	if ((len - idx == 6) && (buffer[idx + 1] == LPP_DEVID))
+	{
+		memcpy(values->dev_id, &buffer[idx + 2], 4);
+		fields |= PAYLOAD_HAS_DEVID;
+	}
+	else if (len != idx)
+	{
+		return false;
+	}
+	values->fields = fields;
+	return true;
+}
+
+/**
+ * @brief Encode a diagnostic record, the number of values and the values as unsigned varints
+ *
+ * @param values values to encode
+ * @param count number of values
+ * @param buffer buffer for the record
+ * @param buf_len size of the buffer
+ * @return uint8_t length of the record, 0 if the buffer is too small
+ */
+uint8_t payload_encode_diag(const uint32_t *values, uint8_t count, uint8_t *buffer, uint8_t buf_len)
+{
+	uint16_t len = 2;
+	for (uint8_t value = 0; value < count; value++)
+	{
+		len += varint_size(values[value]);
+	}
+	if (len > buf_len)
+	{
+		return 0;
+	}
+	uint8_t idx = 0;
+	buffer[idx++] = PAYLOAD_MARKER | (PAYLOAD_RECORD_DIAG << 2) | PAYLOAD_VERSION;
+	buffer[idx++] = count;
+	for (uint8_t value = 0; value < count; value++)
+	{
+		idx += varint_put(&buffer[idx], values[value]);
+	}
+	return idx;
+}
+
+/**
+ * @brief Decode a diagnostic record, an appended DevID is skipped
+ *
+ * @param buffer received payload
+ * @param len length of the payload
+ * @param values returns the values
+ * @param max_count size of the values array
+ * @return uint8_t number of values, 0 if the payload is not a diagnostic record
+ */
+uint8_t payload_decode_diag(const uint8_t *buffer, uint8_t len, uint32_t *values, uint8_t max_count)
+{
+	if ((len < 2) || (buffer[0] != (PAYLOAD_MARKER | (PAYLOAD_RECORD_DIAG << 2) | PAYLOAD_VERSION)) || (buffer[1] > max_count))
+	{
+		return 0;
+	}
+	uint8_t count = buffer[1];
+	uint8_t idx = 2;
+	for (uint8_t value = 0; value < count; value++)
+	{
+		if (!varint_get_unsigned(buffer, &idx, len, &values[value]))
+		{
+			return 0;
+		}
+	}
+	if ((len != idx) && ((len - idx != 6) || (buffer[idx + 1] != LPP_DEVID)))
+	{
+		return 0;
+	}
+	return count;
+}
+
+TrackerPayload::TrackerPayload(uint8_t size) : _lpp(size)
+{
+	_format = PAYLOAD_LPP;
+	reset();
+}
+
+/**
+ * @brief Select the payload format, the payload is cleared
+ *
+ * @param format PAYLOAD_LPP or PAYLOAD_COMPACT
+ */
+void TrackerPayload::setFormat(uint8_t format)
+{
+	_format = format;
+	reset();
+}
+
+uint8_t TrackerPayload::getFormat(void)
+{
+	return _format;
+}
+
+void TrackerPayload::reset(void)
+{
+	_lpp.reset();
+	memset(&_values, 0, sizeof(s_payload_fields));
+	_size = 0;
+	_encoded = false;
+}
+
+void TrackerPayload::encode(void)
+{
+	if (!_encoded)
+	{
+		_size = payload_encode(&_values, _buffer, sizeof(_buffer));
+		if ((_size != 0) && (_values.fields & PAYLOAD_HAS_DEVID))
+		{
+			_buffer[_size - 6] = _devid_channel;
+		}
+		_encoded = true;
+	}
+}
+
+uint8_t TrackerPayload::getSize(void)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.getSize();
+	}
+	encode();
+	return _size;
+}
+
+uint8_t *TrackerPayload::getBuffer(void)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.getBuffer();
+	}
+	encode();
+	return _buffer;
+}
+
+uint8_t TrackerPayload::addDigitalInput(uint8_t channel, uint32_t value)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addDigitalInput(channel, value);
+	}
+	if (channel != LPP_CHANNEL_MOTION)
+	{
+		return 0;
+	}
+	_values.motion = value;
+	_values.fields |= PAYLOAD_HAS_MOTION;
+	_encoded = false;
+	return getSize();
+}
+
+uint8_t TrackerPayload::addPresence(uint8_t channel, uint32_t value)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addPresence(channel, value);
+	}
+	if (channel != LPP_CHANNEL_GPS_TOWER)
+	{
+		return 0;
+	}
+	// The tower flag is part of the field map
+	if (value)
+	{
+		_values.fields |= PAYLOAD_HAS_TOWER;
+	}
+	else
+	{
+		_values.fields &= ~PAYLOAD_HAS_TOWER;
+	}
+	_encoded = false;
+	return getSize();
+}
+
+uint8_t TrackerPayload::addTemperature(uint8_t channel, float celsius)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addTemperature(channel, celsius);
+	}
+	_values.temperature = (int16_t)lroundf(celsius * 10);
+	_values.fields |= PAYLOAD_HAS_TEMPERATURE;
+	_encoded = false;
+	return getSize();
+}
+
+uint8_t TrackerPayload::addRelativeHumidity(uint8_t channel, float rh)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addRelativeHumidity(channel, rh);
+	}
+	_values.humidity = (uint8_t)lroundf(rh * 2);
+	_values.fields |= PAYLOAD_HAS_HUMIDITY;
+	_encoded = false;
+	return getSize();
+}
+
+uint8_t TrackerPayload::addBarometricPressure(uint8_t channel, float hpa)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addBarometricPressure(channel, hpa);
+	}
+	_values.pressure = (uint16_t)lroundf(hpa * 10);
+	_values.fields |= PAYLOAD_HAS_PRESSURE;
+	_encoded = false;
+	return getSize();
+}
+
+uint8_t TrackerPayload::addVoltage(uint8_t channel, float voltage)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addVoltage(channel, voltage);
+	}
+	_values.battery = (uint16_t)lroundf(voltage * 100);
+	_values.fields |= PAYLOAD_HAS_BATTERY;
+	_encoded = false;
+	return getSize();
+}
+
+uint8_t TrackerPayload::addGNSS_6(uint8_t channel, int32_t latitude, int32_t longitude, int32_t altitude)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addGNSS_6(channel, latitude, longitude, altitude);
+	}
+	// Same resolution as LPP, the altitude is not sent
+	_values.lat = latitude / 10;
+	_values.lon = longitude / 10;
+	_values.fields |= PAYLOAD_HAS_POSITION;
+	_encoded = false;
+	return getSize();
+}
+
+uint8_t TrackerPayload::addDevID(uint8_t channel, uint8_t *dev_id)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addDevID(channel, dev_id);
+	}
+	memcpy(_values.dev_id, dev_id, 4);
+	_devid_channel = channel;
+	_values.fields |= PAYLOAD_HAS_DEVID;
+	_encoded = false;
+	return getSize();
+}
+
+/**
+ * @brief Add the number of samples of the aggregates
+ * 		In the compact format the count is part of the range field
+ *
+ * @param channel LPP channel of the count
+ * @param count number of samples, limited to 255
+ */
+uint8_t TrackerPayload::addSampleCount(uint8_t channel, uint16_t count)
+{
+	count = count > 255 ? 255 : count;
+	if (_format == PAYLOAD_LPP)
+	{
+		return _lpp.addDigitalInput(channel, count);
+	}
+	_values.range_count = count;
+	_values.fields |= PAYLOAD_HAS_RANGE;
+	_encoded = false;
+	return getSize();
+}
+
+/**
+ * @brief Add min, max and mean of the samples of a RAK1906 channel
+ * 		In LPP each value has its own channel
+ *
+ * @param channel LPP channel of the value, LPP_CHANNEL_TEMP_2, LPP_CHANNEL_HUMID_2 or LPP_CHANNEL_PRESS_2
+ */
+uint8_t TrackerPayload::addRange(uint8_t channel, float min, float max, float mean)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		switch (channel)
+		{
+		case LPP_CHANNEL_TEMP_2:
+			_lpp.addTemperature(LPP_CHANNEL_TEMP_2_MIN, min);
+			_lpp.addTemperature(LPP_CHANNEL_TEMP_2_MAX, max);
+			return _lpp.addTemperature(LPP_CHANNEL_TEMP_2_MEAN, mean);
+		case LPP_CHANNEL_HUMID_2:
+			_lpp.addRelativeHumidity(LPP_CHANNEL_HUMID_2_MIN, min);
+			_lpp.addRelativeHumidity(LPP_CHANNEL_HUMID_2_MAX, max);
+			return _lpp.addRelativeHumidity(LPP_CHANNEL_HUMID_2_MEAN, mean);
+		case LPP_CHANNEL_PRESS_2:
+			_lpp.addBarometricPressure(LPP_CHANNEL_PRESS_2_MIN, min);
+			_lpp.addBarometricPressure(LPP_CHANNEL_PRESS_2_MAX, max);
+			return _lpp.addBarometricPressure(LPP_CHANNEL_PRESS_2_MEAN, mean);
+		default:
+			return 0;
+		}
+	}
+	float range[3] = {min, max, mean};
+	for (uint8_t idx = 0; idx < 3; idx++)
+	{
+		switch (channel)
+		{
+		case LPP_CHANNEL_TEMP_2:
+			_values.temperature_range[idx] = (int16_t)lroundf(range[idx] * 10);
+			break;
+		case LPP_CHANNEL_HUMID_2:
+			_values.humidity_range[idx] = (uint8_t)lroundf(range[idx] * 2);
+			break;
+		case LPP_CHANNEL_PRESS_2:
+			_values.pressure_range[idx] = (uint16_t)lroundf(range[idx] * 10);
+			break;
+		default:
+			return 0;
+		}
+	}
+	_encoded = false;
+	return getSize();
+}
+
+/**
+ * @brief Send a track record, the older fixes are added behind the newest position
+ * 		Only in the compact format, LPP has no track
+ *
+ * @param time time of the newest position, epoch seconds
+ * @param fixes older fixes, oldest first
+ * @param count number of older fixes
+ * @param max_size size limit of the payload, the oldest fixes are dropped if the track does not fit
+ * @return uint8_t size of the payload
+ */
+uint8_t TrackerPayload::addTrack(uint32_t time, const s_track_fix *fixes, uint8_t count, uint8_t max_size)
+{
+	if (_format == PAYLOAD_LPP)
+	{
+		return 0;
+	}
+	if (count > PAYLOAD_TRACK_MAX)
+	{
+		fixes += count - PAYLOAD_TRACK_MAX;
+		count = PAYLOAD_TRACK_MAX;
+	}
+	for (uint8_t idx = 0; idx < count; idx++)
+	{
+		_values.track[idx] = fixes[count - 1 - idx];
+	}
+	_values.track_count = count;
+	_values.time = time;
+	_values.max_size = max_size;
+	_values.fields |= PAYLOAD_HAS_TRACK;
+	_encoded = false;
+	return getSize();
+}
@@ -0,0 +1,129 @@
+/**
+ * @file tracker_payload.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Payload encoder with the same interface as WisCayenne
+ * 		Encodes either Cayenne LPP or the compact bit-packed tracker format
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _TRACKER_PAYLOAD_H_
+#define _TRACKER_PAYLOAD_H_
+
+#include <Arduino.h>
+#include <WisBlock-API-V2.h>
+
+/** Payload formats */
+#define PAYLOAD_LPP 0
+#define PAYLOAD_COMPACT 1
+
+/** First byte of a compact payload, 0xA marker, record type, schema version */
+#define PAYLOAD_MARKER 0xA0
+#define PAYLOAD_MARKER_MASK 0xF0
+#define PAYLOAD_VERSION 1
+#define PAYLOAD_RECORD_STATUS 0
+#define PAYLOAD_RECORD_TRACK 1
+#define PAYLOAD_RECORD_DIAG 2
+
+/** Largest payload, LoRaWAN DR with the largest payload */
+#define PAYLOAD_MAX_SIZE 242
+/** Most fixes in a track record */
+#define PAYLOAD_TRACK_MAX 32
+/** Time and number of fixes in front of the fixes of a track record */
+#define PAYLOAD_TRACK_HEADER 5
+/** Number of samples with min, max and mean of the three RAK1906 channels, compact and LPP */
+#define PAYLOAD_RANGE_SIZE 13
+#define PAYLOAD_RANGE_LPP_SIZE 36
+
+/** Fields of the compact status record, bit in the field map */
+#define PAYLOAD_HAS_POSITION 0x01
+#define PAYLOAD_HAS_TOWER 0x02
+#define PAYLOAD_HAS_BATTERY 0x04
+#define PAYLOAD_HAS_TEMPERATURE 0x08
+#define PAYLOAD_HAS_HUMIDITY 0x10
+#define PAYLOAD_HAS_PRESSURE 0x20
+#define PAYLOAD_HAS_MOTION 0x40
+#define PAYLOAD_HAS_RANGE 0x80
+/** Not part of the field map, the DevID is appended as in LPP */
+#define PAYLOAD_HAS_DEVID 0x100
+/** Not part of the field map, track record with older fixes */
+#define PAYLOAD_HAS_TRACK 0x200
+
+/** Fix of a track */
+struct s_track_fix
+{
+	int32_t lat;   // Latitude in 1e-6 degrees
+	int32_t lon;   // Longitude in 1e-6 degrees
+	uint32_t time; // Epoch seconds of the fix
+};
+
+/** Values of a status or track record, in the resolution of the LPP types */
+struct s_payload_fields
+{
+	uint16_t fields;	 // PAYLOAD_HAS_xxx
+	int32_t lat;		 // Latitude in 1e-6 degrees
+	int32_t lon;		 // Longitude in 1e-6 degrees
+	uint16_t battery;	 // Battery voltage in 10 mV
+	int16_t temperature; // Temperature in 0.1 °C
+	uint8_t humidity;	 // Humidity in 0.5 %RH
+	uint16_t pressure;	 // Pressure in 0.1 hPa
+	uint8_t motion;		 // Motion state
+	uint8_t dev_id[4];	 // Last 4 bytes of the DevEUI
+	// Aggregates of the samples since the last uplink, min, max and mean
+	uint8_t range_count;		  // Number of samples
+	int16_t temperature_range[3]; // Temperature in 0.1 °C
+	uint8_t humidity_range[3];	  // Humidity in 0.5 %RH
+	uint16_t pressure_range[3];	  // Pressure in 0.1 hPa
+	// Track record only
+	uint32_t time;						  // Epoch seconds of the position
+	uint8_t max_size;					  // Size limit of the record without DevID, older fixes that do not fit are dropped
+	uint8_t track_count;				  // Number of older fixes
+	s_track_fix track[PAYLOAD_TRACK_MAX]; // Older fixes, newest first
+};
+
+/**
+ * @brief Payload encoder, the add functions are the ones of WisCayenne used by the tracker
+ * 		In the compact format the values are collected and encoded on getSize() or getBuffer()
+ *
+ */
+class TrackerPayload
+{
+public:
+	TrackerPayload(uint8_t size);
+	void setFormat(uint8_t format);
+	uint8_t getFormat(void);
+	void reset(void);
+	uint8_t getSize(void);
+	uint8_t *getBuffer(void);
+	uint8_t addDigitalInput(uint8_t channel, uint32_t value);
+	uint8_t addPresence(uint8_t channel, uint32_t value);
+	uint8_t addTemperature(uint8_t channel, float celsius);
+	uint8_t addRelativeHumidity(uint8_t channel, float rh);
+	uint8_t addBarometricPressure(uint8_t channel, float hpa);
+	uint8_t addVoltage(uint8_t channel, float voltage);
+	uint8_t addGNSS_6(uint8_t channel, int32_t latitude, int32_t longitude, int32_t altitude);
+	uint8_t addDevID(uint8_t channel, uint8_t *dev_id);
+	uint8_t addSampleCount(uint8_t channel, uint16_t count);
+	uint8_t addRange(uint8_t channel, float min, float max, float mean);
+	uint8_t addTrack(uint32_t time, const s_track_fix *fixes, uint8_t count, uint8_t max_size);
+
+private:
+	void encode(void);
+	WisCayenne _lpp;
+	uint8_t _format;
+	s_payload_fields _values;
+	uint8_t _devid_channel;
+	uint8_t _buffer[PAYLOAD_MAX_SIZE + 6];
+	uint8_t _size;
+	bool _encoded;
+};
+
+uint8_t payload_encode(const s_payload_fields *values, uint8_t *buffer, uint8_t buf_len);
+bool payload_decode(const uint8_t *buffer, uint8_t len, s_payload_fields *values);
+uint8_t payload_track_delta_size(const s_track_fix *newer, const s_track_fix *older);
+uint8_t payload_encode_diag(const uint32_t *values, uint8_t count, uint8_t *buffer, uint8_t buf_len);
+uint8_t payload_decode_diag(const uint8_t *buffer, uint8_t len, uint32_t *values, uint8_t max_count);
+
+#endif // _TRACKER_PAYLOAD_H_
@@ -0,0 +1,405 @@
+/**
+ * @file uplink_queue.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Flash backed store and forward queue for uplinks that could not be sent
+ * 		The queue is a log file in the internal file system. Each record is appended
+ * 		with a CRC, sent records are marked with a tombstone record. A record that
+ * 		was cut by a power failure fails the CRC check and is ignored on the next start.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#ifdef NRF52_SERIES
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Filename of the queue log */
+static const char queue_file_name[] = "UPQ";
+
+/** Filename used while the log is compacted */
+static const char queue_temp_name[] = "UPQT";
+
+/** File for the queue log */
+static File queue_file(InternalFS);
+#endif
+
+/** Marker of a record in the log */
+#define QUEUE_MAGIC 0xA5
+/** Record types */
+#define QUEUE_REC_DATA 0
+#define QUEUE_REC_DONE 1
+/** Log is compacted when it grows beyond this size */
+#define QUEUE_FILE_MAX 8192
+
+/** Header of a record in the log */
+struct s_queue_header
+{
+	uint8_t magic;
+	uint8_t type;
+	uint16_t seq;
+	uint8_t priority;
+	uint8_t len;
+	uint16_t crc;
+};
+
+/** Index entry of a queued record, the payload stays in flash */
+struct s_queue_entry
+{
+	uint16_t seq;
+	uint8_t priority;
+	uint8_t len;
+	uint32_t offset;
+};
+
+/** Index of the queued records */
+static s_queue_entry queue_index[UPLINK_QUEUE_MAX];
+
+/** Number of queued records */
+static uint8_t queue_count = 0;
+
+/** Next sequence number */
+static uint16_t queue_next_seq = 0;
+
+/** Queue counters */
+static s_uplink_queue_stats queue_stats;
+
+/**
+ * @brief CRC16 CCITT, used for the queue records and the settings records
+ *
+ * @param crc start value or CRC of the previous data
+ * @param data data to add
+ * @param len length of the data
+ * @return uint16_t CRC
+ */
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		crc ^= (uint16_t)data[idx] << 8;
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+/**
+ * @brief CRC over the header without the CRC field and the payload
+ *
+ */
+static uint16_t queue_record_crc(s_queue_header *header, const uint8_t *data)
+{
+	uint16_t crc = crc16_ccitt(0xFFFF, (const uint8_t *)header, offsetof(s_queue_header, crc));
+	return crc16_ccitt(crc, data, header->len);
+}
+
+/**
+ * @brief Find a record in the index
+ *
+ * @param seq sequence number of the record
+ * @return int16_t index or -1 if not found
+ */
+static int16_t queue_find(uint16_t seq)
+{
+	for (uint8_t idx = 0; idx < queue_count; idx++)
+	{
+		if (queue_index[idx].seq == seq)
+		{
+			return idx;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Remove a record from the index
+ *
+ */
+static void queue_index_remove(uint8_t idx)
+{
+	queue_count--;
+	memmove(&queue_index[idx], &queue_index[idx + 1], (queue_count - idx) * sizeof(s_queue_entry));
+}
+
+#ifdef NRF52_SERIES
+/**
+ * @brief Append a record to an open log file
+ *
+ * @return uint32_t file offset of the payload
+ */
+static uint32_t queue_write_record(File &file, uint8_t type, uint16_t seq, uint8_t priority, const uint8_t *data, uint8_t len)
+{
+	s_queue_header header = {QUEUE_MAGIC, type, seq, priority, len, 0};
+	header.crc = queue_record_crc(&header, data);
+	file.write((const uint8_t *)&header, sizeof(s_queue_header));
+	uint32_t offset = file.position();
+	if (len != 0)
+	{
+		file.write(data, len);
+	}
+	return offset;
+}
+
+/**
+ * @brief Write the queued records into a new log and replace the old log
+ * 		Rename replaces the old log in one step, a power failure leaves either
+ * 		the old or the new log.
+ *
+ */
+static void queue_compact(void)
+{
+	if (queue_count == 0)
+	{
+		InternalFS.remove(queue_file_name);
+		return;
+	}
+
+	uint8_t data[256];
+	File new_file(InternalFS);
+	if (InternalFS.exists(queue_temp_name))
+	{
+		InternalFS.remove(queue_temp_name);
+	}
+	new_file.open(queue_temp_name, FILE_O_WRITE);
+	queue_file.open(queue_file_name, FILE_O_READ);
+	for (uint8_t idx = 0; idx < queue_count; idx++)
+	{
+		queue_file.seek(queue_index[idx].offset);
+		queue_file.read(data, queue_index[idx].len);
+		queue_index[idx].offset = queue_write_record(new_file, QUEUE_REC_DATA, queue_index[idx].seq, queue_index[idx].priority, data, queue_index[idx].len);
+	}
+	queue_file.close();
+	new_file.close();
+	InternalFS.rename(queue_temp_name, queue_file_name);
+	MYLOG("UPQ", "Log compacted, %d records", queue_count);
+}
+#endif
+
+/**
+ * @brief Remove a record from the index and mark it as done in the log
+ *
+ * @param idx index of the record
+ */
+static void queue_delete(uint8_t idx)
+{
+	uint16_t seq = queue_index[idx].seq;
+	queue_index_remove(idx);
+#ifdef NRF52_SERIES
+	queue_file.open(queue_file_name, FILE_O_WRITE);
+	queue_write_record(queue_file, QUEUE_REC_DONE, seq, 0, NULL, 0);
+	uint32_t file_size = queue_file.size();
+	queue_file.close();
+	if ((queue_count == 0) || (file_size > QUEUE_FILE_MAX))
+	{
+		queue_compact();
+	}
+#endif
+}
+
+/**
+ * @brief Load the queue from flash
+ *
+ */
+void uplink_queue_init(void)
+{
+	queue_count = 0;
+	queue_next_seq = 0;
+#ifdef NRF52_SERIES
+	// Left over from a compaction that was interrupted
+	if (InternalFS.exists(queue_temp_name))
+	{
+		InternalFS.remove(queue_temp_name);
+	}
+	if (!queue_file.open(queue_file_name, FILE_O_READ))
+	{
+		return;
+	}
+
+	s_queue_header header;
+	uint8_t data[256];
+	uint32_t valid_size = 0;
+	while (queue_file.read((void *)&header, sizeof(s_queue_header)) == sizeof(s_queue_header))
+	{
+		uint32_t offset = queue_file.position();
+		if ((header.magic != QUEUE_MAGIC) || (queue_file.read(data, header.len) != header.len) || (queue_record_crc(&header, data) != header.crc))
+		{
+			MYLOG("UPQ", "Broken record at %ld", (long)valid_size);
+			break;
+		}
+		valid_size = queue_file.position();
+		if ((int16_t)(header.seq - queue_next_seq) >= 0)
+		{
+			queue_next_seq = header.seq + 1;
+		}
+		if (header.type == QUEUE_REC_DONE)
+		{
+			int16_t idx = queue_find(header.seq);
+			if (idx >= 0)
+			{
+				queue_index_remove(idx);
+			}
+		}
+		else if (queue_count < UPLINK_QUEUE_MAX)
+		{
+			queue_index[queue_count].seq = header.seq;
+			queue_index[queue_count].priority = header.priority;
+			queue_index[queue_count].len = header.len;
+			queue_index[queue_count].offset = offset;
+			queue_count++;
+		}
+	}
+	bool broken = valid_size != queue_file.size();
+	queue_file.close();
+
+	if (broken)
+	{
+		// Drop the cut record, otherwise new records would be appended behind it
+		queue_compact();
+	}
+	MYLOG("UPQ", "%d queued uplinks", queue_count);
+#endif
+}
+
+/**
+ * @brief Add an uplink to the queue
+ * 		If the queue is full, the oldest record with the lowest priority is dropped.
+ * 		If all queued records have a higher priority, the new record is dropped.
+ *
+ * @param data payload
+ * @param len payload length
+ * @param priority higher values are sent first
+ * @return true if the record was queued
+ * @return false if the record was dropped
+ */
+bool uplink_queue_add(uint8_t *data, uint8_t len, uint8_t priority)
+{
+#ifdef NRF52_SERIES
+	if (queue_count == UPLINK_QUEUE_MAX)
+	{
+		int16_t drop_idx = -1;
+		for (uint8_t idx = 0; idx < queue_count; idx++)
+		{
+			if ((queue_index[idx].priority <= priority) && ((drop_idx < 0) || (queue_index[idx].priority < queue_index[drop_idx].priority)))
+			{
+				drop_idx = idx;
+			}
+		}
+		queue_stats.dropped++;
+		if (drop_idx < 0)
+		{
+			MYLOG("UPQ", "Queue full, uplink dropped");
+			return false;
+		}
+		MYLOG("UPQ", "Queue full, drop #%d", queue_index[drop_idx].seq);
+		queue_delete(drop_idx);
+	}
+
+	queue_file.open(queue_file_name, FILE_O_WRITE);
+	queue_index[queue_count].seq = queue_next_seq;
+	queue_index[queue_count].priority = priority;
+	queue_index[queue_count].len = len;
+	queue_index[queue_count].offset = queue_write_record(queue_file, QUEUE_REC_DATA, queue_next_seq, priority, data, len);
+	queue_file.close();
+	MYLOG("UPQ", "Queued #%d, %d bytes, priority %d", queue_next_seq, len, priority);
+	queue_count++;
+	queue_next_seq++;
+	queue_stats.queued++;
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * @brief Get the next record to send, highest priority first, oldest first within a priority
+ *
+ * @param data buffer for the payload, 256 bytes
+ * @param seq returns the sequence number of the record
+ * @param priority optional, returns the priority of the record
+ * @return uint8_t length of the payload, 0 if the queue is empty
+ */
+uint8_t uplink_queue_peek(uint8_t *data, uint16_t *seq, uint8_t *priority)
+{
+	if (queue_count == 0)
+	{
+		return 0;
+	}
+	// Index is in order of arrival
+	uint8_t next = 0;
+	for (uint8_t idx = 1; idx < queue_count; idx++)
+	{
+		if (queue_index[idx].priority > queue_index[next].priority)
+		{
+			next = idx;
+		}
+	}
+#ifdef NRF52_SERIES
+	if (!queue_file.open(queue_file_name, FILE_O_READ))
+	{
+		return 0;
+	}
+	queue_file.seek(queue_index[next].offset);
+	queue_file.read(data, queue_index[next].len);
+	queue_file.close();
+#endif
+	*seq = queue_index[next].seq;
+	if (priority != NULL)
+	{
+		*priority = queue_index[next].priority;
+	}
+	return queue_index[next].len;
+}
+
+/**
+ * @brief Remove a record after it was sent
+ *
+ * @param seq sequence number of the record
+ */
+void uplink_queue_remove(uint16_t seq)
+{
+	int16_t idx = queue_find(seq);
+	if (idx >= 0)
+	{
+		queue_delete(idx);
+		queue_stats.sent++;
+	}
+}
+
+/**
+ * @brief Delete all queued records
+ *
+ */
+void uplink_queue_clear(void)
+{
+	queue_count = 0;
+#ifdef NRF52_SERIES
+	if (InternalFS.exists(queue_file_name))
+	{
+		InternalFS.remove(queue_file_name);
+	}
+#endif
+}
+
+/**
+ * @brief Number of queued records
+ *
+ */
+uint8_t uplink_queue_count(void)
+{
+	return queue_count;
+}
+
+/**
+ * @brief Get the queue counters
+ *
+ */
+s_uplink_queue_stats *uplink_queue_stats(void)
+{
+	return &queue_stats;
+}
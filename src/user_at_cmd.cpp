@@ -18,12 +18,6 @@ s_blues_settings g_blues_settings;
 #include <InternalFileSystem.h>
 using namespace Adafruit_LittleFS_Namespace;
 
-/** Filename to save Blues settings */
-static const char blues_file_name[] = "BLUES";
-
-/** File to save battery check status */
-File this_file(InternalFS);
-
 #define REQ_PRINTF(...)                     \
 	do                                      \
 	{                                       \
@@ -92,6 +86,10 @@ int at_set_blues_prod_uid(char *str)
 	if (need_save)
 	{
 		save_blues_settings();
+		// Often followed by ATZ, write it now instead of after the burst delay
+		settings_flush();
+		// Apply to the NoteCard without reboot
+		blues_config_update();
 	}
 	return AT_SUCCESS;
 }
@@ -220,6 +218,10 @@ int at_set_blues_sim_set(char *str)
 	if (need_save)
 	{
 		save_blues_settings();
+		// Often followed by ATZ, write it now instead of after the burst delay
+		settings_flush();
+		// Apply to the NoteCard without reboot
+		blues_config_update();
 	}
 	return AT_SUCCESS;
 }
@@ -293,6 +295,10 @@ int at_set_blues_mode(char *str)
 	if (need_save)
 	{
 		save_blues_settings();
+		// Often followed by ATZ, write it now instead of after the burst delay
+		settings_flush();
+		// Apply to the NoteCard without reboot
+		blues_config_update();
 	}
 	return AT_SUCCESS;
 }
@@ -309,6 +315,70 @@ int at_query_blues_mode(void)
 	return AT_SUCCESS;
 }
 
+/**
+ * @brief Set the NoteHub sync thresholds
+ *
+ * @param str params as string, format count:age:priority
+ * 				count = sync after this number of notes (1 = sync every note)
+ * 				age = sync if the oldest note waits longer than this (minutes), 0 = no limit
+ * 				priority = sync immediately for packets with this or higher priority
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_NUM if params error
+ */
+int at_set_blues_sync(char *str)
+{
+	char *param;
+	long new_count;
+	long new_age;
+	long new_priority;
+
+	param = strtok(str, ":");
+	if (param == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	new_count = strtol(param, NULL, 0);
+	param = strtok(NULL, ":");
+	if (param == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	new_age = strtol(param, NULL, 0);
+	param = strtok(NULL, ":");
+	if (param == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	new_priority = strtol(param, NULL, 0);
+
+	if ((new_count < 1) || (new_count > 100) || (new_age < 0) || (new_age > 1440) || (new_priority < 0) || (new_priority > 255))
+	{
+		MYLOG("USR_AT", "Invalid sync thresholds %ld:%ld:%ld", new_count, new_age, new_priority);
+		return AT_ERRNO_PARA_NUM;
+	}
+
+	if ((new_count != g_blues_settings.sync_count) || (new_age != g_blues_settings.sync_age) || (new_priority != g_blues_settings.sync_priority))
+	{
+		g_blues_settings.sync_count = new_count;
+		g_blues_settings.sync_age = new_age;
+		g_blues_settings.sync_priority = new_priority;
+		save_blues_settings();
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the NoteHub sync thresholds
+ *
+ * @return int AT_SUCCESS
+ */
+int at_query_blues_sync(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d:%d", g_blues_settings.sync_count, g_blues_settings.sync_age, g_blues_settings.sync_priority);
+	return AT_SUCCESS;
+}
+
 /**
  * @brief Enable/disable the motion trigger
  *
@@ -368,25 +438,21 @@ int at_query_blues_trigger(void)
 int at_query_blues_imsi(void)
 {
 	snprintf(g_at_query_buf, ATQUERY_SIZE, "ERROR");
+	// Wait until the NoteCard worker finished its job
+	blues_lock();
 	//  Check if Notecard is plugged in
-	for (int try_send = 0; try_send < 5; try_send++)
+	if (!blues_request("card.version"))
 	{
-		if (rak_blues.start_req((char *)"card.version"))
-		{
-			if (rak_blues.send_req())
-			{
-				if (rak_blues.has_entry((char *)"device"))
-				{
-					rak_blues.get_string_entry((char *)"device", g_at_query_buf, ATQUERY_SIZE);
-					snprintf(g_at_query_buf, ATQUERY_SIZE, "%s", &g_at_query_buf[4]);
-				}
-				return AT_SUCCESS;
-				break;
-			}
-		}
+		blues_unlock();
+		return AT_ERRNO_EXEC_FAIL;
 	}
-
-	return AT_ERRNO_EXEC_FAIL;
+	if (rak_blues.has_entry((char *)"device"))
+	{
+		rak_blues.get_string_entry((char *)"device", g_at_query_buf, ATQUERY_SIZE);
+		snprintf(g_at_query_buf, ATQUERY_SIZE, "%s", &g_at_query_buf[4]);
+	}
+	blues_unlock();
+	return AT_SUCCESS;
 }
 
 /**
@@ -397,10 +463,7 @@ int at_query_blues_imsi(void)
 static int at_reset_blues_settings(void)
 {
 #ifdef NRF52_SERIES
-	if (InternalFS.exists(blues_file_name))
-	{
-		InternalFS.remove(blues_file_name);
-	}
+	settings_remove();
 	return AT_SUCCESS;
 #endif
 #ifdef ESP32
@@ -421,7 +484,9 @@ static int at_reset_blues_settings(void)
  */
 static int at_blues_factory(void)
 {
+	blues_lock();
 	blues_card_restore();
+	blues_unlock();
 	return AT_SUCCESS;
 }
 
@@ -455,7 +520,16 @@ static int at_blues_report_status(void)
 		REQ_PRINTF("Selected SIM card: internal primary, external secondary - APN: %s", g_blues_settings.ext_sim_apn);
 		break;
 	}
-	REQ_PRINTF("Cellular network: %s", blues_hub_connected() ? "Connected" : "Not Connected");
+	REQ_PRINTF("Sync after %d notes, %d minutes or priority %d", g_blues_settings.sync_count, g_blues_settings.sync_age, g_blues_settings.sync_priority);
+	REQ_PRINTF("Deadband %d m, keep-alive after %d uplinks", g_blues_settings.deadband, g_blues_settings.keepalive);
+	REQ_PRINTF("Payload format: %s", g_blues_settings.payload_format == PAYLOAD_LPP ? "Cayenne LPP" : "compact");
+	REQ_PRINTF("Track: %d fixes per uplink while moving", g_blues_settings.track_fixes);
+	REQ_PRINTF("Diagnostic uplink every %d hours", g_blues_settings.diag_interval);
+	REQ_PRINTF("BME680 sample every %d seconds", g_blues_settings.env_interval);
+	blues_lock();
+	bool connected = blues_hub_connected();
+	blues_unlock();
+	REQ_PRINTF("Cellular network: %s", connected ? "Connected" : "Not Connected");
 
 	return AT_SUCCESS;
 }
@@ -467,17 +541,22 @@ static int at_blues_report_status(void)
  */
 int at_blues_status(void)
 {
-	if (!rak_blues.start_req((char *)"hub.status"))
+	// Wait until the NoteCard worker finished its job
+	blues_lock();
+	if (!blues_start_req("hub.status"))
 	{
+		blues_unlock();
 		snprintf(g_at_query_buf, ATQUERY_SIZE, "Request creation failed");
 		return AT_ERRNO_EXEC_FAIL;
 	}
 
-	if (!rak_blues.send_req(g_at_query_buf, ATQUERY_SIZE))
+	if (!blues_send_req(g_at_query_buf, ATQUERY_SIZE))
 	{
+		blues_unlock();
 		snprintf(g_at_query_buf, ATQUERY_SIZE, "Send request failed");
 		return AT_ERRNO_EXEC_FAIL;
 	}
+	blues_unlock();
 	// Print out response as AT response
 	REQ_PRINTF(">>>>\n%s\n<<<<", g_at_query_buf);
 	return AT_SUCCESS;
@@ -491,38 +570,30 @@ bool read_blues_settings(void)
 {
 #ifdef NRF52_SERIES
 	bool structure_valid = false;
-	if (InternalFS.exists(blues_file_name))
+	if (settings_read(&g_blues_settings))
 	{
-		this_file.open(blues_file_name, FILE_O_READ);
-		this_file.read((void *)&g_blues_settings.valid_mark, sizeof(s_blues_settings));
-		this_file.close();
-
-		// Check for valid data
-		if (g_blues_settings.valid_mark == 0xAA55)
-		{
-			structure_valid = true;
-			MYLOG("USR_AT", "Valid Blues settings found, Blues Product UID = %s", g_blues_settings.product_uid);
-			switch (g_blues_settings.sim_usage)
-			{
-			case 0:
-				MYLOG("USR_AT", "Selected SIM card: internal only");
-				break;
-			case 1:
-				MYLOG("USR_AT", "Selected SIM card: external only - APN: %s", g_blues_settings.ext_sim_apn);
-				break;
-			case 2:
-				MYLOG("USR_AT", "Selected SIM card: external primary, internal secondary - APN: %s", g_blues_settings.ext_sim_apn);
-				break;
-			case 3:
-				MYLOG("USR_AT", "Selected SIM card: internal primary, external secondary - APN: %s", g_blues_settings.ext_sim_apn);
-				break;
-			}
-		}
-		else
+		structure_valid = true;
+		MYLOG("USR_AT", "Valid Blues settings found, Blues Product UID = %s", g_blues_settings.product_uid);
+		switch (g_blues_settings.sim_usage)
 		{
-			MYLOG("USR_AT", "No valid Blues settings found");
+		case 0:
+			MYLOG("USR_AT", "Selected SIM card: internal only");
+			break;
+		case 1:
+			MYLOG("USR_AT", "Selected SIM card: external only - APN: %s", g_blues_settings.ext_sim_apn);
+			break;
+		case 2:
+			MYLOG("USR_AT", "Selected SIM card: external primary, internal secondary - APN: %s", g_blues_settings.ext_sim_apn);
+			break;
+		case 3:
+			MYLOG("USR_AT", "Selected SIM card: internal primary, external secondary - APN: %s", g_blues_settings.ext_sim_apn);
+			break;
 		}
 	}
+	else
+	{
+		MYLOG("USR_AT", "No valid Blues settings found");
+	}
 
 	if (!structure_valid)
 	{
@@ -555,6 +626,15 @@ bool read_blues_settings(void)
 		g_blues_settings.sim_usage = blues_prefs.getShort("sim", 0);		  // 0 int SIM, 1 ext SIM, 2 ext int SIM, 3 int ext SIM
 		blues_prefs.getString("apn", &g_blues_settings.ext_sim_apn[0], 256);  // APN to be used with external SIM
 		g_blues_settings.motion_trigger = blues_prefs.getBool("acc", false);  // Send data on motion trigger
+		g_blues_settings.sync_count = blues_prefs.getUChar("scnt", 1);		  // Sync after this number of notes
+		g_blues_settings.sync_age = blues_prefs.getUShort("sage", 60);		  // Sync if a note waits longer (minutes)
+		g_blues_settings.sync_priority = blues_prefs.getUChar("sprio", 1);	  // Sync immediately for this priority
+		g_blues_settings.deadband = blues_prefs.getUShort("dead", 0);		  // Position deadband (meters)
+		g_blues_settings.keepalive = blues_prefs.getUChar("kalive", 6);		  // Keep-alive after suppressed uplinks
+		g_blues_settings.payload_format = blues_prefs.getUChar("fmt", 0);	  // Uplink payload format
+		g_blues_settings.track_fixes = blues_prefs.getUChar("track", 1);	  // Fixes per uplink while moving
+		g_blues_settings.diag_interval = blues_prefs.getUChar("diag", 0);	  // Diagnostic uplink interval (hours)
+		g_blues_settings.env_interval = blues_prefs.getUShort("env", 0);	  // BME680 sample interval (seconds)
 	}
 
 	blues_prefs.end();
@@ -570,16 +650,9 @@ bool read_blues_settings(void)
 void save_blues_settings(void)
 {
 #ifdef NRF52_SERIES
-	if (InternalFS.exists(blues_file_name))
-	{
-		InternalFS.remove(blues_file_name);
-	}
-
+	// Written after a burst of changes, see settings_store.cpp
 	g_blues_settings.valid_mark = 0xAA55;
-	this_file.open(blues_file_name, FILE_O_WRITE);
-	this_file.write((const char *)&g_blues_settings.valid_mark, sizeof(s_blues_settings));
-	this_file.close();
-	MYLOG("USR_AT", "Saved Blues Settings");
+	settings_save();
 #endif
 #ifdef ESP32
 	blues_prefs.begin("BluesCred", false);
@@ -591,6 +664,15 @@ void save_blues_settings(void)
 	g_blues_settings.sim_usage = blues_prefs.putShort("sim", g_blues_settings.sim_usage);			// 0 int SIM, 1 ext SIM, 2 ext int SIM, 3 int ext SIM
 	blues_prefs.putString("apn", &g_blues_settings.ext_sim_apn[0]);									// APN to be used with external SIM
 	g_blues_settings.motion_trigger = blues_prefs.putBool("acc", g_blues_settings.motion_trigger);	// Send data on motion trigger
+	blues_prefs.putUChar("scnt", g_blues_settings.sync_count);										// Sync after this number of notes
+	blues_prefs.putUShort("sage", g_blues_settings.sync_age);										// Sync if a note waits longer (minutes)
+	blues_prefs.putUChar("sprio", g_blues_settings.sync_priority);									// Sync immediately for this priority
+	blues_prefs.putUShort("dead", g_blues_settings.deadband);										// Position deadband (meters)
+	blues_prefs.putUChar("kalive", g_blues_settings.keepalive);										// Keep-alive after suppressed uplinks
+	blues_prefs.putUChar("fmt", g_blues_settings.payload_format);									// Uplink payload format
+	blues_prefs.putUChar("track", g_blues_settings.track_fixes);									// Fixes per uplink while moving
+	blues_prefs.putUChar("diag", g_blues_settings.diag_interval);									// Diagnostic uplink interval (hours)
+	blues_prefs.putUShort("env", g_blues_settings.env_interval);									// BME680 sample interval (seconds)
 
 	blues_prefs.end();
 #endif
@@ -604,22 +686,726 @@ int at_blues_req(char *str)
 			str[i] = str[i] + 32;			// converting uppercase to lowercase
 	}
 
-	if (!rak_blues.start_req(str))
+	// Wait until the NoteCard worker finished its job
+	blues_lock();
+
+	// The request might change the NoteCard settings
+	blues_shadow_reset();
+	blues_config_forget();
+
+	if (!blues_start_req(str))
 	{
+		blues_unlock();
 		snprintf(g_at_query_buf, ATQUERY_SIZE, "Request creation failed");
 		return AT_ERRNO_EXEC_FAIL;
 	}
 
-	if (!rak_blues.send_req(g_at_query_buf, ATQUERY_SIZE))
+	if (!blues_send_req(g_at_query_buf, ATQUERY_SIZE))
 	{
+		blues_unlock();
 		snprintf(g_at_query_buf, ATQUERY_SIZE, "Send request failed");
 		return AT_ERRNO_EXEC_FAIL;
 	}
+	blues_unlock();
 	// Print out response as AT response
 	REQ_PRINTF(">>>>\n%s\n<<<<", g_at_query_buf);
 	return AT_SUCCESS;
 }
 
+/**
+ * @brief Enable/disable capture of NoteCard requests
+ * 		The transcript file is shared with the NoteCard worker, all capture commands hold the lock
+ *
+ * @param str 0 = stop capture, 1 = start new capture, 2 = continue capture
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_NUM if params error
+ */
+static int at_set_blues_capture(char *str)
+{
+	if ((str[0] < '0') || (str[0] > '2'))
+	{
+		MYLOG("USR_AT", "Invalid capture flag %d", str[0]);
+		return AT_ERRNO_PARA_NUM;
+	}
+	blues_lock();
+	if (str[0] == '0')
+	{
+		blues_capture_stop();
+	}
+	else
+	{
+		blues_capture_start(str[0] == '1');
+	}
+	blues_unlock();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get NoteCard capture status
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_blues_capture(void)
+{
+	blues_lock();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%ld", blues_capture_active() ? 1 : 0, (long)blues_capture_size());
+	blues_unlock();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Print one line of the NoteCard transcript
+ *
+ * @param line transcript line
+ */
+static void print_capture_line(const char *line)
+{
+	REQ_PRINTF("%s", line);
+}
+
+/**
+ * @brief Export the NoteCard transcript
+ * 		The worker waits until the export is finished, no request is added in the middle
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_blues_capture_export(void)
+{
+	blues_lock();
+	uint16_t lines = blues_capture_export(print_capture_line);
+	blues_unlock();
+	REQ_PRINTF("BCAP:END,%d", lines);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Show the retry counters of the NoteCard requests
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_blues_retry_stats(void)
+{
+	const char *name;
+	const s_blues_req_stats *stats;
+	for (uint8_t idx = 0; (stats = blues_request_stats(idx, &name)) != NULL; idx++)
+	{
+		if (stats->requests != 0)
+		{
+			REQ_PRINTF("%s: req %ld try %ld fail %ld wait %ldms busy %ldms", name,
+					   (long)stats->requests, (long)stats->attempts, (long)stats->failures,
+					   (long)stats->backoff_ms, (long)stats->busy_ms);
+		}
+	}
+	REQ_PRINTF("skipped: %ld", (long)blues_shadow_skipped());
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Show the histograms of the NoteCard requests, two lines per request name
+ * 		Times in ms <10/<20/<50/<100/<200/<500/<1000/>=1000, sizes in bytes <32/<64/<128/<256/<512/>=512
+ *
+ * @return uint8_t number of request names
+ */
+static uint8_t print_blues_perf(void)
+{
+	const s_blues_perf *perf;
+	uint8_t idx = 0;
+	for (; (perf = blues_perf_stats(idx)) != NULL; idx++)
+	{
+		const uint32_t *time = perf->time_hist;
+		REQ_PRINTF("%s: req %ld try %ld retry %ld err %ld fail %ld avg %ldms max %ldms ms %ld/%ld/%ld/%ld/%ld/%ld/%ld/%ld", perf->name,
+				   (long)perf->requests, (long)perf->tries, (long)perf->retries, (long)perf->errors, (long)perf->failures,
+				   (long)(perf->tries != 0 ? perf->total_ms / perf->tries : 0), (long)perf->max_ms,
+				   (long)time[0], (long)time[1], (long)time[2], (long)time[3], (long)time[4], (long)time[5], (long)time[6], (long)time[7]);
+		uint32_t sent_num = 0;
+		uint32_t received_num = 0;
+		for (uint8_t bucket = 0; bucket < BLUES_PERF_SIZE_BUCKETS; bucket++)
+		{
+			sent_num += perf->sent_hist[bucket];
+			received_num += perf->received_hist[bucket];
+		}
+		const uint32_t *sent = perf->sent_hist;
+		const uint32_t *received = perf->received_hist;
+		REQ_PRINTF("%s: tx avg %ldB %ld/%ld/%ld/%ld/%ld/%ld rx avg %ldB %ld/%ld/%ld/%ld/%ld/%ld", perf->name,
+				   (long)(sent_num != 0 ? perf->sent / sent_num : 0), (long)sent[0], (long)sent[1], (long)sent[2], (long)sent[3], (long)sent[4], (long)sent[5],
+				   (long)(received_num != 0 ? perf->received / received_num : 0), (long)received[0], (long)received[1], (long)received[2],
+				   (long)received[3], (long)received[4], (long)received[5]);
+	}
+	return idx;
+}
+
+/**
+ * @brief Show the histograms of the NoteCard requests
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_blues_perf(void)
+{
+	print_blues_perf();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Show the histograms of the NoteCard requests, the response is the number of request names
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_blues_perf(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", print_blues_perf());
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Clear the histograms of the NoteCard requests
+ *
+ * @param str 0 to clear
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the parameter is not 0
+ */
+static int at_set_blues_perf(char *str)
+{
+	if (str[0] != '0')
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	blues_perf_reset();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Show the counters of the wake-up events
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_app_events(void)
+{
+	const char *name;
+	const s_app_event_stats *stats;
+	for (uint8_t idx = 0; (stats = app_event_stats(idx, &name)) != NULL; idx++)
+	{
+		REQ_PRINTF("%s: posted %ld merged %ld handled %ld avg %ldus max %ldus", name, (long)stats->posted, (long)stats->coalesced,
+				   (long)stats->handled, (long)(stats->latency_num != 0 ? stats->total_us / stats->latency_num : 0), (long)stats->max_us);
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the sums of the events posted by the application, posted:merged:handled
+ * 		Without lost events posted is merged + handled while no event is pending
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_app_events(void)
+{
+	const char *name;
+	const s_app_event_stats *stats;
+	long posted = 0;
+	long merged = 0;
+	long handled = 0;
+	for (uint8_t idx = 0; (stats = app_event_stats(idx, &name)) != NULL; idx++)
+	{
+		posted += stats->posted;
+		merged += stats->coalesced;
+		handled += stats->handled;
+	}
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%ld:%ld:%ld", posted, merged, handled);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Clear the counters of the wake-up events
+ *
+ * @param str 0 to clear
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the parameter is not 0
+ */
+static int at_set_app_events(char *str)
+{
+	if (str[0] != '0')
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	app_event_stats_reset();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the counters of the NoteCard worker
+ * 		depth:max_depth:jobs:inline:avg_wait_ms:avg_run_ms:max_ms
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_blues_worker(void)
+{
+	const s_blues_worker_stats *stats = blues_worker_stats();
+	uint32_t completed = stats->completed != 0 ? stats->completed : 1;
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d:%ld:%ld:%ld:%ld:%ld", blues_worker_depth(), stats->max_depth, (long)stats->submitted,
+			 (long)stats->inline_jobs, (long)(stats->wait_ms / completed), (long)(stats->run_ms / completed), (long)stats->max_ms);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Clear the counters of the NoteCard worker
+ *
+ * @param str 0 to clear
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the parameter is not 0
+ */
+static int at_set_blues_worker(char *str)
+{
+	if (str[0] != '0')
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	blues_worker_stats_reset();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the counters of the NoteCard configuration
+ * 		warm:reconciled:live:skipped
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_blues_config(void)
+{
+	s_blues_config_stats *stats = blues_config_stats();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d:%d:%ld:%d", stats->warm, stats->reconciled, stats->live, (long)stats->skipped, stats->lost);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Forget the saved NoteCard configuration, the next boot sends all sections
+ *
+ * @param str 0 to forget
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the parameter is not 0
+ */
+static int at_set_blues_config(char *str)
+{
+	if (str[0] != '0')
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	blues_config_forget();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the counters of the settings store
+ * 		requests:writes:unchanged:seq:size
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_settings_store(void)
+{
+	s_settings_stats *stats = settings_stats();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%ld:%ld:%ld:%d:%d", (long)stats->requests, (long)stats->writes, (long)stats->unchanged,
+			 stats->seq, stats->size);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the counters of the BME680 readings
+ * 		readings:early:timeouts:average saved ms:average wait ms
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_rak1906(void)
+{
+	s_rak1906_stats *stats = rak1906_stats();
+	uint32_t readings = stats->readings != 0 ? stats->readings : 1;
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%ld:%ld:%ld:%ld:%ld:%ld", (long)stats->readings, (long)stats->early, (long)stats->timeouts,
+			 (long)(stats->saved_ms / readings), (long)(stats->wait_ms / readings), (long)stats->age_ms);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Show the times of the boot phases
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_boot_profile(void)
+{
+	const char *name;
+	const s_boot_phase *phase;
+	for (uint8_t idx = 0; (phase = boot_phase(idx, &name)) != NULL; idx++)
+	{
+		if (!phase->started)
+		{
+			REQ_PRINTF("%s: not run", name);
+		}
+		else if (!phase->finished)
+		{
+			REQ_PRINTF("%s: start %ldms running", name, (long)phase->start_ms);
+		}
+		else
+		{
+			REQ_PRINTF("%s: start %ldms end %ldms took %ldms", name, (long)phase->start_ms, (long)phase->end_ms,
+					   (long)(phase->end_ms - phase->start_ms));
+		}
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the milestones of the boot, app:blues:join:uplink in ms since the reset, 0 if not reached
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_boot_profile(void)
+{
+	const uint8_t milestones[4] = {BOOT_APP, BOOT_BLUES, BOOT_JOIN, BOOT_UPLINK};
+	const char *name;
+	int len = 0;
+	for (uint8_t idx = 0; idx < 4; idx++)
+	{
+		const s_boot_phase *phase = boot_phase(milestones[idx], &name);
+		len += snprintf(&g_at_query_buf[len], ATQUERY_SIZE - len, "%s%ld", idx == 0 ? "" : ":", (long)(phase->finished ? phase->end_ms : 0));
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the status of the uplink queue
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_uplink_queue(void)
+{
+	s_uplink_queue_stats *stats = uplink_queue_stats();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%ld:%ld:%ld", uplink_queue_count(), (long)stats->queued, (long)stats->sent, (long)stats->dropped);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Delete all queued uplinks
+ *
+ * @param str 0 to delete the queue
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if params error
+ */
+static int at_set_uplink_queue(char *str)
+{
+	if (str[0] != '0')
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	uplink_queue_clear();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Set the position deadband
+ *
+ * @param str params as string, format <meters>:<keep-alive>
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_NUM if params error
+ */
+static int at_set_deadband(char *str)
+{
+	char *param;
+	long new_deadband;
+	long new_keepalive;
+
+	param = strtok(str, ":");
+	if (param == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	new_deadband = strtol(param, NULL, 0);
+	param = strtok(NULL, ":");
+	if (param == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	new_keepalive = strtol(param, NULL, 0);
+
+	if ((new_deadband < 0) || (new_deadband > 10000) || (new_keepalive < 0) || (new_keepalive > 255))
+	{
+		MYLOG("USR_AT", "Invalid deadband %ld:%ld", new_deadband, new_keepalive);
+		return AT_ERRNO_PARA_NUM;
+	}
+
+	if ((new_deadband != g_blues_settings.deadband) || (new_keepalive != g_blues_settings.keepalive))
+	{
+		g_blues_settings.deadband = new_deadband;
+		g_blues_settings.keepalive = new_keepalive;
+		save_blues_settings();
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the position deadband and the number of suppressed uplinks
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_deadband(void)
+{
+	s_deadband_stats *stats = deadband_stats();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d:%ld:%ld", g_blues_settings.deadband, g_blues_settings.keepalive,
+			 (long)stats->suppressed, (long)stats->bytes_saved);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Set the uplink payload format
+ *
+ * @param str 0 = Cayenne LPP, 1 = compact
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the format is unknown
+ */
+static int at_set_payload_format(char *str)
+{
+	if (((str[0] != '0') && (str[0] != '1')) || (str[1] != 0))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	uint8_t new_format = str[0] - '0';
+	if (new_format != g_blues_settings.payload_format)
+	{
+		g_blues_settings.payload_format = new_format;
+		g_solution_data.setFormat(new_format);
+		save_blues_settings();
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the uplink payload format
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_payload_format(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_blues_settings.payload_format);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Set the number of fixes sent together while moving
+ *
+ * @param str number of fixes, 0 or 1 sends every fix
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the number is out of range
+ */
+static int at_set_track(char *str)
+{
+	long new_fixes = strtol(str, NULL, 0);
+	if ((new_fixes < 0) || (new_fixes > PAYLOAD_TRACK_MAX))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	if (new_fixes != g_blues_settings.track_fixes)
+	{
+		g_blues_settings.track_fixes = new_fixes;
+		save_blues_settings();
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the number of fixes per track, the fixes held back and the tracks sent
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_track(void)
+{
+	s_track_stats *stats = track_stats();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%ld:%ld", g_blues_settings.track_fixes, (long)stats->held, (long)stats->tracks);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the state of the link model
+ * 		ACK ratio, SNR, cellular success ratio, expected energy of both paths and how often each was chosen
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_link(void)
+{
+	s_link_stats *stats = link_stats();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%s%d.%d:%d:%ld:%ld:%ld:%ld", stats->lora_ack, stats->snr_x10 < 0 ? "-" : "",
+			 abs(stats->snr_x10) / 10, abs(stats->snr_x10) % 10,
+			 stats->cell_ok, (long)stats->lora_mj, (long)stats->cell_mj, (long)stats->lora_chosen, (long)stats->cell_chosen);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Show the time in each energy state since boot and over all boots
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_energy_stats(void)
+{
+	s_energy_stats *stats = energy_stats();
+	REQ_PRINTF("boots: %d, uptime %lds, total %lds", stats->boots, (long)stats->uptime_s, (long)stats->total_uptime_s);
+	for (uint8_t state = 0; state < ENERGY_NUM; state++)
+	{
+		REQ_PRINTF("%s: boot %ldms, total %lds", energy_state_name(state), (long)stats->boot_ms[state], (long)stats->total_s[state]);
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the totals of the energy states in seconds
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_energy(void)
+{
+	s_energy_stats *stats = energy_stats();
+	int len = snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%ld", stats->boots, (long)stats->total_uptime_s);
+	for (uint8_t state = 0; (state < ENERGY_NUM) && (len < ATQUERY_SIZE); state++)
+	{
+		len += snprintf(&g_at_query_buf[len], ATQUERY_SIZE - len, ":%ld", (long)stats->total_s[state]);
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Clear the energy counters
+ *
+ * @param str 0 to clear the counters
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if params error
+ */
+static int at_set_energy(char *str)
+{
+	if (str[0] != '0')
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	energy_clear();
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Set the interval of the diagnostic uplink with the energy counters
+ *
+ * @param str interval in hours, 0 = off
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the interval is out of range
+ */
+static int at_set_diag(char *str)
+{
+	long new_interval = strtol(str, NULL, 0);
+	if ((new_interval < 0) || (new_interval > 255))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	if (new_interval != g_blues_settings.diag_interval)
+	{
+		g_blues_settings.diag_interval = new_interval;
+		save_blues_settings();
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the interval of the diagnostic uplink
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_diag(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", g_blues_settings.diag_interval);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Set the interval of the BME680 samples between the uplinks
+ *
+ * @param str interval in seconds, 0 = off
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the interval is out of range
+ */
+static int at_set_env(char *str)
+{
+	long new_interval = strtol(str, NULL, 0);
+	if ((new_interval < 0) || (new_interval > 3600) || ((new_interval != 0) && (new_interval < 10)))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	if (new_interval != g_blues_settings.env_interval)
+	{
+		g_blues_settings.env_interval = new_interval;
+		save_blues_settings();
+		rak1906_schedule();
+	}
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the interval of the BME680 samples and the number of samples
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_env(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%ld:%ld", g_blues_settings.env_interval, (long)rak1906_stats()->samples,
+			 (long)rak1906_stats()->dropped);
+	return AT_SUCCESS;
+}
+
+#if MY_DEBUG > 0
+/**
+ * @brief Select text or binary output of the debug log
+ *
+ * @param str 0 = text, 1 = binary records for native/log_decode.py
+ * @return int
+ * 			AT_SUCCESS is params are set correct
+ * 			AT_ERRNO_PARA_VAL if the mode is unknown
+ */
+static int at_set_log(char *str)
+{
+	if (((str[0] != '0') && (str[0] != '1')) || (str[1] != 0))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	log_ring_set_mode(str[0] == '1' ? LOG_MODE_BINARY : LOG_MODE_TEXT);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Get the output mode and the counters of the debug log
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_log(void)
+{
+	s_log_stats *stats = log_ring_stats();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%lu:%lu:%lu", log_ring_get_mode(), (unsigned long)stats->records,
+			 (unsigned long)stats->dropped, (unsigned long)stats->max_used);
+	return AT_SUCCESS;
+}
+#endif
+
+/**
+ * @brief Get the motion state and the send interval in seconds used for it
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_motion_state(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%s:%ld", motion_state_name(), (long)(motion_state_interval() / 1000));
+	return AT_SUCCESS;
+}
+
 /**
  * @brief List of all available commands with short help and pointer to functions
  *
@@ -630,6 +1416,7 @@ atcmd_t g_user_at_cmd_new_list[] = {
 	{"+BUID", "Set/get the Blues product UID", at_query_blues_prod_uid, at_set_blues_prod_uid, NULL, "RW"},
 	{"+BSIM", "Set/get Blues SIM settings", at_query_blues_sim_set, at_set_blues_sim_set, NULL, "RW"},
 	{"+BMOD", "Set/get Blues NoteCard connection modes", at_query_blues_mode, at_set_blues_mode, NULL, "RW"},
+	{"+BSYNC", "Set/get NoteHub sync count:age:priority", at_query_blues_sync, at_set_blues_sync, NULL, "RW"},
 	{"+BTRIG", "Set/get Blues send trigger", at_query_blues_trigger, at_set_blues_trigger, NULL, "RW"},
 	{"+BR", "Remove all Blues Settings", NULL, NULL, at_reset_blues_settings, "W"},
 	{"+BLUES", "Blues Notecard Status", at_blues_status, NULL, NULL, "R"},
@@ -638,6 +1425,28 @@ atcmd_t g_user_at_cmd_new_list[] = {
 	{"+BLE", "Switch on BLE advertising", NULL, NULL, at_ble_on, "W"},
 	{"+BIMSI", "Read internal IMSI", at_query_blues_imsi, NULL, NULL, "R"},
 	{"+BSTATUS", "Blues settings", NULL, NULL, at_blues_report_status, "W"},
+	{"+BCAP", "Set/get NoteCard request capture", at_query_blues_capture, at_set_blues_capture, NULL, "RW"},
+	{"+BCAPX", "Export NoteCard request capture", NULL, NULL, at_blues_capture_export, "W"},
+	{"+BRETRY", "Show NoteCard request retry counters", NULL, NULL, at_blues_retry_stats, "W"},
+	{"+BPERF", "Show/get/clear NoteCard request time and size histograms", at_query_blues_perf, at_set_blues_perf, at_blues_perf, "RW"},
+	{"+BEVT", "Show/get/clear wake-up event counters posted:merged:handled", at_query_app_events, at_set_app_events, at_app_events, "RW"},
+	{"+BBOOT", "Show/get boot phases app:blues:join:uplink ms", at_query_boot_profile, NULL, at_boot_profile, "RW"},
+	{"+BWORK", "Get/clear NoteCard worker depth:max:jobs:inline:wait:run:max ms", at_query_blues_worker, at_set_blues_worker, NULL, "RW"},
+	{"+BSTORE", "Get settings store requests:writes:unchanged:seq:size", at_query_settings_store, NULL, NULL, "R"},
+	{"+BBME", "Get BME680 readings:early:timeouts:saved ms:wait ms", at_query_rak1906, NULL, NULL, "R"},
+	{"+BCFG", "Get NoteCard config warm:reconciled:live:skipped, 0 to forget", at_query_blues_config, at_set_blues_config, NULL, "RW"},
+	{"+BQUEUE", "Get/clear queued uplinks", at_query_uplink_queue, at_set_uplink_queue, NULL, "RW"},
+	{"+BMOTION", "Get motion state and send interval", at_query_motion_state, NULL, NULL, "R"},
+	{"+BDEAD", "Set/get position deadband meters:keep-alive", at_query_deadband, at_set_deadband, NULL, "RW"},
+	{"+BFMT", "Set/get uplink payload format 0 = LPP, 1 = compact", at_query_payload_format, at_set_payload_format, NULL, "RW"},
+	{"+BTRACK", "Set/get fixes per uplink while moving", at_query_track, at_set_track, NULL, "RW"},
+	{"+BLINK", "Get link model ACK%:SNR:cell%:LoRa mJ:cell mJ:LoRa:cell", at_query_link, NULL, NULL, "R"},
+	{"+BENERGY", "Show/get/clear time in the energy states", at_query_energy, at_set_energy, at_energy_stats, "RW"},
+	{"+BDIAG", "Set/get diagnostic uplink interval in hours", at_query_diag, at_set_diag, NULL, "RW"},
+	{"+BENV", "Set/get BME680 sample interval in seconds, 0 = off", at_query_env, at_set_env, NULL, "RW"},
+#if MY_DEBUG > 0
+	{"+BLOG", "Set/get log mode 0 = text, 1 = binary, mode:records:dropped:max used", at_query_log, at_set_log, NULL, "RW"},
+#endif
 };
 
 /** Number of user defined AT commands */